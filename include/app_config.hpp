@@ -15,4 +15,28 @@ struct AppConfig {
 	int width         = 1200;
 	int height        = 800;
 	std::string title = "Fluid Simulation";
+
+	size_t benchmarkParticles = 0;   // run the headless solver benchmark instead of the app
+	uint32_t benchmarkSteps   = 100;
+	size_t openDomainBenchmarkParticles = 0; // unbounded SPH leaving the box, compact hash memory against a dense grid
+	int distributedCheckRanks = 0;   // fork this many SPH ranks per transport and check particle conservation
+	uint32_t distributedCheckSteps = 100;
+	size_t vortexBenchmarkParticles = 0; // FMM accuracy versus time, orders 1..vortexBenchmarkOrder
+	uint32_t vortexBenchmarkOrder   = 8;
+	int pressureBenchmarkResolution = 0; // cells per axis of the pressure solver benchmark
+	int advectionBenchmarkResolution = 0; // cells per axis of the rotating sphere advection benchmark
+	int marchingCubesBenchmarkResolution = 0; // cells per axis of the surface extraction benchmark
+	int lbmBenchmarkResolution = 0;   // cells across the channel of the lattice Boltzmann benchmark, BGK and MRT
+	uint32_t lbmBenchmarkSteps = 20;
+	size_t gpuSphCheckParticles = 0;  // compare the GPU SPH step with the CPU solver on a headless device
+	uint32_t gpuSphCheckSteps   = 20;
+	size_t gpuSortCheckElements = 0;  // GPU radix sort and scan correctness and throughput
+	int gpuMarchingCubesCheckResolution = 0; // GPU marching cubes against the CPU extraction, cells per axis
+	size_t streamBenchmarkParticles = 0; // per frame instance uploads, staging buffer against streaming ring
+	size_t deltaUploadBenchmarkParticles = 0; // bytes uploaded per frame when only changed blocks are copied
+	size_t simulationParticles  = 0;  // particles of the GPU dam break simulated alongside rendering
+	size_t cpuSimulationParticles = 0; // or of the same dam break on the CPU, streamed to the renderer
+	bool fluidSurface           = false; // draw them as a screen-space liquid surface instead of spheres
+	int meshSurfaceResolution   = 0;  // or as a GPU marching cubes mesh with this many cells per axis
+	int shallowWaterResolution  = 0;  // cells per axis of a shallow water basin on the CPU, drawn as a mesh instead of particles
 };
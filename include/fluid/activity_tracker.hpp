@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "scene/particle.hpp"
+#include "fluid/neighbor_grid.hpp"
+
+struct SleepParams {
+	bool enabled                 = true;
+	float velocityThreshold      = 0.05f;  // m/s, above the g * dt jitter of wall contacts
+	float densityChangeThreshold = 0.001f; // relative to rest density, per step
+	uint32_t quietStepsToSleep   = 30;
+};
+
+/*
+ * Tracks fluid activity per neighbour grid cell. A cell falls asleep once all
+ * of its particles stayed below the velocity and density-change thresholds for
+ * quietStepsToSleep steps and none of its neighbour cells is active. Sleeping
+ * cells are skipped by the solver until a neighbour moves again.
+ *
+ * The state is stored per particle so it survives grids whose cell indices
+ * change between builds, like CompactHashGrid.
+ */
+class ActivityTracker {
+public:
+	template<typename Grid, int Dim>
+	void update(const SleepParams& params,
+		const Grid& grid,
+		const std::vector<BasicParticle<Dim>>& particles,
+		float restDensity);
+
+	bool isCellAwake(std::span<const uint32_t> cellParticles) const
+	{
+		for (uint32_t i : cellParticles)
+			if (i >= asleep.size() || !asleep[i]) return true;
+		return cellParticles.empty();
+	}
+
+	/* Forgets all state, for particles that were reordered or replaced. */
+	void reset();
+
+	uint32_t sleepingCellCount() const { return sleepingCells; }
+	uint32_t sleepingParticleCount() const { return sleepingParticles; }
+
+private:
+	std::vector<uint32_t> quietSteps;
+	std::vector<uint8_t> asleep;
+	std::vector<float> lastDensity;
+
+	uint32_t sleepingCells = 0;
+	uint32_t sleepingParticles = 0;
+};
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct BenchmarkResult {
+	std::string solver;
+	size_t particles   = 0;
+	uint32_t steps     = 0;
+	double msPerStep   = 0.0;
+	double timeStep    = 0.0;
+	double simulatedPerSecond = 0.0; // simulated seconds per wall clock second
+};
+
+/*
+ * Runs the same dam break, a cube of roughly particleCount particles in the
+ * unit box, with every particle solver and reports the cost per step. The
+ * 2D SPH preview runs a square cross-section of the cube, and once more
+ * with a square of as many particles as the cube.
+ */
+std::vector<BenchmarkResult> runSolverBenchmark(size_t particleCount, uint32_t steps);
+void printBenchmark(const std::vector<BenchmarkResult>& results, std::ostream& out);
+
+struct OpenDomainBenchmarkResult {
+	uint32_t step        = 0;
+	size_t outside       = 0;   // particles outside the unit box
+	float extent         = 0.f; // longest side of the particles' bounding box
+	size_t occupiedCells = 0;
+	size_t denseCells    = 0;   // cells of a dense grid covering the bounding box
+	size_t hashBytes     = 0;   // held by the compact hash grid
+	size_t denseBytes    = 0;   // a dense grid over the bounding box would need
+};
+
+/*
+ * Unbounded SPH on the compact hash grid: a block of particleCount
+ * particles in the unit box expands radially without gravity and leaves
+ * the box. Reports the grid memory against a dense grid over the same
+ * particles, four times over the run.
+ */
+std::vector<OpenDomainBenchmarkResult> runOpenDomainBenchmark(size_t particleCount, uint32_t steps);
+void printOpenDomainBenchmark(const std::vector<OpenDomainBenchmarkResult>& results, std::ostream& out);
+
+struct DistributedCheckResult {
+	std::string transport;
+	int ranks           = 0;
+	size_t particles    = 0;
+	uint32_t steps      = 0;
+	size_t misplaced    = 0;   // particles outside their rank's slab after the initial migration
+	size_t lost         = 0;   // largest difference between the owned particles of all ranks and the initial count
+	uint32_t rebalances = 0;   // steps after which the slab boundaries had moved
+	double imbalance    = 0.0; // max / mean owned particles after the last step
+	double msPerStep    = 0.0; // of the slowest rank
+	bool passed         = false;
+};
+
+/*
+ * Forks one process per rank for each transport, every rank runs a
+ * DistributedSphSolver on its slab of a dam break that starts in one
+ * corner, so the first rebalance moves most particles. The owned
+ * particles of all ranks must add up to the initial count after every
+ * step. Call it before this process starts the thread pool, forked
+ * children only keep the calling thread.
+ */
+std::vector<DistributedCheckResult> runDistributedCheck(int ranks, uint32_t steps, size_t particleCount = 8000);
+void printDistributedCheck(const std::vector<DistributedCheckResult>& results, std::ostream& out);
+
+struct VortexBenchmarkResult {
+	std::string method;
+	uint32_t order       = 0;   // 0 for direct summation
+	double seconds       = 0.0; // per evaluation
+	double velocityError = 0.0; // relative L2 error against direct summation
+	double gradientError = 0.0;
+};
+
+/*
+ * Accuracy versus time of the vortex FMM for expansion orders 1..maxOrder on
+ * particleCount random vortex particles in the unit cube. Errors are measured
+ * on a random sample of targets; the direct time is extrapolated from it.
+ */
+std::vector<VortexBenchmarkResult> runVortexBenchmark(size_t particleCount, uint32_t maxOrder, size_t sampleTargets = 1000);
+void printVortexBenchmark(const std::vector<VortexBenchmarkResult>& results, std::ostream& out);
+
+struct PressureBenchmarkResult {
+	std::string solver;
+	size_t cells        = 0;
+	uint32_t iterations = 0;
+	double msPerSolve   = 0.0;
+	double residual     = 0.0; // final residual relative to the right-hand side
+	double msToTarget   = -1.0; // time until the residual first dropped below pressureBenchmarkTarget, -1 if never
+};
+
+constexpr double pressureBenchmarkTarget = 1e-4;
+
+/*
+ * Solves a random right-hand side on resolution^3 cells: the spectral
+ * solver on a periodic box; multigrid, PCG, plain CG and Jacobi on a
+ * closed box open at the top. Not the same system, but the same cell
+ * count, as a throughput reference between the solvers. Jacobi stops at
+ * its iteration budget long before the tolerance.
+ */
+std::vector<PressureBenchmarkResult> runPressureBenchmark(int resolution);
+void printPressureBenchmark(const std::vector<PressureBenchmarkResult>& results, std::ostream& out);
+
+struct AdvectionBenchmarkResult {
+	std::string scheme;
+	int resolution    = 0;
+	uint32_t steps    = 0;
+	double msPerStep  = 0.0; // advection of velocity and density
+	double error      = 0.0; // L1 density error after one revolution, relative to the initial mass
+	double peak       = 0.0; // maximum density left of an initial 1
+};
+
+/*
+ * Rotates a sharp smoke sphere once around the grid centre with every
+ * advection scheme, at resolution and at half of it, to weigh higher order
+ * advection against first order at higher resolution.
+ */
+std::vector<AdvectionBenchmarkResult> runAdvectionBenchmark(int resolution);
+void printAdvectionBenchmark(const std::vector<AdvectionBenchmarkResult>& results, std::ostream& out);
+
+struct MarchingCubesBenchmarkResult {
+	int resolution       = 0;
+	size_t particles     = 0;
+	size_t triangles     = 0;
+	double splatMs       = 0.0;
+	double extractMs     = 0.0; // every block
+	double incrementalMs = 0.0; // after a few particles moved
+	size_t rebuiltBlocks = 0;
+	size_t blocks        = 0;
+};
+
+/*
+ * Splats a dam break block into resolution^3 cells and extracts its
+ * surface, then moves a handful of particles in one corner and extracts
+ * again to show the cost of an incremental update.
+ */
+std::vector<MarchingCubesBenchmarkResult> runMarchingCubesBenchmark(int resolution);
+void printMarchingCubesBenchmark(const std::vector<MarchingCubesBenchmarkResult>& results, std::ostream& out);
+
+struct LbmBenchmarkResult {
+	std::string solver;
+	size_t cells      = 0; // fluid and equilibrium cells updated per step
+	uint32_t steps    = 0;
+	double msPerStep  = 0.0;
+	double mlups      = 0.0; // million lattice updates per second over all steps
+};
+
+/*
+ * Channel flow through a 2 * resolution x resolution x resolution lattice
+ * with the BGK and the MRT collision. Runs an even number of steps, so the
+ * in-place and the neighbour phase of the AA pattern count equally.
+ */
+std::vector<LbmBenchmarkResult> runLbmBenchmark(int resolution, uint32_t steps);
+void printLbmBenchmark(const std::vector<LbmBenchmarkResult>& results, std::ostream& out);
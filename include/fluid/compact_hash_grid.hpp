@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "scene/particle.hpp"
+
+/*
+ * Compact hashing (Ihmsen et al. 2011) for unbounded domains. Only occupied
+ * cells exist: a fixed-size hash table maps a cell coordinate to a range of
+ * the compact cell array, which is sorted by hash. Memory is proportional
+ * to the particle count, not to the domain volume.
+ *
+ * The query API matches BasicNeighborGrid, with cell handles instead of
+ * dense cell indices. Handles are only valid until the next build().
+ */
+template<int Dim>
+class BasicCompactHashGrid {
+public:
+	using Vec = glm::vec<Dim, float>;
+	using IVec = glm::vec<Dim, int>;
+
+	static constexpr uint32_t InvalidCell = UINT32_MAX;
+
+	BasicCompactHashGrid() = default;
+	/* tableSize 0 sizes the table to twice the particle count on the first build. */
+	BasicCompactHashGrid(Vec origin, float cellSize, uint32_t tableSize = 0);
+
+	void build(const std::vector<BasicParticle<Dim>>& particles);
+
+	IVec cellCoord(const Vec& position) const;
+	uint32_t findCell(const IVec& coord) const;
+	uint32_t cellCount() const { return static_cast<uint32_t>(cells.size()); }
+	uint32_t cellOf(uint32_t particle) const { return particleCell[particle]; }
+	uint32_t tableSize() const { return static_cast<uint32_t>(bucketStart.size()) - 1; }
+	size_t memoryBytes() const;
+
+	std::span<const uint32_t> cellParticles(uint32_t cell) const
+	{
+		return { particleIndices.data() + cells[cell].start, cells[cell].count };
+	}
+
+	template<typename F>
+	void forEachNeighborCell(uint32_t cell, F&& fn) const
+	{
+		forEachStencilCell(unpack(cells[cell].key), fn);
+	}
+
+	template<typename F>
+	void forEachNeighbor(const Vec& position, F&& fn) const
+	{
+		forEachStencilCell(cellCoord(position), [&](uint32_t neighbor) {
+			for (uint32_t j : cellParticles(neighbor)) fn(j);
+		});
+	}
+
+private:
+	struct Cell {
+		uint64_t key;
+		uint32_t start;
+		uint32_t count;
+	};
+
+	/* Calls fn(cell) for every occupied cell of the 3x3(x3) block around c. */
+	template<typename F>
+	void forEachStencilCell(const IVec& c, F&& fn) const
+	{
+		if constexpr (Dim == 2) {
+			for (int y = c.y - 1; y <= c.y + 1; y++) {
+				for (int x = c.x - 1; x <= c.x + 1; x++) {
+					uint32_t neighbor = findCell({ x, y });
+					if (neighbor != InvalidCell) fn(neighbor);
+				}
+			}
+		}
+		else {
+			for (int z = c.z - 1; z <= c.z + 1; z++) {
+				for (int y = c.y - 1; y <= c.y + 1; y++) {
+					for (int x = c.x - 1; x <= c.x + 1; x++) {
+						uint32_t neighbor = findCell({ x, y, z });
+						if (neighbor != InvalidCell) fn(neighbor);
+					}
+				}
+			}
+		}
+	}
+
+	static uint64_t pack(const IVec& coord);
+	static IVec unpack(uint64_t key);
+	uint32_t hash(const IVec& coord) const;
+
+	Vec origin { 0.f };
+	float invCellSize = 1.f;
+
+	std::vector<uint32_t> bucketStart { 0, 0 }; // compact cell range per hash bucket
+	std::vector<Cell> cells;                   // occupied cells, sorted by hash
+	std::vector<uint32_t> particleIndices;
+	std::vector<uint32_t> particleCell;
+};
+
+using CompactHashGrid = BasicCompactHashGrid<3>;
+using CompactHashGrid2D = BasicCompactHashGrid<2>;
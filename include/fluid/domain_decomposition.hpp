@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "scene/particle.hpp"
+#include "fluid/halo_transport.hpp"
+#include "fluid/sph_solver.hpp"
+
+struct DecompositionParams {
+	int axis                   = 0;
+	float haloWidth            = 0.f;   // 0 uses two smoothing radii, the least exchangeHalo() needs
+	uint32_t rebalanceInterval = 100;   // steps, 0 disables rebalancing
+	float imbalanceTolerance   = 0.1f;  // rebalance once max / mean particle count exceeds 1 + tolerance
+	uint32_t histogramBins     = 1024;
+};
+
+/*
+ * Splits the simulation box into one slab per rank along params.axis. All
+ * operations are collective: every rank of the transport must call them in
+ * the same order.
+ */
+class DomainDecomposition {
+public:
+	DomainDecomposition(HaloTransport& transport, const DecompositionParams& params,
+		glm::vec3 boundsMin, glm::vec3 boundsMax);
+
+	int ownerOf(const glm::vec3& position) const;
+	const std::vector<float>& getBoundaries() const { return boundaries; }
+
+	/* Sends particles that left this rank's slab to their new owner. */
+	void migrate(std::vector<Particle>& owned);
+
+	/*
+	 * Returns copies of the particles of other ranks that lie within haloWidth
+	 * of this slab. With a halo of 2h the ghosts' own densities can be computed
+	 * locally for every ghost an owned particle interacts with, so one exchange
+	 * per step is enough.
+	 */
+	std::vector<Particle> exchangeHalo(const std::vector<Particle>& owned);
+
+	/* Moves slab boundaries to equalize particle counts, returns true if they changed. */
+	bool rebalance(std::vector<Particle>& owned);
+
+private:
+	std::vector<Particle> exchange(const std::vector<std::vector<Particle>>& outgoing);
+	std::vector<uint32_t> allGather(const std::vector<uint32_t>& values);
+
+	HaloTransport& transport;
+	DecompositionParams params;
+	float domainMin = 0.f;
+	float domainMax = 1.f;
+	std::vector<float> boundaries;
+};
+
+/*
+ * Runs one SphSolver per process on its slab of the domain. Migration
+ * reorders the owned particles every step, so sleeping is disabled here;
+ * the activity state is kept per index and would not follow the particles.
+ */
+class DistributedSphSolver : public FluidSolver {
+public:
+	DistributedSphSolver(HaloTransport& transport, const SphParams& sphParams, DecompositionParams decompositionParams);
+
+	/* Collective, every rank may pass any subset of the initial particles. */
+	void addParticles(std::vector<Particle> particles);
+
+	void step() override;
+	float getTimeStep() const override { return solver.getTimeStep(); }
+	const char* getName() const override { return "Distributed SPH"; }
+
+	std::span<const Particle> getParticles() const { return solver.getParticles(); }
+	const DomainDecomposition& getDecomposition() const { return decomposition; }
+
+private:
+	SphSolver solver;
+	DomainDecomposition decomposition;
+	DecompositionParams params;
+	uint64_t stepCount = 0;
+};
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/*
+ * Mixed-radix Stockham FFT of one length, any size (hand written radix 4
+ * and 2 butterflies, plain DFT butterflies for other factors). It
+ * transforms Lanes sequences at once, stored interleaved (element e of
+ * lane l at e * Lanes + l), so every butterfly loop runs over the lanes
+ * and vectorizes regardless of the stage stride.
+ */
+class FftPlan {
+public:
+	static constexpr size_t Lanes = 8;
+
+	explicit FftPlan(size_t n);
+
+	size_t size() const { return n; }
+
+	/* In place, unnormalized. re, im and both scratch arrays hold size() * Lanes floats. */
+	void transform(float* re, float* im, float* scratchRe, float* scratchIm, bool inverse) const;
+
+private:
+	struct Stage {
+		size_t radix = 1;
+		size_t m = 1;               // remaining length / radix
+		size_t stride = 1;
+		std::vector<float> twiddleRe; // m * radix, exp(-2 pi i p k / (m * radix))
+		std::vector<float> twiddleIm;
+	};
+
+	size_t n = 1;
+	std::vector<Stage> stages;
+};
+
+/*
+ * 3D complex FFT of a field stored x fastest, in place and unnormalized.
+ * Each axis is transformed in batches of FftPlan::Lanes pencils, batches
+ * spread over the thread pool.
+ */
+class Fft3d {
+public:
+	explicit Fft3d(glm::ivec3 dims);
+
+	glm::ivec3 getDims() const { return dims; }
+	void transform(std::vector<float>& re, std::vector<float>& im, bool inverse) const;
+
+private:
+	void transformAxis(int axis, float* re, float* im, bool inverse) const;
+
+	glm::ivec3 dims;
+	FftPlan plans[3];
+};
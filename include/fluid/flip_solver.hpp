@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <memory>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "fluid/fluid_solver.hpp"
+#include "fluid/level_set.hpp"
+#include "fluid/mac_grid.hpp"
+#include "fluid/pcg_solver.hpp"
+
+enum class TransferMode {
+	FlipPic, // FLIP blended with PIC by flipRatio
+	Apic     // affine particle-in-cell (Jiang et al. 2015)
+};
+
+struct HybridParams {
+	glm::ivec3 resolution { 64 };
+	float cellSize = 1.f / 64.f;
+	glm::vec3 origin { 0.f };
+
+	float timeStep     = 1.f / 120.f;
+	glm::vec3 gravity  { 0.f, -9.81f, 0.f };
+	TransferMode mode  = TransferMode::FlipPic;
+	float flipRatio    = 0.95f; // 1 is pure FLIP, 0 pure PIC
+	int particlesPerAxis = 2;   // seeding density per cell and axis
+	int blockSize      = 4;     // cells per axis of one P2G block, at least 2
+	bool levelSetCells = true;  // fluid cells from the particles' level set, false marks every occupied cell
+};
+
+struct HybridParticle {
+	glm::vec3 position { 0.f };
+	glm::vec3 velocity { 0.f };
+	glm::vec3 affine[3] { glm::vec3(0.f), glm::vec3(0.f), glm::vec3(0.f) }; // APIC velocity gradient, one row per component
+};
+
+/*
+ * FLIP / PIC / APIC solver: particles carry the velocity, the MAC grid is
+ * only used to make it divergence free. The particle to grid scatter runs
+ * without atomics: particles are sorted by cell and the grid is split into
+ * blocks colored by the parity of their coordinates. A particle only writes
+ * to faces within one cell of its own, so blocks of one color never touch
+ * the same face and are processed in parallel, one color after the other.
+ */
+class HybridSolver : public FluidSolver {
+public:
+	explicit HybridSolver(const HybridParams& params,
+		std::unique_ptr<PressureSolver> pressureSolver = std::make_unique<PcgPressureSolver>());
+
+	/* Seeds particlesPerAxis^3 jittered particles in every non-solid cell inside the box. */
+	void addFluidBox(glm::vec3 boxMin, glm::vec3 boxMax, glm::vec3 velocity = glm::vec3(0.f));
+	void addSolidMesh(std::span<const glm::vec3> positions, std::span<const uint32_t> indices);
+
+	void setPressureSolver(std::unique_ptr<PressureSolver> solver) { pressureSolver = std::move(solver); }
+	PressureSolver& getPressureSolver() { return *pressureSolver; }
+
+	void step() override;
+	float getTimeStep() const override { return params.timeStep; }
+	const char* getName() const override { return params.mode == TransferMode::Apic ? "APIC" : "FLIP"; }
+
+	std::span<const HybridParticle> getParticles() const { return particles; }
+	const MacGrid& getGrid() const { return grid; }
+	const NarrowBandLevelSet& getLevelSet() const { return levelSet; }
+	HybridParams& getParams() { return params; }
+
+private:
+	void sortParticles();
+	void particlesToGrid();
+	void markCells();
+	void extrapolateVelocity(int layers);
+	void gridToParticles();
+	void advectParticles();
+
+	size_t cellOf(const glm::vec3& position) const;
+
+	HybridParams params;
+	MacGrid grid;
+	std::unique_ptr<PressureSolver> pressureSolver;
+	std::vector<CellType> solidMask; // Solid or Air, the static part of grid.cellType
+	NarrowBandLevelSet levelSet;
+	std::vector<glm::vec3> positions;
+
+	std::vector<HybridParticle> particles;
+	std::vector<HybridParticle> sorted;
+	std::vector<uint32_t> cellStart;  // cellCount + 1 offsets into the sorted particles
+
+	std::vector<float> uWeight, vWeight, wWeight;
+	std::vector<float> uOld, vOld, wOld;
+	std::vector<float> rhs;
+};
@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+/* Common interface of the simulation engines, particle or grid based. */
+class FluidSolver {
+public:
+	virtual ~FluidSolver() = default;
+
+	virtual void step() = 0;
+	virtual float getTimeStep() const = 0;
+	virtual const char* getName() const = 0;
+};
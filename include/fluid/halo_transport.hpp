@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+enum class TransportKind {
+	SharedMemory,
+	UnixSocket
+};
+
+/*
+ * Message passing between the solver processes of one machine. Messages are
+ * length-prefixed byte blobs. send() only queues, receive() blocks and keeps
+ * pushing queued sends while it waits, so symmetric exchanges cannot
+ * deadlock on full socket buffers or rings.
+ */
+class HaloTransport {
+public:
+	virtual ~HaloTransport() = default;
+
+	int rank() const { return rankIndex; }
+	int size() const { return rankCount; }
+
+	void send(int peer, std::vector<std::byte> message);
+	std::vector<std::byte> receive(int peer);
+	void flush();
+
+protected:
+	HaloTransport(int rank, int size);
+
+	/* Non-blocking primitives, return the number of bytes moved (possibly 0). */
+	virtual size_t writeSome(int peer, std::span<const std::byte> data) = 0;
+	virtual size_t readSome(int peer, std::span<std::byte> data) = 0;
+
+private:
+	struct Outgoing {
+		std::vector<std::byte> data;
+		size_t offset = 0;
+	};
+
+	bool pumpSends();
+	void readExactly(int peer, std::span<std::byte> data);
+
+	int rankIndex = 0;
+	int rankCount = 1;
+	std::vector<std::deque<Outgoing>> outgoing;
+};
+
+/* Full mesh of Unix domain stream sockets under one directory. */
+class UnixSocketTransport : public HaloTransport {
+public:
+	UnixSocketTransport(int rank, int size, const std::filesystem::path& directory);
+	~UnixSocketTransport() override;
+
+protected:
+	size_t writeSome(int peer, std::span<const std::byte> data) override;
+	size_t readSome(int peer, std::span<std::byte> data) override;
+
+private:
+	std::filesystem::path socketPath;
+	std::vector<int> sockets;
+};
+
+/* One POSIX shared memory segment, created by rank 0, holding a single-producer ring per rank pair. */
+class SharedMemoryTransport : public HaloTransport {
+public:
+	SharedMemoryTransport(int rank, int size, const std::string& name, size_t ringBytes = 8u << 20);
+	~SharedMemoryTransport() override;
+
+protected:
+	size_t writeSome(int peer, std::span<const std::byte> data) override;
+	size_t readSome(int peer, std::span<std::byte> data) override;
+
+private:
+	struct Ring;
+	Ring* ring(int from, int to) const;
+
+	std::string segmentName;
+	size_t ringBytes = 0;
+	size_t segmentBytes = 0;
+	std::byte* segment = nullptr;
+};
+
+std::unique_ptr<HaloTransport> createTransport(TransportKind kind, int rank, int size, const std::string& name);
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "fluid/mac_grid.hpp"
+#include "fluid/sparse_grid.hpp"
+
+struct LevelSetParams {
+	float cellSize          = 1.f / 64.f;
+	glm::vec3 origin        { 0.f };
+	int bandWidth           = 3;     // voxels kept on each side of the interface
+	uint32_t maxSweepPasses = 16;
+	float tolerance         = 1e-3f; // in cells, stops the sweeps once no distance changes more
+};
+
+/*
+ * Signed distance to the liquid surface, negative inside, stored only in a
+ * band of bandWidth voxels around the interface on a SparseTopology.
+ * Blocks without band voxels lie entirely on one side; the ones inside the
+ * liquid are remembered as interior tiles without values, so the sign is
+ * known everywhere and memory grows with the surface area, not the volume.
+ * Beyond the band values are clamped to +-bandWidth cells.
+ */
+class NarrowBandLevelSet {
+public:
+	explicit NarrowBandLevelSet(const LevelSetParams& params = {});
+
+	/* Union of spheres around the particles, then redistanced, e.g. from FLIP particles. */
+	void buildFromParticles(std::span<const glm::vec3> positions, float radius);
+
+	/* Semi-Lagrangian advection of the band through the grid's velocity, followed by updateBand(). */
+	void advect(const MacGrid& grid, float dt);
+
+	/*
+	 * Grows the band by one voxel layer where the interface came close to
+	 * its edge, redistances and drops voxels that left it. Only touches the
+	 * band, so the cost follows the surface as it moves.
+	 */
+	void updateBand();
+
+	/*
+	 * Parallel fast sweeping: voxels next to a sign change are fixed from a
+	 * linear estimate of the crossing, the others solve the upwind eikonal
+	 * equation in the eight sweep orders, every block on a padded tile.
+	 * Blocks exchange values between passes (block Jacobi, Gauss-Seidel
+	 * within a block), so passes run in parallel without races. Leaves
+	 * every value within +-bandWidth cells.
+	 */
+	void redistance();
+
+	float value(glm::ivec3 voxel) const;
+	float sample(glm::vec3 position) const;
+	glm::vec3 normal(glm::vec3 position) const;
+	bool isInside(glm::vec3 position) const { return sample(position) < 0.f; }
+
+	/* Non-solid cells of grid become fluid inside the surface and air outside. */
+	void markFluidCells(MacGrid& grid) const;
+
+	const SparseTopology& getBand() const { return band; }
+	size_t bandVoxelCount() const { return band.activeCount(); }
+	size_t interiorBlockCount() const { return interior.blockCount(); }
+	uint32_t getLastSweepPasses() const { return lastSweepPasses; }
+	size_t memoryBytes() const;
+
+private:
+	uint32_t touchBlock(glm::ivec3 blockCoord);
+	void trimBand();
+	float bandLimit() const { return params.bandWidth * params.cellSize; }
+
+	LevelSetParams params;
+	SparseTopology band;
+	SparseTopology interior;     // blocks entirely inside the liquid, no values
+	std::vector<float> phi;      // BlockVoxels per band block, inactive voxels hold +-bandLimit()
+	uint32_t lastSweepPasses = 0;
+};
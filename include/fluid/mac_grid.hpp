@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+enum class CellType : uint8_t {
+	Fluid,
+	Solid,
+	Air
+};
+
+/*
+ * Staggered marker-and-cell grid. u, v and w live on the x, y and z faces,
+ * scalars at cell centres. Every field is its own array with x contiguous
+ * so inner loops run over unit-stride memory.
+ */
+struct MacGrid {
+	MacGrid() = default;
+	MacGrid(glm::ivec3 dims, float cellSize, glm::vec3 origin = glm::vec3(0.f));
+
+	glm::ivec3 dims { 0 };
+	float cellSize   = 1.f;
+	glm::vec3 origin { 0.f };
+
+	std::vector<float> u;        // (nx + 1) * ny * nz
+	std::vector<float> v;        // nx * (ny + 1) * nz
+	std::vector<float> w;        // nx * ny * (nz + 1)
+	std::vector<float> pressure; // nx * ny * nz
+	std::vector<float> density;  // passive smoke density
+	std::vector<CellType> cellType;
+
+	size_t cellCount() const { return static_cast<size_t>(dims.x) * dims.y * dims.z; }
+
+	size_t cellIndex(int i, int j, int k) const { return (static_cast<size_t>(k) * dims.y + j) * dims.x + i; }
+	size_t uIndex(int i, int j, int k) const { return (static_cast<size_t>(k) * dims.y + j) * (dims.x + 1) + i; }
+	size_t vIndex(int i, int j, int k) const { return (static_cast<size_t>(k) * (dims.y + 1) + j) * dims.x + i; }
+	size_t wIndex(int i, int j, int k) const { return (static_cast<size_t>(k) * dims.y + j) * dims.x + i; }
+
+	bool isSolid(int i, int j, int k) const
+	{
+		if (i < 0 || j < 0 || k < 0 || i >= dims.x || j >= dims.y || k >= dims.z) return true;
+		return cellType[cellIndex(i, j, k)] == CellType::Solid;
+	}
+
+	/* World space position to continuous cell coordinates (cell centres at n + 0.5). */
+	glm::vec3 toGrid(const glm::vec3& position) const { return (position - origin) / cellSize; }
+
+	glm::vec3 sampleVelocity(const glm::vec3& position) const;
+	float sampleDensity(const glm::vec3& position) const;
+};
+
+/*
+ * Trilinear interpolation of a field with size samples per axis, stored x
+ * fastest. gridPos is in sample units, out of range positions are clamped.
+ */
+float sampleTrilinear(const std::vector<float>& field, glm::ivec3 size, glm::vec3 gridPos);
+
+/*
+ * Batched sampleTrilinear() at count positions given as separate x, y and
+ * z arrays. Works in groups of eight lanes: every lane computes its cell,
+ * gathers its 8 corners and blends. On x86-64 CPUs with AVX2 the groups
+ * run as AVX2 gathers selected at run time, elsewhere and for the tail as
+ * fixed-length loops left to the compiler. outMin and outMax, if given,
+ * receive the range of the corners for advection limiters.
+ */
+void sampleTrilinear(const std::vector<float>& field, glm::ivec3 size, const float* x, const float* y, const float* z,
+	float* out, size_t count, float* outMin = nullptr, float* outMax = nullptr);
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "fluid/surface_mesh.hpp"
+#include "scene/particle.hpp"
+
+class NarrowBandLevelSet;
+
+/*
+ * Triangles of every corner configuration, as cell edges in triples and -1
+ * terminated, at most five per cell. Corner c of a cell sits at
+ * (c & 1, c >> 1 & 1, c >> 2 & 1) and bit c of the configuration is set if
+ * it is inside. Edge axis * 4 + k runs along axis from corner
+ * edgeBase[axis][k] = { { 0, 2, 4, 6 }, { 0, 1, 4, 5 }, { 0, 1, 2, 3 } }.
+ */
+using MarchingCubesTable = std::array<std::array<int8_t, 16>, 256>;
+const MarchingCubesTable& marchingCubesTable();
+
+struct MarchingCubesParams {
+	glm::ivec3 resolution { 64 };   // cells per axis, the field has one more node per axis
+	glm::vec3 origin { 0.f };
+	float cellSize         = 1.f / 64.f;
+	float isoLevel         = 0.5f;  // the surface, inside where the field is larger
+	int blockSize          = 16;    // cells per block edge, the unit of parallel and incremental extraction
+	float changeThreshold  = 1e-3f; // largest node change since a block's last extraction that keeps it
+	glm::vec3 color { 0.2f, 0.45f, 0.8f };
+};
+
+/*
+ * Marching cubes over a node field in blocks. Every block keeps its own
+ * mesh and a copy of the nodes it was built from. extract() polygonizes
+ * only the blocks whose nodes moved by more than changeThreshold, in
+ * parallel, and concatenates the block meshes. Within a block, vertices
+ * on shared cell edges are welded. Vertices on a block face are duplicated,
+ * but both blocks interpolate the same edge the same way, so the seams
+ * are closed. The triangle table is built from face contours, with
+ * ambiguous faces separating the inside corners. Triangles wind
+ * counterclockwise seen from outside, and the normals follow the field
+ * gradient.
+ */
+class MarchingCubes {
+public:
+	explicit MarchingCubes(const MarchingCubesParams& params);
+
+	/*
+	 * Splats particle volume with the poly6 kernel of the given radius, so
+	 * the field is about 1 inside the fluid for particles at spacing.
+	 */
+	void splatParticles(std::span<const Particle> particles, float radius, float spacing);
+	/* Samples isoLevel - phi / cellSize, the zero level becomes the surface. */
+	void sampleLevelSet(const NarrowBandLevelSet& levelSet);
+
+	/* Re-extracts the changed blocks, returns how many were rebuilt. */
+	size_t extract();
+	/* Forces every block to be rebuilt by the next extract(). */
+	void invalidate();
+
+	const SurfaceMesh& getMesh() const { return mesh; }
+	std::vector<float>& getField() { return field; }
+	size_t getBlockCount() const { return blocks.size(); }
+	const MarchingCubesParams& getParams() const { return params; }
+
+private:
+	struct Block {
+		glm::ivec3 begin { 0 };           // first cell
+		glm::ivec3 end { 0 };             // one past the last cell
+		std::vector<float> snapshot;      // nodes at the last extraction
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<uint32_t> indices;
+		bool valid = false;
+	};
+
+	size_t nodeIndex(int i, int j, int k) const
+	{
+		return (static_cast<size_t>(k) * nodes.y + j) * nodes.x + i;
+	}
+	float node(int i, int j, int k) const { return field[nodeIndex(i, j, k)]; }
+	glm::vec3 gradient(int i, int j, int k) const;
+
+	bool changed(Block& block) const;
+	void polygonize(Block& block, std::vector<int32_t>& edgeCache) const;
+	void assemble();
+
+	MarchingCubesParams params;
+	glm::ivec3 nodes { 1 };
+	std::vector<float> field;
+	std::vector<Block> blocks;
+	SurfaceMesh mesh;
+};
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "fluid/fluid_solver.hpp"
+
+enum class MpmMaterial : uint8_t {
+	Fluid, // equation of state on J plus Newtonian viscosity
+	Snow,  // fixed corotated elasticity with clamped singular values (Stomakhin et al. 2013)
+	Sand   // Drucker-Prager plasticity on the Hencky strain (Klar et al. 2016)
+};
+
+struct MpmMaterialParams {
+	float density        = 1000.f;
+	float youngsModulus  = 1e5f;    // bulk stiffness of Fluid
+	float poissonRatio   = 0.3f;
+	float viscosity      = 0.f;     // Fluid, Pa s
+	float hardening      = 10.f;    // Snow
+	float criticalCompression = 2.5e-2f; // Snow
+	float criticalStretch     = 7.5e-3f; // Snow
+	float frictionAngle  = 30.f;    // Sand, degrees
+};
+
+struct MpmParams {
+	glm::ivec3 resolution { 64 }; // grid nodes per axis
+	float cellSize = 1.f / 64.f;
+	glm::vec3 origin { 0.f };
+
+	float timeStep    = 1e-4f;
+	glm::vec3 gravity { 0.f, -9.81f, 0.f };
+	int boundaryCells = 2;  // nodes this close to the box faces act as separating walls
+	float wallFriction = 0.5f; // Coulomb friction coefficient of the walls
+	int blockSize     = 4;  // cells per axis of one P2G block, at least 2
+
+	MpmMaterialParams materials[3];
+};
+
+struct MpmParticle {
+	glm::vec3 position { 0.f };
+	glm::vec3 velocity { 0.f };
+	glm::mat3 affine { 0.f };          // APIC velocity gradient C
+	glm::mat3 deformation { 1.f };     // elastic deformation gradient F, solids only
+	glm::mat3 stress { 0.f };          // Kirchhoff stress for the next scatter
+	float volume        = 0.f;         // rest volume
+	float volumeRatio   = 1.f;         // J, Fluid only
+	float plasticVolume = 1.f;         // Jp for Snow hardening
+	MpmMaterial material = MpmMaterial::Fluid;
+};
+
+/*
+ * Moving least squares MPM (Hu et al. 2018) with quadratic B-spline
+ * weights. Particles are sorted by the cell of their lowest stencil node
+ * and scattered block by block; blocks are colored by coordinate parity so
+ * blocks of one color never share a node and the scatter needs no atomics.
+ */
+class MpmSolver : public FluidSolver {
+public:
+	explicit MpmSolver(const MpmParams& params);
+
+	/* Fills the box with particlesPerAxis^3 particles per cell. */
+	void addBox(glm::vec3 boxMin, glm::vec3 boxMax, MpmMaterial material,
+		int particlesPerAxis = 2, glm::vec3 velocity = glm::vec3(0.f));
+
+	void step() override;
+	float getTimeStep() const override { return params.timeStep; }
+	const char* getName() const override { return "MLS-MPM"; }
+
+	std::span<const MpmParticle> getParticles() const { return particles; }
+	MpmParams& getParams() { return params; }
+
+private:
+	void sortParticles();
+	void particlesToGrid();
+	void updateGrid();
+	void gridToParticles();
+
+	size_t baseCellOf(const glm::vec3& position) const;
+	void updateStress(MpmParticle& particle) const;
+
+	MpmParams params;
+	std::vector<MpmParticle> particles;
+	std::vector<MpmParticle> sorted;
+	std::vector<uint32_t> cellStart;
+
+	std::vector<glm::vec4> nodes; // momentum and mass, velocity after updateGrid()
+};
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "scene/particle.hpp"
+
+/*
+ * Dense uniform grid over the simulation box with cell size equal to the
+ * smoothing radius. Particles are binned with a counting sort, so a cell's
+ * particles are a contiguous range of particleIndices. In 2D the neighbour
+ * stencil is the 3x3 block instead of 3x3x3.
+ */
+template<int Dim>
+class BasicNeighborGrid {
+public:
+	using Vec = glm::vec<Dim, float>;
+	using IVec = glm::vec<Dim, int>;
+
+	BasicNeighborGrid() = default;
+	BasicNeighborGrid(Vec boundsMin, Vec boundsMax, float cellSize);
+
+	void build(const std::vector<BasicParticle<Dim>>& particles);
+
+	IVec cellCoord(const Vec& position) const;
+	uint32_t cellIndex(const IVec& coord) const;
+	uint32_t cellCount() const { return static_cast<uint32_t>(cellStart.size()) - 1; }
+	size_t memoryBytes() const;
+	uint32_t cellOf(uint32_t particle) const { return particleCell[particle]; }
+
+	std::span<const uint32_t> cellParticles(uint32_t cell) const
+	{
+		return { particleIndices.data() + cellStart[cell], cellStart[cell + 1] - cellStart[cell] };
+	}
+
+	/* Calls fn(neighbourCell) for every cell of the 3x3(x3) block around cell. */
+	template<typename F>
+	void forEachNeighborCell(uint32_t cell, F&& fn) const
+	{
+		IVec c = unflatten(cell);
+		if constexpr (Dim == 2) {
+			for (int y = c.y - 1; y <= c.y + 1; y++) {
+				if (y < 0 || y >= dims.y) continue;
+				for (int x = c.x - 1; x <= c.x + 1; x++) {
+					if (x < 0 || x >= dims.x) continue;
+					fn(cellIndex({ x, y }));
+				}
+			}
+		}
+		else {
+			for (int z = c.z - 1; z <= c.z + 1; z++) {
+				if (z < 0 || z >= dims.z) continue;
+				for (int y = c.y - 1; y <= c.y + 1; y++) {
+					if (y < 0 || y >= dims.y) continue;
+					for (int x = c.x - 1; x <= c.x + 1; x++) {
+						if (x < 0 || x >= dims.x) continue;
+						fn(cellIndex({ x, y, z }));
+					}
+				}
+			}
+		}
+	}
+
+	/* Calls fn(j) for every particle j in the cells around position. */
+	template<typename F>
+	void forEachNeighbor(const Vec& position, F&& fn) const
+	{
+		forEachNeighborCell(cellIndex(cellCoord(position)), [&](uint32_t cell) {
+			for (uint32_t j : cellParticles(cell)) fn(j);
+		});
+	}
+
+private:
+	IVec unflatten(uint32_t cell) const
+	{
+		IVec c;
+		c.x = static_cast<int>(cell % dims.x);
+		c.y = static_cast<int>((cell / dims.x) % dims.y);
+		if constexpr (Dim == 3) c.z = static_cast<int>(cell / (dims.x * dims.y));
+		return c;
+	}
+
+	Vec origin { 0.f };
+	float invCellSize = 1.f;
+	IVec dims { 1 };
+
+	std::vector<uint32_t> cellStart { 0, 0 };
+	std::vector<uint32_t> particleIndices;
+	std::vector<uint32_t> particleCell;
+};
+
+using NeighborGrid = BasicNeighborGrid<3>;
+using NeighborGrid2D = BasicNeighborGrid<2>;
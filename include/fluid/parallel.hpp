@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Persistent worker threads for the solver loops. parallelFor() hands out
+ * chunks of grain iterations from a shared counter, the calling thread
+ * works along. Nested calls from inside a chunk run serially.
+ */
+class ThreadPool {
+public:
+	explicit ThreadPool(unsigned threadCount = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	static ThreadPool& global();
+
+	unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+	void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+private:
+	void workerLoop();
+	void runChunks();
+
+	std::vector<std::thread> workers;
+	std::mutex submitMutex;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	const std::function<void(size_t, size_t)>* job = nullptr;
+	size_t jobCount = 0;
+	size_t jobGrain = 1;
+	std::atomic<size_t> nextChunk { 0 };
+	unsigned busyWorkers = 0;
+	uint64_t generation = 0;
+	bool stopping = false;
+};
+
+template<typename F>
+void parallelFor(size_t count, size_t grain, F&& fn)
+{
+	ThreadPool::global().parallelFor(count, grain, std::function<void(size_t, size_t)>(std::forward<F>(fn)));
+}
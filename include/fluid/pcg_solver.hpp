@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "fluid/pressure_solver.hpp"
+
+struct PcgParams {
+	bool precondition = true;  // false runs plain conjugate gradient
+	float tuning      = 0.97f; // blend between incomplete (0) and modified (1) Cholesky
+	float safety      = 0.25f; // fall back to the plain diagonal when a pivot drops below this fraction
+};
+
+/*
+ * Conjugate gradient with a MIC(0) preconditioner (Bridson, Fluid Simulation
+ * for Computer Graphics). The factorization keeps the natural cell order;
+ * its triangular solves are level scheduled, all cells on a wavefront
+ * i + j + k = const only depend on the previous one and run in parallel.
+ */
+class PcgPressureSolver : public PressureSolver {
+public:
+	explicit PcgPressureSolver(const PressureSolverParams& params = { 200, 1e-4f }, const PcgParams& pcg = {});
+
+	void solve(const MacGrid& grid, const PoissonSystem& A,
+		const std::vector<float>& rhs, std::vector<float>& pressure) override;
+	const char* getName() const override { return pcg.precondition ? "PCG" : "CG"; }
+
+private:
+	void buildPreconditioner(const PoissonSystem& A);
+
+	/* z = M^-1 r, returns dot(r, z). */
+	double applyPreconditioner(const PoissonSystem& A, const std::vector<float>& r, std::vector<float>& z);
+
+	PcgParams pcg;
+	std::vector<float> precon;  // 1 / sqrt(e) of the factor's diagonal
+	std::vector<float> r, z, s, q;
+};
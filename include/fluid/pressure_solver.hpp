@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "fluid/mac_grid.hpp"
+
+/*
+ * 7-point Poisson matrix of the pressure projection (Bridson's layout).
+ * Rows of non-fluid cells are empty. Air neighbours only add to the
+ * diagonal (p = 0), solid neighbours are left out entirely.
+ */
+struct PoissonSystem {
+	glm::ivec3 dims { 0 };
+	std::vector<float> diag;
+	std::vector<float> plusX; // coupling to the +x neighbour, -1 or 0
+	std::vector<float> plusY;
+	std::vector<float> plusZ;
+	bool singular = false;    // no air cell, pressure only defined up to a constant
+
+	size_t index(int i, int j, int k) const { return (static_cast<size_t>(k) * dims.y + j) * dims.x + i; }
+	size_t size() const { return diag.size(); }
+};
+
+PoissonSystem buildPoissonSystem(const MacGrid& grid);
+PoissonSystem buildPoissonSystem(glm::ivec3 dims, const std::vector<CellType>& cellType);
+
+/* result = A * x, parallel over z slices. */
+void applyPoisson(const PoissonSystem& A, const std::vector<float>& x, std::vector<float>& result);
+
+/* Same as applyPoisson(), also returns dot(x, result) from the same pass. */
+double applyPoissonDot(const PoissonSystem& A, const std::vector<float>& x, std::vector<float>& result);
+
+/* Subtracts the mean over fluid cells, the null space of a singular system. */
+void removeNullSpace(const PoissonSystem& A, std::vector<float>& x);
+
+struct PressureSolverParams {
+	uint32_t maxIterations = 200;
+	float tolerance        = 1e-4f; // on the residual norm relative to the right-hand side
+};
+
+struct PressureSolveStats {
+	uint32_t iterations = 0;
+	std::vector<float> residualHistory; // relative residual after each iteration or cycle
+	double seconds = 0.0;
+};
+
+class PressureSolver {
+public:
+	explicit PressureSolver(const PressureSolverParams& params) : params(params) {}
+	virtual ~PressureSolver() = default;
+
+	/* Solves A * pressure = rhs, pressure holds the initial guess. */
+	virtual void solve(const MacGrid& grid, const PoissonSystem& A,
+		const std::vector<float>& rhs, std::vector<float>& pressure) = 0;
+	virtual const char* getName() const = 0;
+
+	const PressureSolveStats& getStats() const { return stats; }
+	PressureSolverParams& getParams() { return params; }
+
+protected:
+	PressureSolverParams params;
+	PressureSolveStats stats;
+};
+
+/* Zeroes the normal velocity of every face touching a solid cell or the domain boundary. */
+void enforceSolidBoundaries(MacGrid& grid);
+
+/*
+ * Makes the velocity of grid divergence free on its fluid cells, air cells
+ * are held at zero pressure. rhs is scratch space kept by the caller.
+ */
+void projectVelocity(MacGrid& grid, PressureSolver& pressureSolver, std::vector<float>& rhs);
+
+class JacobiPressureSolver : public PressureSolver {
+public:
+	explicit JacobiPressureSolver(const PressureSolverParams& params = {}) : PressureSolver(params) {}
+
+	void solve(const MacGrid& grid, const PoissonSystem& A,
+		const std::vector<float>& rhs, std::vector<float>& pressure) override;
+	const char* getName() const override { return "Jacobi"; }
+
+private:
+	std::vector<float> next;
+};
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "fluid/mac_grid.hpp"
+#include "fluid/parallel.hpp"
+
+/*
+ * Block topology of a sparse voxel grid: 8^3 voxel blocks, found through an
+ * open addressing hash of their block coordinates, plus one active bit per
+ * voxel. Blocks are numbered densely in allocation order, so channels store
+ * their values as plain arrays of BlockVoxels floats per block. Coordinates
+ * may be negative, the domain is only bounded by the 21 bit key per axis.
+ *
+ * Allocation and activation are not thread safe; iteration is.
+ */
+class SparseTopology {
+public:
+	static constexpr int BlockBits = 3;
+	static constexpr int BlockSize = 1 << BlockBits;
+	static constexpr size_t BlockVoxels = BlockSize * BlockSize * BlockSize;
+	static constexpr uint32_t InvalidBlock = UINT32_MAX;
+	static constexpr int PaddedSize = BlockSize + 2;
+
+	using Mask = std::array<uint64_t, BlockVoxels / 64>;
+	using PaddedBlock = std::array<float, PaddedSize * PaddedSize * PaddedSize>;
+
+	static glm::ivec3 blockOf(glm::ivec3 voxel) { return voxel >> BlockBits; }
+	static uint32_t localIndex(glm::ivec3 voxel)
+	{
+		glm::ivec3 l = voxel & (BlockSize - 1);
+		return static_cast<uint32_t>((l.z * BlockSize + l.y) * BlockSize + l.x);
+	}
+	static glm::ivec3 localCoord(uint32_t index)
+	{
+		return { index & (BlockSize - 1), (index >> BlockBits) & (BlockSize - 1), index >> (2 * BlockBits) };
+	}
+
+	uint32_t findBlock(glm::ivec3 blockCoord) const;
+	/* Returns the existing block or allocates one, invalidating the neighbour table. */
+	uint32_t touchBlock(glm::ivec3 blockCoord);
+
+	void activate(glm::ivec3 voxel);
+	void deactivate(glm::ivec3 voxel);
+	bool isActive(glm::ivec3 voxel) const;
+
+	size_t blockCount() const { return coords.size(); }
+	size_t activeCount() const;
+	glm::ivec3 blockCoord(uint32_t block) const { return coords[block]; }
+	const Mask& activeMask(uint32_t block) const { return masks[block]; }
+	Mask& activeMask(uint32_t block) { return masks[block]; }
+
+	/* Allocates the 26 neighbour blocks of every block with an active voxel, returns the number added. */
+	size_t dilateBlocks();
+
+	/*
+	 * Drops blocks without active voxels, except those holding the high
+	 * faces of an active voxel in their -x, -y or -z neighbour, as
+	 * staggered velocities are stored at the low face. remap[old] is the
+	 * new index or InvalidBlock, for compacting channel data.
+	 */
+	void prune(std::vector<uint32_t>& remap);
+
+	/* 27 neighbours per block, offset (dx, dy, dz) in -1..1 at ((dz + 1) * 3 + dy + 1) * 3 + dx + 1. */
+	void updateNeighbors();
+	uint32_t neighbor(uint32_t block, int dx, int dy, int dz) const
+	{
+		return neighbors[block * 27 + ((dz + 1) * 3 + dy + 1) * 3 + dx + 1];
+	}
+	bool neighborsValid() const { return neighbors.size() == coords.size() * 27; }
+
+	/*
+	 * Copies a block of a channel (BlockVoxels floats per block) and a one
+	 * voxel halo from its neighbours into out, fill where a neighbour is not
+	 * allocated, so stencils run on a dense 10^3 tile. Index
+	 * ((z + 1) * 10 + y + 1) * 10 + x + 1 for local coordinates -1..8.
+	 * Requires an up to date neighbour table.
+	 */
+	void gatherPadded(const float* data, uint32_t block, float fill, PaddedBlock& out) const;
+
+	size_t memoryBytes() const;
+
+	/* fn(block, local index, voxel coordinate) for every active voxel, parallel over blocks. */
+	template<typename F>
+	void forEachActive(F&& fn) const
+	{
+		parallelFor(coords.size(), 16, [&](size_t begin, size_t end) {
+			for (size_t b = begin; b < end; b++) {
+				const glm::ivec3 base = coords[b] * BlockSize;
+				for (size_t word = 0; word < masks[b].size(); word++) {
+					for (uint64_t bits = masks[b][word]; bits != 0; bits &= bits - 1) {
+						const uint32_t local = static_cast<uint32_t>(word * 64 + std::countr_zero(bits));
+						fn(static_cast<uint32_t>(b), local, base + localCoord(local));
+					}
+				}
+			}
+		});
+	}
+
+private:
+	static uint64_t pack(glm::ivec3 blockCoord);
+	size_t slot(uint64_t key) const;
+	void rehash(size_t capacity);
+
+	std::vector<glm::ivec3> coords;
+	std::vector<Mask> masks;
+	std::vector<uint32_t> neighbors;
+
+	static constexpr uint64_t EmptyKey = UINT64_MAX;
+	std::vector<uint64_t> tableKeys;
+	std::vector<uint32_t> tableBlocks;
+};
+
+enum class SparseField : uint8_t {
+	U,        // x face at the low x side of the voxel, same staggering as MacGrid
+	V,
+	W,
+	Pressure,
+	Density,
+	LevelSet,
+	Count
+};
+
+/*
+ * Storage for all grid quantities of a solver on one shared sparse
+ * topology, memory grows with the allocated blocks, not the bounding box.
+ * No solver runs on it yet: GridSolver and HybridSolver still step on a
+ * dense MacGrid, so their domains are bounded by dense memory and 1024^3
+ * simulations are not reachable. Only the container, sampling and
+ * computeDivergence() exist so far.
+ */
+class SparseFluidGrid {
+public:
+	static constexpr size_t FieldCount = static_cast<size_t>(SparseField::Count);
+	static constexpr int PaddedSize = SparseTopology::PaddedSize;
+	using PaddedBlock = SparseTopology::PaddedBlock;
+
+	explicit SparseFluidGrid(float cellSize, glm::vec3 origin = glm::vec3(0.f));
+
+	SparseTopology& getTopology() { return topology; }
+	const SparseTopology& getTopology() const { return topology; }
+	float getCellSize() const { return cellSize; }
+	glm::vec3 getOrigin() const { return origin; }
+
+	/* Value outside allocated blocks, e.g. a positive distance for the level set of the air. */
+	void setBackground(SparseField field, float value) { background[index(field)] = value; }
+	float getBackground(SparseField field) const { return background[index(field)]; }
+
+	/* Allocates the block in every channel, filled with the backgrounds. */
+	uint32_t touchBlock(glm::ivec3 blockCoord);
+
+	float get(SparseField field, glm::ivec3 voxel) const;
+	/* Allocates the voxel's block if needed, does not change its active state. */
+	void set(SparseField field, glm::ivec3 voxel, float value);
+
+	std::span<float> block(SparseField field, uint32_t block)
+	{
+		return { values[index(field)].data() + block * SparseTopology::BlockVoxels, SparseTopology::BlockVoxels };
+	}
+	std::span<const float> block(SparseField field, uint32_t block) const
+	{
+		return { values[index(field)].data() + block * SparseTopology::BlockVoxels, SparseTopology::BlockVoxels };
+	}
+
+	/* SparseTopology::gatherPadded() of one channel, the background fills missing neighbours. */
+	void gatherPadded(SparseField field, uint32_t block, PaddedBlock& out) const
+	{
+		topology.gatherPadded(values[index(field)].data(), block, background[index(field)], out);
+	}
+
+	/* Trilinear sample at a world position, staggered fields sampled at their face positions. */
+	float sample(SparseField field, glm::vec3 position) const;
+	glm::vec3 sampleVelocity(glm::vec3 position) const;
+
+	/* Both rebuild the neighbour table. */
+	void dilate();
+	void prune();
+	size_t memoryBytes() const;
+
+	/* Allocates and activates the blocks holding non-air cells of a dense grid, copies all fields and builds the neighbour table. */
+	void fromDense(const MacGrid& grid);
+
+private:
+	static size_t index(SparseField field) { return static_cast<size_t>(field); }
+	void resizeChannels();
+
+	SparseTopology topology;
+	float cellSize = 1.f;
+	glm::vec3 origin { 0.f };
+	std::array<float, FieldCount> background {};
+	std::array<std::vector<float>, FieldCount> values;
+};
+
+/* Net outflow of every active voxel, stored in the block layout of the topology. Needs an up to date neighbour table. */
+void computeDivergence(const SparseFluidGrid& grid, std::vector<float>& divergence);
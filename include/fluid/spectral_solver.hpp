@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "fluid/fft.hpp"
+#include "fluid/mac_grid.hpp"
+#include "fluid/pressure_solver.hpp"
+
+/*
+ * Direct solver for the fully periodic 7-point system with the scaling of
+ * PoissonSystem (6 on the diagonal, -1 to the six wrapped neighbours). The
+ * FFT diagonalizes it, so one forward transform, a division by the
+ * discrete Laplacian's eigenvalues and one inverse transform give the
+ * exact solution in O(N log N). The constant mode, the null space, is
+ * dropped. Not a PressureSolver: it has no notion of solid or air cells.
+ */
+class SpectralPoissonSolver {
+public:
+	explicit SpectralPoissonSolver(glm::ivec3 dims);
+
+	void solve(const std::vector<float>& rhs, std::vector<float>& pressure);
+
+	glm::ivec3 getDims() const { return fft.getDims(); }
+	const PressureSolveStats& getStats() const { return stats; }
+
+private:
+	Fft3d fft;
+	std::vector<float> inverseEigenvalues; // includes the 1 / N of the inverse transform
+	std::vector<float> re, im;
+	PressureSolveStats stats;
+};
+
+/*
+ * Exact projection of a periodic MAC grid: faces at i = n alias those at
+ * i = 0 and are rewritten from them. Cell types are ignored, the whole box
+ * is fluid. rhs is scratch space kept by the caller.
+ */
+void projectPeriodic(MacGrid& grid, SpectralPoissonSolver& solver, std::vector<float>& rhs);
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+/*
+ * Smoothing kernels from Mueller et al. 2003, all with support radius h.
+ * Dim selects the 2D or 3D normalization, the shapes are the same.
+ */
+namespace Kernel
+{
+	constexpr float PI = 3.14159265358979f;
+
+	template<int Dim = 3>
+	inline float poly6(float r2, float h)
+	{
+		float h2 = h * h;
+		if (r2 >= h2) return 0.f;
+
+		float d = h2 - r2;
+		if constexpr (Dim == 2) return 4.f / (PI * (h2 * h2 * h2 * h2)) * d * d * d;
+		else return 315.f / (64.f * PI * (h2 * h2 * h2 * h2 * h)) * d * d * d;
+	}
+
+	template<int Dim>
+	inline glm::vec<Dim, float> spikyGradient(const glm::vec<Dim, float>& r, float dist, float h)
+	{
+		if (dist >= h || dist <= 1e-6f) return glm::vec<Dim, float>(0.f);
+
+		float d = h - dist;
+		if constexpr (Dim == 2) {
+			float h5 = h * h * h * h * h;
+			return -30.f / (PI * h5) * d * d * (r / dist);
+		}
+		else {
+			float h3 = h * h * h;
+			return -45.f / (PI * h3 * h3) * d * d * (r / dist);
+		}
+	}
+
+	template<int Dim = 3>
+	inline float viscosityLaplacian(float dist, float h)
+	{
+		if (dist >= h) return 0.f;
+
+		if constexpr (Dim == 2) {
+			float h5 = h * h * h * h * h;
+			return 40.f / (PI * h5) * (h - dist);
+		}
+		else {
+			float h3 = h * h * h;
+			return 45.f / (PI * h3 * h3) * (h - dist);
+		}
+	}
+} // namespace Kernel
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/* Indexed triangle list produced by the solvers, laid out like the renderer's vertex attributes. */
+struct SurfaceMesh {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;   // optional, per vertex
+	std::vector<glm::vec3> colors;
+	std::vector<glm::vec2> texCoords;
+	std::vector<uint32_t> indices;
+};
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct FmmParams {
+	uint32_t order    = 4;   // total degree of the Cartesian Taylor expansions
+	uint32_t leafSize = 64;  // target mean particle count per occupied leaf
+	int maxDepth      = 10;
+};
+
+struct FmmStats {
+	int depth         = 0;
+	size_t cells      = 0;   // occupied cells over all levels
+	size_t m2l        = 0;   // multipole to local translations
+	size_t p2p        = 0;   // near field particle pairs
+	double seconds    = 0.0;
+};
+
+/*
+ * Regularized Biot-Savart velocity u and gradient du/dx induced at every
+ * particle by all others. gradient[j][i] = du_i / dx_j, so gradient * a is
+ * the stretching term (a . grad) u.
+ */
+void evaluateBiotSavartDirect(std::span<const glm::vec3> positions, std::span<const glm::vec3> strengths,
+	float coreRadius, std::vector<glm::vec3>& velocity, std::vector<glm::mat3>& gradient);
+
+/* Only at the listed particles, velocity[t] belongs to targets[t]. Used as reference for the FMM error. */
+void evaluateBiotSavartDirect(std::span<const glm::vec3> positions, std::span<const glm::vec3> strengths,
+	float coreRadius, std::span<const uint32_t> targets, std::vector<glm::vec3>& velocity, std::vector<glm::mat3>& gradient);
+
+/*
+ * Same as evaluateBiotSavartDirect() in O(N) with a fast multipole method on
+ * a uniform depth octree that only stores occupied cells (sorted Morton
+ * keys per level). The velocity is the curl of the vector potential
+ * psi = sum a / (4 pi r), whose three components are expanded as Laplace
+ * potentials in Cartesian Taylor series (multi-indices up to total degree
+ * params.order). Near field pairs use the regularized kernel, the far field
+ * the singular one, which agree once cells are well separated compared to
+ * the core radius.
+ */
+class VortexFmm {
+public:
+	explicit VortexFmm(const FmmParams& params = {});
+
+	void evaluate(std::span<const glm::vec3> positions, std::span<const glm::vec3> strengths,
+		float coreRadius, std::vector<glm::vec3>& velocity, std::vector<glm::mat3>& gradient);
+
+	const FmmStats& getStats() const { return stats; }
+	const FmmParams& getParams() const { return params; }
+	void setOrder(uint32_t order);
+
+private:
+	struct Level {
+		std::vector<uint32_t> keys;        // sorted Morton keys of the occupied cells
+		std::vector<uint32_t> parent;      // index into the next coarser level
+		std::vector<uint32_t> childBegin;  // into the next finer level, or into the sorted particles on the leaf level
+		std::vector<uint32_t> childEnd;
+		std::vector<glm::dvec3> multipole; // cells * termCount
+		std::vector<glm::dvec3> local;
+		float cellSize = 0.f;
+	};
+
+	/* term[c] += term[a] * term[b] style translations, with deg(a) + deg(b) <= order. */
+	struct Triple {
+		uint16_t a, b, sum;
+	};
+
+	void buildTerms();
+	void buildTree(std::span<const glm::vec3> positions);
+	void upwardPass(std::span<const glm::vec3> strengths);
+	void transferPass();
+	void downwardPass();
+	void evaluateLeaves(std::span<const glm::vec3> strengths, float coreRadius,
+		std::vector<glm::vec3>& velocity, std::vector<glm::mat3>& gradient);
+
+	glm::dvec3 cellCenter(int level, uint32_t key) const;
+	int64_t findCell(int level, glm::ivec3 coord) const;
+	void monomials(glm::dvec3 d, double* out) const;
+	void derivatives(glm::dvec3 r, double* out) const;
+
+	FmmParams params;
+	FmmStats stats;
+
+	/* Multi-indices (t, u, v) ordered by total degree. */
+	std::vector<glm::ivec3> terms;
+	std::vector<int> degree;
+	std::vector<uint16_t> lower;   // index of the term with one less power along lowerAxis
+	std::vector<uint8_t> lowerAxis;
+	std::vector<uint16_t> lower2;  // two less along lowerAxis, or 0xffff
+	std::vector<Triple> triples;
+	std::vector<Triple> evalTriples; // deg(a) <= 2, the potential and its first two derivatives
+
+	std::vector<Level> levels;
+	std::vector<uint32_t> order;     // sorted position -> input index
+	std::vector<glm::vec3> sorted;
+	glm::vec3 boxMin { 0.f };
+	float boxSize = 1.f;
+};
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "fluid/fluid_solver.hpp"
+#include "fluid/vortex_fmm.hpp"
+
+struct VortexParams {
+	float timeStep          = 0.005f;
+	float coreRadius        = 0.02f;
+	glm::vec3 freestream    { 0.f };
+	FmmParams fmm;
+	size_t directThreshold  = 2000; // below this particle count direct summation is faster than the FMM
+};
+
+/*
+ * Inviscid vortex particle method: each particle carries a vector strength
+ * (vorticity times volume) that is advected with the Biot-Savart velocity
+ * and stretched by its gradient, (a . grad) u. Suited to smoke and wakes,
+ * where vorticity fills a small part of an unbounded domain.
+ */
+class VortexSolver : public FluidSolver {
+public:
+	explicit VortexSolver(const VortexParams& params = {});
+
+	void addParticles(std::span<const glm::vec3> positions, std::span<const glm::vec3> strengths);
+
+	/* A thin ring of count particles around normal, travelling along it for positive circulation. */
+	void addVortexRing(glm::vec3 center, glm::vec3 normal, float radius, float circulation, uint32_t count);
+
+	void step() override;
+	float getTimeStep() const override { return params.timeStep; }
+	const char* getName() const override { return "Vortex particles"; }
+
+	std::span<const glm::vec3> getPositions() const { return positions; }
+	std::span<const glm::vec3> getStrengths() const { return strengths; }
+	std::span<const glm::vec3> getVelocities() const { return velocity; }
+	const VortexFmm& getFmm() const { return fmm; }
+	VortexParams& getParams() { return params; }
+
+private:
+	VortexParams params;
+	VortexFmm fmm;
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> strengths;
+	std::vector<glm::vec3> velocity;
+	std::vector<glm::mat3> gradient;
+};
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+/*
+ * Marks the cells of a dims grid covered by a triangle mesh, e.g. the
+ * positions and indices loadModel() produced. Rays along +x through every
+ * row of cell centres are tested against the triangles; cells between
+ * pairs of crossings are inside, and cells containing a crossing count as
+ * well so thin or open shells still block the flow.
+ */
+std::vector<uint8_t> voxelizeMesh(std::span<const glm::vec3> positions,
+	std::span<const uint32_t> indices,
+	glm::ivec3 dims,
+	glm::vec3 origin,
+	float cellSize);
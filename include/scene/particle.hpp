@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+/* Particle of a Dim = 2 or 3 dimensional simulation. */
+template<int Dim>
+struct BasicParticle {
+	using Vec = glm::vec<Dim, float>;
+
+	Vec position { 0.f };
+	Vec velocity { 0.f };
+	Vec force    { 0.f };
+	float density  = 0.f;
+	float pressure = 0.f;
+};
+
+using Particle = BasicParticle<3>;
+using Particle2D = BasicParticle<2>;
+
+/* Fill the box [min, max] with particles on a regular lattice. */
+std::vector<Particle> initParticles(glm::vec3 min, glm::vec3 max, float spacing);
+std::vector<Particle2D> initParticles(glm::vec2 min, glm::vec2 max, float spacing);
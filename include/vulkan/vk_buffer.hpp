@@ -14,6 +14,23 @@ void copyBuffer(VkContext& context,
 		vk::Buffer& dstBuffer,
 		vk::DeviceSize size);
 
+/* Buffer with its own allocation, used for the simulation's storage buffers. */
+struct DeviceBuffer {
+	vk::Buffer buffer             = nullptr;
+	vk::DeviceMemory memory       = nullptr;
+	vk::DeviceSize size           = 0;
+};
+
+DeviceBuffer createDeviceBuffer(VkContext& context,
+		vk::DeviceSize size,
+		vk::BufferUsageFlags usage,
+		vk::MemoryPropertyFlags properties = vk::MemoryPropertyFlagBits::eDeviceLocal);
+void destroyDeviceBuffer(VkContext& context, DeviceBuffer& buffer);
+
+/* Blocking transfers through a temporary staging buffer. */
+void uploadToBuffer(VkContext& context, DeviceBuffer& buffer, const void* data, vk::DeviceSize size, vk::DeviceSize offset = 0);
+void downloadFromBuffer(VkContext& context, DeviceBuffer& buffer, void* data, vk::DeviceSize size, vk::DeviceSize offset = 0);
+
 void copyBufferToImage(VkContext& context, const vk::Buffer& buffer, vk::Image& image, uint32_t width, uint32_t height);
 
 void createVertexBuffer(VkContext& context);
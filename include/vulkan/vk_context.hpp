@@ -16,6 +16,12 @@
 #include "vulkan/vk_vertex.hpp"
 
 class ImGuiVulkanUtil;
+class AsyncSimulation;
+class StreamedSimulation;
+class StreamedShallowWater;
+class ParticleRenderer;
+class ScreenSpaceFluid;
+class SurfaceMeshRenderer;
 
 constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
@@ -25,6 +31,7 @@ struct VkContext {
 	vk::Device device          = nullptr;
 	vk::Queue graphicsQueue    = nullptr;
 	vk::Queue presentQueue     = nullptr;
+	vk::Queue computeQueue     = nullptr;
 	vk::SwapchainKHR swapChain = nullptr;
 	vk::SurfaceKHR surface     = nullptr;
 
@@ -35,6 +42,7 @@ struct VkContext {
 
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	std::optional<uint32_t> computeFamily;
 
 	std::vector<vk::ImageView> swapChainImageViews;
 	vk::Format                 swapChainImageFormat = vk::Format::eUndefined;
@@ -47,6 +55,7 @@ struct VkContext {
 	vk::DebugUtilsMessengerEXT debugCallback    = nullptr;
 
 	vk::CommandPool commandPool = nullptr;
+	vk::CommandPool computeCommandPool = nullptr; // same as commandPool without a dedicated compute family
 	std::vector<vk::CommandBuffer> commandBuffers;
 
 	vk::ShaderModule shaderModule;
@@ -57,6 +66,7 @@ struct VkContext {
 
 	GLFWwindow* window                     = nullptr;
 	uint32_t currentFrame = 0;
+	uint64_t frameNumber  = 0;  // frames submitted so far, the value of the render timeline
 
 	bool framebufferResized = false;
 
@@ -87,6 +97,12 @@ struct VkContext {
 	vk::DeviceMemory depthImageMemory = nullptr;
 	vk::ImageView depthImageView = nullptr;
 	std::unique_ptr<ImGuiVulkanUtil> imGui;
+	std::unique_ptr<AsyncSimulation> simulation;
+	std::unique_ptr<StreamedSimulation> streamedSimulation; // CPU solver streamed to the renderer, instead of simulation
+	std::unique_ptr<ParticleRenderer> particleRenderer;
+	std::unique_ptr<ScreenSpaceFluid> screenSpaceFluid; // draws the particles as a liquid surface when set
+	std::unique_ptr<StreamedShallowWater> shallowWater; // CPU heightfield drawn by surfaceMeshRenderer, instead of particles
+	std::unique_ptr<SurfaceMeshRenderer> surfaceMeshRenderer; // draws the simulation's marching cubes surface or shallowWater when set
 };
 
 void initWindow(VkContext& context, AppConfig& config);
@@ -94,3 +110,7 @@ void initVulkan(VkContext& context);
 void drawFrame(VkContext& context);
 void run(VkContext& context);
 void cleanup(VkContext& context);
+
+/* Instance, device and command pool without a window, for compute-only runs. */
+void initHeadless(VkContext& context);
+void cleanupHeadless(VkContext& context);
@@ -5,3 +5,9 @@
 void createDescriptorPool(VkContext& context);
 void createDescriptorSetLayout(VkContext& context);
 void createDescriptorSets(VkContext& context);
+
+/* Set layout of bindingCount storage buffers at bindings 0..bindingCount-1. */
+vk::DescriptorSetLayout createStorageBufferSetLayout(VkContext& context, uint32_t bindingCount);
+vk::DescriptorPool createStorageBufferPool(VkContext& context, uint32_t maxSets, uint32_t descriptorCount);
+vk::DescriptorSet allocateDescriptorSet(VkContext& context, vk::DescriptorPool pool, vk::DescriptorSetLayout layout);
+void writeStorageBufferSet(VkContext& context, vk::DescriptorSet set, const std::vector<vk::Buffer>& buffers);
@@ -4,3 +4,9 @@
 
 void pickPhysicalDevice(VkContext& context);
 vk::Device createDevice(VkContext& vkContext);
+
+/*
+ * Picks any device with a compute queue, software drivers like lavapipe
+ * included, and creates it without surface or swapchain.
+ */
+void createComputeDevice(VkContext& context);
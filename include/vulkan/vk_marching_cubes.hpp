@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "vulkan/vk_context.hpp"
+#include "vulkan/vk_buffer.hpp"
+#include "vulkan/vk_pipeline.hpp"
+#include "vulkan/vk_sort.hpp"
+#include "vulkan/vk_stream.hpp"
+#include "fluid/marching_cubes.hpp"
+#include "fluid/surface_mesh.hpp"
+
+/* Output vertex, mirrors SurfaceVertex in shaders/marching_cubes.slang. */
+struct SurfaceVertex {
+	glm::vec4 position;
+	glm::vec4 normal;
+};
+
+/*
+ * MarchingCubes on the GPU (shaders/marching_cubes.slang): the particles
+ * are splatted into a fixed point field, every cell counts its triangles,
+ * GpuScan turns the counts into output offsets and every cell writes its
+ * triangles there. A last kernel writes the total into a
+ * VkDrawIndirectCommand, so the mesh is drawn without the host ever
+ * reading the triangle count back. The output is double buffered in slots
+ * like the particle instances of AsyncSimulation. Uses the same triangle
+ * table as the CPU extraction, without welding or incremental blocks.
+ */
+class GpuMarchingCubes {
+public:
+	static constexpr uint32_t SlotCount = 2;
+	static constexpr float FieldScale   = 65536.f; // fixed point steps per unit of the field
+
+	/* Splats from positions, float4 per particle, which must outlive the extraction. */
+	GpuMarchingCubes(VkContext& context, const MarchingCubesParams& params, vk::Buffer positions, uint32_t maxTriangles);
+	~GpuMarchingCubes();
+
+	GpuMarchingCubes(const GpuMarchingCubes&) = delete;
+	GpuMarchingCubes& operator=(const GpuMarchingCubes&) = delete;
+
+	/* Clears the field and splats the first count particles, as MarchingCubes::splatParticles(). */
+	void recordSplat(vk::CommandBuffer commandBuffer, uint32_t count, float radius, float spacing);
+	/* Extracts the field into the vertices and the draw command of slot. */
+	void recordExtract(vk::CommandBuffer commandBuffer, uint32_t slot);
+
+	/* (resolution + 1)^3 uints, FieldScale per unit. */
+	DeviceBuffer& getFieldBuffer() { return field; }
+	/* A VkDrawIndirectCommand followed by the triangle count before clamping to maxTriangles. */
+	DeviceBuffer& getIndirectBuffer(uint32_t slot) { return slots[slot % SlotCount].indirect; }
+	DeviceBuffer& getVertexBuffer(uint32_t slot) { return slots[slot % SlotCount].vertices; }
+	std::array<vk::Buffer, SlotCount> getVertexBuffers() const { return { slots[0].vertices.buffer, slots[1].vertices.buffer }; }
+	uint32_t getMaxTriangles() const { return maxTriangles; }
+	const MarchingCubesParams& getParams() const { return params; }
+
+private:
+	enum KernelSlot { ClearField, SplatParticles, ClassifyCells, GenerateTriangles, WriteIndirect, KernelCount };
+
+	/* Push constant block, mirrors MarchingCubesConstants in shaders/marching_cubes.slang. */
+	struct Constants {
+		glm::vec4 origin;
+		glm::uvec4 resolution;
+		glm::vec4 kernel;
+		glm::uvec4 counts;
+	};
+
+	struct Slot {
+		DeviceBuffer vertices;
+		DeviceBuffer indirect;
+		vk::DescriptorSet descriptorSet = nullptr;
+	};
+
+	void dispatch(vk::CommandBuffer commandBuffer, KernelSlot kernel, uint32_t threads, uint32_t slot);
+
+	VkContext& context;
+	MarchingCubesParams params;
+	uint32_t maxTriangles = 0;
+	uint32_t cellTotal = 0;
+	uint32_t nodeTotal = 0;
+	Constants constants {};
+
+	DeviceBuffer field;
+	DeviceBuffer triangleTable;
+	DeviceBuffer triangleOffsets;
+	std::array<Slot, SlotCount> slots {};
+	std::unique_ptr<GpuScan> offsetScan;
+
+	ComputeKernels kernels;
+	vk::DescriptorPool descriptorPool = nullptr;
+};
+
+/*
+ * A SurfaceMesh built on the CPU, streamed to SurfaceMeshRenderer: every
+ * frame its vertices, as SurfaceVertex, and its indices each go through a
+ * DeltaUpload into the storage and index buffer of the frame in flight, so
+ * indices that did not change, like those of a heightfield, are uploaded
+ * once per buffer. Meshes beyond the capacity are cut as GpuMarchingCubes
+ * clamps its triangles: vertices past maxVertices and the triangles using
+ * them are dropped, then the triangles past maxIndices.
+ */
+class StreamedMesh {
+public:
+	static constexpr size_t BlockVertices = 256;  // granularity of the delta uploads
+	static constexpr size_t BlockIndices  = 1024;
+
+	StreamedMesh(VkContext& context, uint32_t maxVertices, uint32_t maxIndices);
+	~StreamedMesh();
+
+	StreamedMesh(const StreamedMesh&) = delete;
+	StreamedMesh& operator=(const StreamedMesh&) = delete;
+
+	/*
+	 * Writes mesh for frame in flight frame, missing normals point up.
+	 * Call after waiting for its fence and before resetting it, see
+	 * StreamingBuffer::beginFrame().
+	 */
+	void update(const SurfaceMesh& mesh, uint32_t frame, vk::Fence fence);
+	/* Copies what changed into the frame's buffers, before the frame's rendering. */
+	void recordUpload(vk::CommandBuffer commandBuffer);
+
+	std::array<vk::Buffer, MAX_FRAMES_IN_FLIGHT> getVertexBuffers() const;
+	vk::Buffer getIndexBuffer(uint32_t frame) const { return indexBuffers[frame].buffer; }
+	uint32_t getIndexCount(uint32_t frame) const { return indexCounts[frame]; }
+	/* Of the last update(), vertices and indices. */
+	vk::DeviceSize getUploadedBytes() const { return vertexDelta.getStagedBytes() + indexDelta.getStagedBytes(); }
+
+private:
+	VkContext& context;
+	uint32_t maxVertices = 0;
+	uint32_t maxIndices = 0;
+
+	StreamingBuffer ring;
+	DeltaUpload vertexDelta;
+	DeltaUpload indexDelta;
+	std::vector<SurfaceVertex> vertices; // of the current update, compared by vertexDelta
+	std::vector<uint32_t> cutIndices;    // only used when the mesh is cut
+	std::array<DeviceBuffer, MAX_FRAMES_IN_FLIGHT> vertexBuffers {};
+	std::array<DeviceBuffer, MAX_FRAMES_IN_FLIGHT> indexBuffers {};
+	std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> indexCounts {};
+	uint32_t frame = 0;
+	std::span<const vk::BufferCopy> vertexRegions;
+	std::span<const vk::BufferCopy> indexRegions;
+};
+
+/*
+ * Draws the triangles of GpuMarchingCubes with drawIndirect, or those of a
+ * StreamedMesh with drawIndexed (shaders/surface_mesh.slang). Vertices are
+ * pulled from the storage buffers by their vertex index.
+ */
+class SurfaceMeshRenderer {
+public:
+	/* Sets for every frame in flight and vertex buffer, the buffers must outlive the renderer. */
+	SurfaceMeshRenderer(VkContext& context, std::span<const vk::Buffer> vertexBuffers);
+	~SurfaceMeshRenderer();
+
+	SurfaceMeshRenderer(const SurfaceMeshRenderer&) = delete;
+	SurfaceMeshRenderer& operator=(const SurfaceMeshRenderer&) = delete;
+
+	/* Records the draw of slot inside a dynamic rendering. */
+	void draw(vk::CommandBuffer commandBuffer, GpuMarchingCubes& surface, uint32_t slot);
+	/* Records an indexed draw of the current frame's buffers, the renderer must be created with mesh.getVertexBuffers(). */
+	void draw(vk::CommandBuffer commandBuffer, const StreamedMesh& mesh);
+
+	/* Same placement as ParticleRenderer. */
+	glm::mat4 model = glm::scale(glm::mat4(1.f), glm::vec3(4.f)) * glm::translate(glm::mat4(1.f), glm::vec3(-0.5f));
+	glm::vec3 lightDirection { 0.3f, 0.8f, 0.5f }; // view space
+	glm::vec3 color { 0.2f, 0.45f, 0.8f };
+
+private:
+	/* Push constant block, mirrors SurfaceConstants in shaders/surface_mesh.slang. */
+	struct Constants {
+		glm::mat4 model;
+		glm::vec4 lightDirection;
+		glm::vec4 color;
+	};
+
+	void createPipeline();
+	void createDescriptorSets(std::span<const vk::Buffer> vertexBuffers);
+	/* Binds the pipeline, the set of vertex buffer buffer and the constants. */
+	void bind(vk::CommandBuffer commandBuffer, uint32_t buffer);
+
+	VkContext& context;
+	uint32_t bufferCount = 0;
+
+	vk::ShaderModule shaderModule          = nullptr;
+	vk::DescriptorSetLayout setLayout      = nullptr;
+	vk::PipelineLayout layout              = nullptr;
+	vk::Pipeline pipeline                  = nullptr;
+	vk::DescriptorPool descriptorPool      = nullptr;
+	std::vector<vk::DescriptorSet> descriptorSets; // frame * bufferCount + buffer
+};
+
+struct GpuMarchingCubesCheckResult {
+	int resolution         = 0;
+	size_t particles       = 0;
+	size_t cpuTriangles    = 0;
+	size_t gpuTriangles    = 0;
+	double cpuExtractMs    = 0.0;  // MarchingCubes::extract() of every block
+	double gpuExtractMs    = 0.0;
+	double gpuSplatMs      = 0.0;  // splat and extraction
+	double volumeError     = 0.0;  // enclosed volume relative to the CPU mesh, same field
+	double splatVolumeError = 0.0; // the same after splatting on the GPU
+	bool passed            = false;
+};
+
+/*
+ * Extracts the surface of the CPU benchmark's dam break at resolution^3
+ * cells with MarchingCubes and GpuMarchingCubes from the same quantized
+ * field, then splats on the GPU as well, and compares triangle counts and
+ * enclosed volumes. The triangle count is only read back here, to check it.
+ */
+GpuMarchingCubesCheckResult checkGpuMarchingCubes(VkContext& context, int resolution, uint32_t repeats = 10);
+void printGpuMarchingCubesCheck(const GpuMarchingCubesCheckResult& result, std::ostream& out);
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "vulkan/vk_context.hpp"
+
+/*
+ * Draws particles as ray-cast sphere impostors (shaders/particles.slang):
+ * one instanced four vertex strip per particle, no vertex buffers. Position,
+ * radius and color come from ParticleInstance storage buffers, so a million
+ * particles cost four million vertices instead of a mesh each.
+ */
+class ParticleRenderer {
+public:
+	/* Sets for every frame in flight and instance buffer, the buffers must outlive the renderer. */
+	ParticleRenderer(VkContext& context, std::span<const vk::Buffer> instanceBuffers);
+	~ParticleRenderer();
+
+	ParticleRenderer(const ParticleRenderer&) = delete;
+	ParticleRenderer& operator=(const ParticleRenderer&) = delete;
+
+	/* Records the draw inside a dynamic rendering, with the shaded pipeline unless another is given. */
+	void draw(vk::CommandBuffer commandBuffer, uint32_t bufferIndex, uint32_t count, vk::Pipeline variant = nullptr);
+
+	/*
+	 * Impostor pipeline with another fragment entry point of
+	 * shaders/particles.slang and other attachments, for passes such as the
+	 * screen-space fluid. Without a depth format there is no depth test,
+	 * additive blends the color output. The caller destroys it.
+	 */
+	vk::Pipeline createPipeline(const char* fragmentEntry, vk::Format colorFormat, vk::Format depthFormat, bool additive);
+
+	/* Places the simulation box in the scene, the unit box in front of the default camera. */
+	glm::mat4 model = glm::scale(glm::mat4(1.f), glm::vec3(4.f)) * glm::translate(glm::mat4(1.f), glm::vec3(-0.5f));
+	glm::vec3 lightDirection { 0.3f, 0.8f, 0.5f }; // view space
+
+private:
+	/* Push constant block, mirrors ParticleConstants in shaders/particles.slang. */
+	struct Constants {
+		glm::mat4 model;
+		glm::vec4 lightDirection;
+	};
+
+	void createDescriptorSets(std::span<const vk::Buffer> instanceBuffers);
+
+	VkContext& context;
+	uint32_t bufferCount = 0;
+
+	vk::ShaderModule shaderModule          = nullptr;
+	vk::DescriptorSetLayout setLayout      = nullptr;
+	vk::PipelineLayout layout              = nullptr;
+	vk::Pipeline pipeline                  = nullptr;
+	vk::DescriptorPool descriptorPool      = nullptr;
+	std::vector<vk::DescriptorSet> descriptorSets; // frame * bufferCount + buffer
+};
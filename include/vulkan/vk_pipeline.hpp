@@ -9,6 +9,38 @@
 
 #pragma once
 
+#include <filesystem>
+#include <span>
+
 #include "vulkan/vk_context.hpp"
 
 void createGraphicsPipeline(VkContext& context);
+
+[[nodiscard]] vk::ShaderModule createShaderModule(VkContext& context, const std::vector<char>& code);
+
+/* Layout shared by all kernels of a compute module: one descriptor set and a push constant block. */
+vk::PipelineLayout createComputePipelineLayout(VkContext& context,
+		vk::DescriptorSetLayout setLayout,
+		uint32_t pushConstantSize);
+vk::Pipeline createComputePipeline(VkContext& context,
+		vk::ShaderModule module,
+		const char* entryPoint,
+		vk::PipelineLayout layout);
+
+/* Shader module with one compute pipeline per entry point, all sharing one layout of storage buffers. */
+struct ComputeKernels {
+	vk::ShaderModule module            = nullptr;
+	vk::DescriptorSetLayout setLayout  = nullptr;
+	vk::PipelineLayout layout          = nullptr;
+	std::vector<vk::Pipeline> pipelines;
+};
+
+ComputeKernels createComputeKernels(VkContext& context,
+		const std::filesystem::path& spirvPath,
+		std::span<const char* const> entryPoints,
+		uint32_t storageBufferCount,
+		uint32_t pushConstantSize);
+void destroyComputeKernels(VkContext& context, ComputeKernels& kernels);
+
+/* Makes compute shader writes visible to the following dispatches. */
+void computeBarrier(vk::CommandBuffer commandBuffer);
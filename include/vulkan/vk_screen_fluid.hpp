@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <array>
+
+#include "vulkan/vk_context.hpp"
+#include "vulkan/vk_particles.hpp"
+
+/*
+ * Screen-space fluid surface after van der Laan et al. 2009: the particle
+ * impostors are rendered as front depth and additive thickness, the depth
+ * is smoothed by a separable bilateral filter in compute
+ * (shaders/fluid_filter.slang), and a fullscreen pass in the main rendering
+ * reconstructs normals and shades the liquid (shaders/fluid_composite.slang).
+ * The cost after the two impostor passes depends on the resolution, not on
+ * the particle count.
+ */
+class ScreenSpaceFluid {
+public:
+	ScreenSpaceFluid(VkContext& context, ParticleRenderer& particles);
+	~ScreenSpaceFluid();
+
+	ScreenSpaceFluid(const ScreenSpaceFluid&) = delete;
+	ScreenSpaceFluid& operator=(const ScreenSpaceFluid&) = delete;
+
+	/* Recreates the screen sized images, after the swap chain changed. */
+	void resize();
+
+	/* Depth, thickness and filter passes, recorded before the main rendering begins. */
+	void recordOffscreen(vk::CommandBuffer commandBuffer, uint32_t bufferIndex, uint32_t count);
+	/* Shades the surface inside the main rendering. */
+	void drawComposite(vk::CommandBuffer commandBuffer);
+
+	float filterRadius   = 0.1f;  // view space units
+	float depthFalloff   = 0.1f;  // view space units
+	int maxFilterRadius  = 24;    // pixels
+	float fieldOfView    = glm::radians(45.f); // vertical, as in UniformBufferObject
+	glm::vec3 absorption { 1.6f, 0.5f, 0.15f };
+	glm::vec3 skyColor   { 0.75f, 0.85f, 1.f };
+
+private:
+	struct ScreenImage {
+		vk::Image image          = nullptr;
+		vk::DeviceMemory memory  = nullptr;
+		vk::ImageView view       = nullptr;
+	};
+
+	/* Push constant blocks, mirror FilterConstants and CompositeConstants in the shaders. */
+	struct FilterConstants {
+		glm::ivec2 direction;
+		glm::ivec2 size;
+		float projectedRadius;
+		float depthFalloff;
+		int32_t maxRadius;
+	};
+	struct CompositeConstants {
+		glm::vec4 lightDirection;
+		glm::vec4 absorption;
+		glm::vec4 color;
+	};
+
+	ScreenImage createScreenImage(vk::Format format, vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect);
+	void destroyImages();
+	void createFilter();
+	void createComposite();
+	void writeDescriptorSets();
+	void filter(vk::CommandBuffer commandBuffer, uint32_t pass);
+
+	VkContext& context;
+	ParticleRenderer& particles;
+
+	/* Particle depth rendered to depth[0], filtered into depth[1] and back. */
+	std::array<ScreenImage, 2> depth {};
+	ScreenImage thickness {};
+	ScreenImage depthAttachment {};
+	vk::Format depthAttachmentFormat = vk::Format::eUndefined;
+
+	vk::Pipeline depthPipeline     = nullptr;
+	vk::Pipeline thicknessPipeline = nullptr;
+
+	vk::DescriptorPool descriptorPool = nullptr;
+
+	vk::ShaderModule filterModule         = nullptr;
+	vk::DescriptorSetLayout filterSetLayout = nullptr;
+	vk::PipelineLayout filterLayout       = nullptr;
+	vk::Pipeline filterPipeline           = nullptr;
+	std::array<vk::DescriptorSet, 2> filterSets {}; // per pass
+
+	vk::ShaderModule compositeModule         = nullptr;
+	vk::DescriptorSetLayout compositeSetLayout = nullptr;
+	vk::PipelineLayout compositeLayout       = nullptr;
+	vk::Pipeline compositePipeline           = nullptr;
+	std::array<vk::DescriptorSet, MAX_FRAMES_IN_FLIGHT> compositeSets {};
+};
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <span>
+
+#include "vulkan/vk_context.hpp"
+#include "vulkan/vk_buffer.hpp"
+#include "vulkan/vk_pipeline.hpp"
+#include "vulkan/vk_marching_cubes.hpp"
+#include "vulkan/vk_sph.hpp"
+#include "vulkan/vk_stream.hpp"
+#include "fluid/sph_solver.hpp"
+#include "fluid/shallow_water.hpp"
+
+/* Per particle data of the renderer, mirrors ParticleInstance in shaders/particles.slang. */
+struct ParticleInstance {
+	glm::vec4 positionRadius;
+	glm::vec4 color;
+};
+
+/*
+ * Runs GpuSphSolver on the compute queue one frame ahead of rendering:
+ * step N + 1 is submitted before frame N, so on devices with a dedicated
+ * compute family the two overlap. Each step writes its particles as
+ * ParticleInstances (shaders/particle_instances.slang) into one of two
+ * render buffers. Two timeline semaphores order the queues, the simulation
+ * timeline reaches N once step N is done and the render timeline reaches N
+ * once frame N, the last reader of the other buffer, is done.
+ * Without a dedicated family the same submissions go to the graphics queue.
+ * With a surface enabled, every step also extracts it with GpuMarchingCubes
+ * into the slot of its instances.
+ */
+class AsyncSimulation {
+public:
+	/* Uploads the particles and submits step 1 for the first frame. */
+	AsyncSimulation(VkContext& context, const SphParams& params, std::span<const Particle> particles);
+	~AsyncSimulation();
+
+	AsyncSimulation(const AsyncSimulation&) = delete;
+	AsyncSimulation& operator=(const AsyncSimulation&) = delete;
+
+	/* Submits the step that frame `step` will draw, call it before the graphics submit of frame step - 1. */
+	void submitStep(uint64_t step);
+
+	/* The graphics submit of frame N waits for getSimulationTimeline() == N and signals getRenderTimeline() = N. */
+	vk::Semaphore getSimulationTimeline() const { return simulationTimeline; }
+	vk::Semaphore getRenderTimeline() const { return renderTimeline; }
+
+	/* ParticleInstances of step N, in the buffer getInstanceBuffers()[getInstanceSlot(N)]. */
+	uint32_t getInstanceSlot(uint64_t step) const { return static_cast<uint32_t>(step % instances.size()); }
+	vk::Buffer getInstances(uint64_t step) const { return instances[getInstanceSlot(step)].buffer; }
+	std::array<vk::Buffer, 2> getInstanceBuffers() const { return { instances[0].buffer, instances[1].buffer }; }
+	uint32_t getParticleCount() const { return solver->getParticleCount(); }
+	GpuSphSolver& getSolver() { return *solver; }
+
+	/* Extracts a surface from the particles of every following step. */
+	void enableSurface(const MarchingCubesParams& params, uint32_t maxTriangles);
+	/* Null unless enabled, draw slot getInstanceSlot(N) for frame N. */
+	GpuMarchingCubes* getSurface() { return surface.get(); }
+
+private:
+	void waitTimeline(vk::Semaphore semaphore, uint64_t value);
+
+	VkContext& context;
+	std::unique_ptr<GpuSphSolver> solver;
+	std::unique_ptr<GpuMarchingCubes> surface;
+	float particleRadius = 0.f;
+
+	std::array<DeviceBuffer, 2> instances {};
+	ComputeKernels instanceKernel;
+	vk::DescriptorPool descriptorPool = nullptr;
+	std::array<vk::DescriptorSet, 2> descriptorSets {};
+	std::array<vk::CommandBuffer, 2> commandBuffers {};
+	vk::Semaphore simulationTimeline = nullptr;
+	vk::Semaphore renderTimeline     = nullptr;
+};
+
+/*
+ * Runs SphSolver on the CPU and streams its particles to the renderer:
+ * every frame they are written as ParticleInstances straight into the
+ * frame's part of a StreamingBuffer and copied with one command into the
+ * frame's own instance buffer, so the upload overlaps the frame in flight.
+ * Only blocks of BlockParticles that changed since that buffer was last
+ * written are uploaded, so sleeping regions cost nothing. With a surface
+ * enabled, every update also extracts it on the CPU and streams the mesh.
+ */
+class StreamedSimulation {
+public:
+	static constexpr size_t BlockParticles = 256; // granularity of the delta upload
+	StreamedSimulation(VkContext& context, const SphParams& params, std::span<const Particle> particles);
+	~StreamedSimulation();
+
+	StreamedSimulation(const StreamedSimulation&) = delete;
+	StreamedSimulation& operator=(const StreamedSimulation&) = delete;
+
+	/*
+	 * Steps the solver and writes the particles for frame in flight frame.
+	 * Call after waiting for its fence and before resetting it, see
+	 * StreamingBuffer::beginFrame().
+	 */
+	void update(uint32_t frame, vk::Fence fence);
+	/* Copies the changed blocks into getInstanceBuffers()[frame] with one copyBuffer, before the frame's rendering. */
+	void recordUpload(vk::CommandBuffer commandBuffer);
+
+	std::array<vk::Buffer, MAX_FRAMES_IN_FLIGHT> getInstanceBuffers() const;
+	uint32_t getParticleCount() const { return static_cast<uint32_t>(solver.getParticles().size()); }
+	SphSolver& getSolver() { return solver; }
+
+	/*
+	 * Extracts a surface from the particles of every following update()
+	 * with MarchingCubes and streams it. Welded vertices are fewer than the
+	 * triangles, so maxTriangles bounds both.
+	 */
+	void enableSurface(const MarchingCubesParams& params, uint32_t maxTriangles);
+	/* Null unless enabled, drawn with SurfaceMeshRenderer. */
+	StreamedMesh* getSurface() { return surfaceMesh.get(); }
+	/* Of the last update(), against getParticleCount() * sizeof(ParticleInstance) in full. */
+	vk::DeviceSize getUploadedBytes() const { return delta.getStagedBytes(); }
+	size_t getUploadRegionCount() const { return regions.size(); }
+
+private:
+	VkContext& context;
+	SphSolver solver;
+	float particleRadius = 0.f;
+
+	StreamingBuffer ring;
+	DeltaUpload delta;
+	std::vector<ParticleInstance> staging; // instances of the current step, compared by delta
+	std::array<DeviceBuffer, MAX_FRAMES_IN_FLIGHT> instances {};
+	uint32_t frame = 0;
+	std::span<const vk::BufferCopy> regions;
+
+	std::unique_ptr<MarchingCubes> surface;
+	std::unique_ptr<StreamedMesh> surfaceMesh;
+};
+
+/*
+ * Runs ShallowWaterSolver on the CPU, one step per frame, and streams its
+ * surface mesh to SurfaceMeshRenderer through a StreamedMesh. The grid
+ * topology never changes, so after the first frames only the vertices are
+ * uploaded.
+ */
+class StreamedShallowWater {
+public:
+	/* The mesh samples every stride-th cell. */
+	StreamedShallowWater(VkContext& context, const ShallowWaterParams& params, int stride = 1);
+
+	/* Steps the solver and writes the mesh for frame in flight frame, see StreamedMesh::update(). */
+	void update(uint32_t frame, vk::Fence fence);
+	void recordUpload(vk::CommandBuffer commandBuffer) { mesh.recordUpload(commandBuffer); }
+
+	ShallowWaterSolver& getSolver() { return solver; }
+	StreamedMesh& getMesh() { return mesh; }
+
+private:
+	ShallowWaterSolver solver;
+	int stride = 1;
+	SurfaceMesh surface;
+	StreamedMesh mesh;
+};
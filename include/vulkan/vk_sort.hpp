@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <ostream>
+
+#include "vulkan/vk_context.hpp"
+#include "vulkan/vk_buffer.hpp"
+#include "vulkan/vk_pipeline.hpp"
+
+/*
+ * Exclusive prefix sum over the uints of one buffer, in place
+ * (shaders/scan.slang). Reduce-then-scan instead of decoupled look-back:
+ * look-back spins on other workgroups and needs forward progress
+ * guarantees that software drivers such as lavapipe do not give.
+ * Like FftPlan, a plan is built once for a buffer and a maximum size.
+ */
+class GpuScan {
+public:
+	static constexpr uint32_t BlockSize = 1024; // elements per workgroup
+
+	GpuScan(VkContext& context, const DeviceBuffer& data, uint32_t maxCount);
+	~GpuScan();
+
+	GpuScan(const GpuScan&) = delete;
+	GpuScan& operator=(const GpuScan&) = delete;
+
+	/* Scans the first count elements, followed by a compute barrier. */
+	void record(vk::CommandBuffer commandBuffer, uint32_t count);
+
+private:
+	VkContext& context;
+	uint32_t maxCount = 0;
+	ComputeKernels kernels;
+	DeviceBuffer blockSums;
+	vk::DescriptorPool descriptorPool = nullptr;
+	vk::DescriptorSet descriptorSet   = nullptr;
+};
+
+/*
+ * Stable LSD radix sort of uint keys with uint payloads, 4 bits per pass
+ * (shaders/radix_sort.slang). Every pass counts digits per block, scans the
+ * digit-major histogram with GpuScan and scatters after a local split sort.
+ */
+class GpuRadixSort {
+public:
+	static constexpr uint32_t BlockSize = 256; // elements per workgroup
+	static constexpr uint32_t RadixBits = 4;
+
+	GpuRadixSort(VkContext& context, const DeviceBuffer& keys, const DeviceBuffer& values, uint32_t maxCount);
+	~GpuRadixSort();
+
+	GpuRadixSort(const GpuRadixSort&) = delete;
+	GpuRadixSort& operator=(const GpuRadixSort&) = delete;
+
+	/*
+	 * Sorts the first count pairs by the low keyBits bits, all keys must be
+	 * below 2^keyBits. The sorted pairs end up in keys and values again.
+	 */
+	void record(vk::CommandBuffer commandBuffer, uint32_t count, uint32_t keyBits = 32);
+
+private:
+	VkContext& context;
+	uint32_t maxCount = 0;
+	ComputeKernels kernels;
+	DeviceBuffer scratchKeys;
+	DeviceBuffer scratchValues;
+	DeviceBuffer histograms;
+	std::unique_ptr<GpuScan> histogramScan;
+	vk::DescriptorPool descriptorPool = nullptr;
+	std::array<vk::DescriptorSet, 2> descriptorSets {}; // input to scratch, scratch to input
+};
+
+struct GpuSortCheckResult {
+	size_t count          = 0;
+	double sortMsPerRun   = 0.0;
+	double scanMsPerRun   = 0.0;
+	double sortMkeysPerSecond = 0.0;
+	double scanMelementsPerSecond = 0.0;
+	double cpuSortMs      = 0.0;  // std::stable_sort of the same pairs
+	bool sortCorrect      = false;
+	bool scanCorrect      = false;
+};
+
+/*
+ * Sorts count random 32-bit keys with their indices as payload and scans
+ * count random values, compares both with the standard library and times
+ * repeats runs recorded into one command buffer.
+ */
+GpuSortCheckResult checkGpuSort(VkContext& context, size_t count, uint32_t repeats = 10);
+void printGpuSortCheck(const GpuSortCheckResult& result, std::ostream& out);
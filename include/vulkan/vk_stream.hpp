@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "vulkan/vk_context.hpp"
+
+/*
+ * Persistently mapped upload ring for per-frame data. One host visible
+ * buffer is split into a part per frame in flight, and allocations are
+ * bump allocated within the current part. A part is reused only after the
+ * fence of the submission that read it last has signaled, so the CPU
+ * writes the next frame while the GPU still copies the previous one.
+ * Unlike uploadToBuffer(), nothing is created, mapped or waited for per
+ * upload.
+ */
+class StreamingBuffer {
+public:
+	struct Allocation {
+		vk::Buffer buffer       = nullptr;
+		vk::DeviceSize offset   = 0;     // into buffer, the source offset of a copy
+		vk::DeviceSize size     = 0;
+		void* data              = nullptr;
+	};
+
+	StreamingBuffer(VkContext& context, vk::DeviceSize bytesPerFrame, uint32_t frameCount = MAX_FRAMES_IN_FLIGHT);
+	~StreamingBuffer();
+
+	StreamingBuffer(const StreamingBuffer&) = delete;
+	StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+	/*
+	 * Switches to the part of frame and waits until it is free. fence must
+	 * signal once the submission reading this frame's allocations is done;
+	 * it is waited for when the part comes round again, so it must not be
+	 * reset before then, as drawFrame() resets it only after this call.
+	 */
+	void beginFrame(uint32_t frame, vk::Fence fence);
+	/* Throws if the frame's part is full. */
+	Allocation allocate(vk::DeviceSize size, vk::DeviceSize alignment = 16);
+
+	vk::Buffer getBuffer() const { return buffer; } // source of every allocation
+	vk::DeviceSize getBytesPerFrame() const { return bytesPerFrame; }
+	vk::DeviceSize getFrameBytes() const { return head; } // allocated in the current frame
+
+private:
+	VkContext& context;
+	vk::DeviceSize bytesPerFrame = 0;
+	uint32_t frameCount = 0;
+
+	vk::Buffer buffer        = nullptr;
+	vk::DeviceMemory memory  = nullptr;
+	std::byte* mapped        = nullptr;
+
+	uint32_t current = 0;
+	vk::DeviceSize head = 0;
+	std::array<vk::Fence, MAX_FRAMES_IN_FLIGHT> fences {};
+};
+
+/*
+ * Uploads only the blocks of an array that changed since a target buffer
+ * last received it. update() compares the new contents block by block with
+ * a host copy of the previous update. stage() writes the blocks a target is
+ * missing into a StreamingBuffer, merging adjacent blocks into one region,
+ * so all of them go into a single copyBuffer. Every target, like the
+ * instance buffer of each frame in flight, is tracked separately.
+ */
+class DeltaUpload {
+public:
+	/* blockBytes should be a multiple of the StreamingBuffer alignment, 16. */
+	DeltaUpload(size_t blockBytes, uint32_t targetCount = MAX_FRAMES_IN_FLIGHT);
+
+	/* A change of size marks every block. */
+	void update(std::span<const std::byte> data);
+	/*
+	 * Allocates the blocks target is missing from ring and returns the
+	 * regions to copy from ring.getBuffer() into it; target is then up to
+	 * date. The regions are valid until the next call.
+	 */
+	std::span<const vk::BufferCopy> stage(StreamingBuffer& ring, uint32_t target);
+
+	size_t getBlockBytes() const { return blockBytes; }
+	size_t getBlockCount() const { return blockVersions.size(); }
+	vk::DeviceSize getStagedBytes() const { return stagedBytes; } // by the last stage()
+
+private:
+	size_t blockBytes = 0;
+	uint64_t version = 0;
+	std::vector<std::byte> shadow;       // contents of the last update
+	std::vector<uint64_t> blockVersions; // update that last changed the block
+	std::vector<uint64_t> targetVersions; // update each target was last staged from
+	std::vector<vk::BufferCopy> regions;
+	vk::DeviceSize stagedBytes = 0;
+};
+
+struct StreamingBenchmarkResult {
+	size_t particles      = 0;
+	uint32_t frames       = 0;
+	double stagingMs      = 0.0; // per frame, uploadToBuffer() with a staging buffer per upload
+	double streamingMs    = 0.0; // per frame, StreamingBuffer and one copy, frames overlapping
+	double stagingGBs     = 0.0;
+	double streamingGBs   = 0.0;
+};
+
+/*
+ * Uploads particles ParticleInstances per frame into a device local buffer,
+ * once through uploadToBuffer() and once through a StreamingBuffer with a
+ * fence per frame in flight, and reports the time per frame.
+ */
+StreamingBenchmarkResult runStreamingBenchmark(VkContext& context, size_t particles, uint32_t frames = 60);
+void printStreamingBenchmark(const StreamingBenchmarkResult& result, std::ostream& out);
+
+struct DeltaUploadBenchmarkResult {
+	struct Row {
+		float changedFraction   = 0.f;
+		double bytesPerFrame    = 0.0;
+		double regionsPerFrame  = 0.0;
+		double ms               = 0.0; // per frame, update, staging and copy
+	};
+
+	size_t particles     = 0;
+	uint32_t frames      = 0;
+	size_t blockBytes    = 0;
+	std::vector<Row> rows;
+};
+
+/*
+ * Streams particles ParticleInstances per frame through DeltaUpload into an
+ * instance buffer per frame in flight, moving a given fraction of them in a
+ * few contiguous runs every frame, like the awake regions of a sleeping
+ * solver, and reports the bytes and copy regions uploaded per frame.
+ */
+DeltaUploadBenchmarkResult runDeltaUploadBenchmark(VkContext& context, size_t particles, uint32_t frames = 60);
+void printDeltaUploadBenchmark(const DeltaUploadBenchmarkResult& result, std::ostream& out);
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/activity_tracker.hpp"
+#include "fluid/compact_hash_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+template<typename Grid, int Dim>
+void ActivityTracker::update(const SleepParams& params,
+		const Grid& grid,
+		const std::vector<BasicParticle<Dim>>& particles,
+		float restDensity)
+{
+	const uint32_t cellCount = grid.cellCount();
+
+	if (lastDensity.size() != particles.size()) {
+		size_t oldSize = lastDensity.size();
+		lastDensity.resize(particles.size());
+		for (size_t i = oldSize; i < particles.size(); i++)
+			lastDensity[i] = particles[i].density;
+	}
+
+	if (!params.enabled) {
+		asleep.clear();
+		quietSteps.clear();
+		sleepingCells = 0;
+		sleepingParticles = 0;
+		for (size_t i = 0; i < particles.size(); i++)
+			lastDensity[i] = particles[i].density;
+		return;
+	}
+
+	quietSteps.resize(particles.size(), 0);
+	asleep.resize(particles.size(), 0);
+
+	const float maxSpeed2 = params.velocityThreshold * params.velocityThreshold;
+	const float maxDensityChange = params.densityChangeThreshold * restDensity;
+
+	/* Pass 1: a cell is active if any of its particles moved or compressed noticeably. */
+	std::vector<uint8_t> active(cellCount, 0);
+	std::vector<uint32_t> cellQuietSteps(cellCount, 0);
+	for (uint32_t cell = 0; cell < cellCount; cell++) {
+		uint32_t quiet = params.quietStepsToSleep;
+		for (uint32_t i : grid.cellParticles(cell)) {
+			const BasicParticle<Dim>& p = particles[i];
+			quiet = std::min(quiet, quietSteps[i]);
+			if (glm::dot(p.velocity, p.velocity) > maxSpeed2 ||
+				std::abs(p.density - lastDensity[i]) > maxDensityChange) {
+				active[cell] = 1;
+			}
+		}
+		cellQuietSteps[cell] = active[cell] ? 0 : std::min(quiet + 1, params.quietStepsToSleep);
+	}
+
+	/* Pass 2: sleep after enough quiet steps, wake whenever a neighbour is active. */
+	sleepingCells = 0;
+	sleepingParticles = 0;
+	for (uint32_t cell = 0; cell < cellCount; cell++) {
+		bool neighborActive = false;
+		grid.forEachNeighborCell(cell, [&](uint32_t neighbor) {
+			neighborActive |= active[neighbor] != 0;
+		});
+
+		uint32_t quiet = neighborActive ? 0 : cellQuietSteps[cell];
+		bool sleeping = quiet >= params.quietStepsToSleep;
+
+		for (uint32_t i : grid.cellParticles(cell)) {
+			quietSteps[i] = quiet;
+			asleep[i] = sleeping;
+		}
+
+		if (sleeping) {
+			uint32_t count = static_cast<uint32_t>(grid.cellParticles(cell).size());
+			sleepingCells += count > 0;
+			sleepingParticles += count;
+		}
+	}
+
+	for (size_t i = 0; i < particles.size(); i++)
+		lastDensity[i] = particles[i].density;
+}
+
+void ActivityTracker::reset()
+{
+	quietSteps.clear();
+	asleep.clear();
+	lastDensity.clear();
+	sleepingCells = 0;
+	sleepingParticles = 0;
+}
+
+template void ActivityTracker::update(const SleepParams&, const NeighborGrid&,
+	const std::vector<Particle>&, float);
+template void ActivityTracker::update(const SleepParams&, const CompactHashGrid&,
+	const std::vector<Particle>&, float);
+template void ActivityTracker::update(const SleepParams&, const NeighborGrid2D&,
+	const std::vector<Particle2D>&, float);
+template void ActivityTracker::update(const SleepParams&, const CompactHashGrid2D&,
+	const std::vector<Particle2D>&, float);
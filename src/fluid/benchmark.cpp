@@ -0,0 +1,727 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/benchmark.hpp"
+#include "fluid/domain_decomposition.hpp"
+#include "fluid/grid_solver.hpp"
+#include "fluid/lbm_solver.hpp"
+#include "fluid/marching_cubes.hpp"
+#include "fluid/mpm_solver.hpp"
+#include "fluid/multigrid_solver.hpp"
+#include "fluid/pcg_solver.hpp"
+#include "fluid/parallel.hpp"
+#include "fluid/sph_solver.hpp"
+#include "fluid/spectral_solver.hpp"
+#include "fluid/vortex_fmm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <numbers>
+#include <random>
+#include <stdexcept>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+static BenchmarkResult timeSolver(FluidSolver& solver, size_t particles, uint32_t steps)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < steps; i++)
+		solver.step();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	BenchmarkResult result;
+	result.solver = solver.getName();
+	result.particles = particles;
+	result.steps = steps;
+	result.msPerStep = 1000.0 * seconds / steps;
+	result.timeStep = solver.getTimeStep();
+	result.simulatedPerSecond = steps * result.timeStep / seconds;
+	return result;
+}
+
+std::vector<BenchmarkResult> runSolverBenchmark(size_t particleCount, uint32_t steps)
+{
+	const float blockSize = 0.5f;
+	const int perAxis = std::max(2, static_cast<int>(std::round(std::cbrt(static_cast<double>(particleCount)))));
+	const float spacing = blockSize / perAxis;
+	std::vector<BenchmarkResult> results;
+
+	for (NeighborGridKind kind : { NeighborGridKind::Dense, NeighborGridKind::CompactHash }) {
+		SphParams params;
+		params.particleSpacing = spacing;
+		params.smoothingRadius = 2.f * spacing;
+		params.timeStep = 0.002f * spacing / 0.05f;
+		params.gridKind = kind;
+		params.sleep.enabled = false;
+
+		SphSolver solver(params);
+		std::vector<Particle> particles = initParticles(glm::vec3(0.f), glm::vec3(blockSize - 0.5f * spacing), spacing);
+		solver.addParticles(particles);
+
+		BenchmarkResult result = timeSolver(solver, solver.getParticles().size(), steps);
+		if (kind == NeighborGridKind::CompactHash) result.solver += " (compact hash)";
+		results.push_back(result);
+	}
+
+	/* 2D preview of the same dam break: a cross-section through the block, and a square of as many particles as the cube. */
+	const float spacing2D = blockSize / std::max(2, static_cast<int>(std::round(std::sqrt(static_cast<double>(particleCount)))));
+	for (float previewSpacing : { spacing, spacing2D }) {
+		SphParams2D params;
+		params.particleSpacing = previewSpacing;
+		params.smoothingRadius = 2.f * previewSpacing;
+		params.timeStep = 0.002f * previewSpacing / 0.05f;
+		params.sleep.enabled = false;
+
+		SphSolver2D solver(params);
+		solver.addParticles(initParticles(glm::vec2(0.f), glm::vec2(blockSize - 0.5f * previewSpacing), previewSpacing));
+
+		BenchmarkResult result = timeSolver(solver, solver.getParticles().size(), steps);
+		if (previewSpacing != spacing) result.solver += " (same count)";
+		results.push_back(result);
+	}
+
+	for (MpmMaterial material : { MpmMaterial::Fluid, MpmMaterial::Sand }) {
+		/* Two particles per cell and axis, time step from the speed of sound of the default material. */
+		MpmParams params;
+		params.cellSize = 2.f * spacing;
+		params.resolution = glm::ivec3(static_cast<int>(std::ceil(1.f / params.cellSize)));
+		params.timeStep = 0.25f * params.cellSize / std::sqrt(params.materials[0].youngsModulus / params.materials[0].density);
+
+		MpmSolver solver(params);
+		glm::vec3 offset(params.boundaryCells * params.cellSize);
+		solver.addBox(offset, offset + blockSize, material);
+
+		BenchmarkResult result = timeSolver(solver, solver.getParticles().size(), steps);
+		result.solver += material == MpmMaterial::Fluid ? " (fluid)" : " (sand)";
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+void printBenchmark(const std::vector<BenchmarkResult>& results, std::ostream& out)
+{
+	out << ThreadPool::global().size() << " threads\n";
+	out << std::left << std::setw(24) << "solver" << std::right << std::setw(10) << "particles"
+		<< std::setw(8) << "steps" << std::setw(12) << "ms/step" << std::setw(12) << "dt" << std::setw(14) << "sim s / s" << '\n';
+
+	for (const BenchmarkResult& r : results) {
+		out << std::left << std::setw(24) << r.solver << std::right << std::setw(10) << r.particles
+			<< std::setw(8) << r.steps << std::fixed << std::setprecision(3) << std::setw(12) << r.msPerStep
+			<< std::scientific << std::setprecision(2) << std::setw(12) << r.timeStep
+			<< std::fixed << std::setprecision(4) << std::setw(14) << r.simulatedPerSecond << '\n';
+	}
+	out << std::defaultfloat;
+}
+
+std::vector<OpenDomainBenchmarkResult> runOpenDomainBenchmark(size_t particleCount, uint32_t steps)
+{
+	const float blockSize = 0.5f;
+	const int perAxis = std::max(2, static_cast<int>(std::round(std::cbrt(static_cast<double>(particleCount)))));
+	const float spacing = blockSize / perAxis;
+	const glm::vec3 center(0.5f);
+
+	SphParams params;
+	params.particleSpacing = spacing;
+	params.smoothingRadius = 2.f * spacing;
+	params.timeStep = 0.002f * spacing / 0.05f;
+	params.gravity = glm::vec3(0.f);
+	params.gridKind = NeighborGridKind::CompactHash;
+	params.bounded = false;
+	params.sleep.enabled = false;
+
+	/* Velocity grows with the distance from the centre, its side grows about fortyfold over the run. */
+	const float rate = 40.f / (steps * params.timeStep);
+	std::vector<Particle> particles = initParticles(center - 0.5f * blockSize, center + 0.5f * blockSize - 0.5f * spacing, spacing);
+	for (Particle& p : particles)
+		p.velocity = rate * (p.position - center);
+
+	SphSolver solver(params);
+	solver.addParticles(particles);
+
+	std::vector<OpenDomainBenchmarkResult> results;
+	std::vector<uint64_t> keys;
+	for (uint32_t step = 1; step <= steps; step++) {
+		solver.step();
+		if (step % std::max(steps / 4, 1u) != 0 && step != steps) continue;
+
+		OpenDomainBenchmarkResult result;
+		result.step = step;
+
+		glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+		keys.clear();
+		for (const Particle& p : solver.getParticles()) {
+			lo = glm::min(lo, p.position);
+			hi = glm::max(hi, p.position);
+			if (glm::any(glm::lessThan(p.position, glm::vec3(0.f))) || glm::any(glm::greaterThan(p.position, glm::vec3(1.f))))
+				result.outside++;
+
+			glm::ivec3 c = glm::ivec3(glm::floor(p.position / params.smoothingRadius)) + (1 << 20);
+			keys.push_back((static_cast<uint64_t>(c.z) << 42) | (static_cast<uint64_t>(c.y) << 21) | static_cast<uint64_t>(c.x));
+		}
+		std::sort(keys.begin(), keys.end());
+		result.occupiedCells = std::unique(keys.begin(), keys.end()) - keys.begin();
+
+		const glm::dvec3 dims = glm::max(glm::ceil(glm::dvec3(hi - lo) / static_cast<double>(params.smoothingRadius)), glm::dvec3(1.0));
+		result.extent = std::max({ hi.x - lo.x, hi.y - lo.y, hi.z - lo.z });
+		result.denseCells = static_cast<size_t>(dims.x * dims.y * dims.z);
+		result.hashBytes = solver.getGridMemory();
+		result.denseBytes = (result.denseCells + 1 + 2 * particles.size()) * sizeof(uint32_t);
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+void printOpenDomainBenchmark(const std::vector<OpenDomainBenchmarkResult>& results, std::ostream& out)
+{
+	out << ThreadPool::global().size() << " threads\n";
+	out << std::right << std::setw(6) << "step" << std::setw(10) << "outside" << std::setw(9) << "extent"
+		<< std::setw(10) << "occupied" << std::setw(14) << "dense cells" << std::setw(11) << "hash MB" << std::setw(11) << "dense MB" << '\n';
+
+	for (const OpenDomainBenchmarkResult& r : results) {
+		out << std::setw(6) << r.step << std::setw(10) << r.outside << std::fixed << std::setprecision(2) << std::setw(9) << r.extent
+			<< std::setw(10) << r.occupiedCells << std::setw(14) << r.denseCells
+			<< std::setw(11) << r.hashBytes / 1e6 << std::setw(11) << r.denseBytes / 1e6 << '\n';
+	}
+	out << std::defaultfloat;
+}
+
+/* Written by every rank of the distributed check to its pipe, followed by its owned count after each step. */
+struct RankReport {
+	uint64_t misplaced  = 0;
+	uint32_t rebalances = 0;
+	double seconds      = 0.0;
+};
+
+static void runRank(TransportKind kind, int rank, int ranks, const std::string& name,
+	size_t particleCount, uint32_t steps, int fd)
+{
+	const float blockSize = 0.5f;
+	const int perAxis = std::max(2, static_cast<int>(std::round(std::cbrt(static_cast<double>(particleCount)))));
+	const float spacing = blockSize / perAxis;
+
+	SphParams params;
+	params.particleSpacing = spacing;
+	params.smoothingRadius = 2.f * spacing;
+	params.timeStep = 0.002f * spacing / 0.05f;
+
+	DecompositionParams decompositionParams;
+	decompositionParams.rebalanceInterval = 10;
+
+	std::unique_ptr<HaloTransport> transport = createTransport(kind, rank, ranks, name);
+	DistributedSphSolver solver(*transport, params, decompositionParams);
+	solver.addParticles(rank == 0 ? initParticles(glm::vec3(0.f), glm::vec3(blockSize - 0.5f * spacing), spacing) : std::vector<Particle>());
+
+	RankReport report;
+	for (const Particle& p : solver.getParticles())
+		if (solver.getDecomposition().ownerOf(p.position) != rank) report.misplaced++;
+
+	std::vector<uint32_t> counts { static_cast<uint32_t>(solver.getParticles().size()) };
+	std::vector<float> boundaries = solver.getDecomposition().getBoundaries();
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t step = 0; step < steps; step++) {
+		solver.step();
+		counts.push_back(static_cast<uint32_t>(solver.getParticles().size()));
+
+		if (solver.getDecomposition().getBoundaries() != boundaries) {
+			boundaries = solver.getDecomposition().getBoundaries();
+			report.rebalances++;
+		}
+	}
+	report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (write(fd, &report, sizeof(report)) != sizeof(report)
+		|| write(fd, counts.data(), counts.size() * sizeof(uint32_t)) != static_cast<ssize_t>(counts.size() * sizeof(uint32_t)))
+		throw std::runtime_error("Failed to report to the parent process");
+}
+
+static std::vector<std::byte> readAll(int fd)
+{
+	std::vector<std::byte> bytes;
+	std::byte buffer[4096];
+	ssize_t read;
+	while ((read = ::read(fd, buffer, sizeof(buffer))) > 0)
+		bytes.insert(bytes.end(), buffer, buffer + read);
+	return bytes;
+}
+
+std::vector<DistributedCheckResult> runDistributedCheck(int ranks, uint32_t steps, size_t particleCount)
+{
+	const int perAxis = std::max(2, static_cast<int>(std::round(std::cbrt(static_cast<double>(particleCount)))));
+	const size_t particles = static_cast<size_t>(perAxis) * perAxis * perAxis;
+	std::vector<DistributedCheckResult> results;
+
+	for (TransportKind kind : { TransportKind::SharedMemory, TransportKind::UnixSocket }) {
+		DistributedCheckResult result;
+		result.transport = kind == TransportKind::SharedMemory ? "shared memory" : "unix socket";
+		result.ranks = ranks;
+		result.particles = particles;
+		result.steps = steps;
+
+		const std::string name = "fluid-check-" + std::to_string(getpid()) + (kind == TransportKind::SharedMemory ? "-shm" : "-sock");
+		std::vector<pid_t> children;
+		std::vector<int> pipes;
+		for (int rank = 0; rank < ranks; rank++) {
+			int fds[2];
+			if (pipe(fds) != 0) throw std::runtime_error("Failed to create a pipe for rank " + std::to_string(rank));
+
+			pid_t pid = fork();
+			if (pid < 0) throw std::runtime_error("Failed to fork rank " + std::to_string(rank));
+			if (pid == 0) {
+				close(fds[0]);
+				int code = 0;
+				try {
+					runRank(kind, rank, ranks, name, particleCount, steps, fds[1]);
+				}
+				catch (const std::exception& e) {
+					std::cerr << "Rank " << rank << ": " << e.what() << '\n';
+					code = 1;
+				}
+				_exit(code);
+			}
+
+			close(fds[1]);
+			children.push_back(pid);
+			pipes.push_back(fds[0]);
+		}
+
+		/* Ranks only write after the last collective step, so reading them in order cannot block one on another. */
+		bool complete = true;
+		std::vector<uint64_t> totals(steps + 1, 0);
+		std::vector<uint32_t> finalCounts;
+		double slowest = 0.0;
+		for (int rank = 0; rank < ranks; rank++) {
+			std::vector<std::byte> bytes = readAll(pipes[rank]);
+			close(pipes[rank]);
+
+			int status = 0;
+			waitpid(children[rank], &status, 0);
+			complete &= WIFEXITED(status) && WEXITSTATUS(status) == 0;
+			if (bytes.size() != sizeof(RankReport) + totals.size() * sizeof(uint32_t)) {
+				complete = false;
+				continue;
+			}
+
+			RankReport report;
+			std::vector<uint32_t> counts(totals.size());
+			std::memcpy(&report, bytes.data(), sizeof(report));
+			std::memcpy(counts.data(), bytes.data() + sizeof(report), counts.size() * sizeof(uint32_t));
+
+			result.misplaced += report.misplaced;
+			result.rebalances = std::max(result.rebalances, report.rebalances);
+			slowest = std::max(slowest, report.seconds);
+			for (size_t s = 0; s < totals.size(); s++) totals[s] += counts[s];
+			finalCounts.push_back(counts.back());
+		}
+
+		for (uint64_t total : totals)
+			result.lost = std::max<size_t>(result.lost, total > particles ? total - particles : particles - total);
+		if (!finalCounts.empty())
+			result.imbalance = *std::ranges::max_element(finalCounts) / (static_cast<double>(particles) / ranks);
+		result.msPerStep = steps > 0 ? 1000.0 * slowest / steps : 0.0;
+		result.passed = complete && result.lost == 0 && result.misplaced == 0 && (ranks == 1 || result.rebalances > 0);
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+void printDistributedCheck(const std::vector<DistributedCheckResult>& results, std::ostream& out)
+{
+	out << std::left << std::setw(15) << "transport" << std::right << std::setw(6) << "ranks" << std::setw(11) << "particles"
+		<< std::setw(7) << "steps" << std::setw(11) << "misplaced" << std::setw(6) << "lost" << std::setw(12) << "rebalances"
+		<< std::setw(11) << "imbalance" << std::setw(10) << "ms/step" << '\n';
+
+	for (const DistributedCheckResult& r : results) {
+		out << std::left << std::setw(15) << r.transport << std::right << std::setw(6) << r.ranks << std::setw(11) << r.particles
+			<< std::setw(7) << r.steps << std::setw(11) << r.misplaced << std::setw(6) << r.lost << std::setw(12) << r.rebalances
+			<< std::fixed << std::setprecision(2) << std::setw(11) << r.imbalance << std::setw(10) << r.msPerStep
+			<< "  " << (r.passed ? "PASSED" : "FAILED") << '\n';
+	}
+	out << std::defaultfloat;
+}
+
+static void relativeErrors(const std::vector<glm::vec3>& velocity, const std::vector<glm::mat3>& gradient,
+	const std::vector<uint32_t>& targets, const std::vector<glm::vec3>& refVelocity, const std::vector<glm::mat3>& refGradient,
+	VortexBenchmarkResult& result)
+{
+	double du = 0.0, u = 0.0, dg = 0.0, g = 0.0;
+	for (size_t t = 0; t < targets.size(); t++) {
+		glm::vec3 e = velocity[targets[t]] - refVelocity[t];
+		du += glm::dot(e, e);
+		u += glm::dot(refVelocity[t], refVelocity[t]);
+		for (int j = 0; j < 3; j++) {
+			glm::vec3 eg = gradient[targets[t]][j] - refGradient[t][j];
+			dg += glm::dot(eg, eg);
+			g += glm::dot(refGradient[t][j], refGradient[t][j]);
+		}
+	}
+	result.velocityError = std::sqrt(du / std::max(u, 1e-300));
+	result.gradientError = std::sqrt(dg / std::max(g, 1e-300));
+}
+
+std::vector<VortexBenchmarkResult> runVortexBenchmark(size_t particleCount, uint32_t maxOrder, size_t sampleTargets)
+{
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	std::uniform_real_distribution<float> signedUnit(-1.f, 1.f);
+
+	std::vector<glm::vec3> positions(particleCount), strengths(particleCount);
+	for (size_t i = 0; i < particleCount; i++) {
+		positions[i] = { unit(rng), unit(rng), unit(rng) };
+		strengths[i] = glm::vec3(signedUnit(rng), signedUnit(rng), signedUnit(rng)) / static_cast<float>(particleCount);
+	}
+	const float coreRadius = 0.25f / std::cbrt(static_cast<float>(particleCount));
+
+	std::vector<uint32_t> targets(std::min(sampleTargets, particleCount));
+	std::uniform_int_distribution<uint32_t> pick(0, static_cast<uint32_t>(particleCount - 1));
+	for (uint32_t& t : targets) t = pick(rng);
+
+	std::vector<VortexBenchmarkResult> results;
+	std::vector<glm::vec3> refVelocity, velocity;
+	std::vector<glm::mat3> refGradient, gradient;
+
+	auto start = std::chrono::steady_clock::now();
+	evaluateBiotSavartDirect(positions, strengths, coreRadius, targets, refVelocity, refGradient);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	results.push_back({ "direct", 0, seconds * particleCount / std::max<size_t>(targets.size(), 1), 0.0, 0.0 });
+
+	for (uint32_t order = 1; order <= maxOrder; order++) {
+		VortexFmm fmm(FmmParams { order });
+		fmm.evaluate(positions, strengths, coreRadius, velocity, gradient);
+
+		VortexBenchmarkResult result { "fmm", order, fmm.getStats().seconds };
+		relativeErrors(velocity, gradient, targets, refVelocity, refGradient, result);
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+void printVortexBenchmark(const std::vector<VortexBenchmarkResult>& results, std::ostream& out)
+{
+	out << ThreadPool::global().size() << " threads\n";
+	out << std::left << std::setw(10) << "method" << std::right << std::setw(8) << "order"
+		<< std::setw(12) << "ms" << std::setw(14) << "u error" << std::setw(14) << "du/dx error" << '\n';
+
+	for (const VortexBenchmarkResult& r : results) {
+		out << std::left << std::setw(10) << r.method << std::right << std::setw(8) << r.order
+			<< std::fixed << std::setprecision(1) << std::setw(12) << 1000.0 * r.seconds
+			<< std::scientific << std::setprecision(2) << std::setw(14) << r.velocityError << std::setw(14) << r.gradientError << '\n';
+	}
+	out << std::defaultfloat;
+}
+
+/* |b - A x| / |b| of the periodic 7-point system. */
+static double periodicResidual(glm::ivec3 n, const std::vector<float>& x, const std::vector<float>& b)
+{
+	auto at = [&](int i, int j, int k) {
+		i = (i + n.x) % n.x;
+		j = (j + n.y) % n.y;
+		k = (k + n.z) % n.z;
+		return static_cast<double>(x[(static_cast<size_t>(k) * n.y + j) * n.x + i]);
+	};
+
+	double r2 = 0.0, b2 = 0.0;
+	for (int k = 0; k < n.z; k++) {
+		for (int j = 0; j < n.y; j++) {
+			for (int i = 0; i < n.x; i++) {
+				double Ax = 6.0 * at(i, j, k) - at(i - 1, j, k) - at(i + 1, j, k)
+					- at(i, j - 1, k) - at(i, j + 1, k) - at(i, j, k - 1) - at(i, j, k + 1);
+				double bc = b[(static_cast<size_t>(k) * n.y + j) * n.x + i];
+				r2 += (bc - Ax) * (bc - Ax);
+				b2 += bc * bc;
+			}
+		}
+	}
+	return std::sqrt(r2 / b2);
+}
+
+std::vector<PressureBenchmarkResult> runPressureBenchmark(int resolution)
+{
+	const glm::ivec3 dims(resolution);
+	const size_t cells = static_cast<size_t>(resolution) * resolution * resolution;
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> signedUnit(-1.f, 1.f);
+
+	std::vector<float> rhs(cells);
+	for (float& b : rhs) b = signedUnit(rng);
+	std::vector<PressureBenchmarkResult> results;
+
+	{
+		/* The periodic system is singular, only a zero mean right-hand side has a solution. */
+		std::vector<float> b = rhs;
+		double mean = 0.0;
+		for (float value : b) mean += value;
+		for (float& value : b) value -= static_cast<float>(mean / cells);
+
+		SpectralPoissonSolver solver(dims);
+		std::vector<float> pressure;
+		solver.solve(b, pressure);
+		const double ms = 1000.0 * solver.getStats().seconds;
+		const double residual = periodicResidual(dims, pressure, b);
+		results.push_back({ "Spectral (periodic)", cells, 1, ms, residual, residual < pressureBenchmarkTarget ? ms : -1.0 });
+	}
+
+	MacGrid grid(dims, 1.f / resolution);
+	for (int j = 0; j < resolution; j++)
+		for (int i = 0; i < resolution; i++)
+			grid.cellType[grid.cellIndex(i, resolution - 1, j)] = CellType::Air;
+	PoissonSystem A = buildPoissonSystem(grid);
+	for (size_t c = 0; c < cells; c++)
+		if (A.diag[c] == 0.f) rhs[c] = 0.f;
+
+	MultigridPressureSolver multigrid(PressureSolverParams { 50, 1e-5f });
+	PcgPressureSolver pcg(PressureSolverParams { 1000, 1e-5f });
+	PcgPressureSolver cg(PressureSolverParams { 4000, 1e-5f }, PcgParams { .precondition = false });
+	JacobiPressureSolver jacobi(PressureSolverParams { 2000, 1e-5f });
+	for (PressureSolver* solver : std::initializer_list<PressureSolver*> { &multigrid, &pcg, &cg, &jacobi }) {
+		std::vector<float> pressure(cells, 0.f);
+		solver->solve(grid, A, rhs, pressure);
+
+		/* Every iteration costs the same, so the time to the target is proportional to its index. */
+		const PressureSolveStats& stats = solver->getStats();
+		const double ms = 1000.0 * stats.seconds;
+		const auto reached = std::find_if(stats.residualHistory.begin(), stats.residualHistory.end(),
+			[](float residual) { return residual < pressureBenchmarkTarget; });
+		const double msToTarget = reached == stats.residualHistory.end() ? -1.0
+			: ms * static_cast<double>(reached - stats.residualHistory.begin() + 1) / stats.iterations;
+
+		results.push_back({ solver->getName(), cells, stats.iterations, ms,
+			stats.residualHistory.empty() ? 0.0 : stats.residualHistory.back(), msToTarget });
+	}
+
+	return results;
+}
+
+void printPressureBenchmark(const std::vector<PressureBenchmarkResult>& results, std::ostream& out)
+{
+	out << ThreadPool::global().size() << " threads\n";
+	out << std::left << std::setw(22) << "solver" << std::right << std::setw(12) << "cells" << std::setw(8) << "iters"
+		<< std::setw(12) << "ms" << std::setw(12) << "Mcells/s" << std::setw(12) << "residual"
+		<< std::setw(14) << "ms to 1e-4" << '\n';
+
+	for (const PressureBenchmarkResult& r : results) {
+		out << std::left << std::setw(22) << r.solver << std::right << std::setw(12) << r.cells << std::setw(8) << r.iterations
+			<< std::fixed << std::setprecision(1) << std::setw(12) << r.msPerSolve
+			<< std::setw(12) << r.cells / (1000.0 * std::max(r.msPerSolve, 1e-6))
+			<< std::scientific << std::setprecision(2) << std::setw(12) << r.residual << std::fixed << std::setprecision(1);
+		if (r.msToTarget < 0.0) out << std::setw(14) << "-" << '\n';
+		else out << std::setw(14) << r.msToTarget << '\n';
+	}
+	out << std::defaultfloat;
+}
+
+/* Rigid rotation about the z axis through the domain centre, one turn per second. */
+static void setRotation(MacGrid& grid)
+{
+	const glm::ivec3 n = grid.dims;
+	const float omega = 2.f * std::numbers::pi_v<float>;
+	for (int k = 0; k < n.z; k++) {
+		for (int j = 0; j < n.y; j++) {
+			for (int i = 0; i <= n.x; i++) {
+				float y = (j + 0.5f) * grid.cellSize - 0.5f;
+				grid.u[grid.uIndex(i, j, k)] = -omega * y;
+			}
+		}
+		for (int j = 0; j <= n.y; j++) {
+			for (int i = 0; i < n.x; i++) {
+				float x = (i + 0.5f) * grid.cellSize - 0.5f;
+				grid.v[grid.vIndex(i, j, k)] = omega * x;
+			}
+		}
+	}
+	std::fill(grid.w.begin(), grid.w.end(), 0.f);
+}
+
+std::vector<AdvectionBenchmarkResult> runAdvectionBenchmark(int resolution)
+{
+	struct Config {
+		const char* name;
+		AdvectionScheme scheme;
+		int resolution;
+	};
+	const int half = std::max(resolution / 2, 4);
+	const Config configs[] = {
+		{ "Semi-Lagrangian", AdvectionScheme::SemiLagrangian, resolution },
+		{ "Semi-Lagrangian", AdvectionScheme::SemiLagrangian, half },
+		{ "MacCormack", AdvectionScheme::MacCormack, half },
+		{ "BFECC", AdvectionScheme::Bfecc, half },
+		{ "MacCormack", AdvectionScheme::MacCormack, resolution },
+		{ "BFECC", AdvectionScheme::Bfecc, resolution },
+	};
+
+	std::vector<AdvectionBenchmarkResult> results;
+	for (const Config& config : configs) {
+		/* One cell per step at the domain edge. */
+		const uint32_t steps = static_cast<uint32_t>(std::ceil(std::numbers::pi * config.resolution));
+		GridParams params;
+		params.resolution = glm::ivec3(config.resolution);
+		params.cellSize = 1.f / config.resolution;
+		params.timeStep = 1.f / steps;
+		params.advection = config.scheme;
+
+		GridSolver solver(params);
+		MacGrid& grid = solver.getGrid();
+		for (int k = 0; k < config.resolution; k++) {
+			for (int j = 0; j < config.resolution; j++) {
+				for (int i = 0; i < config.resolution; i++) {
+					glm::vec3 center = (glm::vec3(i, j, k) + 0.5f) * params.cellSize;
+					grid.density[grid.cellIndex(i, j, k)] = glm::distance(center, glm::vec3(0.75f, 0.5f, 0.5f)) < 0.15f ? 1.f : 0.f;
+				}
+			}
+		}
+		const std::vector<float> initial = grid.density;
+
+		double seconds = 0.0;
+		for (uint32_t s = 0; s < steps; s++) {
+			setRotation(grid);
+			auto start = std::chrono::steady_clock::now();
+			solver.advect();
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		double error = 0.0, mass = 0.0, peak = 0.0;
+		for (size_t c = 0; c < initial.size(); c++) {
+			error += std::abs(grid.density[c] - initial[c]);
+			mass += initial[c];
+			peak = std::max(peak, static_cast<double>(grid.density[c]));
+		}
+		results.push_back({ config.name, config.resolution, steps, 1000.0 * seconds / steps, error / mass, peak });
+	}
+
+	return results;
+}
+
+void printAdvectionBenchmark(const std::vector<AdvectionBenchmarkResult>& results, std::ostream& out)
+{
+	out << ThreadPool::global().size() << " threads\n";
+	out << std::left << std::setw(18) << "scheme" << std::right << std::setw(6) << "res" << std::setw(8) << "steps"
+		<< std::setw(12) << "ms/step" << std::setw(12) << "total s" << std::setw(10) << "L1 error" << std::setw(8) << "peak" << '\n';
+
+	for (const AdvectionBenchmarkResult& r : results) {
+		out << std::left << std::setw(18) << r.scheme << std::right << std::setw(6) << r.resolution << std::setw(8) << r.steps
+			<< std::fixed << std::setprecision(2) << std::setw(12) << r.msPerStep << std::setw(12) << r.msPerStep * r.steps / 1000.0
+			<< std::setprecision(3) << std::setw(10) << r.error << std::setw(8) << r.peak << '\n';
+	}
+	out << std::defaultfloat;
+}
+
+std::vector<MarchingCubesBenchmarkResult> runMarchingCubesBenchmark(int resolution)
+{
+	std::vector<int> resolutions;
+	for (int r = std::min(resolution, 64); r < resolution; r *= 2)
+		resolutions.push_back(r);
+	resolutions.push_back(resolution);
+
+	std::vector<MarchingCubesBenchmarkResult> results;
+	for (int r : resolutions) {
+		MarchingCubesParams params;
+		params.resolution = glm::ivec3(r);
+		params.cellSize = 1.f / r;
+		MarchingCubes surface(params);
+
+		/* Two cells per particle, the kernel reaches two particle spacings. */
+		const float spacing = 2.f * params.cellSize;
+		std::vector<Particle> particles = initParticles(glm::vec3(0.1f), glm::vec3(0.6f, 0.4f, 0.6f), spacing);
+
+		MarchingCubesBenchmarkResult result;
+		result.resolution = r;
+		result.particles = particles.size();
+		result.blocks = surface.getBlockCount();
+
+		auto start = std::chrono::steady_clock::now();
+		surface.splatParticles(particles, 2.f * spacing, spacing);
+		auto splatted = std::chrono::steady_clock::now();
+		surface.extract();
+		auto extracted = std::chrono::steady_clock::now();
+		result.splatMs = std::chrono::duration<double, std::milli>(splatted - start).count();
+		result.extractMs = std::chrono::duration<double, std::milli>(extracted - splatted).count();
+		result.triangles = surface.getMesh().indices.size() / 3;
+
+		for (size_t p = 0; p < std::min<size_t>(particles.size(), 8); p++)
+			particles[p].position += glm::vec3(0.5f * spacing);
+		surface.splatParticles(particles, 2.f * spacing, spacing);
+		start = std::chrono::steady_clock::now();
+		result.rebuiltBlocks = surface.extract();
+		result.incrementalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+void printMarchingCubesBenchmark(const std::vector<MarchingCubesBenchmarkResult>& results, std::ostream& out)
+{
+	out << ThreadPool::global().size() << " threads\n";
+	out << std::right << std::setw(6) << "res" << std::setw(10) << "particles" << std::setw(11) << "triangles"
+		<< std::setw(10) << "splat ms" << std::setw(12) << "extract ms" << std::setw(16) << "incremental ms" << std::setw(10) << "rebuilt" << '\n';
+
+	for (const MarchingCubesBenchmarkResult& r : results) {
+		out << std::setw(6) << r.resolution << std::setw(10) << r.particles << std::setw(11) << r.triangles
+			<< std::fixed << std::setprecision(2) << std::setw(10) << r.splatMs << std::setw(12) << r.extractMs
+			<< std::setw(16) << r.incrementalMs << std::setw(10) << (std::to_string(r.rebuiltBlocks) + "/" + std::to_string(r.blocks)) << '\n';
+	}
+	out << std::defaultfloat;
+}
+
+std::vector<LbmBenchmarkResult> runLbmBenchmark(int resolution, uint32_t steps)
+{
+	steps += steps % 2;
+	std::vector<LbmBenchmarkResult> results;
+
+	for (CollisionModel collision : { CollisionModel::Bgk, CollisionModel::Mrt }) {
+		LbmParams params;
+		params.resolution = glm::ivec3(2 * resolution, resolution, resolution);
+		params.cellSize = 1.f / resolution;
+		params.collision = collision;
+
+		LbmSolver solver(params);
+		const std::vector<LbmCell>& cells = solver.getCells();
+		const size_t updated = cells.size() - std::count(cells.begin(), cells.end(), LbmCell::Solid);
+
+		double seconds = 0.0;
+		for (uint32_t i = 0; i < steps; i++) {
+			solver.step();
+			seconds += solver.getStats().seconds;
+		}
+
+		LbmBenchmarkResult result;
+		result.solver = solver.getName();
+		result.cells = updated;
+		result.steps = steps;
+		result.msPerStep = 1000.0 * seconds / steps;
+		result.mlups = updated * static_cast<double>(steps) / seconds * 1e-6;
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+void printLbmBenchmark(const std::vector<LbmBenchmarkResult>& results, std::ostream& out)
+{
+	out << ThreadPool::global().size() << " threads\n";
+	out << std::left << std::setw(12) << "solver" << std::right << std::setw(12) << "cells"
+		<< std::setw(8) << "steps" << std::setw(12) << "ms/step" << std::setw(10) << "MLUPS" << '\n';
+
+	for (const LbmBenchmarkResult& r : results) {
+		out << std::left << std::setw(12) << r.solver << std::right << std::setw(12) << r.cells << std::setw(8) << r.steps
+			<< std::fixed << std::setprecision(2) << std::setw(12) << r.msPerStep << std::setw(10) << r.mlups << '\n';
+	}
+	out << std::defaultfloat;
+}
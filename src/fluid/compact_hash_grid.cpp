@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/compact_hash_grid.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+static constexpr int KeyBits = 21;
+static constexpr int KeyBias = 1 << (KeyBits - 1);
+static constexpr uint64_t KeyMask = (uint64_t(1) << KeyBits) - 1;
+
+template<int Dim>
+BasicCompactHashGrid<Dim>::BasicCompactHashGrid(Vec origin, float cellSize, uint32_t tableSize)
+	: origin(origin), invCellSize(1.f / cellSize)
+{
+	if (cellSize <= 0.f)
+		throw std::invalid_argument("CompactHashGrid cell size must be positive!");
+
+	if (tableSize > 0) bucketStart.assign(static_cast<size_t>(tableSize) + 1, 0);
+}
+
+template<int Dim>
+uint64_t BasicCompactHashGrid<Dim>::pack(const IVec& coord)
+{
+	uint64_t key = 0;
+	for (int axis = 0; axis < Dim; axis++)
+		key |= (static_cast<uint64_t>(coord[axis] + KeyBias) & KeyMask) << (axis * KeyBits);
+	return key;
+}
+
+template<int Dim>
+typename BasicCompactHashGrid<Dim>::IVec BasicCompactHashGrid<Dim>::unpack(uint64_t key)
+{
+	IVec coord;
+	for (int axis = 0; axis < Dim; axis++)
+		coord[axis] = static_cast<int>((key >> (axis * KeyBits)) & KeyMask) - KeyBias;
+	return coord;
+}
+
+template<int Dim>
+uint32_t BasicCompactHashGrid<Dim>::hash(const IVec& coord) const
+{
+	uint32_t h = (static_cast<uint32_t>(coord.x) * 73856093u)
+		^ (static_cast<uint32_t>(coord.y) * 19349663u);
+	if constexpr (Dim == 3) h ^= static_cast<uint32_t>(coord.z) * 83492791u;
+	return h % tableSize();
+}
+
+template<int Dim>
+typename BasicCompactHashGrid<Dim>::IVec BasicCompactHashGrid<Dim>::cellCoord(const Vec& position) const
+{
+	IVec coord = IVec(glm::floor((position - origin) * invCellSize));
+	return glm::clamp(coord, IVec(-KeyBias + 1), IVec(KeyBias - 2));
+}
+
+template<int Dim>
+uint32_t BasicCompactHashGrid<Dim>::findCell(const IVec& coord) const
+{
+	uint32_t h = hash(coord);
+	uint64_t key = pack(coord);
+
+	for (uint32_t cell = bucketStart[h]; cell < bucketStart[h + 1]; cell++)
+		if (cells[cell].key == key) return cell;
+
+	return InvalidCell;
+}
+
+template<int Dim>
+void BasicCompactHashGrid<Dim>::build(const std::vector<BasicParticle<Dim>>& particles)
+{
+	const size_t count = particles.size();
+
+	if (tableSize() < 2) {
+		uint32_t size = std::bit_ceil(static_cast<uint32_t>(std::max<size_t>(2 * count, 64)));
+		bucketStart.assign(static_cast<size_t>(size) + 1, 0);
+	}
+
+	std::vector<uint32_t> hashes(count);
+	std::vector<uint64_t> keys(count);
+	particleIndices.resize(count);
+	particleCell.resize(count);
+
+	/* Counting sort by hash bucket, the table doubles as the histogram. */
+	std::fill(bucketStart.begin(), bucketStart.end(), 0);
+	for (size_t i = 0; i < count; i++) {
+		IVec coord = cellCoord(particles[i].position);
+		hashes[i] = hash(coord);
+		keys[i] = pack(coord);
+		bucketStart[hashes[i] + 1]++;
+	}
+
+	for (size_t b = 1; b < bucketStart.size(); b++)
+		bucketStart[b] += bucketStart[b - 1];
+
+	std::vector<uint32_t> cursor(bucketStart.begin(), bucketStart.end() - 1);
+	for (size_t i = 0; i < count; i++)
+		particleIndices[cursor[hashes[i]]++] = static_cast<uint32_t>(i);
+
+	/* Colliding cells share a bucket, group them by key inside it. */
+	for (uint32_t b = 0; b < tableSize(); b++) {
+		if (bucketStart[b + 1] - bucketStart[b] < 2) continue;
+		std::sort(particleIndices.begin() + bucketStart[b], particleIndices.begin() + bucketStart[b + 1],
+			[&](uint32_t a, uint32_t c) { return keys[a] < keys[c]; });
+	}
+
+	cells.clear();
+	for (uint32_t sorted = 0; sorted < count; sorted++) {
+		uint32_t i = particleIndices[sorted];
+		if (cells.empty() || cells.back().key != keys[i])
+			cells.push_back({ keys[i], sorted, 0 });
+
+		cells.back().count++;
+		particleCell[i] = static_cast<uint32_t>(cells.size()) - 1;
+	}
+
+	/* Rebuild the table as hash -> compact cell range. */
+	std::fill(bucketStart.begin(), bucketStart.end(), 0);
+	for (const Cell& cell : cells)
+		bucketStart[hashes[particleIndices[cell.start]] + 1]++;
+
+	for (size_t b = 1; b < bucketStart.size(); b++)
+		bucketStart[b] += bucketStart[b - 1];
+}
+
+template<int Dim>
+size_t BasicCompactHashGrid<Dim>::memoryBytes() const
+{
+	return bucketStart.capacity() * sizeof(uint32_t) + cells.capacity() * sizeof(Cell)
+		+ (particleIndices.capacity() + particleCell.capacity()) * sizeof(uint32_t);
+}
+
+template class BasicCompactHashGrid<2>;
+template class BasicCompactHashGrid<3>;
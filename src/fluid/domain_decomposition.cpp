@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/domain_decomposition.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+
+template<typename T>
+static std::vector<std::byte> serialize(const std::vector<T>& values)
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+
+	std::vector<std::byte> bytes(values.size() * sizeof(T));
+	std::memcpy(bytes.data(), values.data(), bytes.size());
+	return bytes;
+}
+
+template<typename T>
+static void deserializeAppend(const std::vector<std::byte>& bytes, std::vector<T>& values)
+{
+	if (bytes.size() % sizeof(T) != 0)
+		throw std::runtime_error("Received truncated halo message");
+
+	size_t offset = values.size();
+	values.resize(offset + bytes.size() / sizeof(T));
+	std::memcpy(values.data() + offset, bytes.data(), bytes.size());
+}
+
+/* === DomainDecomposition === */
+
+DomainDecomposition::DomainDecomposition(HaloTransport& transport, const DecompositionParams& params,
+		glm::vec3 boundsMin, glm::vec3 boundsMax)
+	: transport(transport), params(params),
+	  domainMin(boundsMin[params.axis]), domainMax(boundsMax[params.axis])
+{
+	if (params.axis < 0 || params.axis > 2)
+		throw std::invalid_argument("Decomposition axis must be 0, 1 or 2");
+
+	boundaries.resize(transport.size() + 1);
+	for (int r = 0; r <= transport.size(); r++)
+		boundaries[r] = domainMin + (domainMax - domainMin) * static_cast<float>(r) / transport.size();
+}
+
+int DomainDecomposition::ownerOf(const glm::vec3& position) const
+{
+	auto it = std::upper_bound(boundaries.begin() + 1, boundaries.end() - 1, position[params.axis]);
+	return static_cast<int>(it - (boundaries.begin() + 1));
+}
+
+std::vector<Particle> DomainDecomposition::exchange(const std::vector<std::vector<Particle>>& outgoing)
+{
+	for (int peer = 0; peer < transport.size(); peer++)
+		if (peer != transport.rank()) transport.send(peer, serialize(outgoing[peer]));
+
+	std::vector<Particle> incoming;
+	for (int peer = 0; peer < transport.size(); peer++)
+		if (peer != transport.rank()) deserializeAppend(transport.receive(peer), incoming);
+
+	return incoming;
+}
+
+std::vector<uint32_t> DomainDecomposition::allGather(const std::vector<uint32_t>& values)
+{
+	for (int peer = 0; peer < transport.size(); peer++)
+		if (peer != transport.rank()) transport.send(peer, serialize(values));
+
+	std::vector<uint32_t> gathered;
+	for (int peer = 0; peer < transport.size(); peer++) {
+		if (peer == transport.rank()) gathered.insert(gathered.end(), values.begin(), values.end());
+		else deserializeAppend(transport.receive(peer), gathered);
+	}
+
+	return gathered;
+}
+
+void DomainDecomposition::migrate(std::vector<Particle>& owned)
+{
+	std::vector<std::vector<Particle>> outgoing(transport.size());
+
+	auto leaving = std::stable_partition(owned.begin(), owned.end(), [&](const Particle& p) {
+		return ownerOf(p.position) == transport.rank();
+	});
+	for (auto it = leaving; it != owned.end(); ++it)
+		outgoing[ownerOf(it->position)].push_back(*it);
+	owned.erase(leaving, owned.end());
+
+	std::vector<Particle> arrived = exchange(outgoing);
+	owned.insert(owned.end(), arrived.begin(), arrived.end());
+}
+
+std::vector<Particle> DomainDecomposition::exchangeHalo(const std::vector<Particle>& owned)
+{
+	std::vector<std::vector<Particle>> outgoing(transport.size());
+
+	for (const Particle& p : owned) {
+		glm::vec3 low = p.position;
+		glm::vec3 high = p.position;
+		low[params.axis] -= params.haloWidth;
+		high[params.axis] += params.haloWidth;
+
+		for (int peer = ownerOf(low); peer <= ownerOf(high); peer++)
+			if (peer != transport.rank()) outgoing[peer].push_back(p);
+	}
+
+	return exchange(outgoing);
+}
+
+bool DomainDecomposition::rebalance(std::vector<Particle>& owned)
+{
+	std::vector<uint32_t> counts = allGather({ static_cast<uint32_t>(owned.size()) });
+	uint64_t total = std::accumulate(counts.begin(), counts.end(), uint64_t(0));
+	if (total == 0) return false;
+
+	float mean = static_cast<float>(total) / transport.size();
+	if (static_cast<float>(*std::ranges::max_element(counts)) <= mean * (1.f + params.imbalanceTolerance))
+		return false;
+
+	/* Global histogram along the split axis, then place cuts at equal-count quantiles. */
+	const uint32_t bins = params.histogramBins;
+	const float binWidth = (domainMax - domainMin) / bins;
+
+	std::vector<uint32_t> local(bins, 0);
+	for (const Particle& p : owned) {
+		int bin = static_cast<int>((p.position[params.axis] - domainMin) / binWidth);
+		local[std::clamp(bin, 0, static_cast<int>(bins) - 1)]++;
+	}
+
+	std::vector<uint32_t> gathered = allGather(local);
+	std::vector<uint64_t> histogram(bins, 0);
+	for (size_t i = 0; i < gathered.size(); i++)
+		histogram[i % bins] += gathered[i];
+
+	uint64_t cumulative = 0;
+	uint32_t bin = 0;
+	for (int r = 1; r < transport.size(); r++) {
+		uint64_t target = total * r / transport.size();
+		while (bin < bins && cumulative + histogram[bin] < target)
+			cumulative += histogram[bin++];
+
+		float fraction = bin < bins && histogram[bin] > 0
+			? static_cast<float>(target - cumulative) / histogram[bin]
+			: 0.f;
+		boundaries[r] = std::max(boundaries[r - 1], domainMin + (bin + fraction) * binWidth);
+	}
+
+	migrate(owned);
+	return true;
+}
+
+/* === DistributedSphSolver === */
+
+static SphParams withoutSleep(SphParams params)
+{
+	params.sleep.enabled = false;
+	return params;
+}
+
+static DecompositionParams withHaloWidth(DecompositionParams params, const SphParams& sphParams)
+{
+	const float minimum = 2.f * sphParams.smoothingRadius;
+	if (params.haloWidth == 0.f) params.haloWidth = minimum;
+	if (params.haloWidth < minimum)
+		throw std::invalid_argument("Halo width must be at least two smoothing radii");
+	return params;
+}
+
+DistributedSphSolver::DistributedSphSolver(HaloTransport& transport, const SphParams& sphParams,
+		DecompositionParams decompositionParams)
+	: solver(withoutSleep(sphParams)),
+	  decomposition(transport, withHaloWidth(decompositionParams, sphParams), sphParams.boundsMin, sphParams.boundsMax),
+	  params(withHaloWidth(decompositionParams, sphParams))
+{
+}
+
+void DistributedSphSolver::addParticles(std::vector<Particle> particles)
+{
+	decomposition.migrate(particles);
+	solver.addParticles(particles);
+}
+
+void DistributedSphSolver::step()
+{
+	std::vector<Particle> owned(solver.getParticles().begin(), solver.getParticles().end());
+
+	bool rebalanced = params.rebalanceInterval > 0
+		&& stepCount % params.rebalanceInterval == 0
+		&& decomposition.rebalance(owned);
+	if (!rebalanced) decomposition.migrate(owned);
+
+	std::vector<Particle> ghosts = decomposition.exchangeHalo(owned);
+	solver.setParticles(std::move(owned));
+	solver.setGhostParticles(ghosts);
+	solver.step();
+
+	stepCount++;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/fft.hpp"
+#include "fluid/parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+static constexpr size_t L = FftPlan::Lanes;
+
+/* Radix 4 first so powers of two take half as many passes. */
+static std::vector<size_t> factorize(size_t n)
+{
+	std::vector<size_t> factors;
+	while (n % 4 == 0) { factors.push_back(4); n /= 4; }
+	for (size_t p : { 2, 3, 5 })
+		while (n % p == 0) { factors.push_back(p); n /= p; }
+	for (size_t p = 7; n > 1; p += 2)
+		while (n % p == 0) { factors.push_back(p); n /= p; }
+	return factors;
+}
+
+FftPlan::FftPlan(size_t n)
+	: n(std::max<size_t>(n, 1))
+{
+	size_t length = this->n;
+	size_t stride = 1;
+	for (size_t radix : factorize(this->n)) {
+		Stage stage;
+		stage.radix = radix;
+		stage.m = length / radix;
+		stage.stride = stride;
+		stage.twiddleRe.resize(stage.m * radix);
+		stage.twiddleIm.resize(stage.m * radix);
+		for (size_t p = 0; p < stage.m; p++) {
+			for (size_t k = 0; k < radix; k++) {
+				double angle = -2.0 * std::numbers::pi * static_cast<double>(p * k) / static_cast<double>(length);
+				stage.twiddleRe[p * radix + k] = static_cast<float>(std::cos(angle));
+				stage.twiddleIm[p * radix + k] = static_cast<float>(std::sin(angle));
+			}
+		}
+		stages.push_back(std::move(stage));
+		length /= radix;
+		stride *= radix;
+	}
+}
+
+/*
+ * One decimation in frequency pass: the radix inputs p + j m are combined
+ * into outputs radix p + k, the next stage sees radix times the stride.
+ * Inverse transforms negate the imaginary part of every root of unity.
+ */
+template<size_t Radix> requires (Radix == 2 || Radix == 4)
+static void butterflyPass(size_t m, size_t stride, const float* twRe, const float* twIm, float sign,
+	const float* xr, const float* xi, float* yr, float* yi)
+{
+	const size_t s = stride * L;
+	for (size_t p = 0; p < m; p++) {
+		const float* w0 = twRe + p * Radix;
+		const float* w1 = twIm + p * Radix;
+		for (size_t q = 0; q < s; q += L) {
+			const float* ar = xr + q + s * p;
+			const float* ai = xi + q + s * p;
+			float* br = yr + q + s * Radix * p;
+			float* bi = yi + q + s * Radix * p;
+			const size_t in = s * m;
+
+			if constexpr (Radix == 2) {
+				for (size_t l = 0; l < L; l++) {
+					float r0 = ar[l], i0 = ai[l], r1 = ar[in + l], i1 = ai[in + l];
+					float dr = r0 - r1, di = i0 - i1;
+					br[l] = r0 + r1;
+					bi[l] = i0 + i1;
+					br[s + l] = dr * w0[1] - di * sign * w1[1];
+					bi[s + l] = dr * sign * w1[1] + di * w0[1];
+				}
+			}
+			else if constexpr (Radix == 4) {
+				for (size_t l = 0; l < L; l++) {
+					float r0 = ar[l], i0 = ai[l];
+					float r1 = ar[in + l], i1 = ai[in + l];
+					float r2 = ar[2 * in + l], i2 = ai[2 * in + l];
+					float r3 = ar[3 * in + l], i3 = ai[3 * in + l];
+
+					float s02r = r0 + r2, s02i = i0 + i2, d02r = r0 - r2, d02i = i0 - i2;
+					float s13r = r1 + r3, s13i = i1 + i3, d13r = r1 - r3, d13i = i1 - i3;
+					/* -i * sign * d13 */
+					float rotr = sign * d13i, roti = -sign * d13r;
+
+					float yr1 = d02r + rotr, yi1 = d02i + roti;
+					float yr2 = s02r - s13r, yi2 = s02i - s13i;
+					float yr3 = d02r - rotr, yi3 = d02i - roti;
+
+					br[l] = s02r + s13r;
+					bi[l] = s02i + s13i;
+					br[s + l] = yr1 * w0[1] - yi1 * sign * w1[1];
+					bi[s + l] = yr1 * sign * w1[1] + yi1 * w0[1];
+					br[2 * s + l] = yr2 * w0[2] - yi2 * sign * w1[2];
+					bi[2 * s + l] = yr2 * sign * w1[2] + yi2 * w0[2];
+					br[3 * s + l] = yr3 * w0[3] - yi3 * sign * w1[3];
+					bi[3 * s + l] = yr3 * sign * w1[3] + yi3 * w0[3];
+				}
+			}
+		}
+	}
+}
+
+/* Any other radix as a plain DFT of its inputs. */
+static void dftPass(size_t radix, size_t m, size_t stride, const float* twRe, const float* twIm, float sign,
+	const float* xr, const float* xi, float* yr, float* yi)
+{
+	const size_t s = stride * L;
+	const size_t in = s * m;
+	std::vector<float> rootRe(radix), rootIm(radix);
+	for (size_t k = 0; k < radix; k++) {
+		double angle = -2.0 * std::numbers::pi * static_cast<double>(k) / static_cast<double>(radix);
+		rootRe[k] = static_cast<float>(std::cos(angle));
+		rootIm[k] = sign * static_cast<float>(std::sin(angle));
+	}
+
+	for (size_t p = 0; p < m; p++) {
+		for (size_t q = 0; q < s; q += L) {
+			const float* ar = xr + q + s * p;
+			const float* ai = xi + q + s * p;
+			float* br = yr + q + s * radix * p;
+			float* bi = yi + q + s * radix * p;
+			for (size_t k = 0; k < radix; k++) {
+				float sumr[L] {}, sumi[L] {};
+				for (size_t j = 0; j < radix; j++) {
+					const float cr = rootRe[(j * k) % radix], ci = rootIm[(j * k) % radix];
+					for (size_t l = 0; l < L; l++) {
+						sumr[l] += ar[j * in + l] * cr - ai[j * in + l] * ci;
+						sumi[l] += ar[j * in + l] * ci + ai[j * in + l] * cr;
+					}
+				}
+				const float wr = twRe[p * radix + k], wi = sign * twIm[p * radix + k];
+				for (size_t l = 0; l < L; l++) {
+					br[k * s + l] = sumr[l] * wr - sumi[l] * wi;
+					bi[k * s + l] = sumr[l] * wi + sumi[l] * wr;
+				}
+			}
+		}
+	}
+}
+
+void FftPlan::transform(float* re, float* im, float* scratchRe, float* scratchIm, bool inverse) const
+{
+	const float sign = inverse ? -1.f : 1.f;
+	float* xr = re;
+	float* xi = im;
+	float* yr = scratchRe;
+	float* yi = scratchIm;
+
+	for (const Stage& stage : stages) {
+		const float* wr = stage.twiddleRe.data();
+		const float* wi = stage.twiddleIm.data();
+		switch (stage.radix) {
+		case 2: butterflyPass<2>(stage.m, stage.stride, wr, wi, sign, xr, xi, yr, yi); break;
+		case 4: butterflyPass<4>(stage.m, stage.stride, wr, wi, sign, xr, xi, yr, yi); break;
+		default: dftPass(stage.radix, stage.m, stage.stride, wr, wi, sign, xr, xi, yr, yi); break;
+		}
+		std::swap(xr, yr);
+		std::swap(xi, yi);
+	}
+
+	if (xr != re) {
+		std::copy(xr, xr + n * L, re);
+		std::copy(xi, xi + n * L, im);
+	}
+}
+
+Fft3d::Fft3d(glm::ivec3 dims)
+	: dims(dims), plans { FftPlan(dims.x), FftPlan(dims.y), FftPlan(dims.z) }
+{
+}
+
+/*
+ * Pencils along axis are gathered Lanes at a time. For y and z the lanes
+ * are neighbouring x positions, so gathers read contiguous memory; for x
+ * they are neighbouring rows.
+ */
+void Fft3d::transformAxis(int axis, float* re, float* im, bool inverse) const
+{
+	const size_t nx = dims.x, ny = dims.y;
+	const size_t length = dims[axis];
+	const size_t strides[3] = { 1, nx, nx * ny };
+	const size_t elementStride = strides[axis];
+
+	/* Pencil p = (a, b) spans the two other axes, a is the one with the smaller stride. */
+	const int axisA = axis == 0 ? 1 : 0;
+	const int axisB = axis == 2 ? 1 : 2;
+	const size_t countA = dims[axisA], countB = dims[axisB];
+	const size_t batchesA = (countA + L - 1) / L;
+
+	parallelFor(batchesA * countB, 1, [&](size_t begin, size_t end) {
+		std::vector<float> bufRe(length * L), bufIm(length * L), tmpRe(length * L), tmpIm(length * L);
+		size_t offsets[L];
+
+		for (size_t batch = begin; batch < end; batch++) {
+			const size_t a0 = (batch % batchesA) * L;
+			const size_t b = batch / batchesA;
+			const size_t lanes = std::min(L, countA - a0);
+			for (size_t l = 0; l < L; l++)
+				offsets[l] = (a0 + std::min(l, lanes - 1)) * strides[axisA] + b * strides[axisB];
+
+			for (size_t e = 0; e < length; e++) {
+				for (size_t l = 0; l < L; l++) {
+					bufRe[e * L + l] = re[offsets[l] + e * elementStride];
+					bufIm[e * L + l] = im[offsets[l] + e * elementStride];
+				}
+			}
+
+			plans[axis].transform(bufRe.data(), bufIm.data(), tmpRe.data(), tmpIm.data(), inverse);
+
+			for (size_t e = 0; e < length; e++) {
+				for (size_t l = 0; l < lanes; l++) {
+					re[offsets[l] + e * elementStride] = bufRe[e * L + l];
+					im[offsets[l] + e * elementStride] = bufIm[e * L + l];
+				}
+			}
+		}
+	});
+}
+
+void Fft3d::transform(std::vector<float>& re, std::vector<float>& im, bool inverse) const
+{
+	for (int axis = 0; axis < 3; axis++)
+		if (dims[axis] > 1) transformAxis(axis, re.data(), im.data(), inverse);
+}
@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/flip_solver.hpp"
+#include "fluid/parallel.hpp"
+#include "fluid/voxelizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+/* Samples of one velocity component: array size and sample position inside a cell. */
+struct FaceLayout {
+	glm::ivec3 size;
+	glm::vec3 offset;
+};
+
+static FaceLayout faceLayout(const glm::ivec3& dims, int axis)
+{
+	FaceLayout layout { dims, glm::vec3(0.5f) };
+	layout.size[axis] += 1;
+	layout.offset[axis] = 0.f;
+	return layout;
+}
+
+/*
+ * Calls fn(index, weight, gradient, delta) for the 8 samples around grid
+ * position g (in cell units). gradient is d weight / d g, delta is the
+ * sample position minus g. Positions are clamped into the array, so every
+ * touched sample lies within one cell of the cell containing g.
+ */
+template<typename F>
+static void forEachSample(const FaceLayout& layout, const glm::vec3& g, F&& fn)
+{
+	glm::vec3 p = glm::clamp(g - layout.offset, glm::vec3(0.f), glm::vec3(layout.size - 1));
+	glm::ivec3 base = glm::min(glm::ivec3(p), glm::max(layout.size - 2, glm::ivec3(0)));
+	glm::vec3 f = p - glm::vec3(base);
+
+	const glm::vec3 weight[2] = { 1.f - f, f };
+	const float slope[2] = { -1.f, 1.f };
+
+	for (int dz = 0; dz < 2; dz++) {
+		for (int dy = 0; dy < 2; dy++) {
+			for (int dx = 0; dx < 2; dx++) {
+				glm::ivec3 node = glm::min(base + glm::ivec3(dx, dy, dz), layout.size - 1);
+				size_t index = (static_cast<size_t>(node.z) * layout.size.y + node.y) * layout.size.x + node.x;
+
+				float w = weight[dx].x * weight[dy].y * weight[dz].z;
+				glm::vec3 gradient {
+					slope[dx] * weight[dy].y * weight[dz].z,
+					weight[dx].x * slope[dy] * weight[dz].z,
+					weight[dx].x * weight[dy].y * slope[dz]
+				};
+				fn(index, w, gradient, glm::vec3(node) + layout.offset - g);
+			}
+		}
+	}
+}
+
+HybridSolver::HybridSolver(const HybridParams& params, std::unique_ptr<PressureSolver> pressureSolver)
+	: params(params),
+	  grid(params.resolution, params.cellSize, params.origin),
+	  pressureSolver(std::move(pressureSolver)),
+	  levelSet(LevelSetParams { .cellSize = params.cellSize, .origin = params.origin, .bandWidth = 1 })
+{
+	solidMask.assign(grid.cellCount(), CellType::Air);
+	grid.cellType = solidMask;
+}
+
+void HybridSolver::addFluidBox(glm::vec3 boxMin, glm::vec3 boxMax, glm::vec3 velocity)
+{
+	const int n = params.particlesPerAxis;
+	const float spacing = 1.f / n;
+	std::mt19937 rng(static_cast<uint32_t>(particles.size()));
+	std::uniform_real_distribution<float> jitter(-0.25f * spacing, 0.25f * spacing);
+
+	glm::ivec3 lo = glm::max(glm::ivec3(glm::floor(grid.toGrid(boxMin))), glm::ivec3(0));
+	glm::ivec3 hi = glm::min(glm::ivec3(glm::ceil(grid.toGrid(boxMax))), grid.dims);
+
+	for (int k = lo.z; k < hi.z; k++) {
+		for (int j = lo.y; j < hi.y; j++) {
+			for (int i = lo.x; i < hi.x; i++) {
+				if (solidMask[grid.cellIndex(i, j, k)] == CellType::Solid) continue;
+
+				for (int c = 0; c < n * n * n; c++) {
+					glm::vec3 sub { (c % n + 0.5f) * spacing, (c / n % n + 0.5f) * spacing, (c / (n * n) + 0.5f) * spacing };
+					glm::vec3 g = glm::vec3(i, j, k) + sub + glm::vec3(jitter(rng), jitter(rng), jitter(rng));
+					glm::vec3 position = grid.origin + g * grid.cellSize;
+					if (glm::any(glm::lessThan(position, boxMin)) || glm::any(glm::greaterThan(position, boxMax))) continue;
+
+					particles.push_back({ .position = position, .velocity = velocity });
+				}
+			}
+		}
+	}
+}
+
+void HybridSolver::addSolidMesh(std::span<const glm::vec3> positions, std::span<const uint32_t> indices)
+{
+	std::vector<uint8_t> solid = voxelizeMesh(positions, indices, grid.dims, grid.origin, grid.cellSize);
+
+	for (size_t c = 0; c < solid.size(); c++)
+		if (solid[c]) solidMask[c] = grid.cellType[c] = CellType::Solid;
+
+	std::erase_if(particles, [&](const HybridParticle& p) { return solidMask[cellOf(p.position)] == CellType::Solid; });
+}
+
+size_t HybridSolver::cellOf(const glm::vec3& position) const
+{
+	glm::ivec3 cell = glm::clamp(glm::ivec3(glm::floor(grid.toGrid(position))), glm::ivec3(0), grid.dims - 1);
+	return grid.cellIndex(cell.x, cell.y, cell.z);
+}
+
+void HybridSolver::step()
+{
+	sortParticles();
+	particlesToGrid();
+	markCells();
+	extrapolateVelocity(2);
+
+	uOld = grid.u;
+	vOld = grid.v;
+	wOld = grid.w;
+
+	const float dt = params.timeStep;
+	for (float& u : grid.u) u += dt * params.gravity.x;
+	for (float& v : grid.v) v += dt * params.gravity.y;
+	for (float& w : grid.w) w += dt * params.gravity.z;
+
+	enforceSolidBoundaries(grid);
+	projectVelocity(grid, *pressureSolver, rhs);
+
+	/* Only faces next to fluid are valid after the projection, extend them into the air again. */
+	auto fluidAt = [&](int i, int j, int k) {
+		if (i < 0 || j < 0 || k < 0 || i >= grid.dims.x || j >= grid.dims.y || k >= grid.dims.z) return false;
+		return grid.cellType[grid.cellIndex(i, j, k)] == CellType::Fluid;
+	};
+	for (int axis = 0; axis < 3; axis++) {
+		FaceLayout layout = faceLayout(grid.dims, axis);
+		std::vector<float>& weight = axis == 0 ? uWeight : axis == 1 ? vWeight : wWeight;
+		glm::ivec3 step(0);
+		step[axis] = 1;
+
+		for (int k = 0; k < layout.size.z; k++)
+			for (int j = 0; j < layout.size.y; j++)
+				for (int i = 0; i < layout.size.x; i++)
+					weight[(static_cast<size_t>(k) * layout.size.y + j) * layout.size.x + i] =
+						fluidAt(i, j, k) || fluidAt(i - step.x, j - step.y, k - step.z) ? 1.f : 0.f;
+	}
+	extrapolateVelocity(2);
+	enforceSolidBoundaries(grid);
+
+	gridToParticles();
+	advectParticles();
+}
+
+void HybridSolver::sortParticles()
+{
+	cellStart.assign(grid.cellCount() + 1, 0);
+	for (const HybridParticle& p : particles)
+		cellStart[cellOf(p.position) + 1]++;
+	for (size_t c = 0; c < grid.cellCount(); c++)
+		cellStart[c + 1] += cellStart[c];
+
+	std::vector<uint32_t> cursor(cellStart.begin(), cellStart.end() - 1);
+	sorted.resize(particles.size());
+	for (const HybridParticle& p : particles)
+		sorted[cursor[cellOf(p.position)]++] = p;
+	particles.swap(sorted);
+}
+
+void HybridSolver::particlesToGrid()
+{
+	std::vector<float>* value[3] = { &grid.u, &grid.v, &grid.w };
+	std::vector<float>* weight[3] = { &uWeight, &vWeight, &wWeight };
+	FaceLayout layout[3];
+
+	for (int axis = 0; axis < 3; axis++) {
+		layout[axis] = faceLayout(grid.dims, axis);
+		value[axis]->assign(value[axis]->size(), 0.f);
+		weight[axis]->assign(value[axis]->size(), 0.f);
+	}
+
+	const bool apic = params.mode == TransferMode::Apic;
+	const int blockSize = std::max(params.blockSize, 2);
+	const glm::ivec3 blocks = (grid.dims + blockSize - 1) / blockSize;
+
+	for (int color = 0; color < 8; color++) {
+		const glm::ivec3 parity { color & 1, (color >> 1) & 1, (color >> 2) & 1 };
+		const glm::ivec3 colored = glm::max((blocks - parity + 1) / 2, glm::ivec3(0));
+		const size_t count = static_cast<size_t>(colored.x) * colored.y * colored.z;
+
+		parallelFor(count, 1, [&](size_t begin, size_t end) {
+			for (size_t b = begin; b < end; b++) {
+				glm::ivec3 block {
+					parity.x + 2 * static_cast<int>(b % colored.x),
+					parity.y + 2 * static_cast<int>(b / colored.x % colored.y),
+					parity.z + 2 * static_cast<int>(b / (static_cast<size_t>(colored.x) * colored.y))
+				};
+				glm::ivec3 lo = block * blockSize;
+				glm::ivec3 hi = glm::min(lo + blockSize, grid.dims);
+
+				for (int k = lo.z; k < hi.z; k++) {
+					for (int j = lo.y; j < hi.y; j++) {
+						for (int i = lo.x; i < hi.x; i++) {
+							size_t c = grid.cellIndex(i, j, k);
+							for (uint32_t p = cellStart[c]; p < cellStart[c + 1]; p++) {
+								const HybridParticle& particle = particles[p];
+								glm::vec3 g = grid.toGrid(particle.position);
+
+								for (int axis = 0; axis < 3; axis++) {
+									forEachSample(layout[axis], g, [&](size_t index, float w, const glm::vec3&, const glm::vec3& delta) {
+										float velocity = particle.velocity[axis];
+										if (apic) velocity += glm::dot(particle.affine[axis], delta * grid.cellSize);
+										(*value[axis])[index] += w * velocity;
+										(*weight[axis])[index] += w;
+									});
+								}
+							}
+						}
+					}
+				}
+			}
+		});
+	}
+
+	for (int axis = 0; axis < 3; axis++) {
+		std::vector<float>& v = *value[axis];
+		const std::vector<float>& w = *weight[axis];
+		for (size_t f = 0; f < v.size(); f++)
+			if (w[f] > 0.f) v[f] /= w[f];
+	}
+}
+
+/*
+ * With levelSetCells, a cell is fluid where its centre lies inside spheres
+ * of 1.2 particle spacings around the particles: a freshly seeded box keeps
+ * exactly its cells, sparse particles near the surface no longer leave air
+ * gaps inside the liquid. Marking only needs the sign, so the band is one
+ * voxel wide.
+ */
+void HybridSolver::markCells()
+{
+	if (params.levelSetCells) {
+		positions.resize(particles.size());
+		for (size_t p = 0; p < particles.size(); p++) positions[p] = particles[p].position;
+
+		levelSet.buildFromParticles(positions, 1.2f * params.cellSize / params.particlesPerAxis);
+		grid.cellType = solidMask;
+		levelSet.markFluidCells(grid);
+		return;
+	}
+
+	for (size_t c = 0; c < grid.cellCount(); c++) {
+		if (solidMask[c] == CellType::Solid) grid.cellType[c] = CellType::Solid;
+		else grid.cellType[c] = cellStart[c + 1] > cellStart[c] ? CellType::Fluid : CellType::Air;
+	}
+}
+
+/* Fills faces without weight with the average of their valid neighbours, one layer per pass. */
+void HybridSolver::extrapolateVelocity(int layers)
+{
+	std::vector<float>* value[3] = { &grid.u, &grid.v, &grid.w };
+	std::vector<float>* weight[3] = { &uWeight, &vWeight, &wWeight };
+
+	for (int axis = 0; axis < 3; axis++) {
+		const glm::ivec3 size = faceLayout(grid.dims, axis).size;
+		std::vector<float>& v = *value[axis];
+		std::vector<float>& valid = *weight[axis];
+
+		for (int layer = 0; layer < layers; layer++) {
+			std::vector<float> previous = valid;
+
+			parallelFor(static_cast<size_t>(size.z), 1, [&](size_t begin, size_t end) {
+				for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++) {
+					for (int j = 0; j < size.y; j++) {
+						for (int i = 0; i < size.x; i++) {
+							size_t f = (static_cast<size_t>(k) * size.y + j) * size.x + i;
+							if (previous[f] > 0.f) continue;
+
+							float sum = 0.f;
+							int count = 0;
+							auto gather = [&](int ni, int nj, int nk) {
+								if (ni < 0 || nj < 0 || nk < 0 || ni >= size.x || nj >= size.y || nk >= size.z) return;
+								size_t n = (static_cast<size_t>(nk) * size.y + nj) * size.x + ni;
+								if (previous[n] > 0.f) {
+									sum += v[n];
+									count++;
+								}
+							};
+							gather(i - 1, j, k);
+							gather(i + 1, j, k);
+							gather(i, j - 1, k);
+							gather(i, j + 1, k);
+							gather(i, j, k - 1);
+							gather(i, j, k + 1);
+
+							if (count > 0) {
+								v[f] = sum / count;
+								valid[f] = 1.f;
+							}
+						}
+					}
+				}
+			});
+		}
+	}
+}
+
+void HybridSolver::gridToParticles()
+{
+	const std::vector<float>* value[3] = { &grid.u, &grid.v, &grid.w };
+	const std::vector<float>* old[3] = { &uOld, &vOld, &wOld };
+	FaceLayout layout[3];
+	for (int axis = 0; axis < 3; axis++)
+		layout[axis] = faceLayout(grid.dims, axis);
+
+	const bool apic = params.mode == TransferMode::Apic;
+	const float flip = apic ? 0.f : params.flipRatio;
+
+	parallelFor(particles.size(), 256, [&](size_t begin, size_t end) {
+		for (size_t p = begin; p < end; p++) {
+			HybridParticle& particle = particles[p];
+			glm::vec3 g = grid.toGrid(particle.position);
+
+			for (int axis = 0; axis < 3; axis++) {
+				float pic = 0.f;
+				float change = 0.f;
+				glm::vec3 affine(0.f);
+
+				forEachSample(layout[axis], g, [&](size_t index, float w, const glm::vec3& gradient, const glm::vec3&) {
+					float current = (*value[axis])[index];
+					pic += w * current;
+					change += w * (current - (*old[axis])[index]);
+					affine += gradient * (current / grid.cellSize);
+				});
+
+				particle.velocity[axis] = flip * (particle.velocity[axis] + change) + (1.f - flip) * pic;
+				particle.affine[axis] = apic ? affine : glm::vec3(0.f);
+			}
+		}
+	});
+}
+
+void HybridSolver::advectParticles()
+{
+	const float dt = params.timeStep;
+	const glm::vec3 lo = grid.origin + 0.01f * grid.cellSize;
+	const glm::vec3 hi = grid.origin + glm::vec3(grid.dims) * grid.cellSize - 0.01f * grid.cellSize;
+
+	parallelFor(particles.size(), 256, [&](size_t begin, size_t end) {
+		for (size_t p = begin; p < end; p++) {
+			HybridParticle& particle = particles[p];
+
+			/* Second order Runge-Kutta through the divergence free grid velocity. */
+			glm::vec3 mid = particle.position + 0.5f * dt * grid.sampleVelocity(particle.position);
+			glm::vec3 next = glm::clamp(particle.position + dt * grid.sampleVelocity(mid), lo, hi);
+
+			if (solidMask[cellOf(next)] != CellType::Solid) particle.position = next;
+		}
+	});
+}
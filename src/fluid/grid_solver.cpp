@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/grid_solver.hpp"
+#include "fluid/parallel.hpp"
+#include "fluid/voxelizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+GridSolver::GridSolver(const GridParams& params, std::unique_ptr<PressureSolver> pressureSolver)
+	: params(params),
+	  grid(params.resolution, params.cellSize, params.origin),
+	  pressureSolver(std::move(pressureSolver))
+{
+}
+
+void GridSolver::addSolidMesh(std::span<const glm::vec3> positions, std::span<const uint32_t> indices)
+{
+	std::vector<uint8_t> solid = voxelizeMesh(positions, indices, grid.dims, grid.origin, grid.cellSize);
+
+	for (size_t c = 0; c < solid.size(); c++)
+		if (solid[c]) grid.cellType[c] = CellType::Solid;
+}
+
+void GridSolver::step()
+{
+	applySources();
+	applyForces();
+	advect();
+	enforceSolidBoundaries(grid);
+	projectVelocity(grid, *pressureSolver, rhs);
+}
+
+void GridSolver::applySources()
+{
+	for (const GridSource& source : sources) {
+		glm::ivec3 lo = glm::max(glm::ivec3(glm::floor(grid.toGrid(source.center - source.radius))), glm::ivec3(0));
+		glm::ivec3 hi = glm::min(glm::ivec3(glm::floor(grid.toGrid(source.center + source.radius))), grid.dims - 1);
+
+		for (int k = lo.z; k <= hi.z; k++) {
+			for (int j = lo.y; j <= hi.y; j++) {
+				for (int i = lo.x; i <= hi.x; i++) {
+					glm::vec3 center = grid.origin + (glm::vec3(i, j, k) + 0.5f) * grid.cellSize;
+					if (glm::distance(center, source.center) > source.radius || grid.isSolid(i, j, k)) continue;
+
+					size_t c = grid.cellIndex(i, j, k);
+					grid.density[c] = std::max(grid.density[c], source.density);
+					grid.u[grid.uIndex(i, j, k)] = grid.u[grid.uIndex(i + 1, j, k)] = source.velocity.x;
+					grid.v[grid.vIndex(i, j, k)] = grid.v[grid.vIndex(i, j + 1, k)] = source.velocity.y;
+					grid.w[grid.wIndex(i, j, k)] = grid.w[grid.wIndex(i, j, k + 1)] = source.velocity.z;
+				}
+			}
+		}
+	}
+}
+
+void GridSolver::applyForces()
+{
+	const float dt = params.timeStep;
+	const glm::ivec3 n = grid.dims;
+
+	for (float& u : grid.u) u += dt * params.gravity.x;
+	for (float& w : grid.w) w += dt * params.gravity.z;
+
+	parallelFor(static_cast<size_t>(n.z), 1, [&](size_t begin, size_t end) {
+		for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++) {
+			for (int j = 0; j <= n.y; j++) {
+				const float* below = grid.density.data() + grid.cellIndex(0, std::max(j - 1, 0), k);
+				const float* above = grid.density.data() + grid.cellIndex(0, std::min(j, n.y - 1), k);
+				float* v = grid.v.data() + grid.vIndex(0, j, k);
+
+				for (int i = 0; i < n.x; i++)
+					v[i] += dt * (params.gravity.y + params.buoyancy * 0.5f * (below[i] + above[i]));
+			}
+		}
+	});
+}
+
+/* Per-thread buffers for one row of traced positions. */
+struct TraceScratch {
+	std::vector<float> x, y, z;    // sample positions in cell units
+	std::vector<float> mx, my, mz; // RK2 midpoints
+	std::vector<float> sx, sy, sz; // positions shifted to one velocity component's samples
+	std::vector<float> vx, vy, vz;
+
+	void resize(size_t count)
+	{
+		for (std::vector<float>* v : { &x, &y, &z, &mx, &my, &mz, &sx, &sy, &sz, &vx, &vy, &vz })
+			v->resize(count);
+	}
+};
+
+static void sampleVelocityRow(const MacGrid& grid, const std::vector<float>& u, const std::vector<float>& v, const std::vector<float>& w,
+	size_t count, const float* x, const float* y, const float* z, TraceScratch& s)
+{
+	const glm::ivec3 n = grid.dims;
+	for (size_t i = 0; i < count; i++) {
+		s.sx[i] = x[i];
+		s.sy[i] = y[i] - 0.5f;
+		s.sz[i] = z[i] - 0.5f;
+	}
+	sampleTrilinear(u, { n.x + 1, n.y, n.z }, s.sx.data(), s.sy.data(), s.sz.data(), s.vx.data(), count);
+
+	for (size_t i = 0; i < count; i++) {
+		s.sx[i] = x[i] - 0.5f;
+		s.sy[i] = y[i];
+	}
+	sampleTrilinear(v, { n.x, n.y + 1, n.z }, s.sx.data(), s.sy.data(), s.sz.data(), s.vy.data(), count);
+
+	for (size_t i = 0; i < count; i++) {
+		s.sy[i] = y[i] - 0.5f;
+		s.sz[i] = z[i];
+	}
+	sampleTrilinear(w, { n.x, n.y, n.z + 1 }, s.sx.data(), s.sy.data(), s.sz.data(), s.vz.data(), count);
+}
+
+/* Second order Runge-Kutta trace of s.x, s.y, s.z by step cells per unit velocity, negative to trace back. */
+static void traceRow(const MacGrid& grid, const std::vector<float>& u, const std::vector<float>& v, const std::vector<float>& w,
+	float step, size_t count, TraceScratch& s, float* outX, float* outY, float* outZ)
+{
+	sampleVelocityRow(grid, u, v, w, count, s.x.data(), s.y.data(), s.z.data(), s);
+	for (size_t i = 0; i < count; i++) {
+		s.mx[i] = s.x[i] + 0.5f * step * s.vx[i];
+		s.my[i] = s.y[i] + 0.5f * step * s.vy[i];
+		s.mz[i] = s.z[i] + 0.5f * step * s.vz[i];
+	}
+
+	sampleVelocityRow(grid, u, v, w, count, s.mx.data(), s.my.data(), s.mz.data(), s);
+	for (size_t i = 0; i < count; i++) {
+		outX[i] = s.x[i] + step * s.vx[i];
+		outY[i] = s.y[i] + step * s.vy[i];
+		outZ[i] = s.z[i] + step * s.vz[i];
+	}
+}
+
+/*
+ * Advects one quantity whose sample (0, 0, 0) sits at offset in cell units.
+ * Traced positions are stored in the quantity's own sample coordinates.
+ */
+void GridSolver::advectField(const std::vector<float>& source, std::vector<float>& target,
+	glm::ivec3 size, glm::vec3 offset, float decay)
+{
+	const size_t count = source.size();
+	const size_t rowLength = static_cast<size_t>(size.x);
+	const size_t rows = static_cast<size_t>(size.y) * size.z;
+	const float dtCells = params.timeStep / grid.cellSize;
+	const bool corrected = params.advection != AdvectionScheme::SemiLagrangian;
+
+	for (std::vector<float>* v : { &backX, &backY, &backZ, &advected })
+		v->resize(count);
+	if (corrected) {
+		for (std::vector<float>* v : { &lower, &upper, &forwardX, &forwardY, &forwardZ })
+			v->resize(count);
+	}
+
+	/* Semi-Lagrangian step, also the first half of the corrected schemes. */
+	parallelFor(rows, 4, [&](size_t begin, size_t end) {
+		TraceScratch scratch;
+		scratch.resize(rowLength);
+		for (size_t row = begin; row < end; row++) {
+			const size_t first = row * rowLength;
+			const float y = static_cast<float>(row % size.y) + offset.y;
+			const float z = static_cast<float>(row / size.y) + offset.z;
+			for (size_t i = 0; i < rowLength; i++) {
+				scratch.x[i] = static_cast<float>(i) + offset.x;
+				scratch.y[i] = y;
+				scratch.z[i] = z;
+			}
+
+			float* bx = &backX[first];
+			float* by = &backY[first];
+			float* bz = &backZ[first];
+			traceRow(grid, uPrev, vPrev, wPrev, -dtCells, rowLength, scratch, bx, by, bz);
+			for (size_t i = 0; i < rowLength; i++) {
+				bx[i] -= offset.x;
+				by[i] -= offset.y;
+				bz[i] -= offset.z;
+			}
+			sampleTrilinear(source, size, bx, by, bz, &advected[first], rowLength,
+				corrected ? &lower[first] : nullptr, corrected ? &upper[first] : nullptr);
+
+			if (!corrected) {
+				for (size_t i = 0; i < rowLength; i++)
+					target[first + i] = decay * advected[first + i];
+				continue;
+			}
+
+			traceRow(grid, uPrev, vPrev, wPrev, dtCells, rowLength, scratch, &forwardX[first], &forwardY[first], &forwardZ[first]);
+			for (size_t i = 0; i < rowLength; i++) {
+				forwardX[first + i] -= offset.x;
+				forwardY[first + i] -= offset.y;
+				forwardZ[first + i] -= offset.z;
+			}
+		}
+	});
+
+	if (!corrected) return;
+
+	/* Trace the result advected again, half the difference to the source is the error estimate. */
+	const bool bfecc = params.advection == AdvectionScheme::Bfecc;
+	if (bfecc) compensated.resize(count);
+
+	parallelFor(rows, 4, [&](size_t begin, size_t end) {
+		std::vector<float> roundTrip(rowLength);
+		for (size_t row = begin; row < end; row++) {
+			const size_t first = row * rowLength;
+			sampleTrilinear(advected, size, &forwardX[first], &forwardY[first], &forwardZ[first], roundTrip.data(), rowLength);
+
+			for (size_t i = 0; i < rowLength; i++) {
+				const size_t c = first + i;
+				const float error = 0.5f * (source[c] - roundTrip[i]);
+				if (bfecc) compensated[c] = source[c] + error;
+				else target[c] = decay * std::clamp(advected[c] + error, lower[c], upper[c]);
+			}
+		}
+	});
+
+	if (!bfecc) return;
+
+	parallelFor(rows, 4, [&](size_t begin, size_t end) {
+		for (size_t row = begin; row < end; row++) {
+			const size_t first = row * rowLength;
+			sampleTrilinear(compensated, size, &backX[first], &backY[first], &backZ[first], &target[first], rowLength);
+			for (size_t c = first; c < first + rowLength; c++)
+				target[c] = decay * std::clamp(target[c], lower[c], upper[c]);
+		}
+	});
+}
+
+void GridSolver::advect()
+{
+	const glm::ivec3 n = grid.dims;
+	const float decay = std::max(0.f, 1.f - params.densityDissipation * params.timeStep);
+
+	uPrev = grid.u;
+	vPrev = grid.v;
+	wPrev = grid.w;
+	densityPrev = grid.density;
+
+	advectField(uPrev, grid.u, { n.x + 1, n.y, n.z }, { 0.f, 0.5f, 0.5f }, 1.f);
+	advectField(vPrev, grid.v, { n.x, n.y + 1, n.z }, { 0.5f, 0.f, 0.5f }, 1.f);
+	advectField(wPrev, grid.w, { n.x, n.y, n.z + 1 }, { 0.5f, 0.5f, 0.f }, 1.f);
+	advectField(densityPrev, grid.density, n, glm::vec3(0.5f), decay);
+}
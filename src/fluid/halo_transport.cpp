@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/halo_transport.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* Yields while a peer is briefly idle, then sleeps up to a millisecond per poll. */
+static void backoff(uint32_t& idle)
+{
+	if (++idle < 64) {
+		std::this_thread::yield();
+		return;
+	}
+	std::this_thread::sleep_for(std::chrono::microseconds(1u << std::min<uint32_t>(idle - 64, 10)));
+}
+
+/* === HaloTransport === */
+
+HaloTransport::HaloTransport(int rank, int size)
+	: rankIndex(rank), rankCount(size), outgoing(static_cast<size_t>(size))
+{
+	if (size < 1 || rank < 0 || rank >= size)
+		throw std::invalid_argument("Invalid transport rank " + std::to_string(rank) + " of " + std::to_string(size));
+}
+
+void HaloTransport::send(int peer, std::vector<std::byte> message)
+{
+	uint64_t length = message.size();
+	std::vector<std::byte> header(sizeof(length));
+	std::memcpy(header.data(), &length, sizeof(length));
+
+	outgoing[peer].push_back({ std::move(header) });
+	outgoing[peer].push_back({ std::move(message) });
+	pumpSends();
+}
+
+std::vector<std::byte> HaloTransport::receive(int peer)
+{
+	uint64_t length = 0;
+	readExactly(peer, { reinterpret_cast<std::byte*>(&length), sizeof(length) });
+
+	std::vector<std::byte> message(length);
+	readExactly(peer, message);
+	return message;
+}
+
+void HaloTransport::flush()
+{
+	auto pending = [&]() {
+		return std::ranges::any_of(outgoing, [](const auto& queue) { return !queue.empty(); });
+	};
+
+	uint32_t idle = 0;
+	while (pending()) {
+		if (pumpSends()) idle = 0;
+		else backoff(idle);
+	}
+}
+
+bool HaloTransport::pumpSends()
+{
+	bool progress = false;
+
+	for (int peer = 0; peer < rankCount; peer++) {
+		auto& queue = outgoing[peer];
+		while (!queue.empty()) {
+			Outgoing& front = queue.front();
+			size_t written = front.offset < front.data.size()
+				? writeSome(peer, std::span(front.data).subspan(front.offset))
+				: 0;
+
+			front.offset += written;
+			progress |= written > 0;
+
+			if (front.offset < front.data.size()) break;
+			queue.pop_front();
+		}
+	}
+
+	return progress;
+}
+
+void HaloTransport::readExactly(int peer, std::span<std::byte> data)
+{
+	size_t offset = 0;
+	uint32_t idle = 0;
+	while (offset < data.size()) {
+		size_t read = readSome(peer, data.subspan(offset));
+		offset += read;
+
+		if (read > 0 || pumpSends()) idle = 0;
+		else backoff(idle);
+	}
+}
+
+/* === UnixSocketTransport === */
+
+static sockaddr_un socketAddress(const std::filesystem::path& path)
+{
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+
+	std::string string = path.string();
+	if (string.size() >= sizeof(address.sun_path))
+		throw std::runtime_error("Socket path too long: " + string);
+
+	std::memcpy(address.sun_path, string.c_str(), string.size() + 1);
+	return address;
+}
+
+UnixSocketTransport::UnixSocketTransport(int rank, int size, const std::filesystem::path& directory)
+	: HaloTransport(rank, size), sockets(static_cast<size_t>(size), -1)
+{
+	std::filesystem::create_directories(directory);
+	auto pathOf = [&](int r) { return directory / ("rank-" + std::to_string(r) + ".sock"); };
+
+	socketPath = pathOf(rank);
+	std::filesystem::remove(socketPath);
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address = socketAddress(socketPath);
+	if (listener < 0 ||
+		bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+		listen(listener, size) != 0) {
+		throw std::runtime_error("Failed to listen on " + socketPath.string() + ": " + std::strerror(errno));
+	}
+
+	/* Lower ranks are connected to, higher ranks connect to us and announce themselves. */
+	for (int peer = 0; peer < rank; peer++) {
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un peerAddress = socketAddress(pathOf(peer));
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+		while (connect(fd, reinterpret_cast<sockaddr*>(&peerAddress), sizeof(peerAddress)) != 0) {
+			if (std::chrono::steady_clock::now() > deadline)
+				throw std::runtime_error("Timed out connecting to rank " + std::to_string(peer));
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		int32_t self = rank;
+		if (::send(fd, &self, sizeof(self), 0) != sizeof(self))
+			throw std::runtime_error("Failed to announce rank to " + std::to_string(peer));
+		sockets[peer] = fd;
+	}
+
+	for (int accepted = rank + 1; accepted < size; accepted++) {
+		int fd = accept(listener, nullptr, nullptr);
+		int32_t peer = -1;
+		if (fd < 0 || recv(fd, &peer, sizeof(peer), MSG_WAITALL) != sizeof(peer) || peer <= rank || peer >= size)
+			throw std::runtime_error("Failed to accept peer connection on rank " + std::to_string(rank));
+		sockets[peer] = fd;
+	}
+
+	close(listener);
+}
+
+UnixSocketTransport::~UnixSocketTransport()
+{
+	/* A peer that already closed its end makes the last sends fail, they have nowhere to go. */
+	try {
+		flush();
+	}
+	catch (const std::exception&) {
+	}
+	for (int fd : sockets)
+		if (fd >= 0) close(fd);
+
+	/* The directory only goes once empty, so the last rank to leave removes it. */
+	std::error_code ec;
+	std::filesystem::remove(socketPath, ec);
+	std::filesystem::remove(socketPath.parent_path(), ec);
+}
+
+size_t UnixSocketTransport::writeSome(int peer, std::span<const std::byte> data)
+{
+	ssize_t written = ::send(sockets[peer], data.data(), data.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (written >= 0) return static_cast<size_t>(written);
+	if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+
+	throw std::runtime_error("Failed to send to rank " + std::to_string(peer) + ": " + std::strerror(errno));
+}
+
+size_t UnixSocketTransport::readSome(int peer, std::span<std::byte> data)
+{
+	ssize_t read = recv(sockets[peer], data.data(), data.size(), MSG_DONTWAIT);
+	if (read > 0) return static_cast<size_t>(read);
+	if (read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+
+	throw std::runtime_error("Connection to rank " + std::to_string(peer) + " closed");
+}
+
+/* === SharedMemoryTransport === */
+
+struct SharedMemoryTransport::Ring {
+	alignas(64) std::atomic<uint64_t> head;
+	alignas(64) std::atomic<uint64_t> tail;
+	alignas(64) std::byte data[1];
+};
+
+/* First 64 bytes of the segment, published by rank 0 once the rings are cleared. */
+struct SharedMemoryHeader {
+	std::atomic<uint32_t> ready;
+	std::atomic<int32_t> creator; // pid of rank 0
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory rings need lock-free atomics");
+static_assert(sizeof(SharedMemoryHeader) <= 64);
+
+static bool sameObject(int fd, const std::string& name)
+{
+	int current = shm_open(name.c_str(), O_RDWR, 0600);
+	if (current < 0) return false;
+
+	struct stat a {}, b {};
+	bool same = fstat(fd, &a) == 0 && fstat(current, &b) == 0 && a.st_dev == b.st_dev && a.st_ino == b.st_ino;
+	close(current);
+	return same;
+}
+
+SharedMemoryTransport::SharedMemoryTransport(int rank, int size, const std::string& name, size_t ringBytes)
+	: HaloTransport(rank, size), segmentName(name), ringBytes(ringBytes)
+{
+	size_t stride = (offsetof(Ring, data) + ringBytes + 63) & ~size_t(63);
+	segmentBytes = 64 + stride * size * size;
+
+	/*
+	 * Rank 0 replaces any segment left by an earlier run and clears the
+	 * rings before publishing it; the other ranks wait for that. A peer that
+	 * opened a stale segment sees it unlinked or its creator gone and retries.
+	 */
+	if (rank == 0) {
+		shm_unlink(segmentName.c_str());
+		int fd = shm_open(segmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0 || ftruncate(fd, static_cast<off_t>(segmentBytes)) != 0)
+			throw std::runtime_error("Failed to create shared memory " + segmentName + ": " + std::strerror(errno));
+
+		void* mapped = mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (mapped == MAP_FAILED)
+			throw std::runtime_error("Failed to map shared memory " + segmentName);
+		segment = static_cast<std::byte*>(mapped);
+
+		for (int from = 0; from < size; from++) {
+			for (int to = 0; to < size; to++) {
+				ring(from, to)->head.store(0, std::memory_order_relaxed);
+				ring(from, to)->tail.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		auto* header = reinterpret_cast<SharedMemoryHeader*>(segment);
+		header->creator.store(static_cast<int32_t>(getpid()), std::memory_order_relaxed);
+		header->ready.store(1, std::memory_order_release);
+		return;
+	}
+
+	uint32_t idle = 0;
+	while (!segment) {
+		int fd = shm_open(segmentName.c_str(), O_RDWR, 0600);
+		struct stat info {};
+		if (fd < 0 || fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) != segmentBytes) {
+			if (fd >= 0) close(fd);
+			backoff(idle);
+			continue;
+		}
+
+		void* mapped = mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (mapped == MAP_FAILED) {
+			close(fd);
+			throw std::runtime_error("Failed to map shared memory " + segmentName);
+		}
+
+		auto* header = static_cast<SharedMemoryHeader*>(mapped);
+		while (!header->ready.load(std::memory_order_acquire) && sameObject(fd, segmentName))
+			backoff(idle);
+
+		const pid_t creator = header->ready.load(std::memory_order_acquire) ? header->creator.load() : 0;
+		const bool live = creator > 0 && (kill(creator, 0) == 0 || errno == EPERM);
+		if (live && sameObject(fd, segmentName)) segment = static_cast<std::byte*>(mapped);
+		else munmap(mapped, segmentBytes);
+
+		close(fd);
+		if (!segment) backoff(idle);
+	}
+}
+
+SharedMemoryTransport::~SharedMemoryTransport()
+{
+	try {
+		flush();
+	}
+	catch (const std::exception&) {
+	}
+	munmap(segment, segmentBytes);
+	if (rank() == 0) shm_unlink(segmentName.c_str());
+}
+
+SharedMemoryTransport::Ring* SharedMemoryTransport::ring(int from, int to) const
+{
+	size_t stride = (segmentBytes - 64) / (static_cast<size_t>(size()) * size());
+	return reinterpret_cast<Ring*>(segment + 64 + stride * (static_cast<size_t>(from) * size() + to));
+}
+
+size_t SharedMemoryTransport::writeSome(int peer, std::span<const std::byte> data)
+{
+	Ring* r = ring(rank(), peer);
+	uint64_t head = r->head.load(std::memory_order_relaxed);
+	uint64_t tail = r->tail.load(std::memory_order_acquire);
+
+	size_t count = std::min<size_t>(ringBytes - (head - tail), data.size());
+	size_t offset = head % ringBytes;
+	size_t first = std::min(count, ringBytes - offset);
+
+	std::memcpy(r->data + offset, data.data(), first);
+	std::memcpy(r->data, data.data() + first, count - first);
+
+	r->head.store(head + count, std::memory_order_release);
+	return count;
+}
+
+size_t SharedMemoryTransport::readSome(int peer, std::span<std::byte> data)
+{
+	Ring* r = ring(peer, rank());
+	uint64_t tail = r->tail.load(std::memory_order_relaxed);
+	uint64_t head = r->head.load(std::memory_order_acquire);
+
+	size_t count = std::min<size_t>(head - tail, data.size());
+	size_t offset = tail % ringBytes;
+	size_t first = std::min(count, ringBytes - offset);
+
+	std::memcpy(data.data(), r->data + offset, first);
+	std::memcpy(data.data() + first, r->data, count - first);
+
+	r->tail.store(tail + count, std::memory_order_release);
+	return count;
+}
+
+std::unique_ptr<HaloTransport> createTransport(TransportKind kind, int rank, int size, const std::string& name)
+{
+	switch (kind) {
+	case TransportKind::SharedMemory:
+		return std::make_unique<SharedMemoryTransport>(rank, size, "/" + name);
+	case TransportKind::UnixSocket:
+		return std::make_unique<UnixSocketTransport>(rank, size, std::filesystem::temp_directory_path() / name);
+	}
+
+	throw std::invalid_argument("Unknown transport kind");
+}
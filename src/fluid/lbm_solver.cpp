@@ -0,0 +1,374 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/lbm_solver.hpp"
+#include "fluid/parallel.hpp"
+#include "fluid/voxelizer.hpp"
+
+#include <chrono>
+
+static constexpr int Q = 19;
+
+/* Rest, the 6 faces, then the 12 edges; every odd direction is followed by its opposite. */
+static constexpr int velocities[Q][3] = {
+	{ 0, 0, 0 },
+	{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+	{ 1, 1, 0 }, { -1, -1, 0 }, { 1, -1, 0 }, { -1, 1, 0 },
+	{ 1, 0, 1 }, { -1, 0, -1 }, { 1, 0, -1 }, { -1, 0, 1 },
+	{ 0, 1, 1 }, { 0, -1, -1 }, { 0, 1, -1 }, { 0, -1, 1 }
+};
+
+static constexpr float weights[Q] = {
+	1.f / 3.f,
+	1.f / 18.f, 1.f / 18.f, 1.f / 18.f, 1.f / 18.f, 1.f / 18.f, 1.f / 18.f,
+	1.f / 36.f, 1.f / 36.f, 1.f / 36.f, 1.f / 36.f, 1.f / 36.f, 1.f / 36.f,
+	1.f / 36.f, 1.f / 36.f, 1.f / 36.f, 1.f / 36.f, 1.f / 36.f, 1.f / 36.f
+};
+
+static constexpr int opposite(int q)
+{
+	return q == 0 ? 0 : (q & 1) ? q + 1 : q - 1;
+}
+
+/* Orthogonal moment basis of d'Humieres et al. 2002 and its inverse. */
+struct MrtBasis {
+	float M[Q][Q];
+	float inverse[Q][Q];
+};
+
+static const MrtBasis& mrtBasis()
+{
+	static const MrtBasis basis = [] {
+		MrtBasis b {};
+		for (int q = 0; q < Q; q++) {
+			const float cx = float(velocities[q][0]), cy = float(velocities[q][1]), cz = float(velocities[q][2]);
+			const float c2 = cx * cx + cy * cy + cz * cz;
+
+			const float row[Q] = {
+				1.f,
+				19.f * c2 - 30.f,
+				(21.f * c2 * c2 - 53.f * c2 + 24.f) / 2.f,
+				cx, (5.f * c2 - 9.f) * cx,
+				cy, (5.f * c2 - 9.f) * cy,
+				cz, (5.f * c2 - 9.f) * cz,
+				3.f * cx * cx - c2, (3.f * c2 - 5.f) * (3.f * cx * cx - c2),
+				cy * cy - cz * cz, (3.f * c2 - 5.f) * (cy * cy - cz * cz),
+				cx * cy, cy * cz, cx * cz,
+				(cy * cy - cz * cz) * cx, (cz * cz - cx * cx) * cy, (cx * cx - cy * cy) * cz
+			};
+			for (int k = 0; k < Q; k++)
+				b.M[k][q] = row[k];
+		}
+
+		/* Rows are orthogonal, so the inverse is the transpose scaled by the squared row norms. */
+		for (int k = 0; k < Q; k++) {
+			float norm = 0.f;
+			for (int q = 0; q < Q; q++)
+				norm += b.M[k][q] * b.M[k][q];
+			for (int q = 0; q < Q; q++)
+				b.inverse[q][k] = b.M[k][q] / norm;
+		}
+		return b;
+	}();
+	return basis;
+}
+
+LbmSolver::LbmSolver(const LbmParams& params)
+	: params(params)
+{
+	const glm::ivec3 n = params.resolution;
+	cellCount = static_cast<size_t>(n.x) * n.y * n.z;
+	cells.assign(cellCount, LbmCell::Fluid);
+
+	if (params.flowThroughX) {
+		for (int k = 0; k < n.z; k++) {
+			for (int j = 0; j < n.y; j++) {
+				cells[cellIndex(0, j, k)] = LbmCell::Equilibrium;
+				cells[cellIndex(n.x - 1, j, k)] = LbmCell::Equilibrium;
+			}
+		}
+	}
+
+	initialize();
+}
+
+void LbmSolver::addSolidMesh(std::span<const glm::vec3> positions, std::span<const uint32_t> indices)
+{
+	std::vector<uint8_t> solid = voxelizeMesh(positions, indices, params.resolution, params.origin, params.cellSize);
+
+	for (size_t c = 0; c < solid.size(); c++)
+		if (solid[c]) cells[c] = LbmCell::Solid;
+	initialize();
+}
+
+void LbmSolver::setCell(int i, int j, int k, LbmCell type)
+{
+	cells[cellIndex(i, j, k)] = type;
+	initialize();
+}
+
+/* Restarts from rest at unit density, equilibrium cells at the inflow velocity. */
+void LbmSolver::initialize()
+{
+	distributions.assign(Q * cellCount, 0.f);
+	fluidCount = 0;
+
+	for (size_t c = 0; c < cellCount; c++) {
+		if (cells[c] == LbmCell::Solid) continue;
+		fluidCount++;
+
+		glm::vec3 u = cells[c] == LbmCell::Equilibrium ? params.inflowVelocity : glm::vec3(0.f);
+		for (int q = 0; q < Q; q++) {
+			float cu = 3.f * (velocities[q][0] * u.x + velocities[q][1] * u.y + velocities[q][2] * u.z);
+			distributions[q * cellCount + c] = weights[q] * (1.f + cu + 0.5f * cu * cu - 1.5f * glm::dot(u, u));
+		}
+	}
+
+	updateWallMasks();
+	stats = {};
+}
+
+void LbmSolver::updateWallMasks()
+{
+	const glm::ivec3 n = params.resolution;
+	wallMask.assign(cellCount, 0);
+
+	parallelFor(static_cast<size_t>(n.z), 1, [&](size_t begin, size_t end) {
+		for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++) {
+			for (int j = 0; j < n.y; j++) {
+				for (int i = 0; i < n.x; i++) {
+					uint32_t mask = 0;
+					for (int q = 1; q < Q; q++) {
+						glm::ivec3 p { i + velocities[q][0], j + velocities[q][1], k + velocities[q][2] };
+						bool outside = p.x < 0 || p.y < 0 || p.z < 0 || p.x >= n.x || p.y >= n.y || p.z >= n.z;
+						if (outside || cells[cellIndex(p.x, p.y, p.z)] == LbmCell::Solid) mask |= 1u << q;
+					}
+					wallMask[cellIndex(i, j, k)] = mask;
+				}
+			}
+		}
+	});
+}
+
+void LbmSolver::step()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	const glm::ivec3 n = params.resolution;
+	const size_t N = cellCount;
+	const bool odd = (stats.steps & 1) != 0;
+	const ptrdiff_t strideY = n.x;
+	const ptrdiff_t strideZ = static_cast<ptrdiff_t>(n.x) * n.y;
+	float* f = distributions.data();
+
+	parallelFor(static_cast<size_t>(n.y) * n.z, 4, [&](size_t begin, size_t end) {
+		std::vector<float> local(static_cast<size_t>(Q) * n.x);
+		std::vector<float> scratch(static_cast<size_t>(Q + 8) * n.x);
+
+		for (size_t row = begin; row < end; row++) {
+			const size_t base = row * n.x;
+			const LbmCell* type = cells.data() + base;
+			const uint32_t* walls = wallMask.data() + base;
+
+			/* Even steps read the own cell. Odd steps pull f_q from the neighbour behind, or bounce back. */
+			for (int q = 0; q < Q; q++) {
+				float* dst = local.data() + static_cast<size_t>(q) * n.x;
+				if (!odd) {
+					const float* src = f + q * N + base;
+					for (int i = 0; i < n.x; i++) dst[i] = src[i];
+					continue;
+				}
+
+				const int qo = opposite(q);
+				const ptrdiff_t offset = velocities[q][0] + velocities[q][1] * strideY + velocities[q][2] * strideZ;
+				const uint32_t behind = 1u << qo;
+				for (int i = 0; i < n.x; i++) {
+					size_t x = base + i;
+					dst[i] = (walls[i] & behind) ? f[q * N + x] : f[qo * N + x - offset];
+				}
+			}
+
+			collideRow(static_cast<int>(row), local, scratch);
+
+			/* Even steps store into the opposite slot. Odd steps push to the neighbour ahead, or bounce back. */
+			for (int q = 0; q < Q; q++) {
+				const float* src = local.data() + static_cast<size_t>(q) * n.x;
+				const int qo = opposite(q);
+				if (!odd) {
+					float* dst = f + qo * N + base;
+					for (int i = 0; i < n.x; i++) dst[i] = src[i];
+					continue;
+				}
+
+				const ptrdiff_t offset = velocities[q][0] + velocities[q][1] * strideY + velocities[q][2] * strideZ;
+				const uint32_t ahead = 1u << q;
+				for (int i = 0; i < n.x; i++) {
+					if (type[i] == LbmCell::Solid) continue;
+					size_t x = base + i;
+					f[(walls[i] & ahead) ? qo * N + x : q * N + x + offset] = src[i];
+				}
+			}
+		}
+	});
+
+	stats.steps++;
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	stats.mlups = fluidCount / stats.seconds * 1e-6;
+}
+
+/*
+ * Collides one x-row held as Q arrays of nx values. Every loop runs over
+ * the cells innermost; solid lanes are computed too and dropped later.
+ */
+void LbmSolver::collideRow(int row, std::vector<float>& local, std::vector<float>& scratch) const
+{
+	const int nx = params.resolution.x;
+	const LbmCell* type = cells.data() + static_cast<size_t>(row) * nx;
+	const float omega = 1.f / (3.f * params.viscosity + 0.5f);
+	const glm::vec3 force = params.bodyForce;
+
+	float* f = local.data();
+	float* rho = scratch.data();
+	float* ux = rho + nx;
+	float* uy = ux + nx;
+	float* uz = uy + nx;
+	float* usq = uz + nx;
+	float* held = usq + nx; // 1 for equilibrium cells
+	float* m = held + nx;
+
+	for (int i = 0; i < nx; i++) {
+		rho[i] = 0.f;
+		ux[i] = 0.f;
+		uy[i] = 0.f;
+		uz[i] = 0.f;
+	}
+	for (int q = 0; q < Q; q++) {
+		const float* fq = f + static_cast<size_t>(q) * nx;
+		const float cx = float(velocities[q][0]), cy = float(velocities[q][1]), cz = float(velocities[q][2]);
+		for (int i = 0; i < nx; i++) {
+			rho[i] += fq[i];
+			ux[i] += cx * fq[i];
+			uy[i] += cy * fq[i];
+			uz[i] += cz * fq[i];
+		}
+	}
+	for (int i = 0; i < nx; i++) {
+		held[i] = type[i] == LbmCell::Equilibrium ? 1.f : 0.f;
+		float inv = rho[i] > 0.f ? 1.f / rho[i] : 0.f;
+		rho[i] = held[i] > 0.f ? 1.f : rho[i];
+		ux[i] = held[i] > 0.f ? params.inflowVelocity.x : ux[i] * inv;
+		uy[i] = held[i] > 0.f ? params.inflowVelocity.y : uy[i] * inv;
+		uz[i] = held[i] > 0.f ? params.inflowVelocity.z : uz[i] * inv;
+		usq[i] = 1.5f * (ux[i] * ux[i] + uy[i] * uy[i] + uz[i] * uz[i]);
+	}
+
+	if (params.collision == CollisionModel::Mrt) {
+		const MrtBasis& basis = mrtBasis();
+
+		for (int k = 0; k < Q; k++) {
+			float* mk = m + static_cast<size_t>(k) * nx;
+			for (int i = 0; i < nx; i++) mk[i] = 0.f;
+			for (int q = 0; q < Q; q++) {
+				const float coefficient = basis.M[k][q];
+				if (coefficient == 0.f) continue;
+				const float* fq = f + static_cast<size_t>(q) * nx;
+				for (int i = 0; i < nx; i++) mk[i] += coefficient * fq[i];
+			}
+		}
+
+		/* Relax towards the equilibrium moments; density and momentum (rates 0) are conserved. */
+		const float s[Q] = {
+			0.f, 1.19f, 1.4f, 0.f, 1.2f, 0.f, 1.2f, 0.f, 1.2f,
+			omega, 1.4f, omega, 1.4f, omega, omega, omega, 1.98f, 1.98f, 1.98f
+		};
+		auto relax = [&](int k, int i, float equilibrium) {
+			float& value = m[static_cast<size_t>(k) * nx + i];
+			value -= s[k] * (value - equilibrium);
+		};
+		for (int i = 0; i < nx; i++) {
+			const float r = rho[i];
+			const float jx = r * ux[i], jy = r * uy[i], jz = r * uz[i];
+			const float inv = r > 0.f ? 1.f / r : 0.f;
+			const float j2 = (jx * jx + jy * jy + jz * jz) * inv;
+			const float pxx = (2.f * jx * jx - jy * jy - jz * jz) * inv;
+			const float pww = (jy * jy - jz * jz) * inv;
+
+			relax(1, i, -11.f * r + 19.f * j2);
+			relax(2, i, 3.f * r - 5.5f * j2);
+			relax(4, i, -2.f / 3.f * jx);
+			relax(6, i, -2.f / 3.f * jy);
+			relax(8, i, -2.f / 3.f * jz);
+			relax(9, i, pxx);
+			relax(10, i, -0.5f * pxx);
+			relax(11, i, pww);
+			relax(12, i, -0.5f * pww);
+			relax(13, i, jx * jy * inv);
+			relax(14, i, jy * jz * inv);
+			relax(15, i, jx * jz * inv);
+			relax(16, i, 0.f);
+			relax(17, i, 0.f);
+			relax(18, i, 0.f);
+		}
+
+		for (int q = 0; q < Q; q++) {
+			float* fq = f + static_cast<size_t>(q) * nx;
+			for (int i = 0; i < nx; i++) fq[i] = 0.f;
+			for (int k = 0; k < Q; k++) {
+				const float coefficient = basis.inverse[q][k];
+				if (coefficient == 0.f) continue;
+				const float* mk = m + static_cast<size_t>(k) * nx;
+				for (int i = 0; i < nx; i++) fq[i] += coefficient * mk[i];
+			}
+		}
+	}
+
+	/*
+	 * BGK relaxation, and for either model the body force and the reset of
+	 * equilibrium cells: with MRT the relaxation factor is zero except there.
+	 */
+	for (int q = 0; q < Q; q++) {
+		float* fq = f + static_cast<size_t>(q) * nx;
+		const float cx = float(velocities[q][0]), cy = float(velocities[q][1]), cz = float(velocities[q][2]);
+		const float w = weights[q];
+		const float forcing = 3.f * w * (cx * force.x + cy * force.y + cz * force.z);
+		const float relaxation = params.collision == CollisionModel::Bgk ? omega : 0.f;
+
+		for (int i = 0; i < nx; i++) {
+			float cu = 3.f * (cx * ux[i] + cy * uy[i] + cz * uz[i]);
+			float feq = w * rho[i] * (1.f + cu + 0.5f * cu * cu - usq[i]);
+			float rate = held[i] > 0.f ? 1.f : relaxation;
+			fq[i] += rate * (feq - fq[i]) + (1.f - held[i]) * forcing;
+		}
+	}
+}
+
+void LbmSolver::computeMacroscopic(std::vector<float>& density, std::vector<glm::vec3>& velocity) const
+{
+	density.assign(cellCount, 0.f);
+	velocity.assign(cellCount, glm::vec3(0.f));
+
+	/* After an even step the post-collision values sit in the opposite slots of the own cell. */
+	const bool swapped = (stats.steps & 1) != 0;
+
+	parallelFor(cellCount, 4096, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) {
+			if (cells[c] == LbmCell::Solid) continue;
+
+			float rho = 0.f;
+			glm::vec3 momentum(0.f);
+			for (int q = 0; q < Q; q++) {
+				float value = distributions[(swapped ? opposite(q) : q) * cellCount + c];
+				rho += value;
+				momentum += value * glm::vec3(velocities[q][0], velocities[q][1], velocities[q][2]);
+			}
+			density[c] = rho;
+			velocity[c] = rho > 0.f ? momentum / rho : glm::vec3(0.f);
+		}
+	});
+}
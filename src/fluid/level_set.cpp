@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/level_set.hpp"
+#include "fluid/parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static constexpr int B = SparseTopology::BlockSize;
+static constexpr int P = SparseTopology::PaddedSize;
+static constexpr size_t V = SparseTopology::BlockVoxels;
+static constexpr float Far = 1e10f;
+
+static float signOf(float x) { return x < 0.f ? -1.f : 1.f; }
+
+static bool anyActive(const SparseTopology::Mask& mask)
+{
+	return std::any_of(mask.begin(), mask.end(), [](uint64_t word) { return word != 0; });
+}
+
+static bool testBit(const SparseTopology::Mask& mask, uint32_t local)
+{
+	return (mask[local >> 6] >> (local & 63)) & 1;
+}
+
+static int paddedIndex(glm::ivec3 local)
+{
+	return ((local.z + 1) * P + local.y + 1) * P + local.x + 1;
+}
+
+/* Upwind eikonal update from the smallest neighbour distance along each axis. */
+static float solveEikonal(float a, float b, float c, float h)
+{
+	if (a > b) std::swap(a, b);
+	if (b > c) std::swap(b, c);
+	if (a > b) std::swap(a, b);
+
+	float d = a + h;
+	if (d <= b) return d;
+	d = 0.5f * (a + b + std::sqrt(std::max(2.f * h * h - (a - b) * (a - b), 0.f)));
+	if (d <= c) return d;
+	const float sum = a + b + c;
+	return (sum + std::sqrt(std::max(sum * sum - 3.f * (a * a + b * b + c * c - h * h), 0.f))) / 3.f;
+}
+
+NarrowBandLevelSet::NarrowBandLevelSet(const LevelSetParams& params)
+	: params(params)
+{
+}
+
+uint32_t NarrowBandLevelSet::touchBlock(glm::ivec3 blockCoord)
+{
+	const size_t before = band.blockCount();
+	const uint32_t block = band.touchBlock(blockCoord);
+	if (band.blockCount() != before) {
+		const bool inside = interior.findBlock(blockCoord) != SparseTopology::InvalidBlock;
+		phi.resize(band.blockCount() * V, inside ? -bandLimit() : bandLimit());
+	}
+	return block;
+}
+
+void NarrowBandLevelSet::buildFromParticles(std::span<const glm::vec3> positions, float radius)
+{
+	band = {};
+	interior = {};
+	phi.clear();
+
+	const float dx = params.cellSize;
+	const float reach = radius + bandLimit();
+
+	/* Bin every particle into the blocks its reach overlaps. */
+	std::vector<std::vector<uint32_t>> bins;
+	for (uint32_t p = 0; p < positions.size(); p++) {
+		const glm::vec3 g = (positions[p] - params.origin) / dx - 0.5f;
+		const glm::ivec3 lo = SparseTopology::blockOf(glm::ivec3(glm::ceil(g - reach / dx)));
+		const glm::ivec3 hi = SparseTopology::blockOf(glm::ivec3(glm::floor(g + reach / dx)));
+		for (int z = lo.z; z <= hi.z; z++) {
+			for (int y = lo.y; y <= hi.y; y++) {
+				for (int x = lo.x; x <= hi.x; x++) {
+					const uint32_t block = touchBlock({ x, y, z });
+					if (bins.size() <= block) bins.resize(block + 1);
+					bins[block].push_back(p);
+				}
+			}
+		}
+	}
+
+	parallelFor(band.blockCount(), 4, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; b++) {
+			const glm::ivec3 base = band.blockCoord(static_cast<uint32_t>(b)) * B;
+			float* values = &phi[b * V];
+
+			for (uint32_t p : bins[b]) {
+				const glm::vec3 g = (positions[p] - params.origin) / dx - 0.5f;
+				const glm::ivec3 lo = glm::max(glm::ivec3(glm::ceil(g - reach / dx)) - base, glm::ivec3(0));
+				const glm::ivec3 hi = glm::min(glm::ivec3(glm::floor(g + reach / dx)) - base, glm::ivec3(B - 1));
+				for (int z = lo.z; z <= hi.z; z++) {
+					for (int y = lo.y; y <= hi.y; y++) {
+						for (int x = lo.x; x <= hi.x; x++) {
+							const glm::ivec3 voxel = base + glm::ivec3(x, y, z);
+							const float d = glm::distance(glm::vec3(voxel), g) * dx - radius;
+							float& value = values[SparseTopology::localIndex(voxel)];
+							value = std::min(value, d);
+						}
+					}
+				}
+			}
+
+			SparseTopology::Mask& mask = band.activeMask(static_cast<uint32_t>(b));
+			for (uint32_t local = 0; local < V; local++)
+				if (values[local] < bandLimit()) mask[local >> 6] |= uint64_t(1) << (local & 63);
+		}
+	});
+
+	band.updateNeighbors();
+	redistance();
+	trimBand();
+}
+
+void NarrowBandLevelSet::redistance()
+{
+	if (!band.neighborsValid()) band.updateNeighbors();
+
+	const size_t blocks = band.blockCount();
+	const float dx = params.cellSize;
+	const std::vector<float> old = phi;
+	std::vector<SparseTopology::Mask> frozen(blocks);
+
+	/* Voxels next to a sign change get their distance from the linearly interpolated crossings. */
+	parallelFor(blocks, 8, [&](size_t begin, size_t end) {
+		SparseTopology::PaddedBlock tile;
+		for (size_t b = begin; b < end; b++) {
+			const uint32_t block = static_cast<uint32_t>(b);
+			const SparseTopology::Mask& mask = band.activeMask(block);
+			band.gatherPadded(old.data(), block, std::numeric_limits<float>::quiet_NaN(), tile);
+
+			for (uint32_t local = 0; local < V; local++) {
+				const int c = paddedIndex(SparseTopology::localCoord(local));
+				const float value = tile[c];
+				float& out = phi[b * V + local];
+				out = signOf(value) * Far;
+				if (!testBit(mask, local)) continue;
+
+				if (value == 0.f) {
+					out = 0.f;
+					frozen[b][local >> 6] |= uint64_t(1) << (local & 63);
+					continue;
+				}
+
+				float inverseSum = 0.f;
+				for (int stride : { 1, P, P * P }) {
+					float axis = Far;
+					for (float neighbor : { tile[c - stride], tile[c + stride] })
+						if (value * neighbor < 0.f) axis = std::min(axis, value / (value - neighbor) * dx);
+					if (axis < Far) inverseSum += 1.f / (axis * axis);
+				}
+				if (inverseSum > 0.f) {
+					out = signOf(value) / std::sqrt(inverseSum);
+					frozen[b][local >> 6] |= uint64_t(1) << (local & 63);
+				}
+			}
+		}
+	});
+
+	std::vector<float> previous;
+	std::vector<float> blockChange(blocks);
+	lastSweepPasses = 0;
+
+	for (uint32_t pass = 0; pass < params.maxSweepPasses; pass++) {
+		previous = phi;
+
+		parallelFor(blocks, 4, [&](size_t begin, size_t end) {
+			SparseTopology::PaddedBlock tile;
+			for (size_t b = begin; b < end; b++) {
+				const uint32_t block = static_cast<uint32_t>(b);
+				const SparseTopology::Mask& mask = band.activeMask(block);
+				blockChange[b] = 0.f;
+				if (!anyActive(mask)) continue;
+				band.gatherPadded(previous.data(), block, Far, tile);
+
+				for (int sweep = 0; sweep < 8; sweep++) {
+					const glm::ivec3 dir((sweep & 1) ? -1 : 1, (sweep & 2) ? -1 : 1, (sweep & 4) ? -1 : 1);
+					for (int iz = 0; iz < B; iz++) {
+						const int z = dir.z > 0 ? iz : B - 1 - iz;
+						for (int iy = 0; iy < B; iy++) {
+							const int y = dir.y > 0 ? iy : B - 1 - iy;
+							for (int ix = 0; ix < B; ix++) {
+								const int x = dir.x > 0 ? ix : B - 1 - ix;
+								const uint32_t local = static_cast<uint32_t>((z * B + y) * B + x);
+								if (!testBit(mask, local) || testBit(frozen[b], local)) continue;
+
+								const int c = paddedIndex({ x, y, z });
+								const float a = std::min(std::abs(tile[c - 1]), std::abs(tile[c + 1]));
+								const float bb = std::min(std::abs(tile[c - P]), std::abs(tile[c + P]));
+								const float cc = std::min(std::abs(tile[c - P * P]), std::abs(tile[c + P * P]));
+								const float d = solveEikonal(a, bb, cc, dx);
+								if (d < std::abs(tile[c])) tile[c] = signOf(tile[c]) * d;
+							}
+						}
+					}
+				}
+
+				float change = 0.f;
+				for (uint32_t local = 0; local < V; local++) {
+					if (!testBit(mask, local)) continue;
+					const float value = tile[paddedIndex(SparseTopology::localCoord(local))];
+					change = std::max(change, std::abs(value - phi[b * V + local]));
+					phi[b * V + local] = value;
+				}
+				blockChange[b] = change;
+			}
+		});
+
+		lastSweepPasses = pass + 1;
+		if (*std::max_element(blockChange.begin(), blockChange.end()) < params.tolerance * dx) break;
+	}
+
+	/* Inactive voxels and band voxels the sweeps did not reach still hold +-Far. */
+	const float limit = bandLimit();
+	parallelFor(phi.size(), 4096, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++)
+			phi[v] = std::clamp(phi[v], -limit, limit);
+	});
+}
+
+/* Deactivates voxels outside the band, drops empty blocks and remembers the ones inside as interior tiles. */
+void NarrowBandLevelSet::trimBand()
+{
+	const float limit = bandLimit();
+	parallelFor(band.blockCount(), 16, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; b++) {
+			SparseTopology::Mask& mask = band.activeMask(static_cast<uint32_t>(b));
+			for (uint32_t local = 0; local < V; local++) {
+				float& value = phi[b * V + local];
+				if (std::abs(value) < limit && testBit(mask, local)) continue;
+				value = signOf(value) * limit;
+				mask[local >> 6] &= ~(uint64_t(1) << (local & 63));
+			}
+		}
+	});
+
+	/* A block without band voxels contains no interface, so one voxel tells its side. */
+	std::vector<glm::ivec3> insideBlocks;
+	for (uint32_t b = 0; b < band.blockCount(); b++)
+		if (!anyActive(band.activeMask(b)) && phi[b * V] < 0.f) insideBlocks.push_back(band.blockCoord(b));
+
+	std::vector<uint32_t> remap;
+	band.prune(remap);
+	for (uint32_t old = 0; old < remap.size(); old++)
+		if (remap[old] != SparseTopology::InvalidBlock && remap[old] != old)
+			std::copy_n(phi.begin() + old * V, V, phi.begin() + remap[old] * V);
+	phi.resize(band.blockCount() * V);
+
+	SparseTopology nextInterior;
+	for (uint32_t b = 0; b < interior.blockCount(); b++)
+		if (band.findBlock(interior.blockCoord(b)) == SparseTopology::InvalidBlock)
+			nextInterior.touchBlock(interior.blockCoord(b));
+	for (const glm::ivec3& coord : insideBlocks)
+		nextInterior.touchBlock(coord);
+	interior = std::move(nextInterior);
+
+	band.updateNeighbors();
+}
+
+void NarrowBandLevelSet::updateBand()
+{
+	if (!band.neighborsValid()) band.updateNeighbors();
+
+	/* Voxels one layer beyond band voxels the interface came within bandWidth - 1 cells of. */
+	const float growLimit = (params.bandWidth - 1) * params.cellSize;
+	std::vector<std::vector<glm::ivec3>> grow(band.blockCount());
+
+	band.forEachActive([&](uint32_t block, uint32_t local, glm::ivec3 voxel) {
+		if (std::abs(phi[block * V + local]) > growLimit) return;
+		for (const glm::ivec3& offset : { glm::ivec3(1, 0, 0), glm::ivec3(-1, 0, 0), glm::ivec3(0, 1, 0),
+				glm::ivec3(0, -1, 0), glm::ivec3(0, 0, 1), glm::ivec3(0, 0, -1) }) {
+			const glm::ivec3 n = voxel + offset;
+			const glm::ivec3 d = SparseTopology::blockOf(n) - SparseTopology::blockOf(voxel);
+			const uint32_t other = band.neighbor(block, d.x, d.y, d.z);
+			if (other == SparseTopology::InvalidBlock || !testBit(band.activeMask(other), SparseTopology::localIndex(n)))
+				grow[block].push_back(n);
+		}
+	});
+
+	for (const std::vector<glm::ivec3>& voxels : grow) {
+		for (const glm::ivec3& voxel : voxels) {
+			const uint32_t local = SparseTopology::localIndex(voxel);
+			band.activeMask(touchBlock(SparseTopology::blockOf(voxel)))[local >> 6] |= uint64_t(1) << (local & 63);
+		}
+	}
+
+	band.updateNeighbors();
+	redistance();
+	trimBand();
+}
+
+void NarrowBandLevelSet::advect(const MacGrid& grid, float dt)
+{
+	std::vector<float> next = phi;
+	const float dx = params.cellSize;
+
+	band.forEachActive([&](uint32_t block, uint32_t local, glm::ivec3 voxel) {
+		const glm::vec3 position = params.origin + (glm::vec3(voxel) + 0.5f) * dx;
+		next[block * V + local] = sample(position - dt * grid.sampleVelocity(position));
+	});
+
+	phi.swap(next);
+	updateBand();
+}
+
+float NarrowBandLevelSet::value(glm::ivec3 voxel) const
+{
+	const glm::ivec3 blockCoord = SparseTopology::blockOf(voxel);
+	const uint32_t block = band.findBlock(blockCoord);
+	if (block != SparseTopology::InvalidBlock) return phi[block * V + SparseTopology::localIndex(voxel)];
+	return interior.findBlock(blockCoord) != SparseTopology::InvalidBlock ? -bandLimit() : bandLimit();
+}
+
+float NarrowBandLevelSet::sample(glm::vec3 position) const
+{
+	const glm::vec3 gridPos = (position - params.origin) / params.cellSize - 0.5f;
+	const glm::vec3 base = glm::floor(gridPos);
+	const glm::vec3 t = gridPos - base;
+	const glm::ivec3 c(base);
+
+	auto at = [&](int x, int y, int z) { return value(c + glm::ivec3(x, y, z)); };
+	auto lerp = [](float a, float b, float s) { return a + (b - a) * s; };
+
+	float c00 = lerp(at(0, 0, 0), at(1, 0, 0), t.x);
+	float c10 = lerp(at(0, 1, 0), at(1, 1, 0), t.x);
+	float c01 = lerp(at(0, 0, 1), at(1, 0, 1), t.x);
+	float c11 = lerp(at(0, 1, 1), at(1, 1, 1), t.x);
+	return lerp(lerp(c00, c10, t.y), lerp(c01, c11, t.y), t.z);
+}
+
+glm::vec3 NarrowBandLevelSet::normal(glm::vec3 position) const
+{
+	const float h = params.cellSize;
+	glm::vec3 gradient(
+		sample(position + glm::vec3(h, 0.f, 0.f)) - sample(position - glm::vec3(h, 0.f, 0.f)),
+		sample(position + glm::vec3(0.f, h, 0.f)) - sample(position - glm::vec3(0.f, h, 0.f)),
+		sample(position + glm::vec3(0.f, 0.f, h)) - sample(position - glm::vec3(0.f, 0.f, h)));
+	float length = glm::length(gradient);
+	return length > 0.f ? gradient / length : glm::vec3(0.f, 1.f, 0.f);
+}
+
+void NarrowBandLevelSet::markFluidCells(MacGrid& grid) const
+{
+	const glm::ivec3 n = grid.dims;
+	parallelFor(static_cast<size_t>(n.z), 1, [&](size_t begin, size_t end) {
+		for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++) {
+			for (int j = 0; j < n.y; j++) {
+				for (int i = 0; i < n.x; i++) {
+					CellType& type = grid.cellType[grid.cellIndex(i, j, k)];
+					if (type == CellType::Solid) continue;
+					glm::vec3 center = grid.origin + (glm::vec3(i, j, k) + 0.5f) * grid.cellSize;
+					type = isInside(center) ? CellType::Fluid : CellType::Air;
+				}
+			}
+		}
+	});
+}
+
+size_t NarrowBandLevelSet::memoryBytes() const
+{
+	return band.memoryBytes() + interior.memoryBytes() + phi.capacity() * sizeof(float);
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/mac_grid.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+MacGrid::MacGrid(glm::ivec3 dims, float cellSize, glm::vec3 origin)
+	: dims(dims), cellSize(cellSize), origin(origin)
+{
+	if (dims.x < 1 || dims.y < 1 || dims.z < 1 || cellSize <= 0.f)
+		throw std::invalid_argument("Invalid MAC grid dimensions!");
+
+	u.assign(static_cast<size_t>(dims.x + 1) * dims.y * dims.z, 0.f);
+	v.assign(static_cast<size_t>(dims.x) * (dims.y + 1) * dims.z, 0.f);
+	w.assign(static_cast<size_t>(dims.x) * dims.y * (dims.z + 1), 0.f);
+	pressure.assign(cellCount(), 0.f);
+	density.assign(cellCount(), 0.f);
+	cellType.assign(cellCount(), CellType::Fluid);
+}
+
+float sampleTrilinear(const std::vector<float>& field, glm::ivec3 size, glm::vec3 gridPos)
+{
+	glm::vec3 p = glm::clamp(gridPos, glm::vec3(0.f), glm::vec3(size - 1));
+	glm::ivec3 base = glm::min(glm::ivec3(p), glm::max(size - 2, glm::ivec3(0)));
+	glm::vec3 t = p - glm::vec3(base);
+	glm::ivec3 next = glm::min(base + 1, size - 1);
+
+	auto at = [&](int i, int j, int k) {
+		return field[(static_cast<size_t>(k) * size.y + j) * size.x + i];
+	};
+
+	float c00 = glm::mix(at(base.x, base.y, base.z), at(next.x, base.y, base.z), t.x);
+	float c10 = glm::mix(at(base.x, next.y, base.z), at(next.x, next.y, base.z), t.x);
+	float c01 = glm::mix(at(base.x, base.y, next.z), at(next.x, base.y, next.z), t.x);
+	float c11 = glm::mix(at(base.x, next.y, next.z), at(next.x, next.y, next.z), t.x);
+
+	return glm::mix(glm::mix(c00, c10, t.y), glm::mix(c01, c11, t.y), t.z);
+}
+
+/* Eight lanes as fixed-length loops, vectorized as far as the target allows. */
+static void sampleTrilinearLanes(const float* data, glm::ivec3 size, const float* x, const float* y, const float* z,
+	float* out, size_t count, float* outMin, float* outMax)
+{
+	constexpr size_t Lanes = 8;
+	const glm::vec3 upper(size - 1);
+	const glm::ivec3 lastBase = glm::max(size - 2, glm::ivec3(0));
+
+	/* Corner offsets are the same for every lane, 0 along axes with a single sample. */
+	const int32_t dx = size.x > 1 ? 1 : 0;
+	const int32_t dy = size.y > 1 ? size.x : 0;
+	const int32_t dz = size.z > 1 ? size.x * size.y : 0;
+
+	for (size_t start = 0; start < count; start += Lanes) {
+		const size_t lanes = std::min(Lanes, count - start);
+		int32_t index[Lanes];
+		float tx[Lanes], ty[Lanes], tz[Lanes];
+		float corner[8][Lanes];
+
+		for (size_t l = 0; l < Lanes; l++) {
+			const size_t s = start + std::min(l, lanes - 1);
+			const float px = std::clamp(x[s], 0.f, upper.x);
+			const float py = std::clamp(y[s], 0.f, upper.y);
+			const float pz = std::clamp(z[s], 0.f, upper.z);
+			const int32_t bx = std::min(static_cast<int32_t>(px), lastBase.x);
+			const int32_t by = std::min(static_cast<int32_t>(py), lastBase.y);
+			const int32_t bz = std::min(static_cast<int32_t>(pz), lastBase.z);
+			tx[l] = px - static_cast<float>(bx);
+			ty[l] = py - static_cast<float>(by);
+			tz[l] = pz - static_cast<float>(bz);
+			index[l] = (bz * size.y + by) * size.x + bx;
+		}
+
+		for (size_t l = 0; l < Lanes; l++) {
+			corner[0][l] = data[index[l]];
+			corner[1][l] = data[index[l] + dx];
+			corner[2][l] = data[index[l] + dy];
+			corner[3][l] = data[index[l] + dx + dy];
+			corner[4][l] = data[index[l] + dz];
+			corner[5][l] = data[index[l] + dx + dz];
+			corner[6][l] = data[index[l] + dy + dz];
+			corner[7][l] = data[index[l] + dx + dy + dz];
+		}
+
+		float result[Lanes], lo[Lanes], hi[Lanes];
+		for (size_t l = 0; l < Lanes; l++) {
+			float c00 = corner[0][l] + tx[l] * (corner[1][l] - corner[0][l]);
+			float c10 = corner[2][l] + tx[l] * (corner[3][l] - corner[2][l]);
+			float c01 = corner[4][l] + tx[l] * (corner[5][l] - corner[4][l]);
+			float c11 = corner[6][l] + tx[l] * (corner[7][l] - corner[6][l]);
+			float c0 = c00 + ty[l] * (c10 - c00);
+			float c1 = c01 + ty[l] * (c11 - c01);
+			result[l] = c0 + tz[l] * (c1 - c0);
+
+			lo[l] = std::min({ corner[0][l], corner[1][l], corner[2][l], corner[3][l], corner[4][l], corner[5][l], corner[6][l], corner[7][l] });
+			hi[l] = std::max({ corner[0][l], corner[1][l], corner[2][l], corner[3][l], corner[4][l], corner[5][l], corner[6][l], corner[7][l] });
+		}
+
+		std::copy_n(result, lanes, out + start);
+		if (outMin) std::copy_n(lo, lanes, outMin + start);
+		if (outMax) std::copy_n(hi, lanes, outMax + start);
+	}
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define FLUID_AVX2_GATHER 1
+
+/* The same eight lanes with AVX2 gathers and the same operation order, picked at run time. */
+__attribute__((target("avx2")))
+static size_t sampleTrilinearAvx2(const float* data, glm::ivec3 size, const float* x, const float* y, const float* z,
+	float* out, size_t count, float* outMin, float* outMax)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 upperX = _mm256_set1_ps(static_cast<float>(size.x - 1));
+	const __m256 upperY = _mm256_set1_ps(static_cast<float>(size.y - 1));
+	const __m256 upperZ = _mm256_set1_ps(static_cast<float>(size.z - 1));
+	const __m256i lastX = _mm256_set1_epi32(std::max(size.x - 2, 0));
+	const __m256i lastY = _mm256_set1_epi32(std::max(size.y - 2, 0));
+	const __m256i lastZ = _mm256_set1_epi32(std::max(size.z - 2, 0));
+	const __m256i sizeX = _mm256_set1_epi32(size.x);
+	const __m256i sizeY = _mm256_set1_epi32(size.y);
+
+	const __m256i dx = _mm256_set1_epi32(size.x > 1 ? 1 : 0);
+	const __m256i dy = _mm256_set1_epi32(size.y > 1 ? size.x : 0);
+	const __m256i dz = _mm256_set1_epi32(size.z > 1 ? size.x * size.y : 0);
+
+	size_t start = 0;
+	for (; start + 8 <= count; start += 8) {
+		const __m256 px = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(x + start), zero), upperX);
+		const __m256 py = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(y + start), zero), upperY);
+		const __m256 pz = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(z + start), zero), upperZ);
+		const __m256i bx = _mm256_min_epi32(_mm256_cvttps_epi32(px), lastX);
+		const __m256i by = _mm256_min_epi32(_mm256_cvttps_epi32(py), lastY);
+		const __m256i bz = _mm256_min_epi32(_mm256_cvttps_epi32(pz), lastZ);
+		const __m256 tx = _mm256_sub_ps(px, _mm256_cvtepi32_ps(bx));
+		const __m256 ty = _mm256_sub_ps(py, _mm256_cvtepi32_ps(by));
+		const __m256 tz = _mm256_sub_ps(pz, _mm256_cvtepi32_ps(bz));
+
+		const __m256i i000 = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(_mm256_mullo_epi32(bz, sizeY), by), sizeX), bx);
+		const __m256i i010 = _mm256_add_epi32(i000, dy);
+		const __m256i i001 = _mm256_add_epi32(i000, dz);
+		const __m256i i011 = _mm256_add_epi32(i010, dz);
+
+		const __m256 c000 = _mm256_i32gather_ps(data, i000, 4);
+		const __m256 c100 = _mm256_i32gather_ps(data, _mm256_add_epi32(i000, dx), 4);
+		const __m256 c010 = _mm256_i32gather_ps(data, i010, 4);
+		const __m256 c110 = _mm256_i32gather_ps(data, _mm256_add_epi32(i010, dx), 4);
+		const __m256 c001 = _mm256_i32gather_ps(data, i001, 4);
+		const __m256 c101 = _mm256_i32gather_ps(data, _mm256_add_epi32(i001, dx), 4);
+		const __m256 c011 = _mm256_i32gather_ps(data, i011, 4);
+		const __m256 c111 = _mm256_i32gather_ps(data, _mm256_add_epi32(i011, dx), 4);
+
+		const __m256 c00 = _mm256_add_ps(c000, _mm256_mul_ps(tx, _mm256_sub_ps(c100, c000)));
+		const __m256 c10 = _mm256_add_ps(c010, _mm256_mul_ps(tx, _mm256_sub_ps(c110, c010)));
+		const __m256 c01 = _mm256_add_ps(c001, _mm256_mul_ps(tx, _mm256_sub_ps(c101, c001)));
+		const __m256 c11 = _mm256_add_ps(c011, _mm256_mul_ps(tx, _mm256_sub_ps(c111, c011)));
+		const __m256 c0 = _mm256_add_ps(c00, _mm256_mul_ps(ty, _mm256_sub_ps(c10, c00)));
+		const __m256 c1 = _mm256_add_ps(c01, _mm256_mul_ps(ty, _mm256_sub_ps(c11, c01)));
+		_mm256_storeu_ps(out + start, _mm256_add_ps(c0, _mm256_mul_ps(tz, _mm256_sub_ps(c1, c0))));
+
+		if (outMin) {
+			const __m256 lo = _mm256_min_ps(_mm256_min_ps(_mm256_min_ps(c000, c100), _mm256_min_ps(c010, c110)),
+				_mm256_min_ps(_mm256_min_ps(c001, c101), _mm256_min_ps(c011, c111)));
+			_mm256_storeu_ps(outMin + start, lo);
+		}
+		if (outMax) {
+			const __m256 hi = _mm256_max_ps(_mm256_max_ps(_mm256_max_ps(c000, c100), _mm256_max_ps(c010, c110)),
+				_mm256_max_ps(_mm256_max_ps(c001, c101), _mm256_max_ps(c011, c111)));
+			_mm256_storeu_ps(outMax + start, hi);
+		}
+	}
+
+	return start;
+}
+
+static bool hasAvx2()
+{
+	static const bool supported = __builtin_cpu_supports("avx2");
+	return supported;
+}
+#endif
+
+void sampleTrilinear(const std::vector<float>& field, glm::ivec3 size, const float* x, const float* y, const float* z,
+	float* out, size_t count, float* outMin, float* outMax)
+{
+	size_t done = 0;
+#ifdef FLUID_AVX2_GATHER
+	if (hasAvx2()) done = sampleTrilinearAvx2(field.data(), size, x, y, z, out, count, outMin, outMax);
+#endif
+	if (done == count) return;
+
+	sampleTrilinearLanes(field.data(), size, x + done, y + done, z + done, out + done, count - done,
+		outMin ? outMin + done : nullptr, outMax ? outMax + done : nullptr);
+}
+
+glm::vec3 MacGrid::sampleVelocity(const glm::vec3& position) const
+{
+	glm::vec3 g = toGrid(position);
+
+	return {
+		sampleTrilinear(u, { dims.x + 1, dims.y, dims.z }, { g.x, g.y - 0.5f, g.z - 0.5f }),
+		sampleTrilinear(v, { dims.x, dims.y + 1, dims.z }, { g.x - 0.5f, g.y, g.z - 0.5f }),
+		sampleTrilinear(w, { dims.x, dims.y, dims.z + 1 }, { g.x - 0.5f, g.y - 0.5f, g.z })
+	};
+}
+
+float MacGrid::sampleDensity(const glm::vec3& position) const
+{
+	return sampleTrilinear(density, dims, toGrid(position) - 0.5f);
+}
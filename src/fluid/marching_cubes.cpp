@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/marching_cubes.hpp"
+#include "fluid/level_set.hpp"
+#include "fluid/parallel.hpp"
+#include "fluid/sph_kernels.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+
+/* See MarchingCubesTable, mirrored in shaders/marching_cubes.slang. */
+static constexpr int edgeBase[3][4] = { { 0, 2, 4, 6 }, { 0, 1, 4, 5 }, { 0, 1, 2, 3 } };
+static glm::ivec3 cornerOffset(int corner)
+{
+	return { corner & 1, (corner >> 1) & 1, (corner >> 2) & 1 };
+}
+
+static int edgeBetween(int a, int b)
+{
+	const int axis = std::countr_zero(static_cast<unsigned>(a ^ b));
+	const int base = std::min(a, b);
+	for (int k = 0; k < 4; k++)
+		if (edgeBase[axis][k] == base) return axis * 4 + k;
+	return -1;
+}
+
+/*
+ * Builds the triangles of every corner configuration from the contour on
+ * the six faces. Walking a face counterclockwise seen from outside, each
+ * crossing from inside to outside starts a segment that ends at the
+ * closest crossing back inside before it, so ambiguous faces cut off their
+ * inside corners separately and both cells of a face agree. The segments
+ * chain into loops around the cell, which are triangulated as fans.
+ */
+static MarchingCubesTable buildTriangleTable()
+{
+	std::array<std::array<int, 4>, 6> faces;
+	for (int axis = 0; axis < 3; axis++) {
+		for (int side = 0; side < 2; side++) {
+			/* u x v is the outward normal. */
+			int u = (axis + 1) % 3, v = (axis + 2) % 3;
+			if (side == 0) std::swap(u, v);
+
+			const int base = side << axis;
+			const int du = 1 << u, dv = 1 << v;
+			faces[axis * 2 + side] = { base, base + du, base + du + dv, base + dv };
+		}
+	}
+
+	/* Bit f is set if the edge lies in face f. */
+	std::array<uint8_t, 12> edgeFaces {};
+	for (int f = 0; f < 6; f++)
+		for (int i = 0; i < 4; i++)
+			edgeFaces[edgeBetween(faces[f][i], faces[f][(i + 1) % 4])] |= 1 << f;
+
+	MarchingCubesTable table;
+	for (int config = 0; config < 256; config++) {
+		std::array<int, 12> next;
+		next.fill(-1);
+
+		for (const std::array<int, 4>& face : faces) {
+			std::array<bool, 4> inside;
+			for (int i = 0; i < 4; i++) inside[i] = (config >> face[i]) & 1;
+
+			for (int i = 0; i < 4; i++) {
+				if (!inside[i] || inside[(i + 1) % 4]) continue;
+
+				for (int back = 1; back <= 4; back++) {
+					const int j = (i + 4 - back) % 4;
+					if (!inside[j] && inside[(j + 1) % 4]) {
+						next[edgeBetween(face[i], face[(i + 1) % 4])] = edgeBetween(face[j], face[(j + 1) % 4]);
+						break;
+					}
+				}
+			}
+		}
+
+		MarchingCubesTable::value_type& entry = table[config];
+		entry.fill(-1);
+		int count = 0;
+		std::array<bool, 12> visited {};
+		for (int start = 0; start < 12; start++) {
+			if (next[start] < 0 || visited[start]) continue;
+
+			std::vector<int> loop;
+			for (int edge = start; !visited[edge]; edge = next[edge]) {
+				visited[edge] = true;
+				loop.push_back(edge);
+			}
+
+			/*
+			 * The loops run clockwise seen from outside the fluid. The fan
+			 * starts where none of its triangles lies in a cell face, the
+			 * neighbour cell would emit the same triangle mirrored.
+			 */
+			const size_t n = loop.size();
+			size_t root = 0;
+			for (size_t r = 0; r < n; r++) {
+				bool planar = false;
+				for (size_t i = 1; i + 1 < n; i++)
+					planar |= (edgeFaces[loop[r]] & edgeFaces[loop[(r + i) % n]] & edgeFaces[loop[(r + i + 1) % n]]) != 0;
+				if (!planar) {
+					root = r;
+					break;
+				}
+			}
+			for (size_t i = 1; i + 1 < n; i++) {
+				entry[count++] = static_cast<int8_t>(loop[root]);
+				entry[count++] = static_cast<int8_t>(loop[(root + i + 1) % n]);
+				entry[count++] = static_cast<int8_t>(loop[(root + i) % n]);
+			}
+		}
+	}
+	return table;
+}
+
+const MarchingCubesTable& marchingCubesTable()
+{
+	static const MarchingCubesTable table = buildTriangleTable();
+	return table;
+}
+
+MarchingCubes::MarchingCubes(const MarchingCubesParams& params)
+	: params(params)
+{
+	this->params.resolution = glm::max(params.resolution, glm::ivec3(1));
+	this->params.blockSize = std::max(params.blockSize, 1);
+	nodes = this->params.resolution + 1;
+	field.assign(static_cast<size_t>(nodes.x) * nodes.y * nodes.z, 0.f);
+
+	const glm::ivec3 resolution = this->params.resolution;
+	const int size = this->params.blockSize;
+	for (int k = 0; k < resolution.z; k += size) {
+		for (int j = 0; j < resolution.y; j += size) {
+			for (int i = 0; i < resolution.x; i += size) {
+				Block block;
+				block.begin = { i, j, k };
+				block.end = glm::min(block.begin + size, resolution);
+				blocks.push_back(std::move(block));
+			}
+		}
+	}
+
+	marchingCubesTable();
+}
+
+void MarchingCubes::splatParticles(std::span<const Particle> particles, float radius, float spacing)
+{
+	const float h = params.cellSize;
+	const float volume = spacing * spacing * spacing;
+	const float r2 = radius * radius;
+
+	/* Particles per node plane, so every plane is written by one thread. */
+	std::vector<std::vector<uint32_t>> planes(nodes.z);
+	for (size_t p = 0; p < particles.size(); p++) {
+		const float z = (particles[p].position.z - params.origin.z) / h;
+		const int k0 = std::max(static_cast<int>(std::ceil(z - radius / h)), 0);
+		const int k1 = std::min(static_cast<int>(std::floor(z + radius / h)), nodes.z - 1);
+		for (int k = k0; k <= k1; k++)
+			planes[k].push_back(static_cast<uint32_t>(p));
+	}
+
+	parallelFor(static_cast<size_t>(nodes.z), 1, [&](size_t begin, size_t end) {
+		for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++) {
+			float* plane = &field[nodeIndex(0, 0, k)];
+			std::fill(plane, plane + static_cast<size_t>(nodes.x) * nodes.y, 0.f);
+
+			const float nz = params.origin.z + k * h;
+			for (uint32_t p : planes[k]) {
+				const glm::vec3 position = particles[p].position;
+				const float dz2 = (position.z - nz) * (position.z - nz);
+				const glm::vec2 local = (glm::vec2(position) - glm::vec2(params.origin)) / h;
+				const int i0 = std::max(static_cast<int>(std::ceil(local.x - radius / h)), 0);
+				const int i1 = std::min(static_cast<int>(std::floor(local.x + radius / h)), nodes.x - 1);
+				const int j0 = std::max(static_cast<int>(std::ceil(local.y - radius / h)), 0);
+				const int j1 = std::min(static_cast<int>(std::floor(local.y + radius / h)), nodes.y - 1);
+
+				for (int j = j0; j <= j1; j++) {
+					const float dy = position.y - (params.origin.y + j * h);
+					const float dyz2 = dz2 + dy * dy;
+					if (dyz2 >= r2) continue;
+					for (int i = i0; i <= i1; i++) {
+						const float dx = position.x - (params.origin.x + i * h);
+						plane[static_cast<size_t>(j) * nodes.x + i] += volume * Kernel::poly6(dyz2 + dx * dx, radius);
+					}
+				}
+			}
+		}
+	});
+}
+
+void MarchingCubes::sampleLevelSet(const NarrowBandLevelSet& levelSet)
+{
+	/* In cells, so changeThreshold means the same for both sources. */
+	parallelFor(static_cast<size_t>(nodes.z), 1, [&](size_t begin, size_t end) {
+		for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++)
+			for (int j = 0; j < nodes.y; j++)
+				for (int i = 0; i < nodes.x; i++) {
+					const glm::vec3 position = params.origin + glm::vec3(i, j, k) * params.cellSize;
+					field[nodeIndex(i, j, k)] = params.isoLevel - levelSet.sample(position) / params.cellSize;
+				}
+	});
+}
+
+void MarchingCubes::invalidate()
+{
+	for (Block& block : blocks)
+		block.valid = false;
+}
+
+glm::vec3 MarchingCubes::gradient(int i, int j, int k) const
+{
+	const int i0 = std::max(i - 1, 0), i1 = std::min(i + 1, nodes.x - 1);
+	const int j0 = std::max(j - 1, 0), j1 = std::min(j + 1, nodes.y - 1);
+	const int k0 = std::max(k - 1, 0), k1 = std::min(k + 1, nodes.z - 1);
+	return {
+		(node(i1, j, k) - node(i0, j, k)) / static_cast<float>(std::max(i1 - i0, 1)),
+		(node(i, j1, k) - node(i, j0, k)) / static_cast<float>(std::max(j1 - j0, 1)),
+		(node(i, j, k1) - node(i, j, k0)) / static_cast<float>(std::max(k1 - k0, 1))
+	};
+}
+
+bool MarchingCubes::changed(Block& block) const
+{
+	if (!block.valid) return true;
+
+	size_t s = 0;
+	for (int k = block.begin.z; k <= block.end.z; k++)
+		for (int j = block.begin.y; j <= block.end.y; j++)
+			for (int i = block.begin.x; i <= block.end.x; i++, s++)
+				if (std::abs(node(i, j, k) - block.snapshot[s]) > params.changeThreshold) return true;
+	return false;
+}
+
+void MarchingCubes::polygonize(Block& block, std::vector<int32_t>& edgeCache) const
+{
+	const MarchingCubesTable& table = marchingCubesTable();
+	const glm::ivec3 extent = block.end - block.begin + 1; // nodes of the block
+	const float iso = params.isoLevel;
+
+	block.snapshot.resize(static_cast<size_t>(extent.x) * extent.y * extent.z);
+	size_t s = 0;
+	for (int k = block.begin.z; k <= block.end.z; k++)
+		for (int j = block.begin.y; j <= block.end.y; j++)
+			for (int i = block.begin.x; i <= block.end.x; i++)
+				block.snapshot[s++] = node(i, j, k);
+
+	block.positions.clear();
+	block.normals.clear();
+	block.indices.clear();
+	edgeCache.assign(block.snapshot.size() * 3, -1);
+
+	auto vertexOn = [&](glm::ivec3 local, int axis) -> uint32_t {
+		int32_t& cached = edgeCache[((static_cast<size_t>(local.z) * extent.y + local.y) * extent.x + local.x) * 3 + axis];
+		if (cached >= 0) return static_cast<uint32_t>(cached);
+
+		const glm::ivec3 a = block.begin + local;
+		glm::ivec3 b = a;
+		b[axis]++;
+		const float va = node(a.x, a.y, a.z);
+		const float vb = node(b.x, b.y, b.z);
+		const float t = std::clamp((iso - va) / (vb - va), 0.f, 1.f);
+
+		glm::vec3 position = glm::vec3(a);
+		position[axis] += t;
+		const glm::vec3 g = glm::mix(gradient(a.x, a.y, a.z), gradient(b.x, b.y, b.z), t);
+		const float length = glm::length(g);
+
+		cached = static_cast<int32_t>(block.positions.size());
+		block.positions.push_back(params.origin + position * params.cellSize);
+		block.normals.push_back(length > 0.f ? -g / length : glm::vec3(0.f, 1.f, 0.f));
+		return static_cast<uint32_t>(cached);
+	};
+
+	for (int k = block.begin.z; k < block.end.z; k++) {
+		for (int j = block.begin.y; j < block.end.y; j++) {
+			for (int i = block.begin.x; i < block.end.x; i++) {
+				int config = 0;
+				for (int c = 0; c < 8; c++) {
+					const glm::ivec3 o = cornerOffset(c);
+					if (node(i + o.x, j + o.y, k + o.z) > iso) config |= 1 << c;
+				}
+				if (config == 0 || config == 255) continue;
+
+				const glm::ivec3 local = glm::ivec3(i, j, k) - block.begin;
+				for (int8_t edge : table[config]) {
+					if (edge < 0) break;
+					const int axis = edge >> 2;
+					block.indices.push_back(vertexOn(local + cornerOffset(edgeBase[axis][edge & 3]), axis));
+				}
+			}
+		}
+	}
+
+	block.valid = true;
+}
+
+void MarchingCubes::assemble()
+{
+	std::vector<size_t> vertexOffsets(blocks.size() + 1, 0), indexOffsets(blocks.size() + 1, 0);
+	for (size_t b = 0; b < blocks.size(); b++) {
+		vertexOffsets[b + 1] = vertexOffsets[b] + blocks[b].positions.size();
+		indexOffsets[b + 1] = indexOffsets[b] + blocks[b].indices.size();
+	}
+
+	mesh.positions.resize(vertexOffsets.back());
+	mesh.normals.resize(vertexOffsets.back());
+	mesh.colors.assign(vertexOffsets.back(), params.color);
+	mesh.texCoords.clear();
+	mesh.indices.resize(indexOffsets.back());
+
+	parallelFor(blocks.size(), 4, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; b++) {
+			const Block& block = blocks[b];
+			std::ranges::copy(block.positions, mesh.positions.begin() + vertexOffsets[b]);
+			std::ranges::copy(block.normals, mesh.normals.begin() + vertexOffsets[b]);
+
+			const uint32_t base = static_cast<uint32_t>(vertexOffsets[b]);
+			std::ranges::transform(block.indices, mesh.indices.begin() + indexOffsets[b],
+				[base](uint32_t index) { return base + index; });
+		}
+	});
+}
+
+size_t MarchingCubes::extract()
+{
+	std::atomic<size_t> rebuilt { 0 };
+	parallelFor(blocks.size(), 1, [&](size_t begin, size_t end) {
+		thread_local std::vector<int32_t> edgeCache;
+		for (size_t b = begin; b < end; b++) {
+			if (!changed(blocks[b])) continue;
+			polygonize(blocks[b], edgeCache);
+			rebuilt++;
+		}
+	});
+
+	if (rebuilt > 0) assemble();
+	return rebuilt;
+}
@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/mpm_solver.hpp"
+#include "fluid/parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+/*
+ * Rotation variant SVD, F = U diag(sigma) V^T with U and V rotations, from
+ * the Jacobi eigen decomposition of F^T F. Only sigma[2] can be negative.
+ */
+static void svd3(const glm::mat3& F, glm::mat3& U, glm::vec3& sigma, glm::mat3& V)
+{
+	glm::dmat3 S = glm::dmat3(glm::transpose(F) * F);
+	glm::dmat3 E(1.0);
+
+	for (int sweep = 0; sweep < 8; sweep++) {
+		double off = S[1][0] * S[1][0] + S[2][0] * S[2][0] + S[2][1] * S[2][1];
+		if (off < 1e-20) break;
+
+		const int pairs[3][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+		for (const auto& [p, q] : pairs) {
+			if (std::abs(S[q][p]) < 1e-30) continue;
+
+			double theta = (S[q][q] - S[p][p]) / (2.0 * S[q][p]);
+			double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+			double c = 1.0 / std::sqrt(t * t + 1.0);
+
+			double sn = t * c;
+
+			/* S = J^T S J and E = E J for the Givens rotation J in the (p, q) plane, columns first. */
+			for (int r = 0; r < 3; r++) {
+				double a = S[p][r], b = S[q][r];
+				S[p][r] = c * a - sn * b;
+				S[q][r] = sn * a + c * b;
+
+				a = E[p][r];
+				b = E[q][r];
+				E[p][r] = c * a - sn * b;
+				E[q][r] = sn * a + c * b;
+			}
+			for (int col = 0; col < 3; col++) {
+				double a = S[col][p], b = S[col][q];
+				S[col][p] = c * a - sn * b;
+				S[col][q] = sn * a + c * b;
+			}
+		}
+	}
+
+	glm::vec3 lambda { float(S[0][0]), float(S[1][1]), float(S[2][2]) };
+	V = glm::mat3(E);
+	for (int i = 0; i < 2; i++) {
+		for (int j = i + 1; j < 3; j++) {
+			if (lambda[j] > lambda[i]) {
+				std::swap(lambda[i], lambda[j]);
+				std::swap(V[i], V[j]);
+			}
+		}
+	}
+	if (glm::determinant(V) < 0.f) V[2] = -V[2];
+
+	glm::vec3 u0 = F * V[0];
+	u0 = glm::length(u0) > 1e-6f ? glm::normalize(u0) : glm::vec3(1.f, 0.f, 0.f);
+
+	glm::vec3 u1 = F * V[1];
+	u1 -= glm::dot(u1, u0) * u0;
+	if (glm::length(u1) < 1e-6f) {
+		u1 = std::abs(u0.x) < 0.9f ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 1.f, 0.f);
+		u1 -= glm::dot(u1, u0) * u0;
+	}
+	u1 = glm::normalize(u1);
+
+	U = glm::mat3(u0, u1, glm::cross(u0, u1));
+	for (int i = 0; i < 3; i++)
+		sigma[i] = glm::dot(U[i], F * V[i]);
+}
+
+/* Quadratic B-spline weights of the three nodes base, base + 1 and base + 2 along each axis. */
+static void quadraticWeights(const glm::vec3& fx, glm::vec3 w[3])
+{
+	w[0] = 0.5f * (1.5f - fx) * (1.5f - fx);
+	w[1] = 0.75f - (fx - 1.f) * (fx - 1.f);
+	w[2] = 0.5f * (fx - 0.5f) * (fx - 0.5f);
+}
+
+MpmSolver::MpmSolver(const MpmParams& params)
+	: params(params)
+{
+	nodes.assign(static_cast<size_t>(params.resolution.x) * params.resolution.y * params.resolution.z, glm::vec4(0.f));
+}
+
+void MpmSolver::addBox(glm::vec3 boxMin, glm::vec3 boxMax, MpmMaterial material, int particlesPerAxis, glm::vec3 velocity)
+{
+	const float spacing = params.cellSize / particlesPerAxis;
+	const glm::ivec3 count = glm::max(glm::ivec3((boxMax - boxMin) / spacing), glm::ivec3(0));
+
+	particles.reserve(particles.size() + static_cast<size_t>(count.x) * count.y * count.z);
+	for (int k = 0; k < count.z; k++) {
+		for (int j = 0; j < count.y; j++) {
+			for (int i = 0; i < count.x; i++) {
+				MpmParticle particle;
+				particle.position = boxMin + (glm::vec3(i, j, k) + 0.5f) * spacing;
+				particle.velocity = velocity;
+				particle.volume = spacing * spacing * spacing;
+				particle.material = material;
+				particles.push_back(particle);
+			}
+		}
+	}
+}
+
+size_t MpmSolver::baseCellOf(const glm::vec3& position) const
+{
+	glm::ivec3 base = glm::ivec3(glm::floor((position - params.origin) / params.cellSize - 0.5f));
+	base = glm::clamp(base, glm::ivec3(0), params.resolution - 3);
+	return (static_cast<size_t>(base.z) * params.resolution.y + base.y) * params.resolution.x + base.x;
+}
+
+void MpmSolver::step()
+{
+	sortParticles();
+	particlesToGrid();
+	updateGrid();
+	gridToParticles();
+}
+
+void MpmSolver::sortParticles()
+{
+	cellStart.assign(nodes.size() + 1, 0);
+	for (const MpmParticle& p : particles)
+		cellStart[baseCellOf(p.position) + 1]++;
+	for (size_t c = 0; c < nodes.size(); c++)
+		cellStart[c + 1] += cellStart[c];
+
+	std::vector<uint32_t> cursor(cellStart.begin(), cellStart.end() - 1);
+	sorted.resize(particles.size());
+	for (const MpmParticle& p : particles)
+		sorted[cursor[baseCellOf(p.position)]++] = p;
+	particles.swap(sorted);
+}
+
+/*
+ * Projects the deformation gradient back onto the yield surface and computes
+ * the Kirchhoff stress of the next scatter, one SVD per particle.
+ */
+void MpmSolver::updateStress(MpmParticle& particle) const
+{
+	const MpmMaterialParams& material = params.materials[static_cast<int>(particle.material)];
+	const float E = material.youngsModulus;
+	const float nu = material.poissonRatio;
+	const float mu0 = E / (2.f * (1.f + nu));
+	const float lambda0 = E * nu / ((1.f + nu) * (1.f - 2.f * nu));
+
+	if (particle.material == MpmMaterial::Fluid) {
+		const float J = particle.volumeRatio;
+		const float bulk = E / (3.f * (1.f - 2.f * nu));
+		const glm::mat3& C = particle.affine;
+		particle.stress = bulk * J * (J - 1.f) * glm::mat3(1.f) + J * material.viscosity * (C + glm::transpose(C));
+		return;
+	}
+
+	glm::mat3 U, V;
+	glm::vec3 sigma;
+	svd3(particle.deformation, U, sigma, V);
+
+	if (particle.material == MpmMaterial::Snow) {
+		glm::vec3 clamped = glm::clamp(sigma, glm::vec3(1.f - material.criticalCompression),
+			glm::vec3(1.f + material.criticalStretch));
+		particle.plasticVolume *= (sigma.x * sigma.y * sigma.z) / (clamped.x * clamped.y * clamped.z);
+		sigma = clamped;
+
+		const float h = std::clamp(std::exp(material.hardening * (1.f - particle.plasticVolume)), 0.1f, 5.f);
+		const float J = sigma.x * sigma.y * sigma.z;
+		const glm::mat3 F = U * glm::mat3(sigma.x, 0.f, 0.f, 0.f, sigma.y, 0.f, 0.f, 0.f, sigma.z) * glm::transpose(V);
+		const glm::mat3 R = U * glm::transpose(V);
+
+		particle.deformation = F;
+		particle.stress = 2.f * mu0 * h * (F - R) * glm::transpose(F) + lambda0 * h * J * (J - 1.f) * glm::mat3(1.f);
+		return;
+	}
+
+	/* Sand: Drucker-Prager return mapping on the Hencky strain, no tension. */
+	const float sinPhi = std::sin(glm::radians(material.frictionAngle));
+	const float alpha = std::sqrt(2.f / 3.f) * 2.f * sinPhi / (3.f - sinPhi);
+
+	glm::vec3 epsilon = glm::log(glm::max(glm::abs(sigma), glm::vec3(1e-6f)));
+	float trace = epsilon.x + epsilon.y + epsilon.z;
+	glm::vec3 deviator = epsilon - trace / 3.f;
+	float deviatorNorm = glm::length(deviator);
+
+	if (trace >= 0.f) {
+		epsilon = glm::vec3(0.f);
+	}
+	else if (deviatorNorm > 1e-10f) {
+		float yield = deviatorNorm + (3.f * lambda0 + 2.f * mu0) / (2.f * mu0) * trace * alpha;
+		if (yield > 0.f) epsilon -= yield / deviatorNorm * deviator;
+	}
+
+	sigma = glm::exp(epsilon);
+	trace = epsilon.x + epsilon.y + epsilon.z;
+	glm::vec3 tau = 2.f * mu0 * epsilon + lambda0 * trace;
+
+	particle.deformation = U * glm::mat3(sigma.x, 0.f, 0.f, 0.f, sigma.y, 0.f, 0.f, 0.f, sigma.z) * glm::transpose(V);
+	particle.stress = U * glm::mat3(tau.x, 0.f, 0.f, 0.f, tau.y, 0.f, 0.f, 0.f, tau.z) * glm::transpose(U);
+}
+
+void MpmSolver::particlesToGrid()
+{
+	std::fill(nodes.begin(), nodes.end(), glm::vec4(0.f));
+
+	const glm::ivec3 res = params.resolution;
+	const float dt = params.timeStep;
+	const float dx = params.cellSize;
+	const float dInv = 4.f / (dx * dx);
+	const int blockSize = std::max(params.blockSize, 2);
+	const glm::ivec3 blocks = (res + blockSize - 1) / blockSize;
+
+	/* Stencils of base cells in one block reach blockSize + 2 nodes, same colored blocks are blockSize apart. */
+	for (int color = 0; color < 8; color++) {
+		const glm::ivec3 parity { color & 1, (color >> 1) & 1, (color >> 2) & 1 };
+		const glm::ivec3 colored = glm::max((blocks - parity + 1) / 2, glm::ivec3(0));
+		const size_t count = static_cast<size_t>(colored.x) * colored.y * colored.z;
+
+		parallelFor(count, 1, [&](size_t begin, size_t end) {
+			for (size_t b = begin; b < end; b++) {
+				glm::ivec3 block {
+					parity.x + 2 * static_cast<int>(b % colored.x),
+					parity.y + 2 * static_cast<int>(b / colored.x % colored.y),
+					parity.z + 2 * static_cast<int>(b / (static_cast<size_t>(colored.x) * colored.y))
+				};
+				glm::ivec3 lo = block * blockSize;
+				glm::ivec3 hi = glm::min(lo + blockSize, res);
+
+				for (int k = lo.z; k < hi.z; k++) {
+					for (int j = lo.y; j < hi.y; j++) {
+						for (int i = lo.x; i < hi.x; i++) {
+							size_t cell = (static_cast<size_t>(k) * res.y + j) * res.x + i;
+
+							for (uint32_t p = cellStart[cell]; p < cellStart[cell + 1]; p++) {
+								const MpmParticle& particle = particles[p];
+								const float mass = particle.volume * params.materials[static_cast<int>(particle.material)].density;
+
+								glm::vec3 fx = (particle.position - params.origin) / dx - glm::vec3(i, j, k);
+								glm::vec3 w[3];
+								quadraticWeights(fx, w);
+
+								glm::mat3 affine = -dt * particle.volume * dInv * particle.stress + mass * particle.affine;
+								glm::vec3 momentum = mass * particle.velocity;
+
+								for (int c = 0; c < 3; c++) {
+									for (int b2 = 0; b2 < 3; b2++) {
+										for (int a = 0; a < 3; a++) {
+											glm::vec3 dpos = (glm::vec3(a, b2, c) - fx) * dx;
+											float weight = w[a].x * w[b2].y * w[c].z;
+											size_t node = (static_cast<size_t>(k + c) * res.y + j + b2) * res.x + i + a;
+											nodes[node] += weight * glm::vec4(momentum + affine * dpos, mass);
+										}
+									}
+								}
+							}
+						}
+					}
+				}
+			}
+		});
+	}
+}
+
+void MpmSolver::updateGrid()
+{
+	const glm::ivec3 res = params.resolution;
+	const int bound = params.boundaryCells;
+	const float dt = params.timeStep;
+
+	parallelFor(static_cast<size_t>(res.z), 1, [&](size_t begin, size_t end) {
+		for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++) {
+			for (int j = 0; j < res.y; j++) {
+				for (int i = 0; i < res.x; i++) {
+					glm::vec4& node = nodes[(static_cast<size_t>(k) * res.y + j) * res.x + i];
+					if (node.w <= 0.f) continue;
+
+					glm::vec3 v = glm::vec3(node) / node.w + dt * params.gravity;
+					const glm::ivec3 index { i, j, k };
+					for (int axis = 0; axis < 3; axis++) {
+						bool into = (index[axis] < bound && v[axis] < 0.f) || (index[axis] >= res[axis] - bound && v[axis] > 0.f);
+						if (!into) continue;
+
+						/* Remove the normal part, Coulomb friction slows the tangential part. */
+						float normal = std::abs(v[axis]);
+						v[axis] = 0.f;
+						float tangential = glm::length(v);
+						v *= tangential > params.wallFriction * normal ? 1.f - params.wallFriction * normal / tangential : 0.f;
+					}
+					node = glm::vec4(v, node.w);
+				}
+			}
+		}
+	});
+}
+
+void MpmSolver::gridToParticles()
+{
+	const glm::ivec3 res = params.resolution;
+	const float dt = params.timeStep;
+	const float dx = params.cellSize;
+	const float dInv = 4.f / (dx * dx);
+	const glm::vec3 lo = params.origin + glm::vec3(1.f) * dx;
+	const glm::vec3 hi = params.origin + glm::vec3(res - 2) * dx;
+
+	/* Particles are sorted by base cell, so consecutive particles read the same nodes. */
+	parallelFor(particles.size(), 256, [&](size_t begin, size_t end) {
+		for (size_t p = begin; p < end; p++) {
+			MpmParticle& particle = particles[p];
+
+			glm::vec3 g = (particle.position - params.origin) / dx;
+			glm::ivec3 base = glm::clamp(glm::ivec3(glm::floor(g - 0.5f)), glm::ivec3(0), res - 3);
+			glm::vec3 fx = g - glm::vec3(base);
+			glm::vec3 w[3];
+			quadraticWeights(fx, w);
+
+			glm::vec3 velocity(0.f);
+			glm::mat3 B(0.f);
+			for (int c = 0; c < 3; c++) {
+				for (int b = 0; b < 3; b++) {
+					for (int a = 0; a < 3; a++) {
+						glm::vec3 dpos = (glm::vec3(a, b, c) - fx) * dx;
+						float weight = w[a].x * w[b].y * w[c].z;
+						glm::vec3 v = glm::vec3(nodes[(static_cast<size_t>(base.z + c) * res.y + base.y + b) * res.x + base.x + a]);
+						velocity += weight * v;
+						B += weight * glm::outerProduct(v, dpos);
+					}
+				}
+			}
+
+			particle.velocity = velocity;
+			particle.affine = dInv * B;
+			particle.position = glm::clamp(particle.position + dt * velocity, lo, hi);
+
+			if (particle.material == MpmMaterial::Fluid) {
+				float trace = particle.affine[0][0] + particle.affine[1][1] + particle.affine[2][2];
+				particle.volumeRatio = std::clamp(particle.volumeRatio * (1.f + dt * trace), 0.5f, 2.f);
+			}
+			else {
+				particle.deformation = (glm::mat3(1.f) + dt * particle.affine) * particle.deformation;
+			}
+			updateStress(particle);
+		}
+	});
+}
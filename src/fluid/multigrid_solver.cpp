@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/multigrid_solver.hpp"
+#include "fluid/parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+MultigridPressureSolver::MultigridPressureSolver(const PressureSolverParams& params, const MultigridParams& multigrid)
+	: PressureSolver(params), multigrid(multigrid)
+{
+}
+
+void MultigridPressureSolver::buildHierarchy(const MacGrid& grid, const PoissonSystem& A)
+{
+	/* A is rebuilt by the caller every solve, so the finest level's pointer from the last call is stale here. */
+	if (levels.empty() || cachedCellType != grid.cellType || cachedDims != A.dims) {
+		cachedCellType = grid.cellType;
+		cachedDims = A.dims;
+		levels.clear();
+
+		Level fine;
+		fine.cellType = grid.cellType;
+		levels.push_back(std::move(fine));
+
+		glm::ivec3 dims = A.dims;
+		while (std::min({ dims.x, dims.y, dims.z }) / 2 >= multigrid.coarsestSize) {
+			glm::ivec3 coarseDims = (dims + 1) / 2;
+			const std::vector<CellType>& fineType = levels.back().cellType;
+
+			Level coarse;
+			coarse.cellType.assign(static_cast<size_t>(coarseDims.x) * coarseDims.y * coarseDims.z, CellType::Solid);
+			for (int k = 0; k < dims.z; k++) {
+				for (int j = 0; j < dims.y; j++) {
+					for (int i = 0; i < dims.x; i++) {
+						CellType child = fineType[(static_cast<size_t>(k) * dims.y + j) * dims.x + i];
+						CellType& parent = coarse.cellType[(static_cast<size_t>(k / 2) * coarseDims.y + j / 2) * coarseDims.x + i / 2];
+
+						if (child == CellType::Air) parent = CellType::Air;
+						else if (child == CellType::Fluid && parent == CellType::Solid) parent = CellType::Fluid;
+					}
+				}
+			}
+
+			coarse.coarseA = buildPoissonSystem(coarseDims, coarse.cellType);
+			levels.push_back(std::move(coarse));
+			dims = coarseDims;
+		}
+
+		for (size_t l = 1; l < levels.size(); l++) {
+			Level& level = levels[l];
+			level.A = &level.coarseA;
+			level.x.assign(level.cellType.size(), 0.f);
+			level.b.assign(level.cellType.size(), 0.f);
+			level.r.assign(level.cellType.size(), 0.f);
+		}
+	}
+
+	levels[0].A = &A;
+}
+
+void MultigridPressureSolver::smooth(Level& level, uint32_t sweeps)
+{
+	const PoissonSystem& A = *level.A;
+	const int nx = A.dims.x;
+	const int ny = A.dims.y;
+	const int nz = A.dims.z;
+	const size_t slice = static_cast<size_t>(nx) * ny;
+
+	for (uint32_t sweep = 0; sweep < sweeps; sweep++) {
+		for (int color = 0; color < 2; color++) {
+			/* Cells of one color only couple to the other color, so slices run in parallel. */
+			parallelFor(static_cast<size_t>(nz), 1, [&](size_t begin, size_t end) {
+				for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++) {
+					for (int j = 0; j < ny; j++) {
+						for (int i = (color + j + k) & 1; i < nx; i += 2) {
+							size_t c = A.index(i, j, k);
+							if (A.diag[c] == 0.f) continue;
+
+							float sigma = 0.f;
+							if (i + 1 < nx) sigma += A.plusX[c] * level.x[c + 1];
+							if (i > 0) sigma += A.plusX[c - 1] * level.x[c - 1];
+							if (j + 1 < ny) sigma += A.plusY[c] * level.x[c + nx];
+							if (j > 0) sigma += A.plusY[c - nx] * level.x[c - nx];
+							if (k + 1 < nz) sigma += A.plusZ[c] * level.x[c + slice];
+							if (k > 0) sigma += A.plusZ[c - slice] * level.x[c - slice];
+
+							level.x[c] = (level.b[c] - sigma) / A.diag[c];
+						}
+					}
+				}
+			});
+		}
+	}
+}
+
+void MultigridPressureSolver::computeResidual(Level& level)
+{
+	const PoissonSystem& A = *level.A;
+	applyPoisson(A, level.x, level.r);
+
+	for (size_t c = 0; c < A.size(); c++)
+		level.r[c] = A.diag[c] > 0.f ? level.b[c] - level.r[c] : 0.f;
+}
+
+void MultigridPressureSolver::restrictResidual(const Level& fine, Level& coarse)
+{
+	const glm::ivec3 fd = fine.A->dims;
+	const glm::ivec3 cd = coarse.A->dims;
+
+	/* Sum of the 8 children, times 4 / 8 for the doubled spacing of the unscaled stencil. */
+	parallelFor(static_cast<size_t>(cd.z), 1, [&](size_t begin, size_t end) {
+		for (int K = static_cast<int>(begin); K < static_cast<int>(end); K++) {
+			for (int J = 0; J < cd.y; J++) {
+				for (int I = 0; I < cd.x; I++) {
+					size_t C = coarse.A->index(I, J, K);
+					float sum = 0.f;
+
+					for (int k = 2 * K; k < std::min(2 * K + 2, fd.z); k++)
+						for (int j = 2 * J; j < std::min(2 * J + 2, fd.y); j++)
+							for (int i = 2 * I; i < std::min(2 * I + 2, fd.x); i++)
+								sum += fine.r[fine.A->index(i, j, k)];
+
+					coarse.b[C] = coarse.A->diag[C] > 0.f ? 0.5f * sum : 0.f;
+				}
+			}
+		}
+	});
+}
+
+void MultigridPressureSolver::prolongateAndCorrect(const Level& coarse, Level& fine)
+{
+	const glm::ivec3 fd = fine.A->dims;
+	const glm::ivec3 cd = coarse.A->dims;
+
+	parallelFor(static_cast<size_t>(fd.z), 1, [&](size_t begin, size_t end) {
+		for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++) {
+			for (int j = 0; j < fd.y; j++) {
+				for (int i = 0; i < fd.x; i++) {
+					size_t c = fine.A->index(i, j, k);
+					if (fine.A->diag[c] == 0.f) continue;
+
+					/* Cell-centred trilinear weights 3/4 and 1/4, skipping coarse cells without a fluid row. */
+					const glm::ivec3 base { i / 2, j / 2, k / 2 };
+					const glm::ivec3 step { (i & 1) ? 1 : -1, (j & 1) ? 1 : -1, (k & 1) ? 1 : -1 };
+
+					float value = 0.f;
+					float weight = 0.f;
+					for (int dz = 0; dz < 2; dz++) {
+						for (int dy = 0; dy < 2; dy++) {
+							for (int dx = 0; dx < 2; dx++) {
+								glm::ivec3 n = base + glm::ivec3(dx, dy, dz) * step;
+								if (n.x < 0 || n.y < 0 || n.z < 0 || n.x >= cd.x || n.y >= cd.y || n.z >= cd.z) continue;
+
+								size_t C = coarse.A->index(n.x, n.y, n.z);
+								if (coarse.A->diag[C] == 0.f) continue;
+
+								float w = (dx ? 0.25f : 0.75f) * (dy ? 0.25f : 0.75f) * (dz ? 0.25f : 0.75f);
+								value += w * coarse.x[C];
+								weight += w;
+							}
+						}
+					}
+
+					if (weight > 0.f) fine.x[c] += value / weight;
+				}
+			}
+		}
+	});
+}
+
+void MultigridPressureSolver::vCycle(size_t l)
+{
+	Level& level = levels[l];
+
+	if (l + 1 == levels.size()) {
+		smooth(level, multigrid.coarsestSweeps);
+		return;
+	}
+
+	smooth(level, multigrid.preSmoothing);
+	computeResidual(level);
+
+	Level& coarse = levels[l + 1];
+	restrictResidual(level, coarse);
+	if (coarse.A->singular) removeNullSpace(*coarse.A, coarse.b);
+	std::fill(coarse.x.begin(), coarse.x.end(), 0.f);
+
+	vCycle(l + 1);
+
+	prolongateAndCorrect(coarse, level);
+	smooth(level, multigrid.postSmoothing);
+}
+
+void MultigridPressureSolver::solve(const MacGrid& grid, const PoissonSystem& A,
+		const std::vector<float>& rhs, std::vector<float>& pressure)
+{
+	auto start = std::chrono::steady_clock::now();
+	stats = {};
+
+	buildHierarchy(grid, A);
+
+	Level& fine = levels[0];
+	fine.b = rhs;
+	if (A.singular) removeNullSpace(A, fine.b);
+	fine.x = pressure;
+	fine.r.resize(A.size());
+
+	const double rhsNorm = std::sqrt(std::inner_product(fine.b.begin(), fine.b.end(), fine.b.begin(), 0.0));
+	if (rhsNorm == 0.0) {
+		std::fill(pressure.begin(), pressure.end(), 0.f);
+		return;
+	}
+
+	for (uint32_t cycle = 0; cycle < params.maxIterations; cycle++) {
+		vCycle(0);
+		computeResidual(fine);
+		stats.iterations++;
+
+		double residual = std::sqrt(std::inner_product(fine.r.begin(), fine.r.end(), fine.r.begin(), 0.0)) / rhsNorm;
+		stats.residualHistory.push_back(static_cast<float>(residual));
+		if (residual < params.tolerance) break;
+	}
+
+	pressure.swap(fine.x);
+	if (A.singular) removeNullSpace(A, pressure);
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
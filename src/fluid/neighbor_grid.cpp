@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/neighbor_grid.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+template<int Dim>
+BasicNeighborGrid<Dim>::BasicNeighborGrid(Vec boundsMin, Vec boundsMax, float cellSize)
+	: origin(boundsMin), invCellSize(1.f / cellSize)
+{
+	if (cellSize <= 0.f)
+		throw std::invalid_argument("NeighborGrid cell size must be positive!");
+
+	dims = glm::max(IVec(glm::ceil((boundsMax - boundsMin) * invCellSize)), IVec(1));
+
+	size_t cells = 1;
+	for (int axis = 0; axis < Dim; axis++) cells *= static_cast<size_t>(dims[axis]);
+	cellStart.assign(cells + 1, 0);
+}
+
+template<int Dim>
+typename BasicNeighborGrid<Dim>::IVec BasicNeighborGrid<Dim>::cellCoord(const Vec& position) const
+{
+	IVec coord = IVec(glm::floor((position - origin) * invCellSize));
+	return glm::clamp(coord, IVec(0), dims - 1);
+}
+
+template<int Dim>
+uint32_t BasicNeighborGrid<Dim>::cellIndex(const IVec& coord) const
+{
+	if constexpr (Dim == 2) return static_cast<uint32_t>(coord.y * dims.x + coord.x);
+	else return static_cast<uint32_t>((coord.z * dims.y + coord.y) * dims.x + coord.x);
+}
+
+template<int Dim>
+void BasicNeighborGrid<Dim>::build(const std::vector<BasicParticle<Dim>>& particles)
+{
+	particleCell.resize(particles.size());
+	particleIndices.resize(particles.size());
+	std::fill(cellStart.begin(), cellStart.end(), 0);
+
+	for (size_t i = 0; i < particles.size(); i++) {
+		particleCell[i] = cellIndex(cellCoord(particles[i].position));
+		cellStart[particleCell[i] + 1]++;
+	}
+
+	for (size_t c = 1; c < cellStart.size(); c++)
+		cellStart[c] += cellStart[c - 1];
+
+	std::vector<uint32_t> cursor(cellStart.begin(), cellStart.end() - 1);
+	for (size_t i = 0; i < particles.size(); i++)
+		particleIndices[cursor[particleCell[i]]++] = static_cast<uint32_t>(i);
+}
+
+template<int Dim>
+size_t BasicNeighborGrid<Dim>::memoryBytes() const
+{
+	return (cellStart.capacity() + particleIndices.capacity() + particleCell.capacity()) * sizeof(uint32_t);
+}
+
+template class BasicNeighborGrid<2>;
+template class BasicNeighborGrid<3>;
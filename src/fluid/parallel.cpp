@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/parallel.hpp"
+
+#include <algorithm>
+
+static thread_local bool insideParallelFor = false;
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+	for (unsigned i = 1; i < std::max(threadCount, 1u); i++)
+		workers.emplace_back([this] { workerLoop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+}
+
+ThreadPool& ThreadPool::global()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn)
+{
+	grain = std::max<size_t>(grain, 1);
+	if (count == 0) return;
+
+	if (workers.empty() || insideParallelFor || count <= grain) {
+		fn(0, count);
+		return;
+	}
+
+	std::lock_guard submit(submitMutex);
+	{
+		std::lock_guard lock(mutex);
+		job = &fn;
+		jobCount = count;
+		jobGrain = grain;
+		nextChunk = 0;
+		busyWorkers = static_cast<unsigned>(workers.size());
+		generation++;
+	}
+	wake.notify_all();
+
+	runChunks();
+
+	std::unique_lock lock(mutex);
+	done.wait(lock, [this] { return busyWorkers == 0; });
+	job = nullptr;
+}
+
+void ThreadPool::workerLoop()
+{
+	uint64_t seen = 0;
+
+	while (true) {
+		{
+			std::unique_lock lock(mutex);
+			wake.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping) return;
+			seen = generation;
+		}
+
+		runChunks();
+
+		std::lock_guard lock(mutex);
+		if (--busyWorkers == 0) done.notify_one();
+	}
+}
+
+void ThreadPool::runChunks()
+{
+	insideParallelFor = true;
+
+	size_t chunk;
+	while ((chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) * jobGrain < jobCount) {
+		size_t begin = chunk * jobGrain;
+		(*job)(begin, std::min(begin + jobGrain, jobCount));
+	}
+
+	insideParallelFor = false;
+}
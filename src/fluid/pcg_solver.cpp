@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/pcg_solver.hpp"
+#include "fluid/parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+/*
+ * Calls fn(i, j, k) for every cell on the wavefront i + j + k = front, in
+ * parallel over z, and returns the sum of its results.
+ */
+template<typename F>
+static double sweepWavefront(const PoissonSystem& A, int front, std::vector<double>& partial, F&& fn)
+{
+	const glm::ivec3 n = A.dims;
+	const int kBegin = std::max(0, front - (n.x - 1) - (n.y - 1));
+	const int kEnd = std::min(n.z - 1, front) + 1;
+	if (kBegin >= kEnd) return 0.0;
+
+	partial.assign(static_cast<size_t>(kEnd - kBegin), 0.0);
+	parallelFor(partial.size(), 8, [&](size_t begin, size_t end) {
+		for (size_t slot = begin; slot < end; slot++) {
+			const int k = kBegin + static_cast<int>(slot);
+			const int jBegin = std::max(0, front - k - (n.x - 1));
+			const int jEnd = std::min(n.y - 1, front - k) + 1;
+
+			double sum = 0.0;
+			for (int j = jBegin; j < jEnd; j++)
+				sum += fn(front - k - j, j, k);
+			partial[slot] = sum;
+		}
+	});
+
+	return std::accumulate(partial.begin(), partial.end(), 0.0);
+}
+
+PcgPressureSolver::PcgPressureSolver(const PressureSolverParams& params, const PcgParams& pcg)
+	: PressureSolver(params), pcg(pcg)
+{
+}
+
+void PcgPressureSolver::buildPreconditioner(const PoissonSystem& A)
+{
+	const int nx = A.dims.x;
+	const size_t slice = static_cast<size_t>(nx) * A.dims.y;
+	precon.assign(A.size(), 0.f);
+	if (!pcg.precondition) return;
+
+	/* Fill-in dropped by the factorization is added back onto the diagonal, scaled by tuning. */
+	const int fronts = A.dims.x + A.dims.y + A.dims.z - 2;
+	std::vector<double> partial;
+	for (int front = 0; front < fronts; front++) {
+		sweepWavefront(A, front, partial, [&](int i, int j, int k) {
+			const size_t c = A.index(i, j, k);
+			if (A.diag[c] == 0.f) return 0.0;
+
+			float e = A.diag[c];
+			if (i > 0) {
+				const size_t n = c - 1;
+				const float t = A.plusX[n] * precon[n];
+				e -= t * t + pcg.tuning * A.plusX[n] * (A.plusY[n] + A.plusZ[n]) * precon[n] * precon[n];
+			}
+			if (j > 0) {
+				const size_t n = c - nx;
+				const float t = A.plusY[n] * precon[n];
+				e -= t * t + pcg.tuning * A.plusY[n] * (A.plusX[n] + A.plusZ[n]) * precon[n] * precon[n];
+			}
+			if (k > 0) {
+				const size_t n = c - slice;
+				const float t = A.plusZ[n] * precon[n];
+				e -= t * t + pcg.tuning * A.plusZ[n] * (A.plusX[n] + A.plusY[n]) * precon[n] * precon[n];
+			}
+
+			if (e < pcg.safety * A.diag[c]) e = A.diag[c];
+			precon[c] = 1.f / std::sqrt(e);
+			return 0.0;
+		});
+	}
+}
+
+/* Forward solve L y = r by increasing wavefronts, then L^T z = y by decreasing ones. */
+double PcgPressureSolver::applyPreconditioner(const PoissonSystem& A, const std::vector<float>& r, std::vector<float>& z)
+{
+	const int nx = A.dims.x;
+	const size_t slice = static_cast<size_t>(nx) * A.dims.y;
+	z.resize(A.size());
+
+	if (!pcg.precondition) {
+		std::copy(r.begin(), r.end(), z.begin());
+		return std::inner_product(r.begin(), r.end(), r.begin(), 0.0);
+	}
+
+	const int fronts = A.dims.x + A.dims.y + A.dims.z - 2;
+	std::vector<double> partial;
+
+	for (int front = 0; front < fronts; front++) {
+		sweepWavefront(A, front, partial, [&](int i, int j, int k) {
+			const size_t c = A.index(i, j, k);
+			if (A.diag[c] == 0.f) {
+				z[c] = 0.f;
+				return 0.0;
+			}
+
+			float t = r[c];
+			if (i > 0) t -= A.plusX[c - 1] * precon[c - 1] * z[c - 1];
+			if (j > 0) t -= A.plusY[c - nx] * precon[c - nx] * z[c - nx];
+			if (k > 0) t -= A.plusZ[c - slice] * precon[c - slice] * z[c - slice];
+			z[c] = t * precon[c];
+			return 0.0;
+		});
+	}
+
+	double rz = 0.0;
+	for (int front = fronts - 1; front >= 0; front--) {
+		rz += sweepWavefront(A, front, partial, [&](int i, int j, int k) {
+			const size_t c = A.index(i, j, k);
+			if (A.diag[c] == 0.f) return 0.0;
+
+			float t = z[c];
+			if (i + 1 < nx) t -= A.plusX[c] * precon[c] * z[c + 1];
+			if (j + 1 < A.dims.y) t -= A.plusY[c] * precon[c] * z[c + nx];
+			if (k + 1 < A.dims.z) t -= A.plusZ[c] * precon[c] * z[c + slice];
+			z[c] = t * precon[c];
+			return static_cast<double>(r[c]) * z[c];
+		});
+	}
+	return rz;
+}
+
+void PcgPressureSolver::solve(const MacGrid&, const PoissonSystem& A,
+		const std::vector<float>& rhs, std::vector<float>& pressure)
+{
+	auto start = std::chrono::steady_clock::now();
+	stats = {};
+
+	r = rhs;
+	if (A.singular) removeNullSpace(A, r);
+
+	const double rhsNorm = std::sqrt(std::inner_product(r.begin(), r.end(), r.begin(), 0.0));
+	if (rhsNorm == 0.0) {
+		std::fill(pressure.begin(), pressure.end(), 0.f);
+		return;
+	}
+
+	/* r = b - A p for the initial guess. */
+	applyPoisson(A, pressure, q);
+	for (size_t c = 0; c < A.size(); c++)
+		r[c] = A.diag[c] > 0.f ? r[c] - q[c] : 0.f;
+	if (A.singular) removeNullSpace(A, r);
+
+	buildPreconditioner(A);
+	double rz = applyPreconditioner(A, r, z);
+	s = z;
+
+	const size_t slice = static_cast<size_t>(A.dims.x) * A.dims.y;
+	std::vector<double> partial(static_cast<size_t>(A.dims.z), 0.0);
+
+	for (uint32_t iteration = 0; iteration < params.maxIterations; iteration++) {
+		double sq = applyPoissonDot(A, s, q);
+		if (sq <= 0.0) break;
+		const float alpha = static_cast<float>(rz / sq);
+
+		/* Fused AXPYs: p += alpha s, r -= alpha q, and |r|^2 in one pass. */
+		parallelFor(partial.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t k = begin; k < end; k++) {
+				double sum = 0.0;
+				for (size_t c = k * slice; c < (k + 1) * slice; c++) {
+					pressure[c] += alpha * s[c];
+					r[c] -= alpha * q[c];
+					sum += static_cast<double>(r[c]) * r[c];
+				}
+				partial[k] = sum;
+			}
+		});
+		stats.iterations++;
+
+		double residual = std::sqrt(std::accumulate(partial.begin(), partial.end(), 0.0)) / rhsNorm;
+		stats.residualHistory.push_back(static_cast<float>(residual));
+		if (residual < params.tolerance) break;
+
+		double rzNext = applyPreconditioner(A, r, z);
+		const float beta = static_cast<float>(rzNext / rz);
+		rz = rzNext;
+
+		parallelFor(partial.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t c = begin * slice; c < end * slice; c++)
+				s[c] = z[c] + beta * s[c];
+		});
+	}
+
+	if (A.singular) removeNullSpace(A, pressure);
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
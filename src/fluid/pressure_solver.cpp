@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/pressure_solver.hpp"
+#include "fluid/parallel.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+PoissonSystem buildPoissonSystem(const MacGrid& grid)
+{
+	return buildPoissonSystem(grid.dims, grid.cellType);
+}
+
+PoissonSystem buildPoissonSystem(glm::ivec3 dims, const std::vector<CellType>& cellType)
+{
+	const size_t count = static_cast<size_t>(dims.x) * dims.y * dims.z;
+
+	PoissonSystem A;
+	A.dims = dims;
+	A.diag.assign(count, 0.f);
+	A.plusX.assign(count, 0.f);
+	A.plusY.assign(count, 0.f);
+	A.plusZ.assign(count, 0.f);
+
+	auto typeAt = [&](int i, int j, int k) {
+		if (i < 0 || j < 0 || k < 0 || i >= dims.x || j >= dims.y || k >= dims.z) return CellType::Solid;
+		return cellType[A.index(i, j, k)];
+	};
+
+	bool anyAir = false;
+	for (int k = 0; k < dims.z; k++) {
+		for (int j = 0; j < dims.y; j++) {
+			for (int i = 0; i < dims.x; i++) {
+				size_t c = A.index(i, j, k);
+				anyAir |= cellType[c] == CellType::Air;
+				if (cellType[c] != CellType::Fluid) continue;
+
+				const glm::ivec3 neighbors[6] = {
+					{ i - 1, j, k }, { i + 1, j, k }, { i, j - 1, k },
+					{ i, j + 1, k }, { i, j, k - 1 }, { i, j, k + 1 }
+				};
+				for (const glm::ivec3& n : neighbors)
+					if (typeAt(n.x, n.y, n.z) != CellType::Solid) A.diag[c] += 1.f;
+
+				if (typeAt(i + 1, j, k) == CellType::Fluid) A.plusX[c] = -1.f;
+				if (typeAt(i, j + 1, k) == CellType::Fluid) A.plusY[c] = -1.f;
+				if (typeAt(i, j, k + 1) == CellType::Fluid) A.plusZ[c] = -1.f;
+			}
+		}
+	}
+
+	A.singular = !anyAir;
+	return A;
+}
+
+/* One x-row of A * x, written so the compiler vectorizes every loop. */
+static void applyPoissonRow(const PoissonSystem& A, const float* x, float* result, int j, int k)
+{
+	const int nx = A.dims.x;
+	const size_t slice = static_cast<size_t>(nx) * A.dims.y;
+	const size_t row = A.index(0, j, k);
+	float* out = result + row;
+	const float* xr = x + row;
+
+	for (int i = 0; i < nx; i++)
+		out[i] = A.diag[row + i] * xr[i];
+	for (int i = 0; i + 1 < nx; i++) {
+		out[i] += A.plusX[row + i] * xr[i + 1];
+		out[i + 1] += A.plusX[row + i] * xr[i];
+	}
+	if (j + 1 < A.dims.y)
+		for (int i = 0; i < nx; i++) out[i] += A.plusY[row + i] * xr[i + nx];
+	if (j > 0)
+		for (int i = 0; i < nx; i++) out[i] += A.plusY[row - nx + i] * xr[i - nx];
+	if (k + 1 < A.dims.z)
+		for (int i = 0; i < nx; i++) out[i] += A.plusZ[row + i] * xr[i + slice];
+	if (k > 0)
+		for (int i = 0; i < nx; i++) out[i] += A.plusZ[row - slice + i] * xr[i - slice];
+}
+
+void applyPoisson(const PoissonSystem& A, const std::vector<float>& x, std::vector<float>& result)
+{
+	result.resize(A.size());
+
+	parallelFor(static_cast<size_t>(A.dims.z), 1, [&](size_t begin, size_t end) {
+		for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++)
+			for (int j = 0; j < A.dims.y; j++)
+				applyPoissonRow(A, x.data(), result.data(), j, k);
+	});
+}
+
+double applyPoissonDot(const PoissonSystem& A, const std::vector<float>& x, std::vector<float>& result)
+{
+	result.resize(A.size());
+	std::vector<double> partial(static_cast<size_t>(A.dims.z), 0.0);
+
+	parallelFor(partial.size(), 1, [&](size_t begin, size_t end) {
+		for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++) {
+			double sum = 0.0;
+			for (int j = 0; j < A.dims.y; j++) {
+				applyPoissonRow(A, x.data(), result.data(), j, k);
+
+				const size_t row = A.index(0, j, k);
+				for (int i = 0; i < A.dims.x; i++)
+					sum += static_cast<double>(x[row + i]) * result[row + i];
+			}
+			partial[k] = sum;
+		}
+	});
+
+	return std::accumulate(partial.begin(), partial.end(), 0.0);
+}
+
+void removeNullSpace(const PoissonSystem& A, std::vector<float>& x)
+{
+	double sum = 0.0;
+	size_t count = 0;
+	for (size_t c = 0; c < A.size(); c++) {
+		if (A.diag[c] == 0.f) continue;
+		sum += x[c];
+		count++;
+	}
+	if (count == 0) return;
+
+	float mean = static_cast<float>(sum / count);
+	for (size_t c = 0; c < A.size(); c++)
+		if (A.diag[c] != 0.f) x[c] -= mean;
+}
+
+void enforceSolidBoundaries(MacGrid& grid)
+{
+	const glm::ivec3 n = grid.dims;
+
+	parallelFor(static_cast<size_t>(n.z + 1), 1, [&](size_t begin, size_t end) {
+		for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++) {
+			for (int j = 0; j <= n.y; j++) {
+				for (int i = 0; i <= n.x; i++) {
+					if (j < n.y && k < n.z && (grid.isSolid(i - 1, j, k) || grid.isSolid(i, j, k)))
+						grid.u[grid.uIndex(i, j, k)] = 0.f;
+					if (i < n.x && k < n.z && (grid.isSolid(i, j - 1, k) || grid.isSolid(i, j, k)))
+						grid.v[grid.vIndex(i, j, k)] = 0.f;
+					if (i < n.x && j < n.y && (grid.isSolid(i, j, k - 1) || grid.isSolid(i, j, k)))
+						grid.w[grid.wIndex(i, j, k)] = 0.f;
+				}
+			}
+		}
+	});
+}
+
+void projectVelocity(MacGrid& grid, PressureSolver& pressureSolver, std::vector<float>& rhs)
+{
+	const glm::ivec3 n = grid.dims;
+	PoissonSystem A = buildPoissonSystem(grid);
+
+	/* Right-hand side is the negated net outflow of each fluid cell. */
+	rhs.assign(grid.cellCount(), 0.f);
+	parallelFor(static_cast<size_t>(n.z), 1, [&](size_t begin, size_t end) {
+		for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++) {
+			for (int j = 0; j < n.y; j++) {
+				for (int i = 0; i < n.x; i++) {
+					size_t c = grid.cellIndex(i, j, k);
+					if (grid.cellType[c] != CellType::Fluid) continue;
+
+					rhs[c] = -(grid.u[grid.uIndex(i + 1, j, k)] - grid.u[grid.uIndex(i, j, k)]
+						+ grid.v[grid.vIndex(i, j + 1, k)] - grid.v[grid.vIndex(i, j, k)]
+						+ grid.w[grid.wIndex(i, j, k + 1)] - grid.w[grid.wIndex(i, j, k)]);
+				}
+			}
+		}
+	});
+
+	pressureSolver.solve(grid, A, rhs, grid.pressure);
+
+	/* Pressure is scaled by dt / (rho dx), so the update is a plain difference. */
+	auto pressureAt = [&](int i, int j, int k) {
+		size_t c = grid.cellIndex(i, j, k);
+		return grid.cellType[c] == CellType::Fluid ? grid.pressure[c] : 0.f;
+	};
+	auto update = [&](float& face, int i0, int j0, int k0, int i1, int j1, int k1) {
+		if (grid.isSolid(i0, j0, k0) || grid.isSolid(i1, j1, k1)) return;
+		if (grid.cellType[grid.cellIndex(i0, j0, k0)] != CellType::Fluid &&
+			grid.cellType[grid.cellIndex(i1, j1, k1)] != CellType::Fluid) return;
+		face -= pressureAt(i1, j1, k1) - pressureAt(i0, j0, k0);
+	};
+
+	parallelFor(static_cast<size_t>(n.z + 1), 1, [&](size_t begin, size_t end) {
+		for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++) {
+			for (int j = 0; j <= n.y; j++) {
+				for (int i = 0; i <= n.x; i++) {
+					if (j < n.y && k < n.z) update(grid.u[grid.uIndex(i, j, k)], i - 1, j, k, i, j, k);
+					if (i < n.x && k < n.z) update(grid.v[grid.vIndex(i, j, k)], i, j - 1, k, i, j, k);
+					if (i < n.x && j < n.y) update(grid.w[grid.wIndex(i, j, k)], i, j, k - 1, i, j, k);
+				}
+			}
+		}
+	});
+}
+
+/* === JacobiPressureSolver === */
+
+void JacobiPressureSolver::solve(const MacGrid&, const PoissonSystem& A,
+		const std::vector<float>& rhs, std::vector<float>& pressure)
+{
+	auto start = std::chrono::steady_clock::now();
+	stats = {};
+
+	std::vector<float> b = rhs;
+	if (A.singular) removeNullSpace(A, b);
+
+	const double rhsNorm = std::sqrt(std::inner_product(b.begin(), b.end(), b.begin(), 0.0));
+	if (rhsNorm == 0.0) {
+		std::fill(pressure.begin(), pressure.end(), 0.f);
+		return;
+	}
+
+	std::vector<float> Ap;
+	next.resize(A.size());
+
+	for (uint32_t iteration = 0; iteration < params.maxIterations; iteration++) {
+		applyPoisson(A, pressure, Ap);
+
+		/* Fused residual and update: p' = p + (b - A p) / diag. */
+		std::vector<double> partial(static_cast<size_t>(A.dims.z), 0.0);
+		const size_t slice = static_cast<size_t>(A.dims.x) * A.dims.y;
+		parallelFor(partial.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t k = begin; k < end; k++) {
+				double sum = 0.0;
+				for (size_t c = k * slice; c < (k + 1) * slice; c++) {
+					float r = A.diag[c] > 0.f ? b[c] - Ap[c] : 0.f;
+					next[c] = A.diag[c] > 0.f ? pressure[c] + r / A.diag[c] : 0.f;
+					sum += static_cast<double>(r) * r;
+				}
+				partial[k] = sum;
+			}
+		});
+
+		pressure.swap(next);
+		stats.iterations++;
+
+		double residual = std::sqrt(std::accumulate(partial.begin(), partial.end(), 0.0)) / rhsNorm;
+		stats.residualHistory.push_back(static_cast<float>(residual));
+		if (residual < params.tolerance) break;
+	}
+
+	if (A.singular) removeNullSpace(A, pressure);
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/shallow_water.hpp"
+#include "fluid/parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+ShallowWaterSolver::ShallowWaterSolver(const ShallowWaterParams& params)
+	: params(params)
+{
+	const glm::ivec2 n = params.resolution;
+	depth.assign(static_cast<size_t>(n.x) * n.y, 0.f);
+	depthNext = depth;
+	outflowLimit = depth;
+	bed = depth;
+	u.assign(static_cast<size_t>(n.x + 1) * n.y, 0.f);
+	v.assign(static_cast<size_t>(n.x) * (n.y + 1), 0.f);
+	uNext = u;
+	vNext = v;
+}
+
+void ShallowWaterSolver::setBed(std::span<const float> elevation)
+{
+	bed.assign(elevation.begin(), elevation.end());
+	bed.resize(depth.size(), 0.f);
+}
+
+void ShallowWaterSolver::setWaterLevel(float level)
+{
+	for (size_t c = 0; c < depth.size(); c++)
+		depth[c] = std::max(level - bed[c], 0.f);
+	maxSpeed = 0.f;
+}
+
+void ShallowWaterSolver::addWater(glm::vec2 center, float radius, float height)
+{
+	const glm::ivec2 n = params.resolution;
+	glm::ivec2 lo = glm::max(glm::ivec2(glm::floor((center - radius - params.origin) / params.cellSize)), glm::ivec2(0));
+	glm::ivec2 hi = glm::min(glm::ivec2(glm::ceil((center + radius - params.origin) / params.cellSize)), n - 1);
+
+	for (int j = lo.y; j <= hi.y; j++) {
+		for (int i = lo.x; i <= hi.x; i++) {
+			glm::vec2 p = params.origin + (glm::vec2(i, j) + 0.5f) * params.cellSize;
+			float r = glm::distance(p, center) / radius;
+			if (r < 1.f) depth[cellIndex(i, j)] += height * 0.5f * (1.f + std::cos(std::numbers::pi_v<float> * r));
+		}
+	}
+	maxSpeed = 0.f;
+}
+
+void ShallowWaterSolver::step()
+{
+	if (maxSpeed == 0.f) {
+		float deepest = *std::max_element(depth.begin(), depth.end());
+		maxSpeed = std::sqrt(params.gravity * deepest);
+	}
+
+	float remaining = params.timeStep;
+	lastSubstepCount = 0;
+	while (remaining > 0.f) {
+		float dt = std::min(remaining, params.cfl * params.cellSize / std::max(maxSpeed, 1e-6f));
+		if (remaining - dt < 1e-3f * dt) dt = remaining;
+
+		updateVelocities(dt);
+		maxSpeed = updateDepth(dt);
+
+		remaining -= dt;
+		lastSubstep = dt;
+		lastSubstepCount++;
+	}
+}
+
+/*
+ * Pressure gradient from the free surface, upwind momentum advection and
+ * bed friction. A face only carries flow if the cell it draws from is wet.
+ */
+void ShallowWaterSolver::updateVelocities(float dt)
+{
+	const int nx = params.resolution.x;
+	const int ny = params.resolution.y;
+	const float dx = params.cellSize;
+	const float g = params.gravity;
+	const float dry = params.dryDepth;
+	const float advect = params.advectMomentum ? 1.f : 0.f;
+	const size_t uStride = static_cast<size_t>(nx) + 1;
+
+	parallelFor(static_cast<size_t>(ny), 16, [&](size_t begin, size_t end) {
+		for (int j = static_cast<int>(begin); j < static_cast<int>(end); j++) {
+			const float* h = depth.data() + cellIndex(0, j);
+			const float* b = bed.data() + cellIndex(0, j);
+			const float* uc = u.data() + j * uStride;
+			const float* uBelow = u.data() + std::max(j - 1, 0) * uStride;
+			const float* uAbove = u.data() + std::min(j + 1, ny - 1) * uStride;
+			const float* vLo = v.data() + cellIndex(0, j);
+			const float* vHi = vLo + nx;
+			float* out = uNext.data() + j * uStride;
+
+			out[0] = 0.f;
+			out[nx] = 0.f;
+			for (int i = 1; i < nx; i++) {
+				const float vel = uc[i];
+				const float dudx = vel > 0.f ? vel - uc[i - 1] : uc[i + 1] - vel;
+				const float vf = 0.25f * (vLo[i - 1] + vLo[i] + vHi[i - 1] + vHi[i]);
+				const float dudy = vf > 0.f ? vel - uBelow[i] : uAbove[i] - vel;
+
+				float next = vel - dt * (advect * (vel * dudx + vf * dudy) + g * (h[i] + b[i] - h[i - 1] - b[i - 1])) / dx;
+				const float source = next > 0.f ? h[i - 1] : h[i];
+				next /= 1.f + dt * params.friction * std::abs(next) / std::max(source, dry);
+				out[i] = source > dry ? next : 0.f;
+			}
+		}
+	});
+
+	parallelFor(static_cast<size_t>(ny) + 1, 16, [&](size_t begin, size_t end) {
+		for (int j = static_cast<int>(begin); j < static_cast<int>(end); j++) {
+			float* out = vNext.data() + cellIndex(0, j);
+			if (j == 0 || j == ny) {
+				std::fill(out, out + nx, 0.f);
+				continue;
+			}
+
+			const float* hLo = depth.data() + cellIndex(0, j - 1);
+			const float* hHi = hLo + nx;
+			const float* bLo = bed.data() + cellIndex(0, j - 1);
+			const float* bHi = bLo + nx;
+			const float* vc = v.data() + cellIndex(0, j);
+			const float* vBelow = vc - nx;
+			const float* vAbove = vc + nx;
+			const float* uLo = u.data() + (j - 1) * uStride;
+			const float* uHi = u.data() + j * uStride;
+
+			for (int i = 0; i < nx; i++) {
+				const float vel = vc[i];
+				const float uf = 0.25f * (uLo[i] + uLo[i + 1] + uHi[i] + uHi[i + 1]);
+				const float dvdx = uf > 0.f ? vel - vc[std::max(i - 1, 0)] : vc[std::min(i + 1, nx - 1)] - vel;
+				const float dvdy = vel > 0.f ? vel - vBelow[i] : vAbove[i] - vel;
+
+				float next = vel - dt * (advect * (uf * dvdx + vel * dvdy) + g * (hHi[i] + bHi[i] - hLo[i] - bLo[i])) / dx;
+				const float source = next > 0.f ? hLo[i] : hHi[i];
+				next /= 1.f + dt * params.friction * std::abs(next) / std::max(source, dry);
+				out[i] = source > dry ? next : 0.f;
+			}
+		}
+	});
+
+	u.swap(uNext);
+	v.swap(vNext);
+}
+
+/*
+ * Finite volume mass update with upwinded face depths, returns the fastest
+ * signal speed. Velocities that grew since the CFL estimate could drain a
+ * cell below zero, so the outgoing fluxes of every cell are first scaled
+ * to at most its depth. Each face flux is scaled by the factor of the cell
+ * it drains, on both of its sides, which keeps the update conservative.
+ */
+float ShallowWaterSolver::updateDepth(float dt)
+{
+	const int nx = params.resolution.x;
+	const int ny = params.resolution.y;
+	const float scale = dt / params.cellSize;
+	const size_t uStride = static_cast<size_t>(nx) + 1;
+	std::vector<float> partial(static_cast<size_t>(ny), 0.f);
+
+	/* The outflow is the depth times the outgoing face speeds, so the factor does not depend on the depth. */
+	parallelFor(static_cast<size_t>(ny), 16, [&](size_t begin, size_t end) {
+		for (int j = static_cast<int>(begin); j < static_cast<int>(end); j++) {
+			const float* uRow = u.data() + j * uStride;
+			const float* vLo = v.data() + cellIndex(0, j);
+			const float* vHi = vLo + nx;
+			float* out = outflowLimit.data() + cellIndex(0, j);
+
+			for (int i = 0; i < nx; i++) {
+				const float outgoing = std::max(-uRow[i], 0.f) + std::max(uRow[i + 1], 0.f) + std::max(-vLo[i], 0.f) + std::max(vHi[i], 0.f);
+				out[i] = scale * outgoing > 1.f ? 1.f / (scale * outgoing) : 1.f;
+			}
+		}
+	});
+
+	parallelFor(static_cast<size_t>(ny), 16, [&](size_t begin, size_t end) {
+		for (int j = static_cast<int>(begin); j < static_cast<int>(end); j++) {
+			const float* h = depth.data() + cellIndex(0, j);
+			const float* hBelow = depth.data() + cellIndex(0, std::max(j - 1, 0));
+			const float* hAbove = depth.data() + cellIndex(0, std::min(j + 1, ny - 1));
+			const float* r = outflowLimit.data() + cellIndex(0, j);
+			const float* rBelow = outflowLimit.data() + cellIndex(0, std::max(j - 1, 0));
+			const float* rAbove = outflowLimit.data() + cellIndex(0, std::min(j + 1, ny - 1));
+			const float* uRow = u.data() + j * uStride;
+			const float* vLo = v.data() + cellIndex(0, j);
+			const float* vHi = vLo + nx;
+			float* out = depthNext.data() + cellIndex(0, j);
+
+			float fastest = 0.f;
+			for (int i = 0; i < nx; i++) {
+				const float uw = uRow[i], ue = uRow[i + 1];
+				const float vs = vLo[i], vn = vHi[i];
+				const int west = std::max(i - 1, 0);
+				const int east = std::min(i + 1, nx - 1);
+
+				/* Upwinded depth times the limiter of the same cell. */
+				const float hw = uw > 0.f ? h[west] * r[west] : h[i] * r[i];
+				const float he = ue > 0.f ? h[i] * r[i] : h[east] * r[east];
+				const float hs = vs > 0.f ? hBelow[i] * rBelow[i] : h[i] * r[i];
+				const float hn = vn > 0.f ? h[i] * r[i] : hAbove[i] * rAbove[i];
+
+				/* Only rounding can leave next below zero now. */
+				const float next = h[i] - scale * (he * ue - hw * uw + hn * vn - hs * vs);
+				out[i] = std::max(next, 0.f);
+
+				const float speed = std::max(std::max(std::abs(uw), std::abs(ue)), std::max(std::abs(vs), std::abs(vn)));
+				fastest = std::max(fastest, speed + std::sqrt(params.gravity * out[i]));
+			}
+			partial[j] = fastest;
+		}
+	});
+
+	depth.swap(depthNext);
+	return *std::max_element(partial.begin(), partial.end());
+}
+
+void ShallowWaterSolver::buildSurfaceMesh(SurfaceMesh& mesh, int stride) const
+{
+	const glm::ivec2 n = params.resolution;
+	stride = std::max(stride, 1);
+	const glm::ivec2 count = (n - 1) / stride + 1;
+	const size_t vertexCount = static_cast<size_t>(count.x) * count.y;
+
+	if (mesh.positions.size() != vertexCount) {
+		mesh.positions.resize(vertexCount);
+		mesh.normals.resize(vertexCount);
+		mesh.colors.resize(vertexCount);
+		mesh.texCoords.resize(vertexCount);
+		mesh.indices.clear();
+		mesh.indices.reserve(static_cast<size_t>(count.x - 1) * (count.y - 1) * 6);
+
+		for (int j = 0; j + 1 < count.y; j++) {
+			for (int i = 0; i + 1 < count.x; i++) {
+				uint32_t v00 = static_cast<uint32_t>(j * count.x + i);
+				uint32_t v10 = v00 + 1;
+				uint32_t v01 = v00 + static_cast<uint32_t>(count.x);
+				uint32_t v11 = v01 + 1;
+				mesh.indices.insert(mesh.indices.end(), { v00, v01, v10, v10, v01, v11 });
+			}
+		}
+		for (int j = 0; j < count.y; j++)
+			for (int i = 0; i < count.x; i++)
+				mesh.texCoords[static_cast<size_t>(j) * count.x + i] = glm::vec2(i, j) / glm::vec2(glm::max(count - 1, glm::ivec2(1)));
+	}
+
+	const glm::vec3 shallow { 0.35f, 0.65f, 0.75f };
+	const glm::vec3 deep { 0.02f, 0.12f, 0.3f };
+	const glm::vec3 sand { 0.76f, 0.7f, 0.5f };
+
+	parallelFor(static_cast<size_t>(count.y), 16, [&](size_t begin, size_t end) {
+		for (int j = static_cast<int>(begin); j < static_cast<int>(end); j++) {
+			for (int i = 0; i < count.x; i++) {
+				const size_t c = cellIndex(i * stride, j * stride);
+				const size_t vertex = static_cast<size_t>(j) * count.x + i;
+				const bool wet = depth[c] > params.dryDepth;
+				const glm::vec2 xz = params.origin + (glm::vec2(i * stride, j * stride) + 0.5f) * params.cellSize;
+
+				mesh.positions[vertex] = { xz.x, bed[c] + (wet ? depth[c] : 0.f), xz.y };
+				mesh.colors[vertex] = wet ? glm::mix(shallow, deep, std::min(depth[c] / 10.f, 1.f)) : sand;
+			}
+		}
+	});
+
+	/* Central differences of the surface heights, one sided at the edges. */
+	const float spacing = static_cast<float>(stride) * params.cellSize;
+	parallelFor(static_cast<size_t>(count.y), 16, [&](size_t begin, size_t end) {
+		for (int j = static_cast<int>(begin); j < static_cast<int>(end); j++) {
+			const int below = std::max(j - 1, 0);
+			const int above = std::min(j + 1, count.y - 1);
+			for (int i = 0; i < count.x; i++) {
+				const int left = std::max(i - 1, 0);
+				const int right = std::min(i + 1, count.x - 1);
+				const auto height = [&](int x, int y) { return mesh.positions[static_cast<size_t>(y) * count.x + x].y; };
+
+				const float dhdx = (height(right, j) - height(left, j)) / (std::max(right - left, 1) * spacing);
+				const float dhdz = (height(i, above) - height(i, below)) / (std::max(above - below, 1) * spacing);
+				mesh.normals[static_cast<size_t>(j) * count.x + i] = glm::normalize(glm::vec3(-dhdx, 1.f, -dhdz));
+			}
+		}
+	});
+}
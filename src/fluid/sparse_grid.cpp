@@ -0,0 +1,397 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/sparse_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+static bool anyActive(const SparseTopology::Mask& mask)
+{
+	return std::any_of(mask.begin(), mask.end(), [](uint64_t word) { return word != 0; });
+}
+
+/* Whether any voxel in the last layer along axis is active, i.e. owns a face in the next block. */
+static bool anyActiveOnHighSide(const SparseTopology::Mask& mask, int axis)
+{
+	constexpr int B = SparseTopology::BlockSize;
+	for (int a = 0; a < B; a++) {
+		for (int b = 0; b < B; b++) {
+			glm::ivec3 local(a, b, B - 1);
+			if (axis == 0) local = { B - 1, a, b };
+			if (axis == 1) local = { a, B - 1, b };
+
+			const uint32_t index = SparseTopology::localIndex(local);
+			if ((mask[index >> 6] >> (index & 63)) & 1) return true;
+		}
+	}
+	return false;
+}
+
+/* === SparseTopology === */
+
+uint64_t SparseTopology::pack(glm::ivec3 blockCoord)
+{
+	const uint64_t bias = 1u << 20;
+	return ((static_cast<uint64_t>(blockCoord.x) + bias) & 0x1fffff)
+		| (((static_cast<uint64_t>(blockCoord.y) + bias) & 0x1fffff) << 21)
+		| (((static_cast<uint64_t>(blockCoord.z) + bias) & 0x1fffff) << 42);
+}
+
+size_t SparseTopology::slot(uint64_t key) const
+{
+	return static_cast<size_t>((key * 0x9e3779b97f4a7c15ull) >> 32) & (tableKeys.size() - 1);
+}
+
+void SparseTopology::rehash(size_t capacity)
+{
+	tableKeys.assign(capacity, EmptyKey);
+	tableBlocks.assign(capacity, InvalidBlock);
+	for (uint32_t b = 0; b < coords.size(); b++) {
+		const uint64_t key = pack(coords[b]);
+		size_t s = slot(key);
+		while (tableKeys[s] != EmptyKey) s = (s + 1) & (capacity - 1);
+		tableKeys[s] = key;
+		tableBlocks[s] = b;
+	}
+}
+
+uint32_t SparseTopology::findBlock(glm::ivec3 blockCoord) const
+{
+	if (tableKeys.empty()) return InvalidBlock;
+
+	const uint64_t key = pack(blockCoord);
+	for (size_t s = slot(key);; s = (s + 1) & (tableKeys.size() - 1)) {
+		if (tableKeys[s] == key) return tableBlocks[s];
+		if (tableKeys[s] == EmptyKey) return InvalidBlock;
+	}
+}
+
+uint32_t SparseTopology::touchBlock(glm::ivec3 blockCoord)
+{
+	uint32_t block = findBlock(blockCoord);
+	if (block != InvalidBlock) return block;
+
+	/* Keep the load factor at or below one half. */
+	if ((coords.size() + 1) * 2 > tableKeys.size())
+		rehash(std::max<size_t>(64, tableKeys.size() * 2));
+
+	block = static_cast<uint32_t>(coords.size());
+	coords.push_back(blockCoord);
+	masks.push_back({});
+	neighbors.clear();
+
+	const uint64_t key = pack(blockCoord);
+	size_t s = slot(key);
+	while (tableKeys[s] != EmptyKey) s = (s + 1) & (tableKeys.size() - 1);
+	tableKeys[s] = key;
+	tableBlocks[s] = block;
+	return block;
+}
+
+void SparseTopology::activate(glm::ivec3 voxel)
+{
+	const uint32_t local = localIndex(voxel);
+	masks[touchBlock(blockOf(voxel))][local >> 6] |= uint64_t(1) << (local & 63);
+}
+
+void SparseTopology::deactivate(glm::ivec3 voxel)
+{
+	const uint32_t block = findBlock(blockOf(voxel));
+	if (block == InvalidBlock) return;
+	const uint32_t local = localIndex(voxel);
+	masks[block][local >> 6] &= ~(uint64_t(1) << (local & 63));
+}
+
+bool SparseTopology::isActive(glm::ivec3 voxel) const
+{
+	const uint32_t block = findBlock(blockOf(voxel));
+	if (block == InvalidBlock) return false;
+	const uint32_t local = localIndex(voxel);
+	return (masks[block][local >> 6] >> (local & 63)) & 1;
+}
+
+size_t SparseTopology::activeCount() const
+{
+	size_t count = 0;
+	for (const Mask& mask : masks)
+		for (uint64_t word : mask) count += std::popcount(word);
+	return count;
+}
+
+size_t SparseTopology::dilateBlocks()
+{
+	std::vector<glm::ivec3> seeds;
+	for (size_t b = 0; b < coords.size(); b++)
+		if (anyActive(masks[b]))
+			seeds.push_back(coords[b]);
+
+	const size_t before = coords.size();
+	for (const glm::ivec3& seed : seeds)
+		for (int z = -1; z <= 1; z++)
+			for (int y = -1; y <= 1; y++)
+				for (int x = -1; x <= 1; x++)
+					touchBlock(seed + glm::ivec3(x, y, z));
+	return coords.size() - before;
+}
+
+void SparseTopology::prune(std::vector<uint32_t>& remap)
+{
+	auto ownsFace = [&](size_t b) {
+		for (int axis = 0; axis < 3; axis++) {
+			glm::ivec3 below = coords[b];
+			below[axis]--;
+			const uint32_t source = findBlock(below);
+			if (source != InvalidBlock && anyActiveOnHighSide(masks[source], axis)) return true;
+		}
+		return false;
+	};
+
+	/* Decide on the old numbering before compacting, the hash still refers to it. */
+	std::vector<uint8_t> keep(coords.size());
+	for (size_t b = 0; b < coords.size(); b++)
+		keep[b] = anyActive(masks[b]) || ownsFace(b);
+
+	remap.assign(coords.size(), InvalidBlock);
+	uint32_t kept = 0;
+	for (size_t b = 0; b < coords.size(); b++) {
+		if (!keep[b]) continue;
+		coords[kept] = coords[b];
+		masks[kept] = masks[b];
+		remap[b] = kept++;
+	}
+	coords.resize(kept);
+	masks.resize(kept);
+	neighbors.clear();
+
+	size_t capacity = 64;
+	while (capacity < 2 * coords.size()) capacity *= 2;
+	rehash(capacity);
+}
+
+void SparseTopology::updateNeighbors()
+{
+	neighbors.resize(coords.size() * 27);
+	parallelFor(coords.size(), 256, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; b++) {
+			uint32_t* out = &neighbors[b * 27];
+			for (int z = -1; z <= 1; z++)
+				for (int y = -1; y <= 1; y++)
+					for (int x = -1; x <= 1; x++)
+						*out++ = findBlock(coords[b] + glm::ivec3(x, y, z));
+		}
+	});
+}
+
+void SparseTopology::gatherPadded(const float* data, uint32_t block, float fill, PaddedBlock& out) const
+{
+	/* Padded coordinate p maps to neighbour offset -1, 0 or 1 and local coordinate (p - 1) mod BlockSize. */
+	auto side = [](int p) { return p == 0 ? -1 : (p == PaddedSize - 1 ? 1 : 0); };
+
+	for (int pz = 0; pz < PaddedSize; pz++) {
+		for (int py = 0; py < PaddedSize; py++) {
+			const int lz = (pz - 1) & (BlockSize - 1);
+			const int ly = (py - 1) & (BlockSize - 1);
+			float* row = &out[(pz * PaddedSize + py) * PaddedSize];
+
+			for (int dx = -1; dx <= 1; dx++) {
+				const uint32_t source = neighbor(block, dx, side(py), side(pz));
+				const int first = dx < 0 ? 0 : (dx == 0 ? 1 : PaddedSize - 1);
+				const int count = dx == 0 ? BlockSize : 1;
+				const int lx = dx < 0 ? BlockSize - 1 : 0;
+
+				if (source == InvalidBlock) {
+					std::fill(row + first, row + first + count, fill);
+					continue;
+				}
+				const float* src = data + source * BlockVoxels + (lz * BlockSize + ly) * BlockSize + lx;
+				std::copy(src, src + count, row + first);
+			}
+		}
+	}
+}
+
+size_t SparseTopology::memoryBytes() const
+{
+	return coords.capacity() * sizeof(glm::ivec3) + masks.capacity() * sizeof(Mask)
+		+ neighbors.capacity() * sizeof(uint32_t)
+		+ tableKeys.capacity() * sizeof(uint64_t) + tableBlocks.capacity() * sizeof(uint32_t);
+}
+
+/* === SparseFluidGrid === */
+
+SparseFluidGrid::SparseFluidGrid(float cellSize, glm::vec3 origin)
+	: cellSize(cellSize), origin(origin)
+{
+}
+
+void SparseFluidGrid::resizeChannels()
+{
+	for (size_t f = 0; f < FieldCount; f++)
+		values[f].resize(topology.blockCount() * SparseTopology::BlockVoxels, background[f]);
+}
+
+uint32_t SparseFluidGrid::touchBlock(glm::ivec3 blockCoord)
+{
+	uint32_t block = topology.touchBlock(blockCoord);
+	resizeChannels();
+	return block;
+}
+
+float SparseFluidGrid::get(SparseField field, glm::ivec3 voxel) const
+{
+	const uint32_t block = topology.findBlock(SparseTopology::blockOf(voxel));
+	if (block == SparseTopology::InvalidBlock) return background[index(field)];
+	return values[index(field)][block * SparseTopology::BlockVoxels + SparseTopology::localIndex(voxel)];
+}
+
+void SparseFluidGrid::set(SparseField field, glm::ivec3 voxel, float value)
+{
+	const uint32_t block = touchBlock(SparseTopology::blockOf(voxel));
+	values[index(field)][block * SparseTopology::BlockVoxels + SparseTopology::localIndex(voxel)] = value;
+}
+
+float SparseFluidGrid::sample(SparseField field, glm::vec3 position) const
+{
+	glm::vec3 offset(0.5f);
+	if (field == SparseField::U) offset.x = 0.f;
+	if (field == SparseField::V) offset.y = 0.f;
+	if (field == SparseField::W) offset.z = 0.f;
+
+	const glm::vec3 gridPos = (position - origin) / cellSize - offset;
+	const glm::vec3 base = glm::floor(gridPos);
+	const glm::vec3 t = gridPos - base;
+	const glm::ivec3 c(base);
+
+	auto at = [&](int x, int y, int z) { return get(field, c + glm::ivec3(x, y, z)); };
+	auto lerp = [](float a, float b, float s) { return a + (b - a) * s; };
+
+	float c00 = lerp(at(0, 0, 0), at(1, 0, 0), t.x);
+	float c10 = lerp(at(0, 1, 0), at(1, 1, 0), t.x);
+	float c01 = lerp(at(0, 0, 1), at(1, 0, 1), t.x);
+	float c11 = lerp(at(0, 1, 1), at(1, 1, 1), t.x);
+	return lerp(lerp(c00, c10, t.y), lerp(c01, c11, t.y), t.z);
+}
+
+glm::vec3 SparseFluidGrid::sampleVelocity(glm::vec3 position) const
+{
+	return { sample(SparseField::U, position), sample(SparseField::V, position), sample(SparseField::W, position) };
+}
+
+void SparseFluidGrid::dilate()
+{
+	topology.dilateBlocks();
+	resizeChannels();
+	topology.updateNeighbors();
+}
+
+void SparseFluidGrid::prune()
+{
+	std::vector<uint32_t> remap;
+	topology.prune(remap);
+
+	/* Kept blocks only move towards the front, so compacting in place is safe. */
+	for (std::vector<float>& channel : values) {
+		for (uint32_t old = 0; old < remap.size(); old++) {
+			if (remap[old] == SparseTopology::InvalidBlock || remap[old] == old) continue;
+			std::copy_n(channel.begin() + old * SparseTopology::BlockVoxels, SparseTopology::BlockVoxels,
+				channel.begin() + remap[old] * SparseTopology::BlockVoxels);
+		}
+		channel.resize(topology.blockCount() * SparseTopology::BlockVoxels);
+		channel.shrink_to_fit();
+	}
+	topology.updateNeighbors();
+}
+
+size_t SparseFluidGrid::memoryBytes() const
+{
+	size_t bytes = topology.memoryBytes();
+	for (const std::vector<float>& channel : values)
+		bytes += channel.capacity() * sizeof(float);
+	return bytes;
+}
+
+void SparseFluidGrid::fromDense(const MacGrid& grid)
+{
+	cellSize = grid.cellSize;
+	origin = grid.origin;
+
+	for (int k = 0; k < grid.dims.z; k++) {
+		for (int j = 0; j < grid.dims.y; j++) {
+			for (int i = 0; i < grid.dims.x; i++) {
+				const size_t c = grid.cellIndex(i, j, k);
+				const bool smoke = c < grid.density.size() && grid.density[c] > 0.f;
+				if (grid.cellType[c] != CellType::Fluid && !smoke) continue;
+				topology.activate({ i, j, k });
+
+				/* The high faces of a voxel are stored in its +x, +y and +z neighbours. */
+				topology.touchBlock(SparseTopology::blockOf({ i + 1, j, k }));
+				topology.touchBlock(SparseTopology::blockOf({ i, j + 1, k }));
+				topology.touchBlock(SparseTopology::blockOf({ i, j, k + 1 }));
+			}
+		}
+	}
+	resizeChannels();
+
+	/* Copy every voxel of the allocated blocks that lies inside the dense grid. */
+	parallelFor(topology.blockCount(), 16, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; b++) {
+			const glm::ivec3 base = topology.blockCoord(static_cast<uint32_t>(b)) * SparseTopology::BlockSize;
+			for (uint32_t local = 0; local < SparseTopology::BlockVoxels; local++) {
+				const glm::ivec3 v = base + SparseTopology::localCoord(local);
+				if (glm::any(glm::greaterThan(v, grid.dims))) continue;
+
+				const size_t at = b * SparseTopology::BlockVoxels + local;
+				const bool inside = glm::all(glm::lessThan(v, grid.dims));
+				if (v.y < grid.dims.y && v.z < grid.dims.z) values[index(SparseField::U)][at] = grid.u[grid.uIndex(v.x, v.y, v.z)];
+				if (v.x < grid.dims.x && v.z < grid.dims.z) values[index(SparseField::V)][at] = grid.v[grid.vIndex(v.x, v.y, v.z)];
+				if (v.x < grid.dims.x && v.y < grid.dims.y) values[index(SparseField::W)][at] = grid.w[grid.wIndex(v.x, v.y, v.z)];
+				if (!inside) continue;
+
+				const size_t c = grid.cellIndex(v.x, v.y, v.z);
+				if (c < grid.pressure.size()) values[index(SparseField::Pressure)][at] = grid.pressure[c];
+				if (c < grid.density.size()) values[index(SparseField::Density)][at] = grid.density[c];
+			}
+		}
+	});
+	topology.updateNeighbors();
+}
+
+void computeDivergence(const SparseFluidGrid& grid, std::vector<float>& divergence)
+{
+	constexpr int P = SparseFluidGrid::PaddedSize;
+	const SparseTopology& topology = grid.getTopology();
+	if (!topology.neighborsValid())
+		throw std::logic_error("computeDivergence needs the neighbour table, call SparseTopology::updateNeighbors()");
+	divergence.assign(topology.blockCount() * SparseTopology::BlockVoxels, 0.f);
+
+	parallelFor(topology.blockCount(), 4, [&](size_t begin, size_t end) {
+		SparseFluidGrid::PaddedBlock u, v, w;
+		for (size_t b = begin; b < end; b++) {
+			const uint32_t block = static_cast<uint32_t>(b);
+			const SparseTopology::Mask& mask = topology.activeMask(block);
+			if (!anyActive(mask)) continue;
+
+			grid.gatherPadded(SparseField::U, block, u);
+			grid.gatherPadded(SparseField::V, block, v);
+			grid.gatherPadded(SparseField::W, block, w);
+
+			for (size_t word = 0; word < mask.size(); word++) {
+				for (uint64_t bits = mask[word]; bits != 0; bits &= bits - 1) {
+					const uint32_t local = static_cast<uint32_t>(word * 64 + std::countr_zero(bits));
+					const glm::ivec3 l = SparseTopology::localCoord(local) + 1;
+					const int c = (l.z * P + l.y) * P + l.x;
+					divergence[b * SparseTopology::BlockVoxels + local] =
+						u[c + 1] - u[c] + v[c + P] - v[c] + w[c + P * P] - w[c];
+				}
+			}
+		}
+	});
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/spectral_solver.hpp"
+#include "fluid/parallel.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <numbers>
+
+SpectralPoissonSolver::SpectralPoissonSolver(glm::ivec3 dims)
+	: fft(dims)
+{
+	const size_t count = static_cast<size_t>(dims.x) * dims.y * dims.z;
+	inverseEigenvalues.resize(count);
+
+	/* Eigenvalue of the 1D stencil (-1, 2, -1) for wave number k is 2 - 2 cos(2 pi k / n). */
+	auto eigen = [](int k, int n) { return 2.0 - 2.0 * std::cos(2.0 * std::numbers::pi * k / n); };
+
+	for (int k = 0; k < dims.z; k++) {
+		for (int j = 0; j < dims.y; j++) {
+			for (int i = 0; i < dims.x; i++) {
+				double lambda = eigen(i, dims.x) + eigen(j, dims.y) + eigen(k, dims.z);
+				size_t c = (static_cast<size_t>(k) * dims.y + j) * dims.x + i;
+				inverseEigenvalues[c] = c == 0 ? 0.f : static_cast<float>(1.0 / (lambda * static_cast<double>(count)));
+			}
+		}
+	}
+}
+
+void SpectralPoissonSolver::solve(const std::vector<float>& rhs, std::vector<float>& pressure)
+{
+	auto start = std::chrono::steady_clock::now();
+	stats = {};
+
+	re = rhs;
+	im.assign(rhs.size(), 0.f);
+	fft.transform(re, im, false);
+
+	parallelFor(re.size(), 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) {
+			re[c] *= inverseEigenvalues[c];
+			im[c] *= inverseEigenvalues[c];
+		}
+	});
+
+	fft.transform(re, im, true);
+	pressure.swap(re);
+
+	stats.iterations = 1;
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void projectPeriodic(MacGrid& grid, SpectralPoissonSolver& solver, std::vector<float>& rhs)
+{
+	const glm::ivec3 n = grid.dims;
+	auto wrap = [](int i, int count) { return i == count ? 0 : (i < 0 ? count - 1 : i); };
+
+	rhs.resize(grid.cellCount());
+	parallelFor(static_cast<size_t>(n.z), 1, [&](size_t begin, size_t end) {
+		for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++) {
+			for (int j = 0; j < n.y; j++) {
+				for (int i = 0; i < n.x; i++) {
+					rhs[grid.cellIndex(i, j, k)] = -(grid.u[grid.uIndex(wrap(i + 1, n.x), j, k)] - grid.u[grid.uIndex(i, j, k)]
+						+ grid.v[grid.vIndex(i, wrap(j + 1, n.y), k)] - grid.v[grid.vIndex(i, j, k)]
+						+ grid.w[grid.wIndex(i, j, wrap(k + 1, n.z))] - grid.w[grid.wIndex(i, j, k)]);
+				}
+			}
+		}
+	});
+
+	solver.solve(rhs, grid.pressure);
+
+	parallelFor(static_cast<size_t>(n.z), 1, [&](size_t begin, size_t end) {
+		for (int k = static_cast<int>(begin); k < static_cast<int>(end); k++) {
+			for (int j = 0; j < n.y; j++) {
+				for (int i = 0; i < n.x; i++) {
+					const float p = grid.pressure[grid.cellIndex(i, j, k)];
+					grid.u[grid.uIndex(i, j, k)] -= p - grid.pressure[grid.cellIndex(wrap(i - 1, n.x), j, k)];
+					grid.v[grid.vIndex(i, j, k)] -= p - grid.pressure[grid.cellIndex(i, wrap(j - 1, n.y), k)];
+					grid.w[grid.wIndex(i, j, k)] -= p - grid.pressure[grid.cellIndex(i, j, wrap(k - 1, n.z))];
+				}
+				grid.u[grid.uIndex(n.x, j, k)] = grid.u[grid.uIndex(0, j, k)];
+			}
+		}
+	});
+
+	for (int k = 0; k < n.z; k++)
+		for (int i = 0; i < n.x; i++)
+			grid.v[grid.vIndex(i, n.y, k)] = grid.v[grid.vIndex(i, 0, k)];
+	for (int j = 0; j < n.y; j++)
+		for (int i = 0; i < n.x; i++)
+			grid.w[grid.wIndex(i, j, n.z)] = grid.w[grid.wIndex(i, j, 0)];
+}
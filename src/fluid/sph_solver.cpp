@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/sph_solver.hpp"
+#include "fluid/sph_kernels.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+template<int Dim>
+BasicSphSolver<Dim>::BasicSphSolver(const BasicSphParams<Dim>& params)
+	: params(params)
+{
+	if (!params.bounded && params.gridKind != NeighborGridKind::CompactHash)
+		throw std::invalid_argument("Unbounded SPH needs the compact hash grid!");
+
+	if (params.gridKind == NeighborGridKind::CompactHash)
+		grid.template emplace<BasicCompactHashGrid<Dim>>(params.boundsMin, params.smoothingRadius, params.hashTableSize);
+	else
+		grid.template emplace<BasicNeighborGrid<Dim>>(params.boundsMin, params.boundsMax, params.smoothingRadius);
+}
+
+template<int Dim>
+void BasicSphSolver<Dim>::addParticles(const std::vector<ParticleType>& newParticles)
+{
+	particles.insert(particles.begin() + ownedCount, newParticles.begin(), newParticles.end());
+	ownedCount += newParticles.size();
+}
+
+template<int Dim>
+void BasicSphSolver<Dim>::setParticles(std::vector<ParticleType> owned)
+{
+	std::vector<ParticleType> ghosts(particles.begin() + ownedCount, particles.end());
+
+	particles = std::move(owned);
+	ownedCount = particles.size();
+	particles.insert(particles.end(), ghosts.begin(), ghosts.end());
+	activity.reset();
+}
+
+template<int Dim>
+void BasicSphSolver<Dim>::setGhostParticles(const std::vector<ParticleType>& ghosts)
+{
+	particles.resize(ownedCount);
+	particles.insert(particles.end(), ghosts.begin(), ghosts.end());
+}
+
+template<int Dim>
+void BasicSphSolver<Dim>::step()
+{
+	std::visit([&](auto& g) {
+		g.build(particles);
+
+		computeDensityPressure(g);
+		computeForces(g);
+		integrate(g);
+
+		activity.update(params.sleep, g, particles, params.restDensity);
+	}, grid);
+}
+
+template<int Dim>
+template<typename Grid>
+void BasicSphSolver<Dim>::computeDensityPressure(const Grid& grid)
+{
+	const float h = params.smoothingRadius;
+	const float mass = params.particleMass();
+
+	for (uint32_t cell = 0; cell < grid.cellCount(); cell++) {
+		if (!activity.isCellAwake(grid.cellParticles(cell))) continue;
+
+		for (uint32_t i : grid.cellParticles(cell)) {
+			ParticleType& pi = particles[i];
+
+			float density = 0.f;
+			grid.forEachNeighbor(pi.position, [&](uint32_t j) {
+				Vec r = pi.position - particles[j].position;
+				density += mass * Kernel::poly6<Dim>(glm::dot(r, r), h);
+			});
+
+			pi.density = density;
+			pi.pressure = std::max(params.stiffness * (density - params.restDensity), 0.f);
+		}
+	}
+}
+
+template<int Dim>
+template<typename Grid>
+void BasicSphSolver<Dim>::computeForces(const Grid& grid)
+{
+	const float h = params.smoothingRadius;
+	const float mass = params.particleMass();
+
+	for (uint32_t cell = 0; cell < grid.cellCount(); cell++) {
+		if (!activity.isCellAwake(grid.cellParticles(cell))) continue;
+
+		for (uint32_t i : grid.cellParticles(cell)) {
+			ParticleType& pi = particles[i];
+
+			Vec pressureForce(0.f);
+			Vec viscosityForce(0.f);
+
+			grid.forEachNeighbor(pi.position, [&](uint32_t j) {
+				if (i == j) return;
+
+				const ParticleType& pj = particles[j];
+				Vec r = pi.position - pj.position;
+				float dist = glm::length(r);
+				if (dist >= h) return;
+
+				pressureForce -= mass * (pi.pressure + pj.pressure) / (2.f * pj.density)
+					* Kernel::spikyGradient(r, dist, h);
+				viscosityForce += params.viscosity * mass * (pj.velocity - pi.velocity) / pj.density
+					* Kernel::viscosityLaplacian<Dim>(dist, h);
+			});
+
+			pi.force = pressureForce + viscosityForce + pi.density * params.gravity;
+		}
+	}
+}
+
+template<int Dim>
+template<typename Grid>
+void BasicSphSolver<Dim>::integrate(const Grid& grid)
+{
+	const float dt = params.timeStep;
+
+	for (uint32_t cell = 0; cell < grid.cellCount(); cell++) {
+		if (!activity.isCellAwake(grid.cellParticles(cell))) continue;
+
+		for (uint32_t i : grid.cellParticles(cell)) {
+			ParticleType& p = particles[i];
+			if (i >= ownedCount || p.density <= 0.f) continue;
+
+			p.velocity += dt * p.force / p.density;
+			p.position += dt * p.velocity;
+			if (!params.bounded) continue;
+
+			for (int axis = 0; axis < Dim; axis++) {
+				if (p.position[axis] < params.boundsMin[axis]) {
+					p.position[axis] = params.boundsMin[axis];
+					p.velocity[axis] *= -params.boundaryDamping;
+				}
+				else if (p.position[axis] > params.boundsMax[axis]) {
+					p.position[axis] = params.boundsMax[axis];
+					p.velocity[axis] *= -params.boundaryDamping;
+				}
+			}
+		}
+	}
+}
+
+template class BasicSphSolver<2>;
+template class BasicSphSolver<3>;
@@ -0,0 +1,489 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/vortex_fmm.hpp"
+#include "fluid/parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <numeric>
+
+static constexpr uint32_t MaxOrder = 12;
+static constexpr size_t MaxTerms = (MaxOrder + 1) * (MaxOrder + 2) * (MaxOrder + 3) / 6;
+static constexpr uint16_t NoTerm = 0xffff;
+
+static uint32_t spreadBits(uint32_t x)
+{
+	x &= 0x3ff;
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x << 8)) & 0x0300f00f;
+	x = (x | (x << 4)) & 0x030c30c3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+static uint32_t compactBits(uint32_t x)
+{
+	x &= 0x09249249;
+	x = (x | (x >> 2)) & 0x030c30c3;
+	x = (x | (x >> 4)) & 0x0300f00f;
+	x = (x | (x >> 8)) & 0x030000ff;
+	x = (x | (x >> 16)) & 0x3ff;
+	return x;
+}
+
+static uint32_t mortonKey(glm::ivec3 c)
+{
+	return spreadBits(c.x) | (spreadBits(c.y) << 1) | (spreadBits(c.z) << 2);
+}
+
+static glm::ivec3 mortonCoord(uint32_t key)
+{
+	return { compactBits(key), compactBits(key >> 1), compactBits(key >> 2) };
+}
+
+/* Derivatives of the vector potential (gradient and Hessian, one dvec3 per psi component) to velocity and its gradient. */
+static void curlOfPotential(const glm::dvec3 grad[3], const glm::dvec3 hessian[3][3], glm::vec3& velocity, glm::mat3& gradient)
+{
+	const double scale = 0.25 / std::numbers::pi;
+	velocity = glm::vec3(scale * glm::dvec3(grad[1].z - grad[2].y, grad[2].x - grad[0].z, grad[0].y - grad[1].x));
+	for (int j = 0; j < 3; j++) {
+		gradient[j] = glm::vec3(scale * glm::dvec3(
+			hessian[1][j].z - hessian[2][j].y,
+			hessian[2][j].x - hessian[0][j].z,
+			hessian[0][j].y - hessian[1][j].x));
+	}
+}
+
+/* Plummer regularized 1 / sqrt(r^2 + sigma^2), first and second derivatives of source strength at target. */
+static void accumulatePair(glm::vec3 target, glm::vec3 source, glm::vec3 strength, float coreRadius2,
+	glm::dvec3 grad[3], glm::dvec3 hessian[3][3])
+{
+	const glm::dvec3 r = glm::dvec3(target) - glm::dvec3(source);
+	const double rho2 = glm::dot(r, r) + coreRadius2;
+	const double inv = 1.0 / std::sqrt(rho2);
+	const double inv3 = inv * inv * inv;
+	const double inv5 = inv3 * inv * inv;
+	const glm::dvec3 a(strength);
+
+	for (int i = 0; i < 3; i++) {
+		grad[i] -= a * (r[i] * inv3);
+		for (int j = i; j < 3; j++)
+			hessian[i][j] += a * (3.0 * r[i] * r[j] * inv5 - (i == j ? inv3 : 0.0));
+	}
+}
+
+static void symmetrize(glm::dvec3 hessian[3][3])
+{
+	hessian[1][0] = hessian[0][1];
+	hessian[2][0] = hessian[0][2];
+	hessian[2][1] = hessian[1][2];
+}
+
+void evaluateBiotSavartDirect(std::span<const glm::vec3> positions, std::span<const glm::vec3> strengths,
+	float coreRadius, std::span<const uint32_t> targets, std::vector<glm::vec3>& velocity, std::vector<glm::mat3>& gradient)
+{
+	const size_t n = positions.size();
+	velocity.resize(targets.size());
+	gradient.resize(targets.size());
+
+	parallelFor(targets.size(), 16, [&](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; t++) {
+			const uint32_t i = targets[t];
+			glm::dvec3 grad[3] {};
+			glm::dvec3 hessian[3][3] {};
+			for (size_t j = 0; j < n; j++)
+				if (j != i) accumulatePair(positions[i], positions[j], strengths[j], coreRadius * coreRadius, grad, hessian);
+			symmetrize(hessian);
+			curlOfPotential(grad, hessian, velocity[t], gradient[t]);
+		}
+	});
+}
+
+void evaluateBiotSavartDirect(std::span<const glm::vec3> positions, std::span<const glm::vec3> strengths,
+	float coreRadius, std::vector<glm::vec3>& velocity, std::vector<glm::mat3>& gradient)
+{
+	std::vector<uint32_t> targets(positions.size());
+	std::iota(targets.begin(), targets.end(), 0u);
+	evaluateBiotSavartDirect(positions, strengths, coreRadius, targets, velocity, gradient);
+}
+
+VortexFmm::VortexFmm(const FmmParams& params)
+	: params(params)
+{
+	setOrder(params.order);
+}
+
+void VortexFmm::setOrder(uint32_t order)
+{
+	params.order = std::clamp(order, 1u, MaxOrder);
+	buildTerms();
+}
+
+void VortexFmm::buildTerms()
+{
+	const int p = static_cast<int>(params.order);
+	const int side = p + 1;
+	std::vector<int> index(static_cast<size_t>(side) * side * side, -1);
+	auto indexOf = [&](glm::ivec3 t) { return index[(t.x * side + t.y) * side + t.z]; };
+
+	terms.clear();
+	degree.clear();
+	for (int d = 0; d <= p; d++) {
+		for (int t = d; t >= 0; t--) {
+			for (int u = d - t; u >= 0; u--) {
+				index[(t * side + u) * side + (d - t - u)] = static_cast<int>(terms.size());
+				terms.push_back({ t, u, d - t - u });
+				degree.push_back(d);
+			}
+		}
+	}
+
+	lower.assign(terms.size(), NoTerm);
+	lower2.assign(terms.size(), NoTerm);
+	lowerAxis.assign(terms.size(), 0);
+	for (size_t i = 1; i < terms.size(); i++) {
+		const int axis = terms[i].x > 0 ? 0 : (terms[i].y > 0 ? 1 : 2);
+		glm::ivec3 t = terms[i];
+		t[axis]--;
+		lower[i] = static_cast<uint16_t>(indexOf(t));
+		lowerAxis[i] = static_cast<uint8_t>(axis);
+		if (t[axis] > 0) {
+			t[axis]--;
+			lower2[i] = static_cast<uint16_t>(indexOf(t));
+		}
+	}
+
+	triples.clear();
+	evalTriples.clear();
+	for (size_t a = 0; a < terms.size(); a++) {
+		for (size_t b = 0; b < terms.size() && degree[a] + degree[b] <= p; b++) {
+			Triple triple { static_cast<uint16_t>(a), static_cast<uint16_t>(b), static_cast<uint16_t>(indexOf(terms[a] + terms[b])) };
+			triples.push_back(triple);
+			if (degree[a] <= 2) evalTriples.push_back(triple);
+		}
+	}
+}
+
+/* out[b] = d^b / b! */
+void VortexFmm::monomials(glm::dvec3 d, double* out) const
+{
+	out[0] = 1.0;
+	for (size_t i = 1; i < terms.size(); i++) {
+		const int axis = lowerAxis[i];
+		out[i] = out[lower[i]] * d[axis] / terms[i][axis];
+	}
+}
+
+/*
+ * out[n] = D^n (1 / |r|) for all terms, by the McMurchie-Davidson recurrence
+ * R(n, t+1) = t R(n+1, t-1) + X R(n+1, t) with R(n, 0) = (-1)^n (2n-1)!! / r^(2n+1).
+ */
+void VortexFmm::derivatives(glm::dvec3 r, double* out) const
+{
+	const int p = static_cast<int>(params.order);
+	const size_t count = terms.size();
+	std::array<double, (MaxOrder + 1) * MaxTerms> aux;
+
+	const double inv2 = 1.0 / glm::dot(r, r);
+	aux[0] = std::sqrt(inv2);
+	for (int n = 1; n <= p; n++)
+		aux[n * count] = aux[(n - 1) * count] * -(2 * n - 1) * inv2;
+
+	for (size_t i = 1; i < count; i++) {
+		const int axis = lowerAxis[i];
+		const int t = terms[i][axis] - 1;
+		for (int n = 0; n + degree[i] <= p; n++) {
+			double value = r[axis] * aux[(n + 1) * count + lower[i]];
+			if (t > 0) value += t * aux[(n + 1) * count + lower2[i]];
+			aux[n * count + i] = value;
+		}
+	}
+
+	for (size_t i = 0; i < count; i++)
+		out[i] = aux[i];
+}
+
+glm::dvec3 VortexFmm::cellCenter(int level, uint32_t key) const
+{
+	const double size = boxSize / static_cast<double>(1u << level);
+	return glm::dvec3(boxMin) + (glm::dvec3(mortonCoord(key)) + 0.5) * size;
+}
+
+int64_t VortexFmm::findCell(int level, glm::ivec3 coord) const
+{
+	const int side = 1 << level;
+	if (glm::any(glm::lessThan(coord, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(coord, glm::ivec3(side)))) return -1;
+
+	const std::vector<uint32_t>& keys = levels[level].keys;
+	const uint32_t key = mortonKey(coord);
+	auto it = std::lower_bound(keys.begin(), keys.end(), key);
+	return it != keys.end() && *it == key ? it - keys.begin() : -1;
+}
+
+void VortexFmm::buildTree(std::span<const glm::vec3> positions)
+{
+	const size_t n = positions.size();
+
+	glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+	for (const glm::vec3& p : positions) {
+		lo = glm::min(lo, p);
+		hi = glm::max(hi, p);
+	}
+	const float extent = std::max({ hi.x - lo.x, hi.y - lo.y, hi.z - lo.z, 1e-6f });
+	boxSize = extent * 1.001f;
+	boxMin = 0.5f * (lo + hi) - 0.5f * boxSize;
+
+	const double leaves = static_cast<double>(n) / std::max(params.leafSize, 1u);
+	const int depth = std::clamp(static_cast<int>(std::ceil(std::log(std::max(leaves, 1.0)) / std::log(8.0))), 2, std::clamp(params.maxDepth, 2, 10));
+	const int side = 1 << depth;
+
+	std::vector<uint64_t> keyed(n);
+	parallelFor(n, 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			glm::ivec3 c = glm::clamp(glm::ivec3((positions[i] - boxMin) / boxSize * static_cast<float>(side)), glm::ivec3(0), glm::ivec3(side - 1));
+			keyed[i] = (static_cast<uint64_t>(mortonKey(c)) << 32) | i;
+		}
+	});
+	std::sort(keyed.begin(), keyed.end());
+
+	order.resize(n);
+	sorted.resize(n);
+	for (size_t i = 0; i < n; i++) {
+		order[i] = static_cast<uint32_t>(keyed[i]);
+		sorted[i] = positions[order[i]];
+	}
+
+	levels.assign(depth + 1, Level {});
+	Level& leaf = levels[depth];
+	for (size_t i = 0; i < n; i++) {
+		const uint32_t key = static_cast<uint32_t>(keyed[i] >> 32);
+		if (leaf.keys.empty() || leaf.keys.back() != key) {
+			leaf.keys.push_back(key);
+			leaf.childBegin.push_back(static_cast<uint32_t>(i));
+			leaf.childEnd.push_back(static_cast<uint32_t>(i));
+		}
+		leaf.childEnd.back()++;
+	}
+
+	for (int l = depth - 1; l >= 2; l--) {
+		Level& fine = levels[l + 1];
+		Level& coarse = levels[l];
+		fine.parent.resize(fine.keys.size());
+		for (size_t c = 0; c < fine.keys.size(); c++) {
+			const uint32_t key = fine.keys[c] >> 3;
+			if (coarse.keys.empty() || coarse.keys.back() != key) {
+				coarse.keys.push_back(key);
+				coarse.childBegin.push_back(static_cast<uint32_t>(c));
+				coarse.childEnd.push_back(static_cast<uint32_t>(c));
+			}
+			coarse.childEnd.back()++;
+			fine.parent[c] = static_cast<uint32_t>(coarse.keys.size() - 1);
+		}
+	}
+
+	stats.depth = depth;
+	stats.cells = 0;
+	for (int l = 2; l <= depth; l++) {
+		Level& level = levels[l];
+		level.cellSize = boxSize / static_cast<float>(1 << l);
+		level.multipole.assign(level.keys.size() * terms.size(), glm::dvec3(0.0));
+		level.local.assign(level.keys.size() * terms.size(), glm::dvec3(0.0));
+		stats.cells += level.keys.size();
+	}
+}
+
+void VortexFmm::upwardPass(std::span<const glm::vec3> strengths)
+{
+	const size_t count = terms.size();
+	const int depth = static_cast<int>(levels.size()) - 1;
+	Level& leaf = levels[depth];
+
+	/* P2M */
+	parallelFor(leaf.keys.size(), 16, [&](size_t begin, size_t end) {
+		std::array<double, MaxTerms> mono;
+		for (size_t c = begin; c < end; c++) {
+			const glm::dvec3 center = cellCenter(depth, leaf.keys[c]);
+			glm::dvec3* M = &leaf.multipole[c * count];
+			for (uint32_t s = leaf.childBegin[c]; s < leaf.childEnd[c]; s++) {
+				monomials(glm::dvec3(sorted[s]) - center, mono.data());
+				const glm::dvec3 a(strengths[order[s]]);
+				for (size_t k = 0; k < count; k++)
+					M[k] += a * mono[k];
+			}
+		}
+	});
+
+	/* M2M */
+	for (int l = depth - 1; l >= 2; l--) {
+		Level& coarse = levels[l];
+		const Level& fine = levels[l + 1];
+		parallelFor(coarse.keys.size(), 16, [&](size_t begin, size_t end) {
+			std::array<double, MaxTerms> mono;
+			for (size_t c = begin; c < end; c++) {
+				const glm::dvec3 center = cellCenter(l, coarse.keys[c]);
+				glm::dvec3* M = &coarse.multipole[c * count];
+				for (uint32_t child = coarse.childBegin[c]; child < coarse.childEnd[c]; child++) {
+					monomials(cellCenter(l + 1, fine.keys[child]) - center, mono.data());
+					const glm::dvec3* childM = &fine.multipole[child * count];
+					for (const Triple& t : triples)
+						M[t.sum] += childM[t.a] * mono[t.b];
+				}
+			}
+		});
+	}
+}
+
+/* M2L from the children of the parent's neighbours that are not adjacent themselves. */
+void VortexFmm::transferPass()
+{
+	const size_t count = terms.size();
+	const int depth = static_cast<int>(levels.size()) - 1;
+	std::atomic<size_t> translations { 0 };
+
+	for (int l = 2; l <= depth; l++) {
+		Level& level = levels[l];
+		parallelFor(level.keys.size(), 4, [&](size_t begin, size_t end) {
+			std::array<double, MaxTerms> D;
+			size_t local = 0;
+			for (size_t c = begin; c < end; c++) {
+				const glm::ivec3 coord = mortonCoord(level.keys[c]);
+				const glm::ivec3 first = (coord >> 1) * 2 - 2;
+				const glm::dvec3 center = cellCenter(l, level.keys[c]);
+				glm::dvec3* L = &level.local[c * count];
+
+				for (int z = first.z; z < first.z + 6; z++) {
+					for (int y = first.y; y < first.y + 6; y++) {
+						for (int x = first.x; x < first.x + 6; x++) {
+							const glm::ivec3 other(x, y, z);
+							const glm::ivec3 offset = glm::abs(other - coord);
+							if (std::max({ offset.x, offset.y, offset.z }) <= 1) continue;
+							const int64_t s = findCell(l, other);
+							if (s < 0) continue;
+
+							derivatives(center - cellCenter(l, level.keys[s]), D.data());
+							const glm::dvec3* M = &level.multipole[s * count];
+							for (const Triple& t : triples) {
+								const double sign = degree[t.b] & 1 ? -1.0 : 1.0;
+								L[t.a] += M[t.b] * (sign * D[t.sum]);
+							}
+							local++;
+						}
+					}
+				}
+			}
+			translations += local;
+		});
+	}
+
+	stats.m2l = translations;
+}
+
+/* L2L */
+void VortexFmm::downwardPass()
+{
+	const size_t count = terms.size();
+	const int depth = static_cast<int>(levels.size()) - 1;
+
+	for (int l = 3; l <= depth; l++) {
+		Level& fine = levels[l];
+		const Level& coarse = levels[l - 1];
+		parallelFor(fine.keys.size(), 16, [&](size_t begin, size_t end) {
+			std::array<double, MaxTerms> mono;
+			for (size_t c = begin; c < end; c++) {
+				const uint32_t p = fine.parent[c];
+				monomials(cellCenter(l, fine.keys[c]) - cellCenter(l - 1, coarse.keys[p]), mono.data());
+				const glm::dvec3* parentL = &coarse.local[p * count];
+				glm::dvec3* L = &fine.local[c * count];
+				for (const Triple& t : triples)
+					L[t.a] += parentL[t.sum] * mono[t.b];
+			}
+		});
+	}
+}
+
+/* L2P and P2P with the 27 neighbouring leaves. */
+void VortexFmm::evaluateLeaves(std::span<const glm::vec3> strengths, float coreRadius,
+	std::vector<glm::vec3>& velocity, std::vector<glm::mat3>& gradient)
+{
+	const size_t count = terms.size();
+	const int depth = static_cast<int>(levels.size()) - 1;
+	const Level& leaf = levels[depth];
+	const float coreRadius2 = coreRadius * coreRadius;
+	std::atomic<size_t> pairs { 0 };
+
+	parallelFor(leaf.keys.size(), 4, [&](size_t begin, size_t end) {
+		std::array<double, MaxTerms> mono;
+		size_t localPairs = 0;
+		for (size_t c = begin; c < end; c++) {
+			const glm::ivec3 coord = mortonCoord(leaf.keys[c]);
+			const glm::dvec3 center = cellCenter(depth, leaf.keys[c]);
+			const glm::dvec3* L = &leaf.local[c * count];
+
+			std::array<int64_t, 27> neighbors;
+			int neighborCount = 0;
+			for (int z = -1; z <= 1; z++)
+				for (int y = -1; y <= 1; y++)
+					for (int x = -1; x <= 1; x++)
+						if (int64_t s = findCell(depth, coord + glm::ivec3(x, y, z)); s >= 0) neighbors[neighborCount++] = s;
+
+			for (uint32_t i = leaf.childBegin[c]; i < leaf.childEnd[c]; i++) {
+				/* Shift the local expansion to the particle, keeping the terms up to degree two. */
+				std::array<glm::dvec3, 10> shifted {};
+				monomials(glm::dvec3(sorted[i]) - center, mono.data());
+				for (const Triple& t : evalTriples)
+					shifted[t.a] += L[t.sum] * mono[t.b];
+
+				glm::dvec3 grad[3] = { shifted[1], shifted[2], shifted[3] };
+				glm::dvec3 hessian[3][3] {};
+				hessian[0][0] = shifted[4];
+				hessian[0][1] = shifted[5];
+				hessian[0][2] = shifted[6];
+				hessian[1][1] = shifted[7];
+				hessian[1][2] = shifted[8];
+				hessian[2][2] = shifted[9];
+
+				for (int nb = 0; nb < neighborCount; nb++) {
+					const int64_t s = neighbors[nb];
+					for (uint32_t j = leaf.childBegin[s]; j < leaf.childEnd[s]; j++)
+						if (j != i) accumulatePair(sorted[i], sorted[j], strengths[order[j]], coreRadius2, grad, hessian);
+					localPairs += leaf.childEnd[s] - leaf.childBegin[s];
+				}
+
+				symmetrize(hessian);
+				curlOfPotential(grad, hessian, velocity[order[i]], gradient[order[i]]);
+			}
+		}
+		pairs += localPairs;
+	});
+
+	stats.p2p = pairs;
+}
+
+void VortexFmm::evaluate(std::span<const glm::vec3> positions, std::span<const glm::vec3> strengths,
+	float coreRadius, std::vector<glm::vec3>& velocity, std::vector<glm::mat3>& gradient)
+{
+	auto start = std::chrono::steady_clock::now();
+	velocity.resize(positions.size());
+	gradient.resize(positions.size());
+	if (positions.empty()) return;
+
+	buildTree(positions);
+	upwardPass(strengths);
+	transferPass();
+	downwardPass();
+	evaluateLeaves(strengths, coreRadius, velocity, gradient);
+
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
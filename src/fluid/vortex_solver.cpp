@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/vortex_solver.hpp"
+#include "fluid/parallel.hpp"
+
+#include <cmath>
+#include <numbers>
+
+VortexSolver::VortexSolver(const VortexParams& params)
+	: params(params), fmm(params.fmm)
+{
+}
+
+void VortexSolver::addParticles(std::span<const glm::vec3> newPositions, std::span<const glm::vec3> newStrengths)
+{
+	positions.insert(positions.end(), newPositions.begin(), newPositions.end());
+	strengths.insert(strengths.end(), newStrengths.begin(), newStrengths.end());
+	strengths.resize(positions.size(), glm::vec3(0.f));
+}
+
+void VortexSolver::addVortexRing(glm::vec3 center, glm::vec3 normal, float radius, float circulation, uint32_t count)
+{
+	normal = glm::normalize(normal);
+	const glm::vec3 helper = std::abs(normal.x) < 0.9f ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 1.f, 0.f);
+	const glm::vec3 e1 = glm::normalize(glm::cross(normal, helper));
+	const glm::vec3 e2 = glm::cross(normal, e1);
+	const float segment = 2.f * std::numbers::pi_v<float> * radius / static_cast<float>(count);
+
+	for (uint32_t i = 0; i < count; i++) {
+		const float angle = 2.f * std::numbers::pi_v<float> * static_cast<float>(i) / static_cast<float>(count);
+		const glm::vec3 radial = std::cos(angle) * e1 + std::sin(angle) * e2;
+		positions.push_back(center + radius * radial);
+		strengths.push_back(circulation * segment * glm::cross(normal, radial));
+	}
+}
+
+void VortexSolver::step()
+{
+	if (positions.empty()) return;
+
+	if (positions.size() < params.directThreshold)
+		evaluateBiotSavartDirect(positions, strengths, params.coreRadius, velocity, gradient);
+	else
+		fmm.evaluate(positions, strengths, params.coreRadius, velocity, gradient);
+
+	const float dt = params.timeStep;
+	parallelFor(positions.size(), 1024, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			velocity[i] += params.freestream;
+			positions[i] += dt * velocity[i];
+			strengths[i] += dt * (gradient[i] * strengths[i]);
+		}
+	});
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "fluid/voxelizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/*
+ * Edge function of (y, z) against u -> v in the yz projection, positive on
+ * its left. Evaluated with the endpoints in a fixed order, so the two
+ * triangles sharing an edge get exactly opposite values.
+ */
+static double edgeFunction(glm::vec3 u, glm::vec3 v, double y, double z)
+{
+	const bool swapped = v.y < u.y || (v.y == u.y && v.z < u.z);
+	if (swapped) std::swap(u, v);
+
+	double e = (double(v.y) - u.y) * (z - u.z) - (double(v.z) - u.z) * (y - u.y);
+	return swapped ? -e : e;
+}
+
+/*
+ * Top-left rule: a row exactly on an edge belongs to the triangle only if
+ * the edge, in counter-clockwise order, points up or straight left. Of two
+ * triangles sharing the edge with the same orientation exactly one takes
+ * the row, and both or neither where the surface folds over the row, so
+ * every crossing is counted once and tangent contacts zero or two times.
+ */
+static bool topLeft(glm::vec3 u, glm::vec3 v)
+{
+	return v.z > u.z || (v.z == u.z && v.y < u.y);
+}
+
+static bool covers(double e, glm::vec3 u, glm::vec3 v)
+{
+	return e > 0.0 || (e == 0.0 && topLeft(u, v));
+}
+
+std::vector<uint8_t> voxelizeMesh(std::span<const glm::vec3> positions,
+	std::span<const uint32_t> indices,
+	glm::ivec3 dims,
+	glm::vec3 origin,
+	float cellSize)
+{
+	std::vector<uint8_t> solid(static_cast<size_t>(dims.x) * dims.y * dims.z, 0);
+	std::vector<std::vector<float>> crossings(static_cast<size_t>(dims.y) * dims.z);
+
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		glm::vec3 a = (positions[indices[t]] - origin) / cellSize;
+		glm::vec3 b = (positions[indices[t + 1]] - origin) / cellSize;
+		glm::vec3 c = (positions[indices[t + 2]] - origin) / cellSize;
+
+		/* Rows whose centre (j + 0.5, k + 0.5) falls inside the triangle's yz bounds. */
+		int jMin = std::max(0, static_cast<int>(std::ceil(std::min({ a.y, b.y, c.y }) - 0.5f)));
+		int jMax = std::min(dims.y - 1, static_cast<int>(std::floor(std::max({ a.y, b.y, c.y }) - 0.5f)));
+		int kMin = std::max(0, static_cast<int>(std::ceil(std::min({ a.z, b.z, c.z }) - 0.5f)));
+		int kMax = std::min(dims.z - 1, static_cast<int>(std::floor(std::max({ a.z, b.z, c.z }) - 0.5f)));
+
+		float area = (b.y - a.y) * (c.z - a.z) - (c.y - a.y) * (b.z - a.z);
+		if (area == 0.f) continue;
+
+		/* Counter-clockwise in the yz projection, the mesh's winding only matters through folds. */
+		if (area < 0.f) std::swap(b, c);
+
+		for (int k = kMin; k <= kMax; k++) {
+			for (int j = jMin; j <= jMax; j++) {
+				double y = j + 0.5;
+				double z = k + 0.5;
+
+				double e0 = edgeFunction(b, c, y, z);
+				double e1 = edgeFunction(c, a, y, z);
+				double e2 = edgeFunction(a, b, y, z);
+				if (!covers(e0, b, c) || !covers(e1, c, a) || !covers(e2, a, b)) continue;
+
+				/* Barycentric coordinates of the row in the yz projection. */
+				double sum = e0 + e1 + e2;
+				crossings[static_cast<size_t>(k) * dims.y + j].push_back(
+					static_cast<float>((e0 * a.x + e1 * b.x + e2 * c.x) / sum));
+			}
+		}
+	}
+
+	for (int k = 0; k < dims.z; k++) {
+		for (int j = 0; j < dims.y; j++) {
+			auto& row = crossings[static_cast<size_t>(k) * dims.y + j];
+			std::sort(row.begin(), row.end());
+
+			size_t base = (static_cast<size_t>(k) * dims.y + j) * dims.x;
+			for (float x : row) {
+				int i = static_cast<int>(std::floor(x));
+				if (i >= 0 && i < dims.x) solid[base + i] = 1;
+			}
+
+			for (size_t p = 0; p + 1 < row.size(); p += 2) {
+				int first = std::max(0, static_cast<int>(std::ceil(row[p] - 0.5f)));
+				int last = std::min(dims.x - 1, static_cast<int>(std::floor(row[p + 1] - 0.5f)));
+				for (int i = first; i <= last; i++) solid[base + i] = 1;
+			}
+		}
+	}
+
+	return solid;
+}
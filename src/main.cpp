@@ -22,10 +22,21 @@
 #include "gui/imgui.hpp"
 #include "app_config.hpp"
 #include "audio/audio.hpp"
+#include "fluid/benchmark.hpp"
+#include "vulkan/vk_sph.hpp"
+#include "vulkan/vk_sort.hpp"
+#include "vulkan/vk_simulation.hpp"
+#include "vulkan/vk_particles.hpp"
+#include "vulkan/vk_screen_fluid.hpp"
+#include "vulkan/vk_marching_cubes.hpp"
+#include "vulkan/vk_stream.hpp"
+
+#include <algorithm>
+#include <cmath>
 
 void printUsage()
 {
-	std::cerr << "Usage: program [--width N] [--height N] [--title NAME]\n";
+	std::cerr << "Usage: program [--width N] [--height N] [--title NAME] [--benchmark PARTICLES] [--benchmark-steps N] [--open-domain-benchmark PARTICLES] [--distributed-check RANKS] [--distributed-steps N] [--vortex-benchmark PARTICLES] [--vortex-order N] [--pressure-benchmark N] [--advection-benchmark N] [--marching-cubes-benchmark N] [--lbm-benchmark N] [--lbm-steps N] [--gpu-sph-check PARTICLES] [--gpu-sph-steps N] [--gpu-sort-check N] [--gpu-marching-cubes-check N] [--stream-benchmark PARTICLES] [--delta-upload-benchmark PARTICLES] [--particles N] [--cpu-particles N] [--fluid-surface] [--mesh-surface N] [--shallow-water N]\n";
 }
 
 /* Parse command line arguments. */
@@ -45,6 +56,75 @@ AppConfig parseArgs(int argc, char** argv)
 		else if (arg == "--title" && i + 1 < argc) {
 			config.title = argv[++i];
 		}
+		else if (arg == "--benchmark" && i + 1 < argc) {
+			config.benchmarkParticles = std::stoul(argv[++i]);
+		}
+		else if (arg == "--benchmark-steps" && i + 1 < argc) {
+			config.benchmarkSteps = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--open-domain-benchmark" && i + 1 < argc) {
+			config.openDomainBenchmarkParticles = std::stoul(argv[++i]);
+		}
+		else if (arg == "--distributed-check" && i + 1 < argc) {
+			config.distributedCheckRanks = std::stoi(argv[++i]);
+		}
+		else if (arg == "--distributed-steps" && i + 1 < argc) {
+			config.distributedCheckSteps = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--vortex-benchmark" && i + 1 < argc) {
+			config.vortexBenchmarkParticles = std::stoul(argv[++i]);
+		}
+		else if (arg == "--vortex-order" && i + 1 < argc) {
+			config.vortexBenchmarkOrder = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--pressure-benchmark" && i + 1 < argc) {
+			config.pressureBenchmarkResolution = std::stoi(argv[++i]);
+		}
+		else if (arg == "--advection-benchmark" && i + 1 < argc) {
+			config.advectionBenchmarkResolution = std::stoi(argv[++i]);
+		}
+		else if (arg == "--marching-cubes-benchmark" && i + 1 < argc) {
+			config.marchingCubesBenchmarkResolution = std::stoi(argv[++i]);
+		}
+		else if (arg == "--lbm-benchmark" && i + 1 < argc) {
+			config.lbmBenchmarkResolution = std::stoi(argv[++i]);
+		}
+		else if (arg == "--lbm-steps" && i + 1 < argc) {
+			config.lbmBenchmarkSteps = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--gpu-sph-check" && i + 1 < argc) {
+			config.gpuSphCheckParticles = std::stoul(argv[++i]);
+		}
+		else if (arg == "--gpu-sph-steps" && i + 1 < argc) {
+			config.gpuSphCheckSteps = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--gpu-sort-check" && i + 1 < argc) {
+			config.gpuSortCheckElements = std::stoul(argv[++i]);
+		}
+		else if (arg == "--gpu-marching-cubes-check" && i + 1 < argc) {
+			config.gpuMarchingCubesCheckResolution = std::stoi(argv[++i]);
+		}
+		else if (arg == "--stream-benchmark" && i + 1 < argc) {
+			config.streamBenchmarkParticles = std::stoul(argv[++i]);
+		}
+		else if (arg == "--delta-upload-benchmark" && i + 1 < argc) {
+			config.deltaUploadBenchmarkParticles = std::stoul(argv[++i]);
+		}
+		else if (arg == "--particles" && i + 1 < argc) {
+			config.simulationParticles = std::stoul(argv[++i]);
+		}
+		else if (arg == "--cpu-particles" && i + 1 < argc) {
+			config.cpuSimulationParticles = std::stoul(argv[++i]);
+		}
+		else if (arg == "--fluid-surface") {
+			config.fluidSurface = true;
+		}
+		else if (arg == "--mesh-surface" && i + 1 < argc) {
+			config.meshSurfaceResolution = std::stoi(argv[++i]);
+		}
+		else if (arg == "--shallow-water" && i + 1 < argc) {
+			config.shallowWaterResolution = std::stoi(argv[++i]);
+		}
 		else {
 			printUsage();
 			throw std::runtime_error("Unknown argument: " + arg);
@@ -66,6 +146,78 @@ int main(int argc, char** argv)
 		return -1;
 	}
 
+	if (config.benchmarkParticles > 0) {
+		printBenchmark(runSolverBenchmark(config.benchmarkParticles, config.benchmarkSteps), std::cout);
+		return 0;
+	}
+	if (config.openDomainBenchmarkParticles > 0) {
+		printOpenDomainBenchmark(runOpenDomainBenchmark(config.openDomainBenchmarkParticles, config.benchmarkSteps), std::cout);
+		return 0;
+	}
+	if (config.distributedCheckRanks > 0) {
+		std::vector<DistributedCheckResult> results = runDistributedCheck(config.distributedCheckRanks, config.distributedCheckSteps);
+		printDistributedCheck(results, std::cout);
+		return std::ranges::all_of(results, [](const DistributedCheckResult& r) { return r.passed; }) ? 0 : 1;
+	}
+	if (config.vortexBenchmarkParticles > 0) {
+		printVortexBenchmark(runVortexBenchmark(config.vortexBenchmarkParticles, config.vortexBenchmarkOrder), std::cout);
+		return 0;
+	}
+	if (config.pressureBenchmarkResolution > 0) {
+		printPressureBenchmark(runPressureBenchmark(config.pressureBenchmarkResolution), std::cout);
+		return 0;
+	}
+	if (config.advectionBenchmarkResolution > 0) {
+		printAdvectionBenchmark(runAdvectionBenchmark(config.advectionBenchmarkResolution), std::cout);
+		return 0;
+	}
+	if (config.marchingCubesBenchmarkResolution > 0) {
+		printMarchingCubesBenchmark(runMarchingCubesBenchmark(config.marchingCubesBenchmarkResolution), std::cout);
+		return 0;
+	}
+	if (config.lbmBenchmarkResolution > 0) {
+		printLbmBenchmark(runLbmBenchmark(config.lbmBenchmarkResolution, config.lbmBenchmarkSteps), std::cout);
+		return 0;
+	}
+	if (config.gpuSphCheckParticles > 0) {
+		VkContext context;
+		initHeadless(context);
+		GpuSphCheckResult result = checkGpuSph(context, config.gpuSphCheckParticles, config.gpuSphCheckSteps);
+		printGpuSphCheck(result, std::cout);
+		cleanupHeadless(context);
+		return result.passed ? 0 : 1;
+	}
+	if (config.gpuSortCheckElements > 0) {
+		VkContext context;
+		initHeadless(context);
+		GpuSortCheckResult result = checkGpuSort(context, config.gpuSortCheckElements);
+		printGpuSortCheck(result, std::cout);
+		cleanupHeadless(context);
+		return result.sortCorrect && result.scanCorrect ? 0 : 1;
+	}
+	if (config.gpuMarchingCubesCheckResolution > 0) {
+		VkContext context;
+		initHeadless(context);
+		GpuMarchingCubesCheckResult result = checkGpuMarchingCubes(context, config.gpuMarchingCubesCheckResolution);
+		printGpuMarchingCubesCheck(result, std::cout);
+		cleanupHeadless(context);
+		return result.passed ? 0 : 1;
+	}
+	if (config.streamBenchmarkParticles > 0) {
+		VkContext context;
+		initHeadless(context);
+		printStreamingBenchmark(runStreamingBenchmark(context, config.streamBenchmarkParticles), std::cout);
+		cleanupHeadless(context);
+		return 0;
+	}
+	if (config.deltaUploadBenchmarkParticles > 0) {
+		VkContext context;
+		initHeadless(context);
+		printDeltaUploadBenchmark(runDeltaUploadBenchmark(context, config.deltaUploadBenchmarkParticles), std::cout);
+		cleanupHeadless(context);
+		return 0;
+	}
+
 	Audio::AudioContext audioContext{};
 	Audio::init(audioContext);
 
@@ -85,6 +237,75 @@ int main(int argc, char** argv)
 	context.imGui->init(context, context.swapChainExtent.width, context.swapChainExtent.height);
 	context.imGui->initResources();
 
+	const size_t simulationParticles = config.simulationParticles > 0 ? config.simulationParticles : config.cpuSimulationParticles;
+	if (config.shallowWaterResolution > 0) {
+		/* A bowl 100 m across, filled to 2 m above its bottom, with a mound of water dropped in off centre. */
+		const int resolution = std::max(config.shallowWaterResolution, 2);
+		ShallowWaterParams waterParams;
+		waterParams.resolution = glm::ivec2(resolution);
+		waterParams.cellSize = 100.f / resolution;
+
+		std::vector<float> bed(static_cast<size_t>(resolution) * resolution);
+		for (int j = 0; j < resolution; j++) {
+			for (int i = 0; i < resolution; i++) {
+				const glm::vec2 p = (glm::vec2(i, j) + 0.5f) * waterParams.cellSize - 50.f;
+				bed[static_cast<size_t>(j) * resolution + i] = 6.f * glm::dot(p, p) / (50.f * 50.f);
+			}
+		}
+
+		/* At most 512^2 vertices are streamed per frame. */
+		context.shallowWater = std::make_unique<StreamedShallowWater>(context, waterParams, std::max(1, resolution / 512));
+		ShallowWaterSolver& solver = context.shallowWater->getSolver();
+		solver.setBed(bed);
+		solver.setWaterLevel(2.f);
+		solver.addWater(glm::vec2(60.f, 50.f), 8.f, 2.f);
+
+		/* The basin at the 4 units of the particle box, the scale must stay uniform for the normals. */
+		context.surfaceMeshRenderer = std::make_unique<SurfaceMeshRenderer>(context, context.shallowWater->getMesh().getVertexBuffers());
+		context.surfaceMeshRenderer->model = glm::scale(glm::mat4(1.f), glm::vec3(0.04f)) * glm::translate(glm::mat4(1.f), glm::vec3(-50.f, 0.f, -50.f));
+	}
+	else if (simulationParticles > 0) {
+		/* Same dam break as the benchmarks, block of half the box edge. */
+		const float spacing = 0.5f / std::max(2.f, std::round(std::cbrt(static_cast<float>(simulationParticles))));
+		SphParams params;
+		params.particleSpacing = spacing;
+		params.smoothingRadius = 2.f * spacing;
+		params.timeStep = 0.002f * spacing / 0.05f;
+
+		std::vector<Particle> particles = initParticles(glm::vec3(0.f), glm::vec3(0.5f - 0.5f * spacing), spacing);
+		if (config.simulationParticles > 0) {
+			context.simulation = std::make_unique<AsyncSimulation>(context, params, particles);
+			context.particleRenderer = std::make_unique<ParticleRenderer>(context, context.simulation->getInstanceBuffers());
+		}
+		else {
+			context.streamedSimulation = std::make_unique<StreamedSimulation>(context, params, particles);
+			context.particleRenderer = std::make_unique<ParticleRenderer>(context, context.streamedSimulation->getInstanceBuffers());
+		}
+		if (config.fluidSurface)
+			context.screenSpaceFluid = std::make_unique<ScreenSpaceFluid>(context, *context.particleRenderer);
+		/* The mesh is extracted on the GPU from its solver's positions, or on the CPU for the streamed solver. */
+		if (config.meshSurfaceResolution > 0) {
+			const glm::vec3 extent = params.boundsMax - params.boundsMin;
+			const int resolution = config.meshSurfaceResolution;
+
+			MarchingCubesParams surfaceParams;
+			surfaceParams.resolution = glm::ivec3(resolution);
+			surfaceParams.origin = params.boundsMin;
+			surfaceParams.cellSize = std::max({ extent.x, extent.y, extent.z }) / resolution;
+
+			/* Several times the faces of the box, a splashing dam break stays well below. */
+			const uint32_t maxTriangles = static_cast<uint32_t>(std::min<size_t>(size_t(8) * resolution * resolution, 1u << 21));
+			if (context.simulation) {
+				context.simulation->enableSurface(surfaceParams, maxTriangles);
+				context.surfaceMeshRenderer = std::make_unique<SurfaceMeshRenderer>(context, context.simulation->getSurface()->getVertexBuffers());
+			}
+			else {
+				context.streamedSimulation->enableSurface(surfaceParams, maxTriangles);
+				context.surfaceMeshRenderer = std::make_unique<SurfaceMeshRenderer>(context, context.streamedSimulation->getSurface()->getVertexBuffers());
+			}
+		}
+	}
+
 	run(context);
 
 	cleanup(context);
@@ -1,11 +0,0 @@
-#include "scene/particle.hpp"
-
-void initParticles()
-{
-
-}
-
-std::vector<Particle> getNeighbourParticles()
-{
-
-}
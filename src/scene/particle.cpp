@@ -0,0 +1,33 @@
+#include "scene/particle.hpp"
+
+std::vector<Particle> initParticles(glm::vec3 min, glm::vec3 max, float spacing)
+{
+	std::vector<Particle> particles;
+
+	for (float z = min.z; z <= max.z; z += spacing) {
+		for (float y = min.y; y <= max.y; y += spacing) {
+			for (float x = min.x; x <= max.x; x += spacing) {
+				Particle particle{};
+				particle.position = { x, y, z };
+				particles.push_back(particle);
+			}
+		}
+	}
+
+	return particles;
+}
+
+std::vector<Particle2D> initParticles(glm::vec2 min, glm::vec2 max, float spacing)
+{
+	std::vector<Particle2D> particles;
+
+	for (float y = min.y; y <= max.y; y += spacing) {
+		for (float x = min.x; x <= max.x; x += spacing) {
+			Particle2D particle{};
+			particle.position = { x, y };
+			particles.push_back(particle);
+		}
+	}
+
+	return particles;
+}
@@ -61,6 +61,101 @@ void copyBuffer(VkContext& context,
 	endSingleTimeCommands(context, commandCopyBuffer);
 }
 
+DeviceBuffer createDeviceBuffer(VkContext& context,
+		vk::DeviceSize size,
+		vk::BufferUsageFlags usage,
+		vk::MemoryPropertyFlags properties)
+{
+	DeviceBuffer result;
+	result.size = size;
+
+	/*
+	 * Simulation buffers are filled on the graphics queue and used by the
+	 * compute and graphics queues. Concurrent sharing avoids ownership
+	 * transfers when the two are different families.
+	 */
+	if (!context.computeFamily || context.computeFamily == context.graphicsFamily) {
+		createBuffer(context, size, usage, properties, result.buffer, result.memory);
+		return result;
+	}
+
+	const uint32_t families[] = { context.graphicsFamily.value(), context.computeFamily.value() };
+	vk::BufferCreateInfo bufferInfo {
+		.size = size,
+		.usage = usage,
+		.sharingMode = vk::SharingMode::eConcurrent,
+		.queueFamilyIndexCount = 2,
+		.pQueueFamilyIndices = families
+	};
+	result.buffer = context.device.createBuffer(bufferInfo);
+
+	vk::MemoryRequirements memRequirements = context.device.getBufferMemoryRequirements(result.buffer);
+	vk::MemoryAllocateInfo allocInfo {
+		.allocationSize = memRequirements.size,
+		.memoryTypeIndex = findMemoryType(context, memRequirements.memoryTypeBits, properties)
+	};
+	result.memory = context.device.allocateMemory(allocInfo);
+	context.device.bindBufferMemory(result.buffer, result.memory, 0);
+	return result;
+}
+
+void destroyDeviceBuffer(VkContext& context, DeviceBuffer& buffer)
+{
+	if (buffer.buffer) context.device.destroyBuffer(buffer.buffer);
+	if (buffer.memory) context.device.freeMemory(buffer.memory);
+	buffer = {};
+}
+
+void uploadToBuffer(VkContext& context, DeviceBuffer& buffer, const void* data, vk::DeviceSize size, vk::DeviceSize offset)
+{
+	if (size == 0) return;
+
+	vk::Buffer stagingBuffer{};
+	vk::DeviceMemory stagingBufferMemory{};
+	createBuffer(context,
+		size,
+		vk::BufferUsageFlagBits::eTransferSrc,
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+		stagingBuffer,
+		stagingBufferMemory);
+
+	void* mapped = context.device.mapMemory(stagingBufferMemory, 0, size);
+	memcpy(mapped, data, static_cast<size_t>(size));
+	context.device.unmapMemory(stagingBufferMemory);
+
+	vk::CommandBuffer commandBuffer = beginSingleTimeCommands(context);
+	commandBuffer.copyBuffer(stagingBuffer, buffer.buffer, vk::BufferCopy(0, offset, size));
+	endSingleTimeCommands(context, commandBuffer);
+
+	context.device.destroyBuffer(stagingBuffer);
+	context.device.freeMemory(stagingBufferMemory);
+}
+
+void downloadFromBuffer(VkContext& context, DeviceBuffer& buffer, void* data, vk::DeviceSize size, vk::DeviceSize offset)
+{
+	if (size == 0) return;
+
+	vk::Buffer stagingBuffer{};
+	vk::DeviceMemory stagingBufferMemory{};
+	createBuffer(context,
+		size,
+		vk::BufferUsageFlagBits::eTransferDst,
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+		stagingBuffer,
+		stagingBufferMemory);
+
+	vk::CommandBuffer commandBuffer = beginSingleTimeCommands(context);
+	commandBuffer.copyBuffer(buffer.buffer, stagingBuffer, vk::BufferCopy(offset, 0, size));
+	endSingleTimeCommands(context, commandBuffer);
+
+	void* mapped = context.device.mapMemory(stagingBufferMemory, 0, size);
+	memcpy(data, mapped, static_cast<size_t>(size));
+	context.device.unmapMemory(stagingBufferMemory);
+
+	context.device.destroyBuffer(stagingBuffer);
+	context.device.freeMemory(stagingBufferMemory);
+}
+
 void copyBufferToImage(VkContext& context, const vk::Buffer& buffer, vk::Image& image, uint32_t width, uint32_t height)
 {
 	vk::CommandBuffer commandBuffer = beginSingleTimeCommands(context);
@@ -13,6 +13,10 @@
 #include "vulkan/vk_vertex.hpp"
 #include "vulkan/vulkan.hpp"
 #include <vulkan/vulkan_structs.hpp>
+#include "vulkan/vk_simulation.hpp"
+#include "vulkan/vk_particles.hpp"
+#include "vulkan/vk_screen_fluid.hpp"
+#include "vulkan/vk_marching_cubes.hpp"
 #include "gui/imgui.hpp"
 
 void createCommandPool(VkContext& context)
@@ -22,6 +26,13 @@ void createCommandPool(VkContext& context)
 		.queueFamilyIndex = context.graphicsFamily.value()
 	};
 	context.commandPool = context.device.createCommandPool(poolInfo);
+
+	/* Command buffers may only be submitted to queues of their pool's family. */
+	context.computeCommandPool = context.commandPool;
+	if (context.computeFamily && context.computeFamily != context.graphicsFamily) {
+		poolInfo.queueFamilyIndex = context.computeFamily.value();
+		context.computeCommandPool = context.device.createCommandPool(poolInfo);
+	}
 }
 
 void createCommandBuffers(VkContext& context)
@@ -81,6 +92,26 @@ void recordCommandBuffer(VkContext& context, uint32_t imageIndex)
 
 	context.commandBuffers[context.currentFrame].begin(beginInfo);
 
+	/* Instance buffer and count of whichever simulation feeds the particle renderer. */
+	uint32_t instanceBuffer = 0;
+	uint32_t particleCount = 0;
+	if (context.simulation) {
+		instanceBuffer = context.simulation->getInstanceSlot(context.frameNumber);
+		particleCount = context.simulation->getParticleCount();
+	}
+	else if (context.streamedSimulation) {
+		context.streamedSimulation->recordUpload(context.commandBuffers[context.currentFrame]);
+		instanceBuffer = context.currentFrame;
+		particleCount = context.streamedSimulation->getParticleCount();
+	}
+	else if (context.shallowWater) {
+		context.shallowWater->recordUpload(context.commandBuffers[context.currentFrame]);
+	}
+
+	if (context.screenSpaceFluid) {
+		context.screenSpaceFluid->recordOffscreen(context.commandBuffers[context.currentFrame], instanceBuffer, particleCount);
+	}
+
 	transition_image_layout(
 		context,
 		imageIndex,
@@ -147,6 +178,25 @@ void recordCommandBuffer(VkContext& context, uint32_t imageIndex)
 
         context.commandBuffers[context.currentFrame].drawIndexed(context.indices.size(), 1, 0, 0, 0);
 
+	if (context.shallowWater && context.surfaceMeshRenderer) {
+		context.surfaceMeshRenderer->draw(context.commandBuffers[context.currentFrame], context.shallowWater->getMesh());
+	}
+	else if (context.simulation && context.surfaceMeshRenderer && context.simulation->getSurface()) {
+		context.surfaceMeshRenderer->draw(
+			context.commandBuffers[context.currentFrame],
+			*context.simulation->getSurface(),
+			context.simulation->getInstanceSlot(context.frameNumber));
+	}
+	else if (context.streamedSimulation && context.surfaceMeshRenderer && context.streamedSimulation->getSurface()) {
+		context.surfaceMeshRenderer->draw(context.commandBuffers[context.currentFrame], *context.streamedSimulation->getSurface());
+	}
+	else if (context.screenSpaceFluid) {
+		context.screenSpaceFluid->drawComposite(context.commandBuffers[context.currentFrame]);
+	}
+	else if (context.particleRenderer) {
+		context.particleRenderer->draw(context.commandBuffers[context.currentFrame], instanceBuffer, particleCount);
+	}
+
 	context.imGui->drawFrame(context.commandBuffers[context.currentFrame]);
 
         context.commandBuffers[context.currentFrame].endRendering();
@@ -24,6 +24,10 @@
 #include "vulkan/vk_descriptor.hpp"
 #include "vulkan/vk_texture.hpp"
 #include "vulkan/vk_model.hpp"
+#include "vulkan/vk_simulation.hpp"
+#include "vulkan/vk_particles.hpp"
+#include "vulkan/vk_screen_fluid.hpp"
+#include "vulkan/vk_marching_cubes.hpp"
 
 #include "scene/uniforms.hpp"
 
@@ -106,6 +110,13 @@ void drawFrame(VkContext& context)
 		throw std::runtime_error("failed to acquire swap chain image!");
         }
 
+	/* Step N + 1 runs on the compute queue while this frame renders. */
+	const uint64_t frame = ++context.frameNumber;
+	if (context.simulation) context.simulation->submitStep(frame + 1);
+	/* The frame's fence was waited for above and is reset below. */
+	if (context.streamedSimulation) context.streamedSimulation->update(context.currentFrame, context.inFlightFences[context.currentFrame]);
+	if (context.shallowWater) context.shallowWater->update(context.currentFrame, context.inFlightFences[context.currentFrame]);
+
 	context.imGui->newFrame();
 	context.imGui->updateBuffers();
 
@@ -115,16 +126,37 @@ void drawFrame(VkContext& context)
         context.commandBuffers[context.currentFrame].reset();
         recordCommandBuffer(context, imageIndex);
 
-	vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+	std::vector<vk::Semaphore> waitSemaphores { context.presentCompleteSemaphores[context.currentFrame] };
+	std::vector<vk::PipelineStageFlags> waitStages { vk::PipelineStageFlagBits::eColorAttachmentOutput };
+	std::vector<vk::Semaphore> signalSemaphores { context.renderFinishedSemaphores[imageIndex] };
+	/* Values of binary semaphores are ignored. */
+	std::vector<uint64_t> waitValues { 0 };
+	std::vector<uint64_t> signalValues { 0 };
+
+	if (context.simulation) {
+		waitSemaphores.push_back(context.simulation->getSimulationTimeline());
+		waitStages.push_back(vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput
+			| vk::PipelineStageFlagBits::eVertexShader);
+		waitValues.push_back(frame);
+		signalSemaphores.push_back(context.simulation->getRenderTimeline());
+		signalValues.push_back(frame);
+	}
+
+	vk::TimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+	timelineInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+	timelineInfo.pSignalSemaphoreValues = signalValues.data();
 
 	vk::SubmitInfo submitInfo{};
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = &context.presentCompleteSemaphores[context.currentFrame];
-	submitInfo.pWaitDstStageMask = &waitStage;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &context.commandBuffers[context.currentFrame];
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = &context.renderFinishedSemaphores[imageIndex];
+	submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+	submitInfo.pSignalSemaphores = signalSemaphores.data();
 
 	context.graphicsQueue.submit(submitInfo, context.inFlightFences[context.currentFrame]);
 
@@ -175,6 +207,13 @@ void cleanup(VkContext& context)
 {
 	context.device.waitIdle();
 
+	context.surfaceMeshRenderer.reset();
+	context.screenSpaceFluid.reset();
+	context.particleRenderer.reset();
+	context.simulation.reset();
+	context.streamedSimulation.reset();
+	context.shallowWater.reset();
+
 	if (context.imGui) {
 		ImGui_ImplVulkan_Shutdown();
 		ImGui_ImplGlfw_Shutdown();
@@ -216,6 +255,8 @@ void cleanup(VkContext& context)
 	for (auto& fence : context.inFlightFences)
 		context.device.destroyFence(fence);
 
+	if (context.computeCommandPool != context.commandPool)
+		context.device.destroyCommandPool(context.computeCommandPool);
 	context.device.destroyCommandPool(context.commandPool);
 	context.device.destroyPipeline(context.graphicsPipeline);
 	context.device.destroyPipelineLayout(context.pipelineLayout);
@@ -241,3 +282,26 @@ void cleanup(VkContext& context)
 	glfwDestroyWindow(context.window);
 	glfwTerminate();
 }
+
+void initHeadless(VkContext& context)
+{
+	createInstance(context);
+	setupValidationLayers(context);
+	createComputeDevice(context);
+	createCommandPool(context);
+}
+
+void cleanupHeadless(VkContext& context)
+{
+	context.device.waitIdle();
+	context.device.destroyCommandPool(context.commandPool);
+	context.device.destroy();
+
+	if (enableValidationLayers && context.debugCallback != VK_NULL_HANDLE) {
+		auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)
+			vkGetInstanceProcAddr(context.instance, "vkDestroyDebugUtilsMessengerEXT");
+		if (func) func(context.instance, context.debugCallback, nullptr);
+	}
+
+	context.instance.destroy();
+}
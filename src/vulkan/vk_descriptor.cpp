@@ -68,3 +68,59 @@ void createDescriptorSets(VkContext& context)
 		context.device.updateDescriptorSets(descriptorWrites, {});
 	}
 }
+
+vk::DescriptorSetLayout createStorageBufferSetLayout(VkContext& context, uint32_t bindingCount)
+{
+	std::vector<vk::DescriptorSetLayoutBinding> bindings;
+	for (uint32_t binding = 0; binding < bindingCount; binding++)
+		bindings.emplace_back(binding, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr);
+
+	vk::DescriptorSetLayoutCreateInfo layoutInfo {
+		.bindingCount = static_cast<uint32_t>(bindings.size()),
+		.pBindings = bindings.data()
+	};
+
+	return context.device.createDescriptorSetLayout(layoutInfo);
+}
+
+vk::DescriptorPool createStorageBufferPool(VkContext& context, uint32_t maxSets, uint32_t descriptorCount)
+{
+	vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageBuffer, descriptorCount);
+	vk::DescriptorPoolCreateInfo poolInfo {
+		.maxSets = maxSets,
+		.poolSizeCount = 1,
+		.pPoolSizes = &poolSize
+	};
+
+	return context.device.createDescriptorPool(poolInfo);
+}
+
+vk::DescriptorSet allocateDescriptorSet(VkContext& context, vk::DescriptorPool pool, vk::DescriptorSetLayout layout)
+{
+	vk::DescriptorSetAllocateInfo allocInfo {
+		.descriptorPool = pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &layout
+	};
+	return context.device.allocateDescriptorSets(allocInfo).front();
+}
+
+void writeStorageBufferSet(VkContext& context, vk::DescriptorSet set, const std::vector<vk::Buffer>& buffers)
+{
+	std::vector<vk::DescriptorBufferInfo> bufferInfos;
+	for (const vk::Buffer& buffer : buffers)
+		bufferInfos.push_back({ .buffer = buffer, .offset = 0, .range = vk::WholeSize });
+
+	std::vector<vk::WriteDescriptorSet> descriptorWrites;
+	for (uint32_t binding = 0; binding < bufferInfos.size(); binding++) {
+		descriptorWrites.push_back(vk::WriteDescriptorSet {
+			.dstSet = set,
+			.dstBinding = binding,
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = vk::DescriptorType::eStorageBuffer,
+			.pBufferInfo = &bufferInfos[binding]
+		});
+	}
+	context.device.updateDescriptorSets(descriptorWrites, {});
+}
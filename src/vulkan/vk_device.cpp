@@ -94,6 +94,7 @@ void createDevice(VkContext& context)
 	auto features = context.gpu.getFeatures2();
 
 	vk::PhysicalDeviceVulkan11Features vulkan11Features{};
+	vk::PhysicalDeviceVulkan12Features vulkan12Features{};
 	vk::PhysicalDeviceVulkan13Features vulkan13Features{};
 	vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
 	vk::PhysicalDeviceFeatures2 enabledFeatures{};
@@ -112,21 +113,46 @@ void createDevice(VkContext& context)
 	vulkan13Features.synchronization2 = vk::True;
 	extendedDynamicStateFeatures.extendedDynamicState = vk::True;
 
+	vulkan12Features.timelineSemaphore = vk::True;
+
 	vulkan13Features.pNext = &extendedDynamicStateFeatures;
-	vulkan11Features.pNext = &vulkan13Features;
+	vulkan12Features.pNext = &vulkan13Features;
+	vulkan11Features.pNext = &vulkan12Features;
 	enabledFeatures.pNext = &vulkan11Features;
 
+	/* A compute family without graphics runs the simulation asynchronously to rendering. */
+	auto computeQueueFamilyProperty = std::ranges::find_if(
+		queueFamilyProperties,
+		[]( auto const & qfp )
+		{
+			return (qfp.queueFlags & vk::QueueFlagBits::eCompute) &&
+				!(qfp.queueFlags & vk::QueueFlagBits::eGraphics);
+		}
+	);
+	uint32_t computeIndex = computeQueueFamilyProperty != queueFamilyProperties.end()
+		? static_cast<uint32_t>(std::distance(queueFamilyProperties.begin(), computeQueueFamilyProperty))
+		: graphicsIndex;
+
 	float                     queuePriority = 0.0f;
-	vk::DeviceQueueCreateInfo deviceQueueCreateInfo {
-		.queueFamilyIndex = graphicsIndex,
-		.queueCount = 1,
-		.pQueuePriorities = &queuePriority
+	std::vector<vk::DeviceQueueCreateInfo> deviceQueueCreateInfos {
+		{
+			.queueFamilyIndex = graphicsIndex,
+			.queueCount = 1,
+			.pQueuePriorities = &queuePriority
+		}
 	};
+	if (computeIndex != graphicsIndex) {
+		deviceQueueCreateInfos.push_back({
+			.queueFamilyIndex = computeIndex,
+			.queueCount = 1,
+			.pQueuePriorities = &queuePriority
+		});
+	}
 
 	vk::DeviceCreateInfo      deviceCreateInfo {
 		.pNext =  &enabledFeatures,
-		.queueCreateInfoCount = 1,
-		.pQueueCreateInfos = &deviceQueueCreateInfo,
+		.queueCreateInfoCount = static_cast<uint32_t>(deviceQueueCreateInfos.size()),
+		.pQueueCreateInfos = deviceQueueCreateInfos.data(),
 		.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()),
 		.ppEnabledExtensionNames = deviceExtensions.data()
 	};
@@ -137,4 +163,69 @@ void createDevice(VkContext& context)
 	context.device = context.gpu.createDevice(deviceCreateInfo);
 	context.graphicsQueue = context.device.getQueue(graphicsIndex, 0);
 	context.presentQueue = context.device.getQueue(presentIndex, 0);
+
+	/* Without a dedicated family the graphics queue, which always supports compute, runs the simulation. */
+	context.computeFamily = computeIndex;
+	context.computeQueue = context.device.getQueue(computeIndex, 0);
+}
+
+void createComputeDevice(VkContext& context)
+{
+	auto physicalDevices = context.instance.enumeratePhysicalDevices();
+	if (physicalDevices.empty())
+		throw std::runtime_error("Failed to find a GPU with Vulkan support!");
+
+	std::multimap<int, std::pair<vk::PhysicalDevice, uint32_t>> candidates;
+
+	for (const auto& device : physicalDevices) {
+		auto props = device.getProperties();
+		if (props.apiVersion < VK_API_VERSION_1_3) continue;
+
+		auto families = device.getQueueFamilyProperties();
+		auto family = std::ranges::find_if(families, [](const auto& qfp) {
+			return (qfp.queueFlags & vk::QueueFlagBits::eCompute) != static_cast<vk::QueueFlags>(0);
+		});
+		if (family == families.end()) continue;
+
+		int score = 0;
+		if (props.deviceType == vk::PhysicalDeviceType::eDiscreteGpu) score += 1000;
+		if (props.deviceType == vk::PhysicalDeviceType::eIntegratedGpu) score += 500;
+
+		candidates.insert({ score, { device, static_cast<uint32_t>(std::distance(families.begin(), family)) } });
+	}
+
+	if (candidates.empty())
+		throw std::runtime_error("Failed to find a device with a compute queue!");
+
+	auto [gpu, computeIndex] = candidates.rbegin()->second;
+	context.gpu = gpu;
+
+	vk::PhysicalDeviceVulkan13Features vulkan13Features {
+		.synchronization2 = vk::True
+	};
+	vk::PhysicalDeviceVulkan12Features vulkan12Features {
+		.pNext = &vulkan13Features,
+		.timelineSemaphore = vk::True
+	};
+
+	float queuePriority = 0.0f;
+	vk::DeviceQueueCreateInfo deviceQueueCreateInfo {
+		.queueFamilyIndex = computeIndex,
+		.queueCount = 1,
+		.pQueuePriorities = &queuePriority
+	};
+
+	vk::DeviceCreateInfo deviceCreateInfo {
+		.pNext = &vulkan12Features,
+		.queueCreateInfoCount = 1,
+		.pQueueCreateInfos = &deviceQueueCreateInfo
+	};
+
+	context.device = context.gpu.createDevice(deviceCreateInfo);
+
+	/* Transfers and single time commands go through the graphics slots, so they share the compute queue. */
+	context.computeFamily = computeIndex;
+	context.computeQueue = context.device.getQueue(computeIndex, 0);
+	context.graphicsFamily = computeIndex;
+	context.graphicsQueue = context.computeQueue;
 }
@@ -0,0 +1,518 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "vulkan/vk_marching_cubes.hpp"
+#include "vulkan/vk_command.hpp"
+#include "vulkan/vk_descriptor.hpp"
+#include "vulkan/vk_image.hpp"
+#include "fluid/parallel.hpp"
+#include "scene/uniforms.hpp"
+#include "FileIO.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+
+static constexpr uint32_t GroupSize = 256;
+static constexpr uint32_t MaxGroupsPerRow = 32768; // below the 65535 every device supports
+
+static const char* const kernelNames[] = { "clearField", "splatParticles", "classifyCells", "generateTriangles", "writeIndirect" };
+
+static uint32_t divideRoundUp(uint32_t value, uint32_t divisor)
+{
+	return (value + divisor - 1) / divisor;
+}
+
+/* === GpuMarchingCubes === */
+
+GpuMarchingCubes::GpuMarchingCubes(VkContext& context, const MarchingCubesParams& params, vk::Buffer positions, uint32_t maxTriangles)
+	: context(context), params(params), maxTriangles(std::max(maxTriangles, 1u))
+{
+	const glm::uvec3 resolution(glm::max(params.resolution, glm::ivec3(1)));
+	cellTotal = resolution.x * resolution.y * resolution.z;
+	nodeTotal = (resolution.x + 1) * (resolution.y + 1) * (resolution.z + 1);
+
+	constants.origin = glm::vec4(params.origin, params.cellSize);
+	constants.resolution = glm::uvec4(resolution, this->maxTriangles);
+	constants.kernel = glm::vec4(0.f, 0.f, params.isoLevel, FieldScale);
+
+	kernels = createComputeKernels(context, "./../shaders/marching_cubes.spv", kernelNames, 6, sizeof(Constants));
+
+	const vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+	field = createDeviceBuffer(context, vk::DeviceSize(nodeTotal) * sizeof(uint32_t), usage | vk::BufferUsageFlagBits::eTransferSrc);
+	triangleOffsets = createDeviceBuffer(context, vk::DeviceSize(cellTotal + 1) * sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer);
+	offsetScan = std::make_unique<GpuScan>(context, triangleOffsets, cellTotal + 1);
+
+	const MarchingCubesTable& table = marchingCubesTable();
+	std::vector<int32_t> entries;
+	entries.reserve(table.size() * table[0].size());
+	for (const auto& configuration : table)
+		entries.insert(entries.end(), configuration.begin(), configuration.end());
+	triangleTable = createDeviceBuffer(context, entries.size() * sizeof(int32_t), usage);
+	uploadToBuffer(context, triangleTable, entries.data(), triangleTable.size);
+
+	/* Empty draws until the first extraction. */
+	const uint32_t emptyDraw[5] = { 0, 1, 0, 0, 0 };
+	descriptorPool = createStorageBufferPool(context, SlotCount, SlotCount * 6);
+	for (Slot& slot : slots) {
+		slot.vertices = createDeviceBuffer(context, vk::DeviceSize(this->maxTriangles) * 3 * sizeof(SurfaceVertex),
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc);
+		slot.indirect = createDeviceBuffer(context, sizeof(emptyDraw),
+			usage | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eIndirectBuffer);
+		uploadToBuffer(context, slot.indirect, emptyDraw, sizeof(emptyDraw));
+
+		slot.descriptorSet = allocateDescriptorSet(context, descriptorPool, kernels.setLayout);
+		writeStorageBufferSet(context, slot.descriptorSet,
+			{ positions, field.buffer, triangleTable.buffer, triangleOffsets.buffer, slot.vertices.buffer, slot.indirect.buffer });
+	}
+}
+
+GpuMarchingCubes::~GpuMarchingCubes()
+{
+	offsetScan.reset();
+	context.device.destroyDescriptorPool(descriptorPool);
+	for (Slot& slot : slots) {
+		destroyDeviceBuffer(context, slot.vertices);
+		destroyDeviceBuffer(context, slot.indirect);
+	}
+	destroyDeviceBuffer(context, field);
+	destroyDeviceBuffer(context, triangleTable);
+	destroyDeviceBuffer(context, triangleOffsets);
+	destroyComputeKernels(context, kernels);
+}
+
+void GpuMarchingCubes::dispatch(vk::CommandBuffer commandBuffer, KernelSlot kernel, uint32_t threads, uint32_t slot)
+{
+	const uint32_t groups = divideRoundUp(threads, GroupSize);
+	const uint32_t rowGroups = std::clamp(groups, 1u, MaxGroupsPerRow);
+	constants.counts.y = rowGroups * GroupSize;
+
+	vk::DescriptorSet set = slots[slot % SlotCount].descriptorSet;
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, kernels.layout, 0, 1, &set, 0, nullptr);
+	commandBuffer.pushConstants(kernels.layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(Constants), &constants);
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, kernels.pipelines[kernel]);
+	commandBuffer.dispatch(rowGroups, divideRoundUp(std::max(groups, 1u), rowGroups), 1);
+	computeBarrier(commandBuffer);
+}
+
+void GpuMarchingCubes::recordSplat(vk::CommandBuffer commandBuffer, uint32_t count, float radius, float spacing)
+{
+	constants.kernel.x = radius;
+	constants.kernel.y = spacing * spacing * spacing;
+	constants.counts.x = count;
+
+	dispatch(commandBuffer, ClearField, nodeTotal, 0);
+	if (count > 0) dispatch(commandBuffer, SplatParticles, count, 0);
+}
+
+void GpuMarchingCubes::recordExtract(vk::CommandBuffer commandBuffer, uint32_t slot)
+{
+	dispatch(commandBuffer, ClassifyCells, cellTotal + 1, slot);
+	offsetScan->record(commandBuffer, cellTotal + 1);
+	dispatch(commandBuffer, GenerateTriangles, cellTotal, slot);
+	dispatch(commandBuffer, WriteIndirect, 1, slot);
+}
+
+/* === StreamedMesh === */
+
+StreamedMesh::StreamedMesh(VkContext& context, uint32_t maxVertices, uint32_t maxIndices)
+	: context(context),
+	  maxVertices(std::max(maxVertices, 1u)),
+	  maxIndices(std::max(maxIndices, 3u)),
+	  /* Every block changed, plus the alignment of every region in the worst case. */
+	  ring(context,
+		vk::DeviceSize(this->maxVertices) * sizeof(SurfaceVertex) + vk::DeviceSize(this->maxIndices) * sizeof(uint32_t)
+		+ 16 * (divideRoundUp(this->maxVertices, uint32_t(BlockVertices)) + divideRoundUp(this->maxIndices, uint32_t(BlockIndices)))),
+	  vertexDelta(BlockVertices * sizeof(SurfaceVertex)),
+	  indexDelta(BlockIndices * sizeof(uint32_t))
+{
+	for (DeviceBuffer& buffer : vertexBuffers) {
+		buffer = createDeviceBuffer(context, vk::DeviceSize(this->maxVertices) * sizeof(SurfaceVertex),
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+	}
+	for (DeviceBuffer& buffer : indexBuffers) {
+		buffer = createDeviceBuffer(context, vk::DeviceSize(this->maxIndices) * sizeof(uint32_t),
+			vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+	}
+}
+
+StreamedMesh::~StreamedMesh()
+{
+	context.device.waitIdle();
+
+	for (DeviceBuffer& buffer : vertexBuffers)
+		destroyDeviceBuffer(context, buffer);
+	for (DeviceBuffer& buffer : indexBuffers)
+		destroyDeviceBuffer(context, buffer);
+}
+
+std::array<vk::Buffer, MAX_FRAMES_IN_FLIGHT> StreamedMesh::getVertexBuffers() const
+{
+	std::array<vk::Buffer, MAX_FRAMES_IN_FLIGHT> buffers;
+	for (size_t i = 0; i < buffers.size(); i++)
+		buffers[i] = vertexBuffers[i].buffer;
+	return buffers;
+}
+
+void StreamedMesh::update(const SurfaceMesh& mesh, uint32_t frame, vk::Fence fence)
+{
+	this->frame = frame;
+	ring.beginFrame(frame, fence);
+
+	const size_t vertexCount = std::min(mesh.positions.size(), size_t(maxVertices));
+	const bool hasNormals = mesh.normals.size() >= vertexCount;
+	vertices.resize(vertexCount);
+	parallelFor(vertexCount, 4096, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++)
+			vertices[v] = { glm::vec4(mesh.positions[v], 1.f), glm::vec4(hasNormals ? mesh.normals[v] : glm::vec3(0.f, 1.f, 0.f), 0.f) };
+	});
+
+	std::span<const uint32_t> indices = mesh.indices;
+	if (vertexCount < mesh.positions.size() || indices.size() > maxIndices) {
+		cutIndices.clear();
+		for (size_t t = 0; t + 2 < indices.size() && cutIndices.size() + 3 <= maxIndices; t += 3) {
+			if (indices[t] < vertexCount && indices[t + 1] < vertexCount && indices[t + 2] < vertexCount)
+				cutIndices.insert(cutIndices.end(), { indices[t], indices[t + 1], indices[t + 2] });
+		}
+		indices = cutIndices;
+	}
+
+	vertexDelta.update(std::as_bytes(std::span(vertices)));
+	indexDelta.update(std::as_bytes(indices));
+	vertexRegions = vertexDelta.stage(ring, frame);
+	indexRegions = indexDelta.stage(ring, frame);
+	indexCounts[frame] = static_cast<uint32_t>(indices.size());
+}
+
+void StreamedMesh::recordUpload(vk::CommandBuffer commandBuffer)
+{
+	if (vertexRegions.empty() && indexRegions.empty()) return;
+
+	if (!vertexRegions.empty()) commandBuffer.copyBuffer(ring.getBuffer(), vertexBuffers[frame].buffer, vertexRegions);
+	if (!indexRegions.empty()) commandBuffer.copyBuffer(ring.getBuffer(), indexBuffers[frame].buffer, indexRegions);
+
+	vk::MemoryBarrier2 barrier {
+		.srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+		.srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+		.dstStageMask = vk::PipelineStageFlagBits2::eIndexInput | vk::PipelineStageFlagBits2::eVertexShader,
+		.dstAccessMask = vk::AccessFlagBits2::eIndexRead | vk::AccessFlagBits2::eShaderStorageRead
+	};
+	commandBuffer.pipelineBarrier2(vk::DependencyInfo { .memoryBarrierCount = 1, .pMemoryBarriers = &barrier });
+}
+
+/* === SurfaceMeshRenderer === */
+
+SurfaceMeshRenderer::SurfaceMeshRenderer(VkContext& context, std::span<const vk::Buffer> vertexBuffers)
+	: context(context), bufferCount(static_cast<uint32_t>(vertexBuffers.size()))
+{
+	std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {
+		vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr),
+		vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr)
+	};
+	setLayout = context.device.createDescriptorSetLayout({
+		.bindingCount = static_cast<uint32_t>(bindings.size()),
+		.pBindings = bindings.data()
+	});
+
+	vk::PushConstantRange pushConstantRange {
+		.stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+		.offset = 0,
+		.size = sizeof(Constants)
+	};
+	layout = context.device.createPipelineLayout({
+		.setLayoutCount = 1,
+		.pSetLayouts = &setLayout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &pushConstantRange
+	});
+
+	shaderModule = createShaderModule(context, readFile("./../shaders/surface_mesh.spv"));
+	createPipeline();
+	createDescriptorSets(vertexBuffers);
+}
+
+SurfaceMeshRenderer::~SurfaceMeshRenderer()
+{
+	context.device.destroyDescriptorPool(descriptorPool);
+	context.device.destroyPipeline(pipeline);
+	context.device.destroyPipelineLayout(layout);
+	context.device.destroyDescriptorSetLayout(setLayout);
+	context.device.destroyShaderModule(shaderModule);
+}
+
+void SurfaceMeshRenderer::createPipeline()
+{
+	vk::PipelineShaderStageCreateInfo shaderStages[] = {
+		{ .stage = vk::ShaderStageFlagBits::eVertex, .module = shaderModule, .pName = "vertMain" },
+		{ .stage = vk::ShaderStageFlagBits::eFragment, .module = shaderModule, .pName = "fragMain" }
+	};
+
+	const vk::DynamicState dynamicStates[] = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+	vk::PipelineDynamicStateCreateInfo dynamicState {
+		.dynamicStateCount = 2,
+		.pDynamicStates = dynamicStates
+	};
+
+	vk::PipelineVertexInputStateCreateInfo vertexInputInfo {};
+	vk::PipelineInputAssemblyStateCreateInfo inputAssembly {
+		.topology = vk::PrimitiveTopology::eTriangleList
+	};
+	vk::PipelineViewportStateCreateInfo viewportState {
+		.viewportCount = 1,
+		.scissorCount = 1
+	};
+	vk::PipelineRasterizationStateCreateInfo rasterizer {
+		.polygonMode = vk::PolygonMode::eFill,
+		.cullMode = vk::CullModeFlagBits::eNone,
+		.frontFace = vk::FrontFace::eCounterClockwise,
+		.lineWidth = 1.0f
+	};
+	vk::PipelineMultisampleStateCreateInfo multisampling {
+		.rasterizationSamples = vk::SampleCountFlagBits::e1
+	};
+	vk::PipelineDepthStencilStateCreateInfo depthStencil {
+		.depthTestEnable = vk::True,
+		.depthWriteEnable = vk::True,
+		.depthCompareOp = vk::CompareOp::eLess
+	};
+
+	vk::PipelineColorBlendAttachmentState colorBlendAttachment {
+		.blendEnable = vk::False,
+		.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG
+			| vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+	};
+	vk::PipelineColorBlendStateCreateInfo colorBlending {
+		.logicOpEnable = vk::False,
+		.attachmentCount = 1,
+		.pAttachments = &colorBlendAttachment
+	};
+
+	const vk::Format depthFormat = findDepthFormat(context);
+	vk::PipelineRenderingCreateInfo renderingInfo {
+		.colorAttachmentCount = 1,
+		.pColorAttachmentFormats = &context.swapChainSurfaceFormat.format,
+		.depthAttachmentFormat = depthFormat
+	};
+
+	vk::GraphicsPipelineCreateInfo pipelineInfo {
+		.pNext = &renderingInfo,
+		.stageCount = 2,
+		.pStages = shaderStages,
+		.pVertexInputState = &vertexInputInfo,
+		.pInputAssemblyState = &inputAssembly,
+		.pViewportState = &viewportState,
+		.pRasterizationState = &rasterizer,
+		.pMultisampleState = &multisampling,
+		.pDepthStencilState = &depthStencil,
+		.pColorBlendState = &colorBlending,
+		.pDynamicState = &dynamicState,
+		.layout = layout
+	};
+
+	auto [result, created] = context.device.createGraphicsPipeline(nullptr, pipelineInfo);
+	if (result != vk::Result::eSuccess) {
+		throw std::runtime_error("Failed to create surface mesh pipeline!");
+	}
+	pipeline = created;
+}
+
+void SurfaceMeshRenderer::createDescriptorSets(std::span<const vk::Buffer> vertexBuffers)
+{
+	const uint32_t setCount = MAX_FRAMES_IN_FLIGHT * bufferCount;
+
+	std::array<vk::DescriptorPoolSize, 2> poolSizes {
+		vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, setCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, setCount)
+	};
+	descriptorPool = context.device.createDescriptorPool({
+		.maxSets = setCount,
+		.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+		.pPoolSizes = poolSizes.data()
+	});
+
+	std::vector<vk::DescriptorSetLayout> layouts(setCount, setLayout);
+	descriptorSets = context.device.allocateDescriptorSets({
+		.descriptorPool = descriptorPool,
+		.descriptorSetCount = setCount,
+		.pSetLayouts = layouts.data()
+	});
+
+	for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+		for (uint32_t buffer = 0; buffer < bufferCount; buffer++) {
+			vk::DescriptorSet set = descriptorSets[frame * bufferCount + buffer];
+			vk::DescriptorBufferInfo cameraInfo { .buffer = context.uniformBuffers[frame], .offset = 0, .range = sizeof(UniformBufferObject) };
+			vk::DescriptorBufferInfo vertexInfo { .buffer = vertexBuffers[buffer], .offset = 0, .range = vk::WholeSize };
+
+			std::array<vk::WriteDescriptorSet, 2> descriptorWrites {
+				vk::WriteDescriptorSet {
+					.dstSet = set,
+					.dstBinding = 0,
+					.descriptorCount = 1,
+					.descriptorType = vk::DescriptorType::eUniformBuffer,
+					.pBufferInfo = &cameraInfo
+				},
+				vk::WriteDescriptorSet {
+					.dstSet = set,
+					.dstBinding = 1,
+					.descriptorCount = 1,
+					.descriptorType = vk::DescriptorType::eStorageBuffer,
+					.pBufferInfo = &vertexInfo
+				}
+			};
+			context.device.updateDescriptorSets(descriptorWrites, {});
+		}
+	}
+}
+
+void SurfaceMeshRenderer::bind(vk::CommandBuffer commandBuffer, uint32_t buffer)
+{
+	Constants constants { model, glm::vec4(glm::normalize(lightDirection), 0.f), glm::vec4(color, 1.f) };
+	vk::DescriptorSet set = descriptorSets[context.currentFrame * bufferCount + buffer % bufferCount];
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 0, 1, &set, 0, nullptr);
+	commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+		0, sizeof(Constants), &constants);
+}
+
+void SurfaceMeshRenderer::draw(vk::CommandBuffer commandBuffer, GpuMarchingCubes& surface, uint32_t slot)
+{
+	bind(commandBuffer, slot);
+	commandBuffer.drawIndirect(surface.getIndirectBuffer(slot).buffer, 0, 1, sizeof(vk::DrawIndirectCommand));
+}
+
+void SurfaceMeshRenderer::draw(vk::CommandBuffer commandBuffer, const StreamedMesh& mesh)
+{
+	const uint32_t frame = context.currentFrame;
+	const uint32_t indexCount = mesh.getIndexCount(frame);
+	if (indexCount == 0) return;
+
+	/* The index is the vertex index, which the shader pulls from the frame's storage buffer. */
+	bind(commandBuffer, frame);
+	commandBuffer.bindIndexBuffer(mesh.getIndexBuffer(frame), 0, vk::IndexType::eUint32);
+	commandBuffer.drawIndexed(indexCount, 1, 0, 0, 0);
+}
+
+/* === Check === */
+
+static double signedVolume(glm::vec3 a, glm::vec3 b, glm::vec3 c)
+{
+	return glm::dot(glm::dvec3(a), glm::cross(glm::dvec3(b), glm::dvec3(c))) / 6.0;
+}
+
+/* Reads back the triangle count and the vertices of slot, returns the enclosed volume. */
+static double downloadVolume(VkContext& context, GpuMarchingCubes& surface, uint32_t slot, size_t& triangles)
+{
+	uint32_t indirect[5] {};
+	downloadFromBuffer(context, surface.getIndirectBuffer(slot), indirect, sizeof(indirect));
+	triangles = indirect[4];
+
+	std::vector<SurfaceVertex> vertices(indirect[0]);
+	downloadFromBuffer(context, surface.getVertexBuffer(slot), vertices.data(), vertices.size() * sizeof(SurfaceVertex));
+
+	double volume = 0.0;
+	for (size_t v = 0; v + 2 < vertices.size(); v += 3)
+		volume += signedVolume(glm::vec3(vertices[v].position), glm::vec3(vertices[v + 1].position), glm::vec3(vertices[v + 2].position));
+	return volume;
+}
+
+GpuMarchingCubesCheckResult checkGpuMarchingCubes(VkContext& context, int resolution, uint32_t repeats)
+{
+	/* Same dam break block and splat as runMarchingCubesBenchmark(). */
+	MarchingCubesParams params;
+	params.resolution = glm::ivec3(std::max(resolution, 2));
+	params.cellSize = 1.f / params.resolution.x;
+	const float spacing = 2.f * params.cellSize;
+	const float radius = 2.f * spacing;
+	std::vector<Particle> particles = initParticles(glm::vec3(0.1f), glm::vec3(0.6f, 0.4f, 0.6f), spacing);
+
+	GpuMarchingCubesCheckResult result;
+	result.resolution = params.resolution.x;
+	result.particles = particles.size();
+	repeats = std::max(repeats, 1u);
+
+	/* Both extract the same quantized field. */
+	MarchingCubes cpu(params);
+	cpu.splatParticles(particles, radius, spacing);
+	std::vector<float>& field = cpu.getField();
+	std::vector<uint32_t> quantized(field.size());
+	for (size_t n = 0; n < field.size(); n++) {
+		quantized[n] = static_cast<uint32_t>(std::max(field[n], 0.f) * GpuMarchingCubes::FieldScale + 0.5f);
+		field[n] = static_cast<float>(quantized[n]) / GpuMarchingCubes::FieldScale;
+	}
+
+	auto cpuStart = std::chrono::steady_clock::now();
+	cpu.extract();
+	result.cpuExtractMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpuStart).count();
+
+	const SurfaceMesh& mesh = cpu.getMesh();
+	result.cpuTriangles = mesh.indices.size() / 3;
+	double cpuVolume = 0.0;
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		cpuVolume += signedVolume(mesh.positions[mesh.indices[i]], mesh.positions[mesh.indices[i + 1]], mesh.positions[mesh.indices[i + 2]]);
+
+	std::vector<glm::vec4> positions(particles.size());
+	for (size_t p = 0; p < particles.size(); p++)
+		positions[p] = glm::vec4(particles[p].position, 1.f);
+	DeviceBuffer positionBuffer = createDeviceBuffer(context, std::max<size_t>(positions.size(), 1) * sizeof(glm::vec4),
+		vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+	uploadToBuffer(context, positionBuffer, positions.data(), positions.size() * sizeof(glm::vec4));
+
+	{
+		const uint32_t maxTriangles = static_cast<uint32_t>(2 * result.cpuTriangles + 1024);
+		GpuMarchingCubes gpu(context, params, positionBuffer.buffer, maxTriangles);
+		const uint32_t count = static_cast<uint32_t>(particles.size());
+
+		auto run = [&](auto&& recordFn) {
+			vk::CommandBuffer commandBuffer = beginSingleTimeCommands(context);
+			recordFn(commandBuffer);
+			auto start = std::chrono::steady_clock::now();
+			endSingleTimeCommands(context, commandBuffer);
+			context.device.freeCommandBuffers(context.commandPool, commandBuffer);
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		};
+
+		uploadToBuffer(context, gpu.getFieldBuffer(), quantized.data(), quantized.size() * sizeof(uint32_t));
+		result.gpuExtractMs = run([&](vk::CommandBuffer commandBuffer) {
+			for (uint32_t r = 0; r < repeats; r++) gpu.recordExtract(commandBuffer, 0);
+		}) / repeats;
+		const double gpuVolume = downloadVolume(context, gpu, 0, result.gpuTriangles);
+
+		result.gpuSplatMs = run([&](vk::CommandBuffer commandBuffer) {
+			for (uint32_t r = 0; r < repeats; r++) {
+				gpu.recordSplat(commandBuffer, count, radius, spacing);
+				gpu.recordExtract(commandBuffer, 1);
+			}
+		}) / repeats;
+		size_t splatTriangles = 0;
+		const double splatVolume = downloadVolume(context, gpu, 1, splatTriangles);
+
+		result.volumeError = std::abs(gpuVolume - cpuVolume) / std::max(std::abs(cpuVolume), 1e-12);
+		result.splatVolumeError = std::abs(splatVolume - cpuVolume) / std::max(std::abs(cpuVolume), 1e-12);
+	}
+
+	destroyDeviceBuffer(context, positionBuffer);
+
+	result.passed = result.gpuTriangles == result.cpuTriangles && result.volumeError < 1e-4 && result.splatVolumeError < 1e-2;
+	return result;
+}
+
+void printGpuMarchingCubesCheck(const GpuMarchingCubesCheckResult& result, std::ostream& out)
+{
+	out << result.resolution << "^3 cells, " << result.particles << " particles\n"
+		<< "triangles CPU " << result.cpuTriangles << ", GPU " << result.gpuTriangles << '\n'
+		<< std::fixed << std::setprecision(3)
+		<< "CPU extract " << result.cpuExtractMs << " ms, GPU extract " << result.gpuExtractMs
+		<< " ms, GPU splat and extract " << result.gpuSplatMs << " ms\n"
+		<< std::scientific << std::setprecision(2)
+		<< "volume error " << result.volumeError << ", after GPU splat " << result.splatVolumeError << '\n'
+		<< (result.passed ? "PASSED" : "FAILED") << '\n'
+		<< std::defaultfloat;
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "vulkan/vk_particles.hpp"
+#include "vulkan/vk_pipeline.hpp"
+#include "vulkan/vk_image.hpp"
+#include "scene/uniforms.hpp"
+#include "FileIO.hpp"
+
+ParticleRenderer::ParticleRenderer(VkContext& context, std::span<const vk::Buffer> instanceBuffers)
+	: context(context), bufferCount(static_cast<uint32_t>(instanceBuffers.size()))
+{
+	std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {
+		vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1,
+			vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, nullptr),
+		vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr)
+	};
+	setLayout = context.device.createDescriptorSetLayout({
+		.bindingCount = static_cast<uint32_t>(bindings.size()),
+		.pBindings = bindings.data()
+	});
+
+	vk::PushConstantRange pushConstantRange {
+		.stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+		.offset = 0,
+		.size = sizeof(Constants)
+	};
+	layout = context.device.createPipelineLayout({
+		.setLayoutCount = 1,
+		.pSetLayouts = &setLayout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &pushConstantRange
+	});
+
+	shaderModule = createShaderModule(context, readFile("./../shaders/particles.spv"));
+	pipeline = createPipeline("fragMain", context.swapChainSurfaceFormat.format, findDepthFormat(context), false);
+
+	createDescriptorSets(instanceBuffers);
+}
+
+ParticleRenderer::~ParticleRenderer()
+{
+	context.device.destroyDescriptorPool(descriptorPool);
+	context.device.destroyPipeline(pipeline);
+	context.device.destroyPipelineLayout(layout);
+	context.device.destroyDescriptorSetLayout(setLayout);
+	context.device.destroyShaderModule(shaderModule);
+}
+
+vk::Pipeline ParticleRenderer::createPipeline(const char* fragmentEntry, vk::Format colorFormat, vk::Format depthFormat, bool additive)
+{
+	vk::PipelineShaderStageCreateInfo shaderStages[] = {
+		{ .stage = vk::ShaderStageFlagBits::eVertex, .module = shaderModule, .pName = "vertMain" },
+		{ .stage = vk::ShaderStageFlagBits::eFragment, .module = shaderModule, .pName = fragmentEntry }
+	};
+
+	const vk::DynamicState dynamicStates[] = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+	vk::PipelineDynamicStateCreateInfo dynamicState {
+		.dynamicStateCount = 2,
+		.pDynamicStates = dynamicStates
+	};
+
+	/* Corners come from the vertex index, instances from the storage buffer. */
+	vk::PipelineVertexInputStateCreateInfo vertexInputInfo {};
+	vk::PipelineInputAssemblyStateCreateInfo inputAssembly {
+		.topology = vk::PrimitiveTopology::eTriangleStrip
+	};
+
+	vk::PipelineViewportStateCreateInfo viewportState {
+		.viewportCount = 1,
+		.scissorCount = 1
+	};
+
+	vk::PipelineRasterizationStateCreateInfo rasterizer {
+		.depthClampEnable = vk::False,
+		.rasterizerDiscardEnable = vk::False,
+		.polygonMode = vk::PolygonMode::eFill,
+		.cullMode = vk::CullModeFlagBits::eNone,
+		.frontFace = vk::FrontFace::eCounterClockwise,
+		.depthBiasEnable = vk::False,
+		.lineWidth = 1.0f
+	};
+
+	vk::PipelineMultisampleStateCreateInfo multisampling {
+		.rasterizationSamples = vk::SampleCountFlagBits::e1,
+		.sampleShadingEnable = vk::False
+	};
+
+	const bool depth = depthFormat != vk::Format::eUndefined;
+	vk::PipelineDepthStencilStateCreateInfo depthStencil {
+		.depthTestEnable = depth,
+		.depthWriteEnable = depth,
+		.depthCompareOp = vk::CompareOp::eLess,
+		.depthBoundsTestEnable = vk::False,
+		.stencilTestEnable = vk::False
+	};
+
+	vk::PipelineColorBlendAttachmentState colorBlendAttachment {
+		.blendEnable = additive,
+		.srcColorBlendFactor = vk::BlendFactor::eOne,
+		.dstColorBlendFactor = vk::BlendFactor::eOne,
+		.colorBlendOp = vk::BlendOp::eAdd,
+		.srcAlphaBlendFactor = vk::BlendFactor::eOne,
+		.dstAlphaBlendFactor = vk::BlendFactor::eOne,
+		.alphaBlendOp = vk::BlendOp::eAdd,
+		.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG
+			| vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+	};
+	vk::PipelineColorBlendStateCreateInfo colorBlending {
+		.logicOpEnable = vk::False,
+		.attachmentCount = 1,
+		.pAttachments = &colorBlendAttachment
+	};
+
+	vk::PipelineRenderingCreateInfo renderingInfo {
+		.colorAttachmentCount = 1,
+		.pColorAttachmentFormats = &colorFormat,
+		.depthAttachmentFormat = depthFormat
+	};
+
+	vk::GraphicsPipelineCreateInfo pipelineInfo {
+		.pNext = &renderingInfo,
+		.stageCount = 2,
+		.pStages = shaderStages,
+		.pVertexInputState = &vertexInputInfo,
+		.pInputAssemblyState = &inputAssembly,
+		.pViewportState = &viewportState,
+		.pRasterizationState = &rasterizer,
+		.pMultisampleState = &multisampling,
+		.pDepthStencilState = &depthStencil,
+		.pColorBlendState = &colorBlending,
+		.pDynamicState = &dynamicState,
+		.layout = layout
+	};
+
+	auto [result, created] = context.device.createGraphicsPipeline(nullptr, pipelineInfo);
+	if (result != vk::Result::eSuccess) {
+		throw std::runtime_error(std::string("Failed to create particle pipeline ") + fragmentEntry + "!");
+	}
+	return created;
+}
+
+void ParticleRenderer::createDescriptorSets(std::span<const vk::Buffer> instanceBuffers)
+{
+	const uint32_t setCount = MAX_FRAMES_IN_FLIGHT * bufferCount;
+
+	std::array<vk::DescriptorPoolSize, 2> poolSizes {
+		vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, setCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, setCount)
+	};
+	descriptorPool = context.device.createDescriptorPool({
+		.maxSets = setCount,
+		.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+		.pPoolSizes = poolSizes.data()
+	});
+
+	std::vector<vk::DescriptorSetLayout> layouts(setCount, setLayout);
+	descriptorSets = context.device.allocateDescriptorSets({
+		.descriptorPool = descriptorPool,
+		.descriptorSetCount = setCount,
+		.pSetLayouts = layouts.data()
+	});
+
+	for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+		for (uint32_t buffer = 0; buffer < bufferCount; buffer++) {
+			vk::DescriptorSet set = descriptorSets[frame * bufferCount + buffer];
+			vk::DescriptorBufferInfo cameraInfo { .buffer = context.uniformBuffers[frame], .offset = 0, .range = sizeof(UniformBufferObject) };
+			vk::DescriptorBufferInfo instanceInfo { .buffer = instanceBuffers[buffer], .offset = 0, .range = vk::WholeSize };
+
+			std::array<vk::WriteDescriptorSet, 2> descriptorWrites {
+				vk::WriteDescriptorSet {
+					.dstSet = set,
+					.dstBinding = 0,
+					.descriptorCount = 1,
+					.descriptorType = vk::DescriptorType::eUniformBuffer,
+					.pBufferInfo = &cameraInfo
+				},
+				vk::WriteDescriptorSet {
+					.dstSet = set,
+					.dstBinding = 1,
+					.descriptorCount = 1,
+					.descriptorType = vk::DescriptorType::eStorageBuffer,
+					.pBufferInfo = &instanceInfo
+				}
+			};
+			context.device.updateDescriptorSets(descriptorWrites, {});
+		}
+	}
+}
+
+void ParticleRenderer::draw(vk::CommandBuffer commandBuffer, uint32_t bufferIndex, uint32_t count, vk::Pipeline variant)
+{
+	if (count == 0) return;
+
+	Constants constants { model, glm::vec4(glm::normalize(lightDirection), 0.f) };
+	vk::DescriptorSet set = descriptorSets[context.currentFrame * bufferCount + bufferIndex % bufferCount];
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, variant ? variant : pipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 0, 1, &set, 0, nullptr);
+	commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+		0, sizeof(Constants), &constants);
+	commandBuffer.draw(4, count, 0, 0);
+}
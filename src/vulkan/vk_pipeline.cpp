@@ -10,6 +10,7 @@
 #include "vulkan/vk_pipeline.hpp"
 #include "vulkan/vk_vertex.hpp"
 #include "vulkan/vk_image.hpp"
+#include "vulkan/vk_descriptor.hpp"
 #include "FileIO.hpp"
 
 static std::vector<vk::DynamicState> dynamicStates = {
@@ -145,3 +146,86 @@ void createGraphicsPipeline(VkContext& context)
 	context.graphicsPipeline = pipeline;
 }
 
+vk::PipelineLayout createComputePipelineLayout(VkContext& context,
+		vk::DescriptorSetLayout setLayout,
+		uint32_t pushConstantSize)
+{
+	vk::PushConstantRange pushConstantRange {
+		.stageFlags = vk::ShaderStageFlagBits::eCompute,
+		.offset = 0,
+		.size = pushConstantSize
+	};
+
+	vk::PipelineLayoutCreateInfo pipelineLayoutInfo {
+		.setLayoutCount = 1,
+		.pSetLayouts = &setLayout,
+		.pushConstantRangeCount = pushConstantSize > 0 ? 1u : 0u,
+		.pPushConstantRanges = &pushConstantRange
+	};
+
+	return context.device.createPipelineLayout(pipelineLayoutInfo);
+}
+
+vk::Pipeline createComputePipeline(VkContext& context,
+		vk::ShaderModule module,
+		const char* entryPoint,
+		vk::PipelineLayout layout)
+{
+	vk::ComputePipelineCreateInfo pipelineInfo {
+		.stage = {
+			.stage = vk::ShaderStageFlagBits::eCompute,
+			.module = module,
+			.pName = entryPoint
+		},
+		.layout = layout
+	};
+
+	auto [result, pipeline] = context.device.createComputePipeline(nullptr, pipelineInfo);
+
+	if (result != vk::Result::eSuccess) {
+		throw std::runtime_error(std::string("Failed to create compute pipeline ") + entryPoint + "!");
+	}
+	return pipeline;
+}
+
+ComputeKernels createComputeKernels(VkContext& context,
+		const std::filesystem::path& spirvPath,
+		std::span<const char* const> entryPoints,
+		uint32_t storageBufferCount,
+		uint32_t pushConstantSize)
+{
+	ComputeKernels kernels;
+	kernels.module = createShaderModule(context, readFile(spirvPath));
+	kernels.setLayout = createStorageBufferSetLayout(context, storageBufferCount);
+	kernels.layout = createComputePipelineLayout(context, kernels.setLayout, pushConstantSize);
+	for (const char* entryPoint : entryPoints)
+		kernels.pipelines.push_back(createComputePipeline(context, kernels.module, entryPoint, kernels.layout));
+	return kernels;
+}
+
+void destroyComputeKernels(VkContext& context, ComputeKernels& kernels)
+{
+	for (vk::Pipeline pipeline : kernels.pipelines)
+		context.device.destroyPipeline(pipeline);
+	if (kernels.layout) context.device.destroyPipelineLayout(kernels.layout);
+	if (kernels.setLayout) context.device.destroyDescriptorSetLayout(kernels.setLayout);
+	if (kernels.module) context.device.destroyShaderModule(kernels.module);
+	kernels = {};
+}
+
+void computeBarrier(vk::CommandBuffer commandBuffer)
+{
+	vk::MemoryBarrier2 barrier {
+		.srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+		.srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+		.dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+		.dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite
+	};
+
+	vk::DependencyInfo dependencyInfo {
+		.memoryBarrierCount = 1,
+		.pMemoryBarriers = &barrier
+	};
+
+	commandBuffer.pipelineBarrier2(dependencyInfo);
+}
@@ -0,0 +1,431 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "vulkan/vk_screen_fluid.hpp"
+#include "vulkan/vk_pipeline.hpp"
+#include "vulkan/vk_image.hpp"
+#include "vulkan/vk_buffer.hpp"
+#include "vulkan/vk_command.hpp"
+#include "scene/uniforms.hpp"
+#include "FileIO.hpp"
+
+static constexpr vk::Format DepthFormat = vk::Format::eR32Sfloat;
+static constexpr vk::Format ThicknessFormat = vk::Format::eR16Sfloat;
+static constexpr uint32_t FilterGroupSize = 16;
+
+static void memoryBarrier(vk::CommandBuffer commandBuffer,
+		vk::PipelineStageFlags2 srcStage, vk::AccessFlags2 srcAccess,
+		vk::PipelineStageFlags2 dstStage, vk::AccessFlags2 dstAccess)
+{
+	vk::MemoryBarrier2 barrier {
+		.srcStageMask = srcStage,
+		.srcAccessMask = srcAccess,
+		.dstStageMask = dstStage,
+		.dstAccessMask = dstAccess
+	};
+	commandBuffer.pipelineBarrier2(vk::DependencyInfo { .memoryBarrierCount = 1, .pMemoryBarriers = &barrier });
+}
+
+ScreenSpaceFluid::ScreenSpaceFluid(VkContext& context, ParticleRenderer& particles)
+	: context(context), particles(particles)
+{
+	depthAttachmentFormat = findDepthFormat(context);
+	depthPipeline = particles.createPipeline("fragDepth", DepthFormat, depthAttachmentFormat, false);
+	thicknessPipeline = particles.createPipeline("fragThickness", ThicknessFormat, vk::Format::eUndefined, true);
+
+	std::array<vk::DescriptorPoolSize, 3> poolSizes {
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, 4),
+		vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, 2 * MAX_FRAMES_IN_FLIGHT),
+		vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, MAX_FRAMES_IN_FLIGHT)
+	};
+	descriptorPool = context.device.createDescriptorPool({
+		.maxSets = 2 + MAX_FRAMES_IN_FLIGHT,
+		.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+		.pPoolSizes = poolSizes.data()
+	});
+
+	createFilter();
+	createComposite();
+	resize();
+}
+
+ScreenSpaceFluid::~ScreenSpaceFluid()
+{
+	destroyImages();
+	context.device.destroyDescriptorPool(descriptorPool);
+
+	context.device.destroyPipeline(compositePipeline);
+	context.device.destroyPipelineLayout(compositeLayout);
+	context.device.destroyDescriptorSetLayout(compositeSetLayout);
+	context.device.destroyShaderModule(compositeModule);
+
+	context.device.destroyPipeline(filterPipeline);
+	context.device.destroyPipelineLayout(filterLayout);
+	context.device.destroyDescriptorSetLayout(filterSetLayout);
+	context.device.destroyShaderModule(filterModule);
+
+	context.device.destroyPipeline(thicknessPipeline);
+	context.device.destroyPipeline(depthPipeline);
+}
+
+ScreenSpaceFluid::ScreenImage ScreenSpaceFluid::createScreenImage(vk::Format format, vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect)
+{
+	ScreenImage result;
+	createImage(context, context.swapChainExtent.width, context.swapChainExtent.height, format,
+		vk::ImageTiling::eOptimal, usage, vk::MemoryPropertyFlagBits::eDeviceLocal, result.image, result.memory);
+	result.view = createImageView(context, result.image, format, aspect);
+	return result;
+}
+
+void ScreenSpaceFluid::destroyImages()
+{
+	for (ScreenImage* image : { &depth[0], &depth[1], &thickness, &depthAttachment }) {
+		if (image->view) context.device.destroyImageView(image->view);
+		if (image->image) context.device.destroyImage(image->image);
+		if (image->memory) context.device.freeMemory(image->memory);
+		*image = {};
+	}
+}
+
+void ScreenSpaceFluid::resize()
+{
+	destroyImages();
+
+	depth[0] = createScreenImage(DepthFormat,
+		vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+		vk::ImageAspectFlagBits::eColor);
+	depth[1] = createScreenImage(DepthFormat, vk::ImageUsageFlagBits::eStorage, vk::ImageAspectFlagBits::eColor);
+	thickness = createScreenImage(ThicknessFormat,
+		vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled,
+		vk::ImageAspectFlagBits::eColor);
+	depthAttachment = createScreenImage(depthAttachmentFormat,
+		vk::ImageUsageFlagBits::eDepthStencilAttachment, vk::ImageAspectFlagBits::eDepth);
+
+	/* The color images stay in the general layout, they are attachments, storage and sampled in turn. */
+	std::vector<vk::ImageMemoryBarrier2> barriers;
+	for (vk::Image image : { depth[0].image, depth[1].image, thickness.image }) {
+		barriers.push_back({
+			.srcStageMask = vk::PipelineStageFlagBits2::eNone,
+			.dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+			.dstAccessMask = vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite,
+			.oldLayout = vk::ImageLayout::eUndefined,
+			.newLayout = vk::ImageLayout::eGeneral,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = image,
+			.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 }
+		});
+	}
+	barriers.push_back({
+		.srcStageMask = vk::PipelineStageFlagBits2::eNone,
+		.dstStageMask = vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
+		.dstAccessMask = vk::AccessFlagBits2::eDepthStencilAttachmentRead | vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+		.oldLayout = vk::ImageLayout::eUndefined,
+		.newLayout = vk::ImageLayout::eDepthAttachmentOptimal,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = depthAttachment.image,
+		.subresourceRange = { vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1 }
+	});
+
+	vk::CommandBuffer commandBuffer = beginSingleTimeCommands(context);
+	commandBuffer.pipelineBarrier2(vk::DependencyInfo {
+		.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size()),
+		.pImageMemoryBarriers = barriers.data()
+	});
+	endSingleTimeCommands(context, commandBuffer);
+	context.device.freeCommandBuffers(context.commandPool, commandBuffer);
+
+	writeDescriptorSets();
+}
+
+void ScreenSpaceFluid::createFilter()
+{
+	std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {
+		vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+		vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute, nullptr)
+	};
+	filterSetLayout = context.device.createDescriptorSetLayout({
+		.bindingCount = static_cast<uint32_t>(bindings.size()),
+		.pBindings = bindings.data()
+	});
+	filterLayout = createComputePipelineLayout(context, filterSetLayout, sizeof(FilterConstants));
+	filterModule = createShaderModule(context, readFile("./../shaders/fluid_filter.spv"));
+	filterPipeline = createComputePipeline(context, filterModule, "bilateralFilter", filterLayout);
+
+	std::array<vk::DescriptorSetLayout, 2> layouts { filterSetLayout, filterSetLayout };
+	std::vector<vk::DescriptorSet> sets = context.device.allocateDescriptorSets({
+		.descriptorPool = descriptorPool,
+		.descriptorSetCount = static_cast<uint32_t>(layouts.size()),
+		.pSetLayouts = layouts.data()
+	});
+	std::ranges::copy(sets, filterSets.begin());
+}
+
+void ScreenSpaceFluid::createComposite()
+{
+	std::array<vk::DescriptorSetLayoutBinding, 3> bindings = {
+		vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eFragment, nullptr),
+		vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eSampledImage, 1, vk::ShaderStageFlagBits::eFragment, nullptr),
+		vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eSampledImage, 1, vk::ShaderStageFlagBits::eFragment, nullptr)
+	};
+	compositeSetLayout = context.device.createDescriptorSetLayout({
+		.bindingCount = static_cast<uint32_t>(bindings.size()),
+		.pBindings = bindings.data()
+	});
+
+	vk::PushConstantRange pushConstantRange {
+		.stageFlags = vk::ShaderStageFlagBits::eFragment,
+		.offset = 0,
+		.size = sizeof(CompositeConstants)
+	};
+	compositeLayout = context.device.createPipelineLayout({
+		.setLayoutCount = 1,
+		.pSetLayouts = &compositeSetLayout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &pushConstantRange
+	});
+
+	compositeModule = createShaderModule(context, readFile("./../shaders/fluid_composite.spv"));
+
+	vk::PipelineShaderStageCreateInfo shaderStages[] = {
+		{ .stage = vk::ShaderStageFlagBits::eVertex, .module = compositeModule, .pName = "vertMain" },
+		{ .stage = vk::ShaderStageFlagBits::eFragment, .module = compositeModule, .pName = "fragMain" }
+	};
+
+	const vk::DynamicState dynamicStates[] = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+	vk::PipelineDynamicStateCreateInfo dynamicState {
+		.dynamicStateCount = 2,
+		.pDynamicStates = dynamicStates
+	};
+
+	vk::PipelineVertexInputStateCreateInfo vertexInputInfo {};
+	vk::PipelineInputAssemblyStateCreateInfo inputAssembly {
+		.topology = vk::PrimitiveTopology::eTriangleList
+	};
+	vk::PipelineViewportStateCreateInfo viewportState {
+		.viewportCount = 1,
+		.scissorCount = 1
+	};
+	vk::PipelineRasterizationStateCreateInfo rasterizer {
+		.polygonMode = vk::PolygonMode::eFill,
+		.cullMode = vk::CullModeFlagBits::eNone,
+		.frontFace = vk::FrontFace::eCounterClockwise,
+		.lineWidth = 1.0f
+	};
+	vk::PipelineMultisampleStateCreateInfo multisampling {
+		.rasterizationSamples = vk::SampleCountFlagBits::e1
+	};
+	vk::PipelineDepthStencilStateCreateInfo depthStencil {
+		.depthTestEnable = vk::True,
+		.depthWriteEnable = vk::True,
+		.depthCompareOp = vk::CompareOp::eLess
+	};
+
+	/* Thin fluid lets the scene behind it show through. */
+	vk::PipelineColorBlendAttachmentState colorBlendAttachment {
+		.blendEnable = vk::True,
+		.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha,
+		.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+		.colorBlendOp = vk::BlendOp::eAdd,
+		.srcAlphaBlendFactor = vk::BlendFactor::eOne,
+		.dstAlphaBlendFactor = vk::BlendFactor::eZero,
+		.alphaBlendOp = vk::BlendOp::eAdd,
+		.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG
+			| vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+	};
+	vk::PipelineColorBlendStateCreateInfo colorBlending {
+		.logicOpEnable = vk::False,
+		.attachmentCount = 1,
+		.pAttachments = &colorBlendAttachment
+	};
+
+	vk::PipelineRenderingCreateInfo renderingInfo {
+		.colorAttachmentCount = 1,
+		.pColorAttachmentFormats = &context.swapChainSurfaceFormat.format,
+		.depthAttachmentFormat = depthAttachmentFormat
+	};
+
+	vk::GraphicsPipelineCreateInfo pipelineInfo {
+		.pNext = &renderingInfo,
+		.stageCount = 2,
+		.pStages = shaderStages,
+		.pVertexInputState = &vertexInputInfo,
+		.pInputAssemblyState = &inputAssembly,
+		.pViewportState = &viewportState,
+		.pRasterizationState = &rasterizer,
+		.pMultisampleState = &multisampling,
+		.pDepthStencilState = &depthStencil,
+		.pColorBlendState = &colorBlending,
+		.pDynamicState = &dynamicState,
+		.layout = compositeLayout
+	};
+
+	auto [result, pipeline] = context.device.createGraphicsPipeline(nullptr, pipelineInfo);
+	if (result != vk::Result::eSuccess) {
+		throw std::runtime_error("Failed to create fluid composite pipeline!");
+	}
+	compositePipeline = pipeline;
+
+	std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, compositeSetLayout);
+	std::vector<vk::DescriptorSet> sets = context.device.allocateDescriptorSets({
+		.descriptorPool = descriptorPool,
+		.descriptorSetCount = MAX_FRAMES_IN_FLIGHT,
+		.pSetLayouts = layouts.data()
+	});
+	std::ranges::copy(sets, compositeSets.begin());
+}
+
+void ScreenSpaceFluid::writeDescriptorSets()
+{
+	std::vector<vk::WriteDescriptorSet> writes;
+	std::vector<vk::DescriptorImageInfo> imageInfos;
+	std::vector<vk::DescriptorBufferInfo> bufferInfos;
+	imageInfos.reserve(4 + 2 * MAX_FRAMES_IN_FLIGHT);
+	bufferInfos.reserve(MAX_FRAMES_IN_FLIGHT);
+
+	auto writeImage = [&](vk::DescriptorSet set, uint32_t binding, vk::DescriptorType type, vk::ImageView view) {
+		imageInfos.push_back({ .imageView = view, .imageLayout = vk::ImageLayout::eGeneral });
+		writes.push_back({
+			.dstSet = set,
+			.dstBinding = binding,
+			.descriptorCount = 1,
+			.descriptorType = type,
+			.pImageInfo = &imageInfos.back()
+		});
+	};
+
+	for (uint32_t pass = 0; pass < 2; pass++) {
+		writeImage(filterSets[pass], 0, vk::DescriptorType::eStorageImage, depth[pass].view);
+		writeImage(filterSets[pass], 1, vk::DescriptorType::eStorageImage, depth[1 - pass].view);
+	}
+
+	for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+		bufferInfos.push_back({ .buffer = context.uniformBuffers[frame], .offset = 0, .range = sizeof(UniformBufferObject) });
+		writes.push_back({
+			.dstSet = compositeSets[frame],
+			.dstBinding = 0,
+			.descriptorCount = 1,
+			.descriptorType = vk::DescriptorType::eUniformBuffer,
+			.pBufferInfo = &bufferInfos.back()
+		});
+		writeImage(compositeSets[frame], 1, vk::DescriptorType::eSampledImage, depth[0].view);
+		writeImage(compositeSets[frame], 2, vk::DescriptorType::eSampledImage, thickness.view);
+	}
+
+	context.device.updateDescriptorSets(writes, {});
+}
+
+void ScreenSpaceFluid::filter(vk::CommandBuffer commandBuffer, uint32_t pass)
+{
+	const vk::Extent2D extent = context.swapChainExtent;
+	const float pixelsPerUnit = 0.5f * extent.height / std::tan(0.5f * fieldOfView);
+
+	FilterConstants constants {
+		pass == 0 ? glm::ivec2(1, 0) : glm::ivec2(0, 1),
+		glm::ivec2(extent.width, extent.height),
+		filterRadius * pixelsPerUnit,
+		depthFalloff,
+		maxFilterRadius
+	};
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, filterPipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, filterLayout, 0, 1, &filterSets[pass], 0, nullptr);
+	commandBuffer.pushConstants(filterLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+	commandBuffer.dispatch(
+		(extent.width + FilterGroupSize - 1) / FilterGroupSize,
+		(extent.height + FilterGroupSize - 1) / FilterGroupSize,
+		1);
+}
+
+void ScreenSpaceFluid::recordOffscreen(vk::CommandBuffer commandBuffer, uint32_t bufferIndex, uint32_t count)
+{
+	const vk::Extent2D extent = context.swapChainExtent;
+
+	/* The previous frame's filter and composite are done with the images. */
+	memoryBarrier(commandBuffer,
+		vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eFragmentShader
+			| vk::PipelineStageFlagBits2::eLateFragmentTests,
+		vk::AccessFlagBits2::eShaderStorageWrite | vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+		vk::PipelineStageFlagBits2::eColorAttachmentOutput | vk::PipelineStageFlagBits2::eEarlyFragmentTests
+			| vk::PipelineStageFlagBits2::eComputeShader,
+		vk::AccessFlagBits2::eColorAttachmentWrite | vk::AccessFlagBits2::eDepthStencilAttachmentWrite
+			| vk::AccessFlagBits2::eShaderStorageWrite);
+
+	vk::RenderingAttachmentInfo depthColor {
+		.imageView = depth[0].view,
+		.imageLayout = vk::ImageLayout::eGeneral,
+		.loadOp = vk::AttachmentLoadOp::eClear,
+		.storeOp = vk::AttachmentStoreOp::eStore,
+		.clearValue = vk::ClearColorValue(0.0f, 0.0f, 0.0f, 0.0f)
+	};
+	vk::RenderingAttachmentInfo depthDepth {
+		.imageView = depthAttachment.view,
+		.imageLayout = vk::ImageLayout::eDepthAttachmentOptimal,
+		.loadOp = vk::AttachmentLoadOp::eClear,
+		.storeOp = vk::AttachmentStoreOp::eDontCare,
+		.clearValue = vk::ClearDepthStencilValue(1.0f, 0)
+	};
+	vk::RenderingAttachmentInfo thicknessColor {
+		.imageView = thickness.view,
+		.imageLayout = vk::ImageLayout::eGeneral,
+		.loadOp = vk::AttachmentLoadOp::eClear,
+		.storeOp = vk::AttachmentStoreOp::eStore,
+		.clearValue = vk::ClearColorValue(0.0f, 0.0f, 0.0f, 0.0f)
+	};
+
+	commandBuffer.beginRendering({
+		.renderArea = { .offset = { 0, 0 }, .extent = extent },
+		.layerCount = 1,
+		.colorAttachmentCount = 1,
+		.pColorAttachments = &depthColor,
+		.pDepthAttachment = &depthDepth
+	});
+	commandBuffer.setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f));
+	commandBuffer.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), extent));
+	particles.draw(commandBuffer, bufferIndex, count, depthPipeline);
+	commandBuffer.endRendering();
+
+	commandBuffer.beginRendering({
+		.renderArea = { .offset = { 0, 0 }, .extent = extent },
+		.layerCount = 1,
+		.colorAttachmentCount = 1,
+		.pColorAttachments = &thicknessColor
+	});
+	particles.draw(commandBuffer, bufferIndex, count, thicknessPipeline);
+	commandBuffer.endRendering();
+
+	memoryBarrier(commandBuffer,
+		vk::PipelineStageFlagBits2::eColorAttachmentOutput, vk::AccessFlagBits2::eColorAttachmentWrite,
+		vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eFragmentShader,
+		vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderSampledRead);
+
+	filter(commandBuffer, 0);
+	computeBarrier(commandBuffer);
+	filter(commandBuffer, 1);
+
+	memoryBarrier(commandBuffer,
+		vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderStorageWrite,
+		vk::PipelineStageFlagBits2::eFragmentShader, vk::AccessFlagBits2::eShaderSampledRead);
+}
+
+void ScreenSpaceFluid::drawComposite(vk::CommandBuffer commandBuffer)
+{
+	CompositeConstants constants {
+		glm::vec4(glm::normalize(particles.lightDirection), 0.f),
+		glm::vec4(absorption, 0.f),
+		glm::vec4(skyColor, 0.f)
+	};
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, compositePipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, compositeLayout, 0, 1,
+		&compositeSets[context.currentFrame], 0, nullptr);
+	commandBuffer.pushConstants(compositeLayout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(constants), &constants);
+	commandBuffer.draw(3, 1, 0, 0);
+}
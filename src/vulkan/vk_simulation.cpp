@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "vulkan/vk_simulation.hpp"
+#include "vulkan/vk_descriptor.hpp"
+#include "fluid/parallel.hpp"
+
+#include <algorithm>
+
+static vk::Semaphore createTimelineSemaphore(VkContext& context)
+{
+	vk::SemaphoreTypeCreateInfo typeInfo {
+		.semaphoreType = vk::SemaphoreType::eTimeline,
+		.initialValue = 0
+	};
+	return context.device.createSemaphore(vk::SemaphoreCreateInfo { .pNext = &typeInfo });
+}
+
+static const char* const instanceKernelNames[] = { "writeInstances" };
+
+struct InstanceConstants {
+	uint32_t count;
+	float radius;
+	float maxSpeed;
+};
+
+AsyncSimulation::AsyncSimulation(VkContext& context, const SphParams& params, std::span<const Particle> particles)
+	: context(context)
+{
+	solver = std::make_unique<GpuSphSolver>(context, params);
+	solver->setParticles(particles);
+	particleRadius = 0.5f * params.particleSpacing;
+
+	instanceKernel = createComputeKernels(context, "./../shaders/particle_instances.spv", instanceKernelNames, 3, sizeof(InstanceConstants));
+	descriptorPool = createStorageBufferPool(context, 2, 6);
+
+	const vk::DeviceSize size = std::max<vk::DeviceSize>(particles.size(), 1) * sizeof(ParticleInstance);
+	for (size_t slot = 0; slot < instances.size(); slot++) {
+		instances[slot] = createDeviceBuffer(context, size, vk::BufferUsageFlagBits::eStorageBuffer);
+		descriptorSets[slot] = allocateDescriptorSet(context, descriptorPool, instanceKernel.setLayout);
+		writeStorageBufferSet(context, descriptorSets[slot],
+			{ solver->getPositionBuffer(), solver->getVelocityBuffer(), instances[slot].buffer });
+	}
+
+	vk::CommandBufferAllocateInfo commandInfo {
+		.commandPool = context.computeCommandPool,
+		.level = vk::CommandBufferLevel::ePrimary,
+		.commandBufferCount = static_cast<uint32_t>(commandBuffers.size())
+	};
+	std::vector<vk::CommandBuffer> allocated = context.device.allocateCommandBuffers(commandInfo);
+	std::ranges::copy(allocated, commandBuffers.begin());
+
+	simulationTimeline = createTimelineSemaphore(context);
+	renderTimeline = createTimelineSemaphore(context);
+
+	submitStep(1);
+}
+
+AsyncSimulation::~AsyncSimulation()
+{
+	context.device.waitIdle();
+
+	context.device.destroySemaphore(simulationTimeline);
+	context.device.destroySemaphore(renderTimeline);
+	context.device.freeCommandBuffers(context.computeCommandPool, commandBuffers);
+	context.device.destroyDescriptorPool(descriptorPool);
+	destroyComputeKernels(context, instanceKernel);
+	for (DeviceBuffer& buffer : instances)
+		destroyDeviceBuffer(context, buffer);
+	surface.reset();
+	solver.reset();
+}
+
+void AsyncSimulation::enableSurface(const MarchingCubesParams& params, uint32_t maxTriangles)
+{
+	surface = std::make_unique<GpuMarchingCubes>(context, params, solver->getPositionBuffer(), maxTriangles);
+}
+
+void AsyncSimulation::waitTimeline(vk::Semaphore semaphore, uint64_t value)
+{
+	vk::SemaphoreWaitInfo waitInfo {
+		.semaphoreCount = 1,
+		.pSemaphores = &semaphore,
+		.pValues = &value
+	};
+	if (context.device.waitSemaphores(waitInfo, UINT64_MAX) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to wait for the simulation timeline!");
+}
+
+void AsyncSimulation::submitStep(uint64_t step)
+{
+	/* Step - 2 used the same command buffer and render buffer. */
+	const uint64_t previousUse = std::max<uint64_t>(step, 2) - 2;
+	vk::CommandBuffer commandBuffer = commandBuffers[step % 2];
+	vk::DescriptorSet descriptorSet = descriptorSets[step % 2];
+
+	waitTimeline(simulationTimeline, previousUse);
+
+	commandBuffer.reset();
+	commandBuffer.begin(vk::CommandBufferBeginInfo { .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+
+	/* The instances of the previous step are still written from the solver state. */
+	computeBarrier(commandBuffer);
+	solver->record(commandBuffer);
+
+	const uint32_t count = solver->getParticleCount();
+	if (count > 0) {
+		InstanceConstants constants { count, particleRadius, 2.f };
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, instanceKernel.layout, 0, 1, &descriptorSet, 0, nullptr);
+		commandBuffer.pushConstants(instanceKernel.layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, instanceKernel.pipelines[0]);
+		commandBuffer.dispatch((count + 255) / 256, 1, 1);
+	}
+	if (surface) {
+		const SphParams& params = solver->getParams();
+		surface->recordSplat(commandBuffer, count, params.smoothingRadius, params.particleSpacing);
+		surface->recordExtract(commandBuffer, getInstanceSlot(step));
+	}
+	commandBuffer.end();
+
+	/*
+	 * Frame step - 2 may still draw this slot. Only writeInstances and the
+	 * surface extraction touch it, but the wait stage covers the whole step,
+	 * waiting later would need a second submission.
+	 */
+	vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eComputeShader;
+	vk::TimelineSemaphoreSubmitInfo timelineInfo {
+		.waitSemaphoreValueCount = 1,
+		.pWaitSemaphoreValues = &previousUse,
+		.signalSemaphoreValueCount = 1,
+		.pSignalSemaphoreValues = &step
+	};
+	vk::SubmitInfo submitInfo {
+		.pNext = &timelineInfo,
+		.waitSemaphoreCount = 1,
+		.pWaitSemaphores = &renderTimeline,
+		.pWaitDstStageMask = &waitStage,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &commandBuffer,
+		.signalSemaphoreCount = 1,
+		.pSignalSemaphores = &simulationTimeline
+	};
+	context.computeQueue.submit(submitInfo, nullptr);
+}
+
+/* === StreamedSimulation === */
+
+StreamedSimulation::StreamedSimulation(VkContext& context, const SphParams& params, std::span<const Particle> particles)
+	: context(context),
+	  solver(params),
+	  particleRadius(0.5f * params.particleSpacing),
+	  ring(context, std::max<size_t>(particles.size(), 1) * sizeof(ParticleInstance)),
+	  delta(BlockParticles * sizeof(ParticleInstance))
+{
+	solver.addParticles(std::vector<Particle>(particles.begin(), particles.end()));
+
+	for (DeviceBuffer& buffer : instances) {
+		buffer = createDeviceBuffer(context, ring.getBytesPerFrame(),
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+	}
+}
+
+StreamedSimulation::~StreamedSimulation()
+{
+	context.device.waitIdle();
+
+	for (DeviceBuffer& buffer : instances)
+		destroyDeviceBuffer(context, buffer);
+}
+
+std::array<vk::Buffer, MAX_FRAMES_IN_FLIGHT> StreamedSimulation::getInstanceBuffers() const
+{
+	std::array<vk::Buffer, MAX_FRAMES_IN_FLIGHT> buffers;
+	for (size_t i = 0; i < buffers.size(); i++)
+		buffers[i] = instances[i].buffer;
+	return buffers;
+}
+
+void StreamedSimulation::update(uint32_t frame, vk::Fence fence)
+{
+	solver.step();
+
+	this->frame = frame;
+	ring.beginFrame(frame, fence);
+
+	std::span<const Particle> particles = solver.getParticles();
+	staging.resize(particles.size());
+
+	/* Same colors as shaders/particle_instances.slang. */
+	ParticleInstance* out = staging.data();
+	const float radius = particleRadius;
+	parallelFor(particles.size(), 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const float speed = glm::clamp(glm::length(particles[i].velocity) / 2.f, 0.f, 1.f);
+			out[i] = {
+				glm::vec4(particles[i].position, radius),
+				glm::vec4(glm::mix(glm::vec3(0.1f, 0.3f, 0.9f), glm::vec3(0.85f, 0.95f, 1.f), speed), 1.f)
+			};
+		}
+	});
+
+	delta.update(std::as_bytes(std::span(staging)));
+	regions = delta.stage(ring, frame);
+
+	if (surface) {
+		const SphParams& params = solver.getParams();
+		surface->splatParticles(particles, params.smoothingRadius, params.particleSpacing);
+		surface->extract();
+		surfaceMesh->update(surface->getMesh(), frame, fence);
+	}
+}
+
+void StreamedSimulation::enableSurface(const MarchingCubesParams& params, uint32_t maxTriangles)
+{
+	surface = std::make_unique<MarchingCubes>(params);
+	surfaceMesh = std::make_unique<StreamedMesh>(context, maxTriangles, 3 * maxTriangles);
+}
+
+void StreamedSimulation::recordUpload(vk::CommandBuffer commandBuffer)
+{
+	if (surfaceMesh) surfaceMesh->recordUpload(commandBuffer);
+	if (regions.empty()) return;
+
+	commandBuffer.copyBuffer(ring.getBuffer(), instances[frame].buffer, regions);
+
+	vk::MemoryBarrier2 barrier {
+		.srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+		.srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+		.dstStageMask = vk::PipelineStageFlagBits2::eVertexShader,
+		.dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead
+	};
+	commandBuffer.pipelineBarrier2(vk::DependencyInfo { .memoryBarrierCount = 1, .pMemoryBarriers = &barrier });
+}
+
+/* === StreamedShallowWater === */
+
+/* Sizes of ShallowWaterSolver::buildSurfaceMesh(). */
+static uint32_t meshVertexCount(const ShallowWaterParams& params, int stride)
+{
+	const glm::ivec2 count = (params.resolution - 1) / std::max(stride, 1) + 1;
+	return static_cast<uint32_t>(count.x * count.y);
+}
+
+static uint32_t meshIndexCount(const ShallowWaterParams& params, int stride)
+{
+	const glm::ivec2 count = (params.resolution - 1) / std::max(stride, 1) + 1;
+	return static_cast<uint32_t>((count.x - 1) * (count.y - 1) * 6);
+}
+
+StreamedShallowWater::StreamedShallowWater(VkContext& context, const ShallowWaterParams& params, int stride)
+	: solver(params),
+	  stride(std::max(stride, 1)),
+	  mesh(context, meshVertexCount(params, stride), meshIndexCount(params, stride))
+{
+}
+
+void StreamedShallowWater::update(uint32_t frame, vk::Fence fence)
+{
+	solver.step();
+	solver.buildSurfaceMesh(surface, stride);
+	mesh.update(surface, frame, fence);
+}
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "vulkan/vk_sort.hpp"
+#include "vulkan/vk_descriptor.hpp"
+#include "vulkan/vk_command.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include <random>
+
+static constexpr uint32_t GroupSize = 256;
+
+static const char* const scanKernelNames[] = { "scanReduce", "scanBlockSums", "scanDownsweep" };
+static const char* const sortKernelNames[] = { "radixCount", "radixScatter" };
+
+struct ScanConstants {
+	uint32_t count;
+	uint32_t blockCount;
+};
+
+struct SortConstants {
+	uint32_t count;
+	uint32_t shift;
+	uint32_t blockCount;
+};
+
+static uint32_t divideRoundUp(uint32_t value, uint32_t divisor)
+{
+	return (value + divisor - 1) / divisor;
+}
+
+/* === GpuScan === */
+
+GpuScan::GpuScan(VkContext& context, const DeviceBuffer& data, uint32_t maxCount)
+	: context(context), maxCount(maxCount)
+{
+	kernels = createComputeKernels(context, "./../shaders/scan.spv", scanKernelNames, 2, sizeof(ScanConstants));
+
+	blockSums = createDeviceBuffer(context,
+		std::max(divideRoundUp(maxCount, BlockSize), 1u) * sizeof(uint32_t),
+		vk::BufferUsageFlagBits::eStorageBuffer);
+
+	descriptorPool = createStorageBufferPool(context, 1, 2);
+	descriptorSet = allocateDescriptorSet(context, descriptorPool, kernels.setLayout);
+	writeStorageBufferSet(context, descriptorSet, { data.buffer, blockSums.buffer });
+}
+
+GpuScan::~GpuScan()
+{
+	context.device.destroyDescriptorPool(descriptorPool);
+	destroyDeviceBuffer(context, blockSums);
+	destroyComputeKernels(context, kernels);
+}
+
+void GpuScan::record(vk::CommandBuffer commandBuffer, uint32_t count)
+{
+	if (count > maxCount)
+		throw std::invalid_argument("GpuScan count exceeds the planned size!");
+	if (count == 0) return;
+
+	ScanConstants constants { count, divideRoundUp(count, BlockSize) };
+
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, kernels.layout, 0, 1, &descriptorSet, 0, nullptr);
+	commandBuffer.pushConstants(kernels.layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, kernels.pipelines[0]);
+	commandBuffer.dispatch(constants.blockCount, 1, 1);
+	computeBarrier(commandBuffer);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, kernels.pipelines[1]);
+	commandBuffer.dispatch(1, 1, 1);
+	computeBarrier(commandBuffer);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, kernels.pipelines[2]);
+	commandBuffer.dispatch(constants.blockCount, 1, 1);
+	computeBarrier(commandBuffer);
+}
+
+/* === GpuRadixSort === */
+
+GpuRadixSort::GpuRadixSort(VkContext& context, const DeviceBuffer& keys, const DeviceBuffer& values, uint32_t maxCount)
+	: context(context), maxCount(maxCount)
+{
+	kernels = createComputeKernels(context, "./../shaders/radix_sort.spv", sortKernelNames, 5, sizeof(SortConstants));
+
+	const vk::DeviceSize elements = std::max(maxCount, 1u);
+	const uint32_t histogramSize = (1u << RadixBits) * std::max(divideRoundUp(maxCount, BlockSize), 1u);
+	scratchKeys = createDeviceBuffer(context, elements * sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer);
+	scratchValues = createDeviceBuffer(context, elements * sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer);
+	histograms = createDeviceBuffer(context, histogramSize * sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer);
+	histogramScan = std::make_unique<GpuScan>(context, histograms, histogramSize);
+
+	descriptorPool = createStorageBufferPool(context, 2, 10);
+	for (vk::DescriptorSet& set : descriptorSets)
+		set = allocateDescriptorSet(context, descriptorPool, kernels.setLayout);
+
+	writeStorageBufferSet(context, descriptorSets[0],
+		{ keys.buffer, values.buffer, scratchKeys.buffer, scratchValues.buffer, histograms.buffer });
+	writeStorageBufferSet(context, descriptorSets[1],
+		{ scratchKeys.buffer, scratchValues.buffer, keys.buffer, values.buffer, histograms.buffer });
+}
+
+GpuRadixSort::~GpuRadixSort()
+{
+	histogramScan.reset();
+	context.device.destroyDescriptorPool(descriptorPool);
+	destroyDeviceBuffer(context, scratchKeys);
+	destroyDeviceBuffer(context, scratchValues);
+	destroyDeviceBuffer(context, histograms);
+	destroyComputeKernels(context, kernels);
+}
+
+void GpuRadixSort::record(vk::CommandBuffer commandBuffer, uint32_t count, uint32_t keyBits)
+{
+	if (count > maxCount)
+		throw std::invalid_argument("GpuRadixSort count exceeds the planned size!");
+	if (count == 0) return;
+
+	/* An even number of passes leaves the result in the caller's buffers, the extra pass sees only zero digits. */
+	uint32_t passes = divideRoundUp(std::clamp(keyBits, 1u, 32u), RadixBits);
+	passes += passes % 2;
+
+	const uint32_t blockCount = divideRoundUp(count, BlockSize);
+	for (uint32_t pass = 0; pass < passes; pass++) {
+		SortConstants constants { count, pass * RadixBits, blockCount };
+		vk::DescriptorSet set = descriptorSets[pass % 2];
+
+		/* GpuScan binds its own layout, so both dispatches rebind. */
+		for (uint32_t kernel = 0; kernel < 2; kernel++) {
+			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, kernels.layout, 0, 1, &set, 0, nullptr);
+			commandBuffer.pushConstants(kernels.layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+			commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, kernels.pipelines[kernel]);
+			commandBuffer.dispatch(blockCount, 1, 1);
+			computeBarrier(commandBuffer);
+
+			if (kernel == 0) histogramScan->record(commandBuffer, (1u << RadixBits) * blockCount);
+		}
+	}
+}
+
+/* === Check === */
+
+GpuSortCheckResult checkGpuSort(VkContext& context, size_t count, uint32_t repeats)
+{
+	std::mt19937 rng(7);
+	std::vector<uint32_t> keys(count), values(count), scanInput(count);
+	for (size_t i = 0; i < count; i++) {
+		keys[i] = rng();
+		values[i] = static_cast<uint32_t>(i);
+		scanInput[i] = rng() % 16;
+	}
+
+	const vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eStorageBuffer
+		| vk::BufferUsageFlagBits::eTransferSrc
+		| vk::BufferUsageFlagBits::eTransferDst;
+	const vk::DeviceSize bytes = std::max<size_t>(count, 1) * sizeof(uint32_t);
+	DeviceBuffer keyBuffer = createDeviceBuffer(context, bytes, usage);
+	DeviceBuffer valueBuffer = createDeviceBuffer(context, bytes, usage);
+	DeviceBuffer scanBuffer = createDeviceBuffer(context, bytes, usage);
+
+	GpuSortCheckResult result;
+	result.count = count;
+	const uint32_t n = static_cast<uint32_t>(count);
+	repeats = std::max(repeats, 1u);
+
+	{
+		GpuRadixSort sort(context, keyBuffer, valueBuffer, n);
+		GpuScan scan(context, scanBuffer, n);
+
+		auto run = [&](auto&& recordFn) {
+			vk::CommandBuffer commandBuffer = beginSingleTimeCommands(context);
+			recordFn(commandBuffer);
+			auto start = std::chrono::steady_clock::now();
+			endSingleTimeCommands(context, commandBuffer);
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		};
+
+		/* Correctness on one run each. */
+		uploadToBuffer(context, keyBuffer, keys.data(), bytes);
+		uploadToBuffer(context, valueBuffer, values.data(), bytes);
+		uploadToBuffer(context, scanBuffer, scanInput.data(), bytes);
+		run([&](vk::CommandBuffer commandBuffer) { sort.record(commandBuffer, n); });
+		run([&](vk::CommandBuffer commandBuffer) { scan.record(commandBuffer, n); });
+
+		std::vector<uint32_t> sortedKeys(count), sortedValues(count), scanned(count);
+		downloadFromBuffer(context, keyBuffer, sortedKeys.data(), bytes);
+		downloadFromBuffer(context, valueBuffer, sortedValues.data(), bytes);
+		downloadFromBuffer(context, scanBuffer, scanned.data(), bytes);
+
+		std::vector<uint32_t> order(count);
+		std::iota(order.begin(), order.end(), 0u);
+		auto cpuStart = std::chrono::steady_clock::now();
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+		result.cpuSortMs = 1000.0 * std::chrono::duration<double>(std::chrono::steady_clock::now() - cpuStart).count();
+
+		std::vector<uint32_t> expectedScan(count);
+		std::exclusive_scan(scanInput.begin(), scanInput.end(), expectedScan.begin(), 0u);
+
+		result.sortCorrect = sortedValues == order;
+		for (size_t i = 0; result.sortCorrect && i < count; i++)
+			result.sortCorrect = sortedKeys[i] == keys[order[i]];
+		result.scanCorrect = scanned == expectedScan;
+
+		/* Throughput, repeated runs in one submission. */
+		double sortSeconds = run([&](vk::CommandBuffer commandBuffer) {
+			for (uint32_t r = 0; r < repeats; r++) sort.record(commandBuffer, n);
+		});
+		double scanSeconds = run([&](vk::CommandBuffer commandBuffer) {
+			for (uint32_t r = 0; r < repeats; r++) scan.record(commandBuffer, n);
+		});
+
+		result.sortMsPerRun = 1000.0 * sortSeconds / repeats;
+		result.scanMsPerRun = 1000.0 * scanSeconds / repeats;
+		result.sortMkeysPerSecond = count * repeats / sortSeconds * 1e-6;
+		result.scanMelementsPerSecond = count * repeats / scanSeconds * 1e-6;
+	}
+
+	destroyDeviceBuffer(context, keyBuffer);
+	destroyDeviceBuffer(context, valueBuffer);
+	destroyDeviceBuffer(context, scanBuffer);
+	return result;
+}
+
+void printGpuSortCheck(const GpuSortCheckResult& result, std::ostream& out)
+{
+	out << result.count << " elements\n"
+		<< std::fixed << std::setprecision(3)
+		<< "radix sort " << (result.sortCorrect ? "correct" : "WRONG") << ", " << result.sortMsPerRun << " ms, "
+		<< std::setprecision(1) << result.sortMkeysPerSecond << " Mkeys/s (std::stable_sort "
+		<< std::setprecision(3) << result.cpuSortMs << " ms)\n"
+		<< "scan       " << (result.scanCorrect ? "correct" : "WRONG") << ", " << result.scanMsPerRun << " ms, "
+		<< std::setprecision(1) << result.scanMelementsPerSecond << " Melements/s\n"
+		<< std::defaultfloat;
+}
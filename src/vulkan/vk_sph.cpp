@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "vulkan/vk_sph.hpp"
+#include "vulkan/vk_pipeline.hpp"
+#include "vulkan/vk_descriptor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+static constexpr uint32_t GroupSize = 256;
+
+static const char* const kernelNames[] = {
+	"clearCells", "binParticles", "scatterParticles", "computeDensity", "computeForces", "integrate"
+};
+
+GpuSphSolver::GpuSphSolver(VkContext& context, const SphParams& params)
+	: context(context), params(params)
+{
+	if (params.smoothingRadius <= 0.f)
+		throw std::invalid_argument("GpuSphSolver smoothing radius must be positive!");
+
+	/* Same cell layout as the dense NeighborGrid of the CPU solver. */
+	const float invCellSize = 1.f / params.smoothingRadius;
+	gridDims = glm::uvec3(glm::max(glm::ivec3(glm::ceil((params.boundsMax - params.boundsMin) * invCellSize)), glm::ivec3(1)));
+	cellTotal = gridDims.x * gridDims.y * gridDims.z;
+
+	constants.boundsMin = glm::vec4(params.boundsMin, invCellSize);
+	constants.boundsMax = glm::vec4(params.boundsMax, params.boundaryDamping);
+	constants.kernel = glm::vec4(params.smoothingRadius, params.particleMass(), params.timeStep, 0.f);
+	constants.material = glm::vec4(params.restDensity, params.stiffness, params.viscosity, 0.f);
+	constants.gravity = glm::vec4(params.gravity, 0.f);
+	constants.grid = glm::uvec4(gridDims, 0u);
+
+	kernels = createComputeKernels(context, "./../shaders/sph.spv", kernelNames, BufferCount, sizeof(Constants));
+	descriptorPool = createStorageBufferPool(context, 1, BufferCount);
+	descriptorSet = allocateDescriptorSet(context, descriptorPool, kernels.setLayout);
+
+	vk::CommandBufferAllocateInfo commandInfo {
+		.commandPool = context.computeCommandPool,
+		.level = vk::CommandBufferLevel::ePrimary,
+		.commandBufferCount = 1
+	};
+	commandBuffer = context.device.allocateCommandBuffers(commandInfo).front();
+	fence = context.device.createFence({});
+
+	createBuffers();
+}
+
+GpuSphSolver::~GpuSphSolver()
+{
+	context.device.waitIdle();
+
+	destroyBuffers();
+	context.device.destroyFence(fence);
+	context.device.freeCommandBuffers(context.computeCommandPool, commandBuffer);
+
+	context.device.destroyDescriptorPool(descriptorPool);
+	destroyComputeKernels(context, kernels);
+}
+
+void GpuSphSolver::createBuffers()
+{
+	/* Empty buffers are invalid, keep room for at least one particle. */
+	const vk::DeviceSize particles = std::max(particleCount, 1u);
+	const vk::DeviceSize sizes[BufferCount] = {
+		particles * sizeof(glm::vec4),          // Positions
+		particles * sizeof(glm::vec4),          // Velocities
+		particles * sizeof(glm::vec4),          // Forces
+		particles * sizeof(glm::vec2),          // DensityPressure
+		particles * sizeof(uint32_t),           // ParticleCell
+		particles * sizeof(uint32_t),           // CellOffset
+		(cellTotal + 1) * sizeof(uint32_t),     // CellStart
+		particles * sizeof(uint32_t)            // SortedIndices
+	};
+
+	const vk::BufferUsageFlags storage = vk::BufferUsageFlagBits::eStorageBuffer
+		| vk::BufferUsageFlagBits::eTransferSrc
+		| vk::BufferUsageFlagBits::eTransferDst;
+
+	std::vector<vk::Buffer> handles;
+	for (uint32_t slot = 0; slot < BufferCount; slot++) {
+		vk::BufferUsageFlags usage = storage;
+		if (slot == Positions) usage |= vk::BufferUsageFlagBits::eVertexBuffer;
+
+		buffers[slot] = createDeviceBuffer(context, sizes[slot], usage);
+		handles.push_back(buffers[slot].buffer);
+	}
+
+	writeStorageBufferSet(context, descriptorSet, handles);
+
+	/* The extra last entry is zero, so the scan leaves the particle count there. */
+	cellScan = std::make_unique<GpuScan>(context, buffers[CellStart], cellTotal + 1);
+}
+
+void GpuSphSolver::destroyBuffers()
+{
+	cellScan.reset();
+	for (DeviceBuffer& buffer : buffers)
+		destroyDeviceBuffer(context, buffer);
+}
+
+void GpuSphSolver::setParticles(std::span<const Particle> particles)
+{
+	context.device.waitIdle();
+
+	if (particles.size() != particleCount) {
+		destroyBuffers();
+		particleCount = static_cast<uint32_t>(particles.size());
+		constants.grid.w = particleCount;
+		createBuffers();
+	}
+
+	std::vector<glm::vec4> positions(particles.size());
+	std::vector<glm::vec4> velocities(particles.size());
+	for (size_t i = 0; i < particles.size(); i++) {
+		positions[i] = glm::vec4(particles[i].position, 1.f);
+		velocities[i] = glm::vec4(particles[i].velocity, 0.f);
+	}
+
+	uploadToBuffer(context, buffers[Positions], positions.data(), positions.size() * sizeof(glm::vec4));
+	uploadToBuffer(context, buffers[Velocities], velocities.data(), velocities.size() * sizeof(glm::vec4));
+}
+
+std::vector<Particle> GpuSphSolver::downloadParticles()
+{
+	context.device.waitIdle();
+
+	std::vector<glm::vec4> positions(particleCount), velocities(particleCount), forces(particleCount);
+	std::vector<glm::vec2> densityPressure(particleCount);
+	downloadFromBuffer(context, buffers[Positions], positions.data(), positions.size() * sizeof(glm::vec4));
+	downloadFromBuffer(context, buffers[Velocities], velocities.data(), velocities.size() * sizeof(glm::vec4));
+	downloadFromBuffer(context, buffers[Forces], forces.data(), forces.size() * sizeof(glm::vec4));
+	downloadFromBuffer(context, buffers[DensityPressure], densityPressure.data(), densityPressure.size() * sizeof(glm::vec2));
+
+	std::vector<Particle> particles(particleCount);
+	for (uint32_t i = 0; i < particleCount; i++) {
+		particles[i].position = glm::vec3(positions[i]);
+		particles[i].velocity = glm::vec3(velocities[i]);
+		particles[i].force = glm::vec3(forces[i]);
+		particles[i].density = densityPressure[i].x;
+		particles[i].pressure = densityPressure[i].y;
+	}
+	return particles;
+}
+
+void GpuSphSolver::dispatch(vk::CommandBuffer commandBuffer, KernelSlot kernel, uint32_t threads)
+{
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, kernels.layout, 0, 1, &descriptorSet, 0, nullptr);
+	commandBuffer.pushConstants(kernels.layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(Constants), &constants);
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, kernels.pipelines[kernel]);
+	commandBuffer.dispatch((threads + GroupSize - 1) / GroupSize, 1, 1);
+	computeBarrier(commandBuffer);
+}
+
+void GpuSphSolver::record(vk::CommandBuffer commandBuffer)
+{
+	if (particleCount == 0) return;
+
+	dispatch(commandBuffer, ClearCells, cellTotal + 1);
+	dispatch(commandBuffer, BinParticles, particleCount);
+	cellScan->record(commandBuffer, cellTotal + 1);
+	dispatch(commandBuffer, ScatterParticles, particleCount);
+	dispatch(commandBuffer, ComputeDensity, particleCount);
+	dispatch(commandBuffer, ComputeForces, particleCount);
+	dispatch(commandBuffer, Integrate, particleCount);
+}
+
+void GpuSphSolver::step()
+{
+	commandBuffer.reset();
+	commandBuffer.begin(vk::CommandBufferBeginInfo { .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+	record(commandBuffer);
+	commandBuffer.end();
+
+	vk::SubmitInfo submitInfo {
+		.commandBufferCount = 1,
+		.pCommandBuffers = &commandBuffer
+	};
+	context.computeQueue.submit(submitInfo, fence);
+
+	if (context.device.waitForFences(fence, true, UINT64_MAX) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to wait for the SPH step!");
+	context.device.resetFences(fence);
+}
+
+GpuSphCheckResult checkGpuSph(VkContext& context, size_t particleCount, uint32_t steps, double tolerance)
+{
+	/* Same dam break as runSolverBenchmark(). */
+	const float blockSize = 0.5f;
+	const int perAxis = std::max(2, static_cast<int>(std::round(std::cbrt(static_cast<double>(particleCount)))));
+	const float spacing = blockSize / perAxis;
+
+	SphParams params;
+	params.particleSpacing = spacing;
+	params.smoothingRadius = 2.f * spacing;
+	params.timeStep = 0.002f * spacing / 0.05f;
+	params.sleep.enabled = false;
+
+	std::vector<Particle> initial = initParticles(glm::vec3(0.f), glm::vec3(blockSize - 0.5f * spacing), spacing);
+
+	SphSolver cpu(params);
+	cpu.addParticles(initial);
+	GpuSphSolver gpu(context, params);
+	gpu.setParticles(initial);
+
+	GpuSphCheckResult result;
+	result.particles = initial.size();
+	result.steps = steps;
+
+	double cpuSeconds = 0.0, gpuSeconds = 0.0;
+	for (uint32_t s = 0; s < steps; s++) {
+		auto start = std::chrono::steady_clock::now();
+		cpu.step();
+		auto middle = std::chrono::steady_clock::now();
+		gpu.step();
+		auto end = std::chrono::steady_clock::now();
+		cpuSeconds += std::chrono::duration<double>(middle - start).count();
+		gpuSeconds += std::chrono::duration<double>(end - middle).count();
+
+		std::vector<Particle> device = gpu.downloadParticles();
+		std::span<const Particle> host = cpu.getParticles();
+		for (size_t i = 0; i < host.size(); i++) {
+			result.maxPositionError = std::max(result.maxPositionError,
+				static_cast<double>(glm::length(host[i].position - device[i].position)) / spacing);
+			result.maxDensityError = std::max(result.maxDensityError,
+				static_cast<double>(std::abs(host[i].density - device[i].density)) / params.restDensity);
+		}
+	}
+
+	result.cpuMsPerStep = 1000.0 * cpuSeconds / std::max(steps, 1u);
+	result.gpuMsPerStep = 1000.0 * gpuSeconds / std::max(steps, 1u);
+	result.passed = result.maxPositionError < tolerance && result.maxDensityError < tolerance;
+	return result;
+}
+
+void printGpuSphCheck(const GpuSphCheckResult& result, std::ostream& out)
+{
+	out << result.particles << " particles, " << result.steps << " steps\n"
+		<< std::fixed << std::setprecision(3)
+		<< "CPU " << result.cpuMsPerStep << " ms/step, GPU " << result.gpuMsPerStep << " ms/step\n"
+		<< std::scientific << std::setprecision(2)
+		<< "max position error " << result.maxPositionError << " spacings, max density error "
+		<< result.maxDensityError << " rest densities\n"
+		<< (result.passed ? "PASSED" : "FAILED") << '\n'
+		<< std::defaultfloat;
+}
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2025 Johannes Elsing
+ *
+ * Licensed under the Creative Commons Attribution-NonCommercial 4.0 International License.
+ * You may not use this work for commercial purposes.
+ * You must give appropriate credit and indicate if changes were made.
+ * Full license: https://creativecommons.org/licenses/by-nc/4.0/legalcode
+ */
+
+#include "vulkan/vk_stream.hpp"
+#include "vulkan/vk_buffer.hpp"
+#include "vulkan/vk_simulation.hpp"
+#include "fluid/parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+StreamingBuffer::StreamingBuffer(VkContext& context, vk::DeviceSize bytesPerFrame, uint32_t frameCount)
+	: context(context), bytesPerFrame(bytesPerFrame), frameCount(std::clamp<uint32_t>(frameCount, 1, MAX_FRAMES_IN_FLIGHT))
+{
+	createBuffer(context,
+		std::max<vk::DeviceSize>(bytesPerFrame, 1) * this->frameCount,
+		vk::BufferUsageFlagBits::eTransferSrc,
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+		buffer,
+		memory);
+	mapped = static_cast<std::byte*>(context.device.mapMemory(memory, 0, vk::WholeSize));
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+	context.device.unmapMemory(memory);
+	context.device.destroyBuffer(buffer);
+	context.device.freeMemory(memory);
+}
+
+void StreamingBuffer::beginFrame(uint32_t frame, vk::Fence fence)
+{
+	current = frame % frameCount;
+	if (fences[current] && context.device.waitForFences(fences[current], true, UINT64_MAX) != vk::Result::eSuccess)
+		throw std::runtime_error("Failed to wait for the streaming buffer!");
+
+	fences[current] = fence;
+	head = 0;
+}
+
+StreamingBuffer::Allocation StreamingBuffer::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+	const vk::DeviceSize offset = (head + alignment - 1) / alignment * alignment;
+	if (offset + size > bytesPerFrame)
+		throw std::runtime_error("StreamingBuffer frame is full!");
+
+	head = offset + size;
+	const vk::DeviceSize base = current * bytesPerFrame + offset;
+	return { buffer, base, size, mapped + base };
+}
+
+DeltaUpload::DeltaUpload(size_t blockBytes, uint32_t targetCount)
+	: blockBytes(std::max<size_t>(blockBytes, 1)), targetVersions(std::max(targetCount, 1u), 0)
+{
+}
+
+void DeltaUpload::update(std::span<const std::byte> data)
+{
+	version++;
+	const size_t blockCount = (data.size() + blockBytes - 1) / blockBytes;
+
+	if (data.size() != shadow.size()) {
+		shadow.assign(data.begin(), data.end());
+		blockVersions.assign(blockCount, version);
+		return;
+	}
+
+	parallelFor(blockCount, 64, [&](size_t begin, size_t end) {
+		for (size_t block = begin; block < end; block++) {
+			const size_t offset = block * blockBytes;
+			const size_t bytes = std::min(blockBytes, data.size() - offset);
+			if (std::memcmp(shadow.data() + offset, data.data() + offset, bytes) == 0) continue;
+
+			std::memcpy(shadow.data() + offset, data.data() + offset, bytes);
+			blockVersions[block] = version;
+		}
+	});
+}
+
+std::span<const vk::BufferCopy> DeltaUpload::stage(StreamingBuffer& ring, uint32_t target)
+{
+	regions.clear();
+	stagedBytes = 0;
+
+	uint64_t& staged = targetVersions[target % targetVersions.size()];
+	for (size_t block = 0; block < blockVersions.size();) {
+		if (blockVersions[block] <= staged) {
+			block++;
+			continue;
+		}
+
+		/* Run of blocks the target lacks, one region. */
+		size_t end = block + 1;
+		while (end < blockVersions.size() && blockVersions[end] > staged) end++;
+
+		const size_t offset = block * blockBytes;
+		const size_t bytes = std::min(end * blockBytes, shadow.size()) - offset;
+		StreamingBuffer::Allocation upload = ring.allocate(bytes);
+		std::memcpy(upload.data, shadow.data() + offset, bytes);
+
+		regions.push_back(vk::BufferCopy(upload.offset, offset, bytes));
+		stagedBytes += bytes;
+		block = end;
+	}
+
+	staged = version;
+	return regions;
+}
+
+StreamingBenchmarkResult runStreamingBenchmark(VkContext& context, size_t particles, uint32_t frames)
+{
+	StreamingBenchmarkResult result;
+	result.particles = particles;
+	result.frames = frames = std::max(frames, 1u);
+
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	std::vector<ParticleInstance> source(std::max<size_t>(particles, 1));
+	for (ParticleInstance& instance : source)
+		instance = { glm::vec4(unit(rng), unit(rng), unit(rng), 0.005f), glm::vec4(0.1f, 0.3f, 0.9f, 1.f) };
+
+	const vk::DeviceSize bytes = source.size() * sizeof(ParticleInstance);
+	DeviceBuffer target = createDeviceBuffer(context, bytes,
+		vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t f = 0; f < frames; f++)
+		uploadToBuffer(context, target, source.data(), bytes);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.stagingMs = 1000.0 * seconds / frames;
+	result.stagingGBs = bytes * frames / seconds * 1e-9;
+
+	{
+		StreamingBuffer ring(context, bytes);
+
+		std::array<vk::Fence, MAX_FRAMES_IN_FLIGHT> fences;
+		for (vk::Fence& fence : fences)
+			fence = context.device.createFence({});
+		std::vector<vk::CommandBuffer> commandBuffers = context.device.allocateCommandBuffers({
+			.commandPool = context.commandPool,
+			.level = vk::CommandBufferLevel::ePrimary,
+			.commandBufferCount = MAX_FRAMES_IN_FLIGHT
+		});
+
+		start = std::chrono::steady_clock::now();
+		for (uint32_t f = 0; f < frames; f++) {
+			const uint32_t frame = f % MAX_FRAMES_IN_FLIGHT;
+			ring.beginFrame(frame, fences[frame]);
+			context.device.resetFences(fences[frame]);
+
+			StreamingBuffer::Allocation upload = ring.allocate(bytes);
+			std::memcpy(upload.data, source.data(), bytes);
+
+			vk::CommandBuffer commandBuffer = commandBuffers[frame];
+			commandBuffer.reset();
+			commandBuffer.begin(vk::CommandBufferBeginInfo { .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+			/* Every frame copies into the one target here, a renderer has a target per frame in flight. */
+			vk::MemoryBarrier2 barrier {
+				.srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+				.srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+				.dstStageMask = vk::PipelineStageFlagBits2::eCopy,
+				.dstAccessMask = vk::AccessFlagBits2::eTransferWrite
+			};
+			commandBuffer.pipelineBarrier2(vk::DependencyInfo { .memoryBarrierCount = 1, .pMemoryBarriers = &barrier });
+			commandBuffer.copyBuffer(upload.buffer, target.buffer, vk::BufferCopy(upload.offset, 0, bytes));
+			commandBuffer.end();
+
+			context.graphicsQueue.submit(vk::SubmitInfo { .commandBufferCount = 1, .pCommandBuffers = &commandBuffer }, fences[frame]);
+		}
+		if (context.device.waitForFences(fences, true, UINT64_MAX) != vk::Result::eSuccess)
+			throw std::runtime_error("Failed to wait for the streaming benchmark!");
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		result.streamingMs = 1000.0 * seconds / frames;
+		result.streamingGBs = bytes * frames / seconds * 1e-9;
+
+		context.device.freeCommandBuffers(context.commandPool, commandBuffers);
+		for (vk::Fence fence : fences)
+			context.device.destroyFence(fence);
+	}
+
+	destroyDeviceBuffer(context, target);
+	return result;
+}
+
+void printStreamingBenchmark(const StreamingBenchmarkResult& result, std::ostream& out)
+{
+	out << result.particles << " particles, " << result.particles * sizeof(ParticleInstance) / (1024.0 * 1024.0)
+		<< " MiB per frame, " << result.frames << " frames\n"
+		<< std::fixed << std::setprecision(3)
+		<< "staging buffer per upload " << result.stagingMs << " ms/frame, " << result.stagingGBs << " GB/s\n"
+		<< "streaming ring            " << result.streamingMs << " ms/frame, " << result.streamingGBs << " GB/s\n"
+		<< std::defaultfloat;
+}
+
+DeltaUploadBenchmarkResult runDeltaUploadBenchmark(VkContext& context, size_t particles, uint32_t frames)
+{
+	constexpr size_t BlockParticles = 256;
+	constexpr size_t Runs = 8; // changed runs per frame, one in each eighth of the particles
+
+	DeltaUploadBenchmarkResult result;
+	result.particles = particles;
+	result.frames = frames = std::max(frames, 1u);
+	result.blockBytes = BlockParticles * sizeof(ParticleInstance);
+
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	std::vector<ParticleInstance> instances(std::max<size_t>(particles, 1));
+	for (ParticleInstance& instance : instances)
+		instance = { glm::vec4(unit(rng), unit(rng), unit(rng), 0.005f), glm::vec4(0.1f, 0.3f, 0.9f, 1.f) };
+
+	const vk::DeviceSize bytes = instances.size() * sizeof(ParticleInstance);
+	const size_t segment = (instances.size() + Runs - 1) / Runs;
+
+	std::array<DeviceBuffer, MAX_FRAMES_IN_FLIGHT> targets;
+	for (DeviceBuffer& target : targets) {
+		target = createDeviceBuffer(context, bytes,
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+	}
+	std::array<vk::Fence, MAX_FRAMES_IN_FLIGHT> fences;
+	for (vk::Fence& fence : fences)
+		fence = context.device.createFence({});
+	std::vector<vk::CommandBuffer> commandBuffers = context.device.allocateCommandBuffers({
+		.commandPool = context.commandPool,
+		.level = vk::CommandBufferLevel::ePrimary,
+		.commandBufferCount = MAX_FRAMES_IN_FLIGHT
+	});
+
+	for (float fraction : { 0.f, 0.01f, 0.1f, 0.5f, 1.f }) {
+		StreamingBuffer ring(context, bytes);
+		DeltaUpload delta(result.blockBytes);
+		const size_t runLength = static_cast<size_t>(fraction * segment);
+
+		DeltaUploadBenchmarkResult::Row row;
+		row.changedFraction = fraction;
+
+		/* The first frame of every target uploads everything and is not measured. */
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t f = 0; f < frames + MAX_FRAMES_IN_FLIGHT; f++) {
+			if (f == MAX_FRAMES_IN_FLIGHT) start = std::chrono::steady_clock::now();
+
+			const uint32_t frame = f % MAX_FRAMES_IN_FLIGHT;
+			ring.beginFrame(frame, fences[frame]);
+			context.device.resetFences(fences[frame]);
+
+			for (size_t first = 0; first < instances.size() && runLength > 0; first += segment) {
+				const size_t offset = first + std::uniform_int_distribution<size_t>(0, segment - runLength)(rng);
+				const size_t end = std::min(offset + runLength, instances.size());
+				for (size_t i = offset; i < end; i++)
+					instances[i].positionRadius.y = unit(rng);
+			}
+
+			delta.update(std::as_bytes(std::span(instances)));
+			std::span<const vk::BufferCopy> regions = delta.stage(ring, frame);
+			if (f >= MAX_FRAMES_IN_FLIGHT) {
+				row.bytesPerFrame += static_cast<double>(delta.getStagedBytes());
+				row.regionsPerFrame += static_cast<double>(regions.size());
+			}
+
+			vk::CommandBuffer commandBuffer = commandBuffers[frame];
+			commandBuffer.reset();
+			commandBuffer.begin(vk::CommandBufferBeginInfo { .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+			if (!regions.empty())
+				commandBuffer.copyBuffer(ring.getBuffer(), targets[frame].buffer, regions);
+			commandBuffer.end();
+
+			context.graphicsQueue.submit(vk::SubmitInfo { .commandBufferCount = 1, .pCommandBuffers = &commandBuffer }, fences[frame]);
+		}
+		if (context.device.waitForFences(fences, true, UINT64_MAX) != vk::Result::eSuccess)
+			throw std::runtime_error("Failed to wait for the delta upload benchmark!");
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		row.ms = 1000.0 * seconds / frames;
+		row.bytesPerFrame /= frames;
+		row.regionsPerFrame /= frames;
+		result.rows.push_back(row);
+	}
+
+	context.device.freeCommandBuffers(context.commandPool, commandBuffers);
+	for (vk::Fence fence : fences)
+		context.device.destroyFence(fence);
+	for (DeviceBuffer& target : targets)
+		destroyDeviceBuffer(context, target);
+	return result;
+}
+
+void printDeltaUploadBenchmark(const DeltaUploadBenchmarkResult& result, std::ostream& out)
+{
+	out << result.particles << " particles, " << result.particles * sizeof(ParticleInstance) / (1024.0 * 1024.0)
+		<< " MiB in full, blocks of " << result.blockBytes << " bytes, " << result.frames << " frames\n"
+		<< std::fixed << std::setprecision(3);
+	for (const DeltaUploadBenchmarkResult::Row& row : result.rows) {
+		out << "changed " << std::setw(6) << 100.f * row.changedFraction << "%  "
+			<< row.bytesPerFrame / (1024.0 * 1024.0) << " MiB/frame, "
+			<< row.regionsPerFrame << " regions/frame, " << row.ms << " ms/frame\n";
+	}
+	out << std::defaultfloat;
+}
@@ -14,6 +14,7 @@
 
 #include "vulkan/vk_swapchain.hpp"
 #include <vulkan/vk_image.hpp>
+#include "vulkan/vk_screen_fluid.hpp"
 
 void createSwapChain(VkContext& context)
 {
@@ -89,6 +90,8 @@ void recreateSwapChain(VkContext& context)
 	createSwapChain(context);
 	createImageViews(context);
 	createDepthResources(context);
+
+	if (context.screenSpaceFluid) context.screenSpaceFluid->resize();
 }
 
 void cleanupSwapchain(VkContext& context)